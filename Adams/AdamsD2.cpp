@@ -85,7 +85,119 @@ uint32_t BinomMod4(uint32_t n, uint32_t m)
     return 0;
 }
 
-void MulMilnorMod4(const std::array<uint32_t, XI_MAX>& R, const std::array<uint32_t, XI_MAX>& S, std::vector<uint64_t>& result_app, uint64_t v_raw_shifted)
+/* Binomial coefficients modulo 4 for 0 <= m <= n < BINOM_MOD4_N.
+ *
+ * By Kummer's theorem C(n, m) is odd iff m is a bit-subset of n and
+ * C(n, m) = 2 mod 4 iff there is exactly one carry when adding m and n-m.
+ * In the odd case the sign is a product of local factors over adjacent pairs of bits, as in Lucas' theorem.
+ * The table stores 2 bits per entry in the triangle m <= n.
+ */
+inline constexpr uint32_t BINOM_MOD4_N = 512;
+class BinomMod4Table
+{
+private:
+    std::vector<uint8_t> data_;
+
+public:
+    BinomMod4Table() : data_((BINOM_MOD4_N * (BINOM_MOD4_N + 1) / 2 + 3) / 4, 0)
+    {
+        for (uint32_t n = 0; n < BINOM_MOD4_N; ++n)
+            for (uint32_t m = 0; m <= n; ++m) {
+                size_t k = n * (n + 1) / 2 + m;
+                data_[k >> 2] |= uint8_t(BinomMod4(n, m) << ((k & 3) << 1));
+            }
+    }
+
+    uint32_t operator()(uint32_t n, uint32_t m) const
+    {
+        if (m > n)
+            return 0;
+        if (n >= BINOM_MOD4_N)
+            return BinomMod4(n, m);
+        size_t k = n * (n + 1) / 2 + m;
+        return (data_[k >> 2] >> ((k & 3) << 1)) & 3;
+    }
+};
+const BinomMod4Table BINOM_MOD4_TABLE;
+
+/**
+ * Accumulate terms `(m << 2) | c` with coefficients c in Z/4 in an open addressing hash table.
+ * This replaces sorting the whole sequence by `SortMod4()`.
+ */
+class AccMod4
+{
+private:
+    static constexpr uint64_t EMPTY = MMILNOR_NULL; /* A key never has the lowest two bits set */
+    std::vector<uint64_t> keys_;
+    std::vector<uint8_t> coeffs_;
+    std::vector<uint32_t> used_; /* Occupied slots in the order of insertion */
+    int bits_ = 0;
+
+    size_t slot(uint64_t key) const
+    {
+        return size_t((key * 0x9e3779b97f4a7c15ULL) >> (64 - bits_));
+    }
+
+    void rehash(int bits)
+    {
+        std::vector<uint64_t> keys(size_t(1) << bits, EMPTY);
+        std::vector<uint8_t> coeffs(size_t(1) << bits, 0);
+        std::swap(keys_, keys);
+        std::swap(coeffs_, coeffs);
+        bits_ = bits;
+        const size_t mask = keys_.size() - 1;
+        for (auto& i_old : used_) {
+            size_t i = slot(keys[i_old]);
+            while (keys_[i] != EMPTY)
+                i = (i + 1) & mask;
+            keys_[i] = keys[i_old];
+            coeffs_[i] = coeffs[i_old];
+            i_old = (uint32_t)i;
+        }
+    }
+
+public:
+    AccMod4()
+    {
+        rehash(10);
+    }
+
+    void add(uint64_t x)
+    {
+        const uint64_t key = x & ~uint64_t(3);
+        const size_t mask = keys_.size() - 1;
+        size_t i = slot(key);
+        while (keys_[i] != EMPTY) {
+            if (keys_[i] == key) {
+                coeffs_[i] = uint8_t((coeffs_[i] + x) & 3);
+                return;
+            }
+            i = (i + 1) & mask;
+        }
+        keys_[i] = key;
+        coeffs_[i] = uint8_t(x & 3);
+        used_.push_back((uint32_t)i);
+        if (used_.size() * 2 > keys_.size())
+            rehash(bits_ + 1);
+    }
+
+    /* Move the terms with nonzero coefficients to `result` and clear the accumulator */
+    void extract(std::vector<uint64_t>& result)
+    {
+        for (uint32_t i : used_) {
+            if (coeffs_[i])
+                result.push_back(keys_[i] | coeffs_[i]);
+            keys_[i] = EMPTY;
+        }
+        used_.clear();
+    }
+};
+
+/* Enumerate the matrices X with R(X)=R and S(X)=S.
+ * Each term `(Xi(T(X)) << 2) | c | v_raw_shifted` is passed to `add`, where c is the multinomial coefficient of X modulo 4.
+ */
+template <typename FnBinom, typename FnAdd>
+void MulMilnorMod4Tpl(const std::array<uint32_t, XI_MAX>& R, const std::array<uint32_t, XI_MAX>& S, uint64_t v_raw_shifted, FnBinom binom, FnAdd add)
 {
     constexpr size_t N = XI_MAX_MULT;
     constexpr size_t N1 = N + 1;
@@ -96,7 +208,7 @@ void MulMilnorMod4(const std::array<uint32_t, XI_MAX>& R, const std::array<uint3
     std::array<uint32_t, N1 * N1 - N> X, XT;  // TODO: use less memory
     std::array<uint32_t, N1 * N1 - N - N1> Xb, XR, XS;
     XT[N * N1] = S[N - 1] + R[N - 1];
-    Xb[N * N1 - N1] = BinomMod4(XT[N * N1], R[N - 1]);
+    Xb[N * N1 - N1] = binom(XT[N * N1], R[N - 1]);
     if (Xb[N * N1 - N1] == 0)
         return;
     X[N] = R[N - 1];
@@ -127,7 +239,7 @@ void MulMilnorMod4(const std::array<uint32_t, XI_MAX>& R, const std::array<uint3
             XT[index] = XT[(i > 1 || j == N - 1) ? index_bottom_left : index_up_right] + X[index];
 
             while (X[index]) {
-                uint32_t b = (Xb[index_prev_b] * BinomMod4(XT[index], X[index])) % 4;
+                uint32_t b = (Xb[index_prev_b] * binom(XT[index], X[index])) % 4;
                 if (b) {
                     Xb[index1] = b;
                     break;
@@ -143,7 +255,7 @@ void MulMilnorMod4(const std::array<uint32_t, XI_MAX>& R, const std::array<uint3
                 X[index_up] = XR[index - N1] - (X[index] << 1);
                 if (j > 1) {
                     XT[index_up] = XT[(i + 1) * N1 + j - 2] + X[index_up];
-                    Xb[index1] = (Xb[index1] * BinomMod4(XT[index_up], X[index_up])) % 4;
+                    Xb[index1] = (Xb[index1] * binom(XT[index_up], X[index_up])) % 4;
                     if (Xb[index1] == 0) {
                         if (X[index])
                             decrease = true;
@@ -171,10 +283,10 @@ void MulMilnorMod4(const std::array<uint32_t, XI_MAX>& R, const std::array<uint3
         else {
             if (i == 1) {
                 XT[N + 1] = XS[N1 - N1] + X[1];
-                uint32_t b = (Xb[N1 + 1 - N1] * BinomMod4(XT[N + 1], X[1])) % 4;
+                uint32_t b = (Xb[N1 + 1 - N1] * binom(XT[N + 1], X[1])) % 4;
                 // fmt::print("push: X=\n{}\nXS=\n{}\nXT=\n{}\nXb=\n{}\n", X, XS, XT, Xb);
                 if (b) {
-                    result_app.push_back((MMilnor::Xi(XT.data() + N + 1).data() << 2) | b | v_raw_shifted);
+                    add((MMilnor::Xi(XT.data() + N + 1).data() << 2) | b | v_raw_shifted);
                 }
                 move_right = true;
             }
@@ -206,6 +318,18 @@ void MulMilnorMod4(const std::array<uint32_t, XI_MAX>& R, const std::array<uint3
         }
     }
 }
+
+/* The reference implementation. The output is unsorted and should be simplified by `SortMod4()` */
+void MulMilnorMod4(const std::array<uint32_t, XI_MAX>& R, const std::array<uint32_t, XI_MAX>& S, std::vector<uint64_t>& result_app, uint64_t v_raw_shifted)
+{
+    MulMilnorMod4Tpl(R, S, v_raw_shifted, BinomMod4, [&result_app](uint64_t x) { result_app.push_back(x); });
+}
+
+/* The output is simplified by `acc.extract()` */
+void MulMilnorMod4(const std::array<uint32_t, XI_MAX>& R, const std::array<uint32_t, XI_MAX>& S, AccMod4& acc, uint64_t v_raw_shifted)
+{
+    MulMilnorMod4Tpl(R, S, v_raw_shifted, [](uint32_t n, uint32_t m) { return BINOM_MOD4_TABLE(n, m); }, [&acc](uint64_t x) { acc.add(x); });
+}
 }  // namespace steenrod
 
 class DbAdamsd2Map : public myio::Database
@@ -275,6 +399,7 @@ Mod ddd(const Mod& dg, const Mod2d& diffs, int s)
     Milnor tmp1, tmp2;
     Mod tmp_m1, tmp_m2;
     std::vector<uint64_t> prod_sec;
+    AccMod4 acc;
 
     for (auto mdg : dg.data) {
         const auto& dv = diffs[size_t(s - 1)][mdg.v()];
@@ -286,10 +411,10 @@ Mod ddd(const Mod& dg, const Mod2d& diffs, int s)
                 std::array<uint32_t, XI_MAX> R = mdv.m().ToXi();
                 for (auto mdv_mdv : dv_mdv.data) {
                     std::array<uint32_t, XI_MAX> S = mdv_mdv.m().ToXi();
-                    MulMilnorMod4(R, S, prod_sec, mdv_mdv.v_raw() << 2);
+                    MulMilnorMod4(R, S, acc, mdv_mdv.v_raw() << 2);
                 }
             }
-            SortMod4(prod_sec);
+            acc.extract(prod_sec);
             for (uint64_t x : prod_sec) {
                 if ((x & 3) != 2) {
                     fmt::print("x should be a two torsion\n");
@@ -541,4 +666,107 @@ int main_d2(int argc, char** argv, int& index, const char* desc)
 
     compute_d2(cw, t_max, nTry);
     return 0;
-}
\ No newline at end of file
+}
+/*
+ * Benchmark the mod 4 Milnor multiplications in the first part of `ddd()`.
+ * The reference `BinomMod4()`+`SortMod4()` path is compared with the table-based `AccMod4` path.
+ */
+int main_bench_d2(int argc, char** argv, int& index, const char* desc)
+{
+    std::string cw = "S0";
+    int t_max = 0;
+    int repeat = 1;
+
+    myio::CmdArg1d args = {{"cw", &cw}, {"t_max", &t_max}};
+    myio::CmdArg1d op_args = {{"repeat", &repeat}};
+    if (int error = myio::ParseArguments(argc, argv, index, PROGRAM, desc, VERSION, args, op_args))
+        return error;
+
+    std::string db_cw = cw + "_Adams_res.db";
+    std::string table_cw = cw + "_Adams_res";
+    myio::AssertFileExists(db_cw);
+
+    std::vector<std::pair<int, AdamsDegV2>> id_deg;
+    int2d vid_num;
+    Mod2d diffs;
+    std::map<AdamsDegV2, size_t> num_diffs;
+    {
+        DbAdamsResLoader dbRes(db_cw);
+        if (int t_max_cw = get_db_t_max(dbRes); t_max > t_max_cw) {
+            t_max = t_max_cw;
+            fmt::print("t_max is truncated to {}\n", t_max_cw);
+        }
+        dbRes.load_generators(table_cw, id_deg, vid_num, diffs, num_diffs, t_max);
+    }
+
+    /* Each batch consists of the products accumulated into one `prod_sec` in `ddd()` */
+    using Xi = std::array<uint32_t, XI_MAX>;
+    std::vector<std::vector<std::tuple<Xi, Xi, uint64_t>>> batches;
+    size_t num_products = 0;
+    for (size_t s = 3; s < diffs.size(); ++s) {
+        for (auto& dg : diffs[s]) {
+            for (auto mdg : dg.data) {
+                Xi Q = mdg.m().ToXi(), Q1;
+                if (!Contr(1, 0, Q, Q1))
+                    continue;
+                auto& batch = batches.emplace_back();
+                for (auto mdv : diffs[s - 1][mdg.v()].data) {
+                    Xi R = mdv.m().ToXi();
+                    for (auto mdv_mdv : diffs[s - 2][mdv.v()].data)
+                        batch.push_back({R, mdv_mdv.m().ToXi(), mdv_mdv.v_raw() << 2});
+                }
+                num_products += batch.size();
+            }
+        }
+    }
+    fmt::print("cw={} t_max={} batches={} products={}\n", cw, t_max, batches.size(), num_products);
+
+    /* Order independent checksum of the results */
+    auto checksum = [](const std::vector<uint64_t>& data) {
+        uint64_t result = 0;
+        for (uint64_t x : data)
+            result += (x ^ (x >> 29)) * 0xbf58476d1ce4e5b9ULL;
+        return result;
+    };
+
+    std::vector<uint64_t> prod_sec;
+    uint64_t checksum_ref = 0, checksum_acc = 0;
+    size_t num_terms = 0;
+    bench::Timer timer;
+    timer.SuppressPrint();
+
+    for (int i = 0; i < repeat; ++i) {
+        for (auto& batch : batches) {
+            prod_sec.clear();
+            for (auto& [R, S, v_raw_shifted] : batch)
+                MulMilnorMod4(R, S, prod_sec, v_raw_shifted);
+            SortMod4(prod_sec);
+            checksum_ref += checksum(prod_sec);
+            num_terms += prod_sec.size();
+        }
+    }
+    double time_ref = timer.Elapsed();
+    timer.Reset();
+
+    AccMod4 acc;
+    for (int i = 0; i < repeat; ++i) {
+        for (auto& batch : batches) {
+            prod_sec.clear();
+            for (auto& [R, S, v_raw_shifted] : batch)
+                MulMilnorMod4(R, S, acc, v_raw_shifted);
+            acc.extract(prod_sec);
+            checksum_acc += checksum(prod_sec);
+        }
+    }
+    double time_acc = timer.Elapsed();
+
+    fmt::print("terms={}\n", num_terms / std::max(repeat, 1));
+    fmt::print("BinomMod4+SortMod4: {}s\n", time_ref);
+    fmt::print("table+AccMod4:      {}s\n", time_acc);
+    fmt::print("speedup: {:.2f}x\n", time_acc > 0 ? time_ref / time_acc : 0.0);
+    if (checksum_ref != checksum_acc) {
+        fmt::print("Error: results differ\n");
+        return -1;
+    }
+    return 0;
+}
@@ -6,6 +6,7 @@
 #include <cstring>
 #include <map>
 #include <regex>
+#include <unordered_map>
 
 class MyDB : public myio::DbAdamsSS
 {
@@ -193,17 +194,62 @@ public:
     }
 };
 
-alg2::int1d mul(const std::map<std::pair<int, int>, alg2::int1d>& map_h, int id_ind, const alg2::int1d& repr)
+/* map_h[ut::Bind(id_ind, id)] is the product of the indecomposable `id_ind` with `id` */
+using MapH = std::unordered_map<uint64_t, alg2::int1d>;
+
+alg2::int1d mul(const MapH& map_h, int id_ind, const alg2::int1d& repr)
 {
     alg2::int1d result;
+    lina::Workspace& ws = lina::ThreadWorkspace();
     for (int id : repr) {
-        auto it = map_h.find(std::make_pair(id_ind, id));
+        auto it = map_h.find(ut::Bind(id_ind, id));
         if (it != map_h.end())
-            result = lina::add(result, it->second);
+            lina::AddInplace(result, it->second, ws);
     }
     return result;
 }
 
+/* Leading monomials indexed by their last two generators for fast divisibility tests */
+class LeadsIndex
+{
+    using TypeIndexKey = uint32_t;
+
+private:
+    alg2::Mon1d leads_;
+    alg2::MonTrace1d traces_;
+    std::unordered_map<TypeIndexKey, alg2::int1d> indices_;
+
+    static TypeIndexKey Key(const alg2::Mon& lead)
+    {
+        return TypeIndexKey{lead.back().g() + (lead.size() == 1 ? 0 : ((lead[size_t(lead.size() - 2)].g() + 1) << 16))};
+    }
+
+public:
+    void push_back(const alg2::Mon& lead)
+    {
+        indices_[Key(lead)].push_back((int)leads_.size());
+        leads_.push_back(lead);
+        traces_.push_back(lead.Trace());
+    }
+
+    /* Return if `mon` is divisible by one of the leading monomials */
+    bool divides(const alg2::Mon& mon) const
+    {
+        auto t = mon.Trace();
+        for (int i = 0; i < (int)mon.size(); ++i) {
+            for (int j = -1; j < i; ++j) {
+                auto p = indices_.find(TypeIndexKey{mon[i].g() + (j == -1 ? 0 : ((mon[j].g() + 1) << 16))});
+                if (p != indices_.end())
+                    for (int k : p->second)
+                        if (divisible(leads_[k], mon, traces_[k], t))
+                            return true;
+            }
+        }
+        return false;
+    }
+};
+using LeadsIndex1d = std::vector<LeadsIndex>;
+
 void ExportRingAdamsE2(std::string_view ring, int t_trunc, int stem_trunc)
 {
     using namespace alg2;
@@ -224,16 +270,28 @@ void ExportRingAdamsE2(std::string_view ring, int t_trunc, int stem_trunc)
     AdamsDeg1d gen_degs;
     int1d gen_reprs;
     dbProd.load_indecomposables(table_in + "_generators", gen_reprs, gen_degs, t_trunc, stem_trunc);
+
+    /* The ring structure needs the products by all indecomposables */
+    int1d multipliers;
+    if (get_db_multipliers(dbProd, multipliers) == 0) {
+        for (size_t i = 0; i < gen_reprs.size(); ++i) {
+            if (!ut::has(multipliers, gen_reprs[i])) {
+                fmt::print("Error: {} only has products by {}. The indecomposable {} in (s,t)=({},{}) is not a multiplier.\n", db_in, myio::Serialize(multipliers), gen_reprs[i], gen_degs[i].s, gen_degs[i].t);
+                throw MyException(0x5e4a7b10U, "Products by some indecomposables are not available.");
+            }
+        }
+    }
+
     auto map_h_dual = dbProd.load_products_h(table_in, t_trunc, stem_trunc); /* (g, gx) -> x */
-    std::map<std::pair<int, int>, int1d> map_h;
+    MapH map_h;
     for (auto& [p, arr] : map_h_dual) {
         int s_i = LocId(p.second).s - LocId(p.first).s;
         for (int i : arr)
-            map_h[std::make_pair(p.first, LocId(s_i, i).id())].push_back(p.second);
+            map_h[ut::Bind(p.first, LocId(s_i, i).id())].push_back(p.second);
     }
 
     std::map<AdamsDeg, Poly1d> gb;
-    Mon2d leads;
+    LeadsIndex1d leads;
     std::map<AdamsDeg, Mon1d> basis;
     std::map<AdamsDeg, int2d> repr;
 
@@ -243,68 +301,87 @@ void ExportRingAdamsE2(std::string_view ring, int t_trunc, int stem_trunc)
 
     /* Add new basis */
     for (int t = 1; t <= t_trunc; t++) {
-        std::map<AdamsDeg, Mon1d> basis_new;
-        std::map<AdamsDeg, int2d> repr_new;
-
-        /* Consider all possible basis in degree t */
-        for (size_t gen_id = gen_degs.size(); gen_id-- > 0;) {
-            auto repr_g = gen_reprs[gen_id];
+        /* Filtrations s of the possible basis in degree t */
+        int1d ss;
+        for (size_t gen_id = 0; gen_id < gen_degs.size(); ++gen_id) {
             int t1 = t - gen_degs[gen_id].t;
-            if (t1 >= 0) {
-                auto p1 = basis.lower_bound(AdamsDeg{0, t1});
-                auto p2 = basis.lower_bound(AdamsDeg{0, t1 + 1});
-                for (auto p = p1; p != p2; ++p) {
-                    auto deg_mon = p->first + gen_degs[gen_id];
-                    if (deg_mon.stem() > stem_trunc)
-                        continue;
-                    for (size_t i = 0; i < p->second.size(); ++i) {
-                        Mon& m = p->second[i];
-                        auto& repr_m = repr.at(p->first)[i];
-                        if (!m || (int)gen_id <= m[0].g()) {
-                            Mon mon = m * Mon::Gen((uint32_t)gen_id);
-                            auto repr_mon = mul(map_h, repr_g, repr_m);
-                            if (gen_id >= leads.size() || std::none_of(leads[gen_id].begin(), leads[gen_id].end(), [&mon](const Mon& _m) { return divisible(_m, mon); })) {
-                                basis_new[deg_mon].push_back(std::move(mon));
-                                repr_new[deg_mon].push_back(std::move(repr_mon));
-                            }
+            if (t1 >= 0)
+                for (auto p = basis.lower_bound(AdamsDeg{0, t1}); p != basis.end() && p->first.t == t1; ++p)
+                    if ((p->first + gen_degs[gen_id]).stem() <= stem_trunc)
+                        ss.push_back(p->first.s + gen_degs[gen_id].s);
+        }
+        std::sort(ss.begin(), ss.end());
+        ss.erase(std::unique(ss.begin(), ss.end()), ss.end());
+
+        /* The degrees (s, t) only depend on the results in degrees < t so they are computed in parallel */
+        std::vector<Poly1d> gb_new(ss.size());
+        std::vector<Mon1d> basis_new(ss.size());
+        std::vector<int2d> repr_new(ss.size());
+        ut::for_each_par32_rethrow(ss.size(), [&](size_t i_s) {
+            AdamsDeg deg_mon(ss[i_s], t);
+            Mon1d basis_new_d;
+            int2d repr_new_d;
+
+            /* Consider all possible basis in degree deg_mon */
+            for (size_t gen_id = gen_degs.size(); gen_id-- > 0;) {
+                auto p = basis.find(deg_mon - gen_degs[gen_id]);
+                if (p == basis.end())
+                    continue;
+                auto& repr_p = repr.at(p->first);
+                for (size_t i = 0; i < p->second.size(); ++i) {
+                    const Mon& m = p->second[i];
+                    if (!m || (uint32_t)gen_id <= m[0].g()) {
+                        Mon mon = m * Mon::Gen((uint32_t)gen_id);
+                        if (gen_id >= leads.size() || !leads[gen_id].divides(mon)) {
+                            basis_new_d.push_back(std::move(mon));
+                            repr_new_d.push_back(mul(map_h, gen_reprs[gen_id], repr_p[i]));
                         }
                     }
                 }
             }
-        }
 
-        /* Compute groebner and basis in degree t */
-        for (auto it = basis_new.begin(); it != basis_new.end(); ++it) {
-            auto indices = ut::size_t_range(it->second.size());
-            std::sort(indices.begin(), indices.end(), [&it](size_t a, size_t b) { return it->second[a] < it->second[b]; });
-            Mon1d basis_new_d;
-            int2d repr_new_d;
+            /* Compute groebner and basis in degree deg_mon */
+            auto indices = ut::size_t_range(basis_new_d.size());
+            std::sort(indices.begin(), indices.end(), [&basis_new_d](size_t a, size_t b) { return basis_new_d[a] < basis_new_d[b]; });
+            Mon1d basis_sorted;
+            int2d repr_sorted;
             for (size_t i = 0; i < indices.size(); ++i) {
-                basis_new_d.push_back(it->second[indices[i]]);
-                repr_new_d.push_back(repr_new.at(it->first)[indices[i]]);
+                basis_sorted.push_back(std::move(basis_new_d[indices[i]]));
+                repr_sorted.push_back(std::move(repr_new_d[indices[i]]));
             }
 
             int2d image, kernel, g;
-            lina::SetLinearMap(repr_new_d, image, kernel, g);
+            lina::SetLinearMap(repr_sorted, image, kernel, g);
             int1d lead_kernel;
-
-            /* Add to groebner */
             for (const int1d& k : kernel) {
                 lead_kernel.push_back(k[0]);
-                gb[it->first].push_back(Indices2Poly(k, basis_new_d));
-                auto& poly = gb.at(it->first).back();
-                int index = poly.GetLead().front().g();
-                if (leads.size() <= (size_t)index)
-                    leads.resize(size_t(index + 1));
+                gb_new[i_s].push_back(Indices2Poly(k, basis_sorted));
+            }
+            std::sort(lead_kernel.begin(), lead_kernel.end());
+            int1d index_basis = lina::add(ut::int_range(int(basis_sorted.size())), lead_kernel);
+            for (int i : index_basis) {
+                basis_new[i_s].push_back(std::move(basis_sorted[i]));
+                repr_new[i_s].push_back(std::move(repr_sorted[i]));
+            }
+        });
+
+        /* Merge in the order of s */
+        for (size_t i_s = 0; i_s < ss.size(); ++i_s) {
+            AdamsDeg deg(ss[i_s], t);
+            /* Add to groebner */
+            for (auto& poly : gb_new[i_s]) {
+                size_t index = (size_t)poly.GetLead().front().g();
+                if (leads.size() <= index)
+                    leads.resize(index + 1);
                 leads[index].push_back(poly.GetLead());
             }
+            if (!gb_new[i_s].empty())
+                gb[deg] = std::move(gb_new[i_s]);
 
             /* Add to basis_H */
-            std::sort(lead_kernel.begin(), lead_kernel.end());
-            int1d index_basis = lina::add(ut::int_range(int(basis_new_d.size())), lead_kernel);
-            for (int i : index_basis) {
-                basis[it->first].push_back(std::move(basis_new_d[i]));
-                repr[it->first].push_back(std::move(repr_new_d[i]));
+            if (!basis_new[i_s].empty()) {
+                basis[deg] = std::move(basis_new[i_s]);
+                repr[deg] = std::move(repr_new[i_s]);
             }
         }
     }
@@ -371,18 +448,18 @@ void ExportModAdamsE2(std::string_view mod, std::string_view ring, int t_trunc,
     int1d gen_reprs;
     dbProd.load_indecomposables(table_mod + "_generators", gen_reprs, v_degs, t_trunc, stem_trunc);
     auto map_h_dual = dbProd.load_products_h(table_mod, t_trunc, stem_trunc);
-    std::map<std::pair<int, int>, int1d> map_h;
+    MapH map_h;
     for (auto& [p, arr] : map_h_dual) {
         int s_i = LocId(p.second).s - LocId(p.first).s;
         for (int i : arr)
-            map_h[std::make_pair(p.first, LocId(s_i, i).id())].push_back(p.second);
+            map_h[ut::Bind(p.first, LocId(s_i, i).id())].push_back(p.second);
     }
 
     auto ring_basis = dbRing.load_basis(table_ring);
     auto ring_basis_repr = dbRing.load_basis_repr(table_ring);
 
     std::map<AdamsDeg, Mod1d> gbm;
-    Mon2d leads;
+    LeadsIndex1d leads;
     std::map<AdamsDeg, MMod1d> basis;
     std::map<AdamsDeg, int2d> repr;
 
@@ -404,7 +481,7 @@ void ExportModAdamsE2(std::string_view mod, std::string_view ring, int t_trunc,
                         continue;
                     for (size_t i = 0; i < p->second.size(); ++i) {
                         MMod m = MMod(p->second[i], (uint32_t)gen_id);
-                        if (size_t(gen_id) >= leads.size() || std::none_of(leads[gen_id].begin(), leads[gen_id].end(), [&m](const Mon& _m) { return divisible(_m, m.m); })) {
+                        if (size_t(gen_id) >= leads.size() || !leads[gen_id].divides(m.m)) {
                             basis_new[deg_mon].push_back(m);
                             auto repr_mon = mul(map_h, repr_g, ring_basis_repr.at(p->first)[i]);
                             repr_new[deg_mon].push_back(std::move(repr_mon));
@@ -539,12 +616,13 @@ void ExportAdamsD2(std::string_view cw)
     }
     {
         myio::Statement stmt(dbE2, fmt::format("UPDATE {}_AdamsE2_basis SET d2=?1 WHERE id=?2;", cw));
+        lina::Workspace ws;
         for (auto& [id, repr] : monid_repr) {
             int1d d2;
             for (int i : repr)
                 if (ut::has(d2E2, i))
                     for (int id_d2 : d2E2.at(i))
-                        d2 = lina::add(d2, res_id_to_basis.at(id_d2));
+                        lina::AddInplace(d2, res_id_to_basis.at(id_d2), ws);
             stmt.bind_and_step(myio::Serialize(d2), id);
         }
     }
@@ -945,12 +1023,12 @@ void Export2Cell(std::string_view cw, std::string_view ring, int t_trunc, int st
     int2d toS0res;
     dbProd.load_indecomposables_cell(table_in + "_E2", gen_reprs, toS0res, v_degs, t_trunc);
     auto map_h_dual = dbProd.load_cell_products_h(table_in, t_trunc);
-    std::map<std::pair<int, int>, int1d> map_h;
+    MapH map_h;
     for (auto& [p, arr] : map_h_dual) {
         int id_ind_mod = p.first;
         int id_mod = p.second;
         for (int i : arr)
-            map_h[std::make_pair(id_ind_mod, i)].push_back(id_mod);
+            map_h[ut::Bind(id_ind_mod, i)].push_back(id_mod);
     }
 
     MyDB dbS0(db_S0);
@@ -969,7 +1047,7 @@ void Export2Cell(std::string_view cw, std::string_view ring, int t_trunc, int st
     }
 
     std::map<AdamsDeg, Mod1d> gbm;
-    Mon2d leads;
+    LeadsIndex1d leads;
     std::map<AdamsDeg, MMod1d> basis;
     std::map<AdamsDeg, int2d> repr;
 
@@ -991,7 +1069,7 @@ void Export2Cell(std::string_view cw, std::string_view ring, int t_trunc, int st
                         continue;
                     for (size_t i = 0; i < p->second.size(); ++i) {
                         MMod m = MMod(p->second[i], (uint32_t)gen_id);
-                        if (size_t(gen_id) >= leads.size() || std::none_of(leads[gen_id].begin(), leads[gen_id].end(), [&m](const Mon& _m) { return divisible(_m, m.m); })) {
+                        if (size_t(gen_id) >= leads.size() || !leads[gen_id].divides(m.m)) {
                             basis_new[deg_mon].push_back(m);
                             auto repr_mon = mul(map_h, repr_g, S0_basis_repr.at(p->first)[i]);
                             repr_new[deg_mon].push_back(std::move(repr_mon));
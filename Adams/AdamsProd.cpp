@@ -318,14 +318,57 @@ void AdamsResConst::rotate(const DbAdamsResLoader& db, const std::string& table,
     deg2 = AdamsDegV2(s - 1, t_trunc);
 }
 
+/* Resolve the comma separated list of multipliers into ids in the resolution.
+ * A multiplier is an id, h<i> or the name of a generator in <ring>_AdamsSS.db */
+int1d ParseMultipliers(const std::string& multipliers, const std::string& ring, const DbAdamsResLoader& dbRes, const std::string& table_res)
+{
+    int1d result;
+    if (multipliers.empty())
+        return result;
+
+    std::map<std::string, int> names;
+    std::string db_ss = ring + "_AdamsSS.db";
+    std::string table_ss = ring + "_AdamsE2_generators";
+    if (myio::FileExists(db_ss)) {
+        myio::Database dbSS(db_ss);
+        if (dbSS.has_table(table_ss)) {
+            myio::Statement stmt(dbSS, fmt::format("SELECT name, repr FROM {} WHERE name IS NOT NULL;", table_ss));
+            while (stmt.step() == MYSQLITE_ROW)
+                names[stmt.column_str(0)] = stmt.column_int(1);
+        }
+    }
+
+    auto is_number = [](const std::string& str) { return !str.empty() && std::all_of(str.begin(), str.end(), [](char c) { return '0' <= c && c <= '9'; }); };
+    for (auto& name : myio::split(multipliers)) {
+        if (is_number(name))
+            result.push_back(std::stoi(name));
+        else if (auto p = names.find(name); p != names.end())
+            result.push_back(p->second);
+        else if (name[0] == 'h' && is_number(name.substr(1)) && std::stoi(name.substr(1)) < 30) {
+            int1d ids = dbRes.get_column_int(table_res + "_generators", "id", fmt::format("WHERE s=1 AND t={}", 1 << std::stoi(name.substr(1))));
+            if (ids.size() != 1)
+                throw MyException(0x3b1e9f55U, fmt::format("{} is not in the resolution", name));
+            result.push_back(ids[0]);
+        }
+        else
+            throw MyException(0x6c0e2a9bU, fmt::format("Unknown multiplier {}", name));
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
 /*  F_s ----f----> F_{s-g}
  *   |                |
  *   d                d
  *   |                |
  *   V                V
  *  F_{s-1} --f--> F_{s-1-g}
+ *
+ * If `multipliers` is nonempty only the products by them are computed.
+ * The indecomposables are then the generators over the subalgebra generated by the multipliers.
  */
-void compute_products(int t_trunc, const std::string& ring)  ////TODO: abstract and avoid repeating code
+void compute_products(int t_trunc, const std::string& ring, const std::string& multipliers_str)  ////TODO: abstract and avoid repeating code
 {
     std::string db_res = ring + "_Adams_res.db";
     std::string table_res = ring + "_Adams_res";
@@ -354,6 +397,16 @@ void compute_products(int t_trunc, const std::string& ring)  ////TODO: abstract
         gs_hopf = dbRes.get_column_int(fmt::format("{}_generators", table_res), "id", "WHERE s=1 ORDER BY id");
         t_gs_hopf = dbRes.get_column_int(fmt::format("{}_generators", table_res), "t", "WHERE s=1 ORDER BY id");
     }
+    int1d multipliers = ParseMultipliers(multipliers_str, ring, dbRes, table_res);
+    if (!multipliers.empty()) {
+        for (size_t i = gs_hopf.size(); i-- > 0;) {
+            if (!ut::has(multipliers, gs_hopf[i])) {
+                gs_hopf.erase(gs_hopf.begin() + i);
+                t_gs_hopf.erase(t_gs_hopf.begin() + i);
+            }
+        }
+        fmt::print("multipliers={}\n", myio::Serialize(multipliers));
+    }
 
     DbAdamsResProd dbProd(db_out);
     int old_t_max_prod = get_db_t_max(dbProd);
@@ -376,6 +429,22 @@ void compute_products(int t_trunc, const std::string& ring)  ////TODO: abstract
     int1d ids_old = dbProd.load_old_ids(table_out);
     ut::RemoveIf(id_deg, [&ids_old](const std::pair<int, AdamsDegV2>& p) { return ut::has(ids_old, p.first); });
 
+    /* The multipliers cannot change when the computation is resumed */
+    if (ids_old.empty()) {
+        if (multipliers.empty())
+            dbProd.execute_cmd("DELETE FROM version WHERE name=\"multipliers\";");
+        else
+            set_db_multipliers(dbProd, multipliers);
+    }
+    else {
+        int1d multipliers_db; /* Empty if all products are computed */
+        get_db_multipliers(dbProd, multipliers_db);
+        if (multipliers_db != multipliers) {
+            fmt::print("Error: multipliers={} but the database has multipliers={}\n", myio::Serialize(multipliers), myio::Serialize(multipliers_db));
+            throw MyException(0x1f0b53c7U, "Multipliers do not match the database.");
+        }
+    }
+
     bench::Timer timer;
     timer.SuppressPrint();
 
@@ -475,8 +544,15 @@ void compute_products(int t_trunc, const std::string& ring)  ////TODO: abstract
         for (int i : indices)
             stmt_set_ind.bind_and_step(id + i);
         /*# indecomposable comultiply with itself */
-        for (int i : indices)
-            stmt_prod.bind_and_step(id + (int)i, id + (int)i, one.data, myio::Serialize(one_h));
+        if (multipliers.empty()) {
+            for (int i : indices)
+                stmt_prod.bind_and_step(id + (int)i, id + (int)i, one.data, myio::Serialize(one_h));
+        }
+        else {
+            for (size_t i = 0; i < diffs_d_size; ++i)
+                if (ut::has(multipliers, id + (int)i))
+                    stmt_prod.bind_and_step(id + (int)i, id + (int)i, one.data, myio::Serialize(one_h));
+        }
 
         double time = timer.Elapsed();
         timer.Reset();
@@ -925,9 +1001,10 @@ int main_prod(int argc, char** argv, int& index, const char* desc)
 {
     std::string ring = "S0";
     int t_max = 0;
+    std::string multipliers;
 
     myio::CmdArg1d args = {{"ring", &ring}, {"t_max", &t_max}};
-    myio::CmdArg1d op_args = {};
+    myio::CmdArg1d op_args = {{"multipliers", &multipliers}};
     if (int error = myio::ParseArguments(argc, argv, index, PROGRAM, desc, VERSION, args, op_args))
         return error;
 
@@ -939,7 +1016,7 @@ int main_prod(int argc, char** argv, int& index, const char* desc)
     }
 #endif
 
-    compute_products(t_max, ring);
+    compute_products(t_max, ring, multipliers);
     return 0;
 }
 
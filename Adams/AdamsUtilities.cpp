@@ -1,4 +1,6 @@
+#include "algebras/benchmark.h"
 #include "algebras/database.h"
+#include "algebras/linalg.h"
 #include "algebras/myio.h"
 #include "algebras/utility.h"
 #include "main.h"
@@ -6,6 +8,7 @@
 #include <filesystem>
 #include <fmt/core.h>
 #include <map>
+#include <random>
 #include <regex>
 
 int get_db_t_verified(const myio::Database& db);
@@ -114,6 +117,22 @@ void set_db_time(const myio::Database& db)
     stmt.step_and_reset();
 }
 
+/* Return 0 if the products are restricted to the multipliers and -1 if all products are computed */
+int get_db_multipliers(const myio::Database& db, std::vector<int>& result)
+{
+    if (db.has_table("version") && db.get_int("select count(*) from version where name=\"multipliers\"") > 0) {
+        result = myio::Deserialize<myio::int1d>(db.get_str("select value from version where name=\"multipliers\""));
+        return 0;
+    }
+    return -1;
+}
+
+void set_db_multipliers(const myio::Database& db, const std::vector<int>& multipliers)
+{
+    myio::Statement stmt(db, "INSERT INTO version (id, name, value) VALUES (1306413473, \"multipliers\", ?1) ON CONFLICT(id) DO UPDATE SET value=excluded.value;"); /* db_key: multipliers */
+    stmt.bind_and_step(myio::Serialize(multipliers));
+}
+
 void UtStatus(const std::string& dir, int num)
 {
     std::regex is_Adams_res_regex("^(\\w+)_Adams_res.db$");                          /* match example: C2h4_Adams_res.db */
@@ -688,3 +707,71 @@ int main_ut(int argc, char** argv, int& index, const char* desc)
         return error;
     return 0;
 }
+
+/* Random sorted vectors with each index in [0, ncols) present with probability 1/inv_density */
+lina::int2d RandomVectors(std::mt19937& gen, size_t n, size_t ncols, size_t inv_density)
+{
+    std::geometric_distribution<size_t> gap(1.0 / (double)inv_density);
+    lina::int2d result(n);
+    for (auto& v : result)
+        for (size_t j = gap(gen); j < ncols; j += gap(gen) + 1)
+            v.push_back((int)j);
+    return result;
+}
+
+/*
+ * Compare the sparse and the dense backends of lina on random matrices around the threshold of `lina::UseDense()`.
+ * GetSpace, GetInvMap and SetLinearMap must give identical results on both backends.
+ */
+int main_bench_lina(int argc, char** argv, int& index, const char* desc)
+{
+    int repeat = 1;
+    int seed = 0;
+
+    myio::CmdArg1d args = {};
+    myio::CmdArg1d op_args = {{"repeat", &repeat}, {"seed", &seed}};
+    if (int error = myio::ParseArguments(argc, argv, index, PROGRAM, desc, VERSION, args, op_args))
+        return error;
+    if (repeat < 1) {
+        fmt::print("repeat should be positive\n");
+        return -1;
+    }
+
+    const std::vector<std::pair<size_t, size_t>> shapes = {{100, 200}, {127, 500}, {128, 500}, {256, 1000}, {512, 4000}, {1000, 30000}};
+    const std::vector<size_t> inv_densities = {4, 64, 1024, 4096};
+    std::mt19937 gen((unsigned)seed);
+    bool same_all = true;
+    for (auto [n, ncols] : shapes) {
+        for (size_t inv_density : inv_densities) {
+            lina::int2d fx = RandomVectors(gen, n, ncols, inv_density);
+            lina::SetBackend(lina::Backend::automatic);
+            bool is_dense = lina::UseDense(fx.begin(), fx.end());
+
+            lina::int2d results[2][6];
+            double times[2];
+            for (int b = 0; b < 2; ++b) {
+                lina::SetBackend(b == 0 ? lina::Backend::sparse : lina::Backend::dense);
+                bench::Timer timer;
+                timer.SuppressPrint();
+                for (int i = 0; i < repeat; ++i) {
+                    for (auto& r : results[b])
+                        r.clear();
+                    results[b][0] = lina::GetSpace(fx);
+                    lina::GetInvMap(fx, results[b][1], results[b][2]);
+                    lina::SetLinearMap(fx, results[b][3], results[b][4], results[b][5]);
+                }
+                times[b] = timer.Elapsed();
+            }
+            bool same = std::equal(std::begin(results[0]), std::end(results[0]), std::begin(results[1]));
+            same_all = same_all && same;
+            fmt::print("{:>4}x{:<5} density=1/{:<4} auto={:6} sparse={:.4f}s dense={:.4f}s speedup={:.2f}x {}\n", n, ncols, inv_density, is_dense ? "dense" : "sparse", times[0], times[1],
+                       times[0] / times[1], same ? "same" : "DIFFERENT");
+        }
+    }
+    lina::SetBackend(lina::Backend::automatic);
+    if (!same_all) {
+        fmt::print("Error: results differ\n");
+        return -1;
+    }
+    return 0;
+}
@@ -7,6 +7,8 @@
 int main_cellstructure(int, char**, int&, const char*);
 int main_res(int, char**, int&, const char*);
 int main_d2(int, char**, int&, const char*);
+int main_bench_d2(int, char**, int&, const char*);
+int main_bench_lina(int, char**, int&, const char*);
 int main_map_res(int, char**, int&, const char*);
 int main_verify_map(int, char**, int&, const char*);
 
@@ -36,6 +38,8 @@ int main(int argc, char** argv)
         {"cellstructure", "Compute the cell structure of a ring", main_cellstructure},
         {"res", "Compute a minimal A-resolution", main_res},
         {"d2", "Compute Adams d2 differentials", main_d2},
+        {"bench_d2", "Benchmark the mod 4 Milnor multiplications in d2", main_bench_d2},
+        {"bench_lina", "Compare the sparse and the dense backends of linear algebra", main_bench_lina},
         {"map_res", "Compute a chain map between resolutions", main_map_res},
         {"verify_map", "Verify the correctness of a chain map", main_verify_map},
         {"prod", "Compute the multiplications for a ring", main_prod},
@@ -1,6 +1,7 @@
 #ifndef MAIN_H
 #define MAIN_H
 #include <string>
+#include <vector>
 #include <fmt/format.h>
 
 inline const char* PROGRAM = "Adams";
@@ -21,6 +22,8 @@ void set_db_t_max(const myio::Database& db, int t_max);
 void set_db_over(const myio::Database& db, const std::string& over);
 void set_db_d2_t_max(const myio::Database& db, int t_max);
 void set_db_time(const myio::Database& db);
+int get_db_multipliers(const myio::Database& db, std::vector<int>& result);
+void set_db_multipliers(const myio::Database& db, const std::vector<int>& multipliers);
 bool IsAdamsRunning(const std::string& cmd_prefix);
 
 /* local id for a resolution row */
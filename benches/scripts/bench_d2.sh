@@ -0,0 +1,4 @@
+#!/usr/bin/env bash
+
+# Mod 4 Milnor multiplications in d2
+./Adams bench_d2 S0 100 3 | tee -a S0_bench_d2.out
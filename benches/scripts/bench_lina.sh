@@ -0,0 +1,4 @@
+#!/usr/bin/env bash
+
+# Sparse and dense backends of linear algebra on random matrices
+./Adams bench_lina 1 | tee -a bench_lina.out
@@ -16,6 +16,7 @@ struct sqlite3;
 struct sqlite3_stmt;
 #define MYSQLITE_ROW 100
 #define MYSQLITE3_TEXT 3
+#define MYSQLITE_BLOB 4
 
 namespace ut {
 
@@ -59,6 +60,68 @@ T Deserialize(const std::string& str)
 template <>
 int1d Deserialize<int1d>(const std::string& str);
 
+/*
+ * Binary format of TEXT columns that are lists of integers.
+ *
+ * Each integer is zigzag encoded and written as a LEB128 varint.
+ */
+inline void AppendVarint(std::vector<uint8_t>& buffer, int i)
+{
+    auto v = (uint32_t(i) << 1) ^ uint32_t(i >> 31);
+    while (v >= 0x80) {
+        buffer.push_back(uint8_t(v | 0x80));
+        v >>= 7;
+    }
+    buffer.push_back(uint8_t(v));
+}
+
+inline int ReadVarint(const uint8_t*& p, const uint8_t* end)
+{
+    uint32_t v = 0;
+    int shift = 0;
+    while (p != end) {
+        uint8_t byte = *p++;
+        v |= uint32_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return int(v >> 1) ^ -int(v & 1);
+        shift += 7;
+    }
+    throw MyException(0x3c1d2b5aU, "Truncated varint in BLOB");
+}
+
+inline std::vector<uint8_t> SerializeBlob(const int1d& arr)
+{
+    std::vector<uint8_t> result;
+    for (int i : arr)
+        AppendVarint(result, i);
+    return result;
+}
+
+template <typename T>
+T DeserializeBlob(const uint8_t* data, size_t size)
+{
+    throw MyException(0x5ad0e7c1U, "Must use a specialization");
+}
+
+template <>
+int1d DeserializeBlob<int1d>(const uint8_t* data, size_t size);
+
+/* A TEXT or BLOB column copied out of a statement so that it can be deserialized later, e.g. in parallel */
+struct RawColumn
+{
+    bool is_blob = false;
+    std::string data;
+
+    template <typename T>
+    T deserialize() const
+    {
+        if (is_blob)
+            return DeserializeBlob<T>((const uint8_t*)data.data(), data.size());
+        return Deserialize<T>(data);
+    }
+};
+using RawColumn1d = std::vector<RawColumn>;
+
 class Database;
 
 /**
@@ -78,6 +141,7 @@ public:
 public:
     std::string column_str(int iCol) const;
     int column_int(int iCol) const;
+    int64_t column_int64(int iCol) const;
     int column_type(int iCol) const;
     const void* column_blob(int iCol) const;
     int column_blob_size(int iCol) const;
@@ -93,6 +157,17 @@ public:
         return result;
     }
 
+    /* Copy a column written either by `Serialize` (TEXT) or by `SerializeBlob` (BLOB) */
+    RawColumn column_raw(int iCol) const;
+    /* Read a column written either by `Serialize` (TEXT) or by `SerializeBlob` (BLOB) */
+    template <typename T>
+    T column_deserialize(int iCol) const
+    {
+        if (column_type(iCol) == MYSQLITE_BLOB)
+            return DeserializeBlob<T>((const uint8_t*)column_blob(iCol), (size_t)column_blob_size(iCol));
+        return Deserialize<T>(column_str(iCol));
+    }
+
     [[nodiscard]] int step() const;
 
 private:
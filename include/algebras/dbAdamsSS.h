@@ -84,6 +84,30 @@ algZ::MMod Deserialize<algZ::MMod>(const std::string& str);
 template <>
 algZ::Mod Deserialize<algZ::Mod>(const std::string& str);
 
+/*
+ * BLOB versions of the TEXT columns `mon` and `rel`.
+ *
+ * Mon: g, e, g, e, ...
+ * MMod: v, g, e, ...
+ * Poly and Mod: each term is prefixed by the number of its `GE`'s.
+ */
+std::vector<uint8_t> SerializeBlob(const Mon& mon);
+std::vector<uint8_t> SerializeBlob(const MMod& mon);
+std::vector<uint8_t> SerializeBlob(const Poly& poly);
+std::vector<uint8_t> SerializeBlob(const Mod& x);
+
+template <>
+Mon DeserializeBlob<Mon>(const uint8_t* data, size_t size);
+
+template <>
+MMod DeserializeBlob<MMod>(const uint8_t* data, size_t size);
+
+template <>
+Poly DeserializeBlob<Poly>(const uint8_t* data, size_t size);
+
+template <>
+Mod DeserializeBlob<Mod>(const uint8_t* data, size_t size);
+
 /*****************************************************
  *             class DbAdamsSS
  *****************************************************/
@@ -162,11 +186,15 @@ public:
 public:
     AdamsDeg1d load_gen_adamsdegs(const std::string& table_prefix) const;
     std::vector<std::string> load_gen_names(const std::string& table_prefix) const;
-    Poly1d load_gb(const std::string& table_prefix, int t_max) const;
-    Mod1d load_gb_mod(const std::string& table_prefix, int t_max) const;
-    std::map<AdamsDeg, Mon1d> load_basis(const std::string& table_prefix) const;
-    std::map<AdamsDeg, int2d> load_basis_d2(const std::string& table_prefix) const;
-    std::map<AdamsDeg, MMod1d> load_basis_mod(const std::string& table_prefix) const;
+    /* The loaders below skip the degrees with t > t_max or stem > stem_max */
+    Poly1d load_gb(const std::string& table_prefix, int t_max, int stem_max = DEG_MAX) const;
+    Mod1d load_gb_mod(const std::string& table_prefix, int t_max, int stem_max = DEG_MAX) const;
+    std::map<AdamsDeg, Mon1d> load_basis(const std::string& table_prefix, int stem_max = DEG_MAX) const;
+    std::map<AdamsDeg, int2d> load_basis_d2(const std::string& table_prefix, int stem_max = DEG_MAX) const;
+    std::map<AdamsDeg, MMod1d> load_basis_mod(const std::string& table_prefix, int stem_max = DEG_MAX) const;
+    /* Rows of load_gb(_mod) and load_basis(_mod) with the serialized columns left unparsed */
+    RawColumn1d load_gb_raw(const std::string& table_prefix, int t_max, int stem_max = DEG_MAX) const;
+    std::vector<std::pair<AdamsDeg, RawColumn>> load_basis_raw(const std::string& table_prefix, int stem_max = DEG_MAX) const;
 
 public:
     void save_pi_generators(const std::string& table_prefix, const AdamsDeg1d& gen_degs, const Poly1d& gen_Einf) const;
@@ -182,6 +210,8 @@ public:
     }
     algZ::Poly1d load_pi_gb(const std::string& table_prefix, int t_max) const;
     algZ::Mod1d load_pi_gb_mod(const std::string& table_prefix, int t_max) const;
+    /* Rows of load_pi_gb(_mod) with the serialized columns left unparsed */
+    RawColumn1d load_pi_gb_raw(const std::string& table_prefix, int t_max) const;
     std::map<AdamsDeg, algZ::Mon1d> load_pi_basis(const std::string& table_prefix) const;
     std::map<AdamsDeg, algZ::MMod1d> load_pi_basis_mod(const std::string& table_prefix) const;
 };
@@ -9,6 +9,7 @@
 #define LINALG_H
 
 #include <algorithm>
+#include <cstdint>
 #include <iterator>
 #include <vector>
 
@@ -26,6 +27,23 @@ inline int1d add(const int1d& v1, const int1d& v2)
     return result;
 };
 
+/* Scratch buffer for the in-place operations. Reusing it avoids a heap allocation for each row operation */
+struct Workspace
+{
+    int1d tmp;
+};
+
+/* The workspace of the current thread */
+Workspace& ThreadWorkspace();
+
+/* v1 += v2 */
+inline void AddInplace(int1d& v1, const int1d& v2, Workspace& ws)
+{
+    ws.tmp.clear();
+    std::set_symmetric_difference(v1.begin(), v1.end(), v2.begin(), v2.end(), std::back_inserter(ws.tmp));
+    v1.swap(ws.tmp);
+}
+
 /* Return the space spanned by `vectors` */
 int2d GetSpace(const int2d& vectors);
 int1d GetLeads(const int2d& spaceV);
@@ -35,14 +53,22 @@ int2d& SimplifySpace(int2d& spaceV);
 
 /* Return a newer v such that (spaceV\\ v) is triangular */
 int1d Residue(int2dIt spaceV_first, int2dIt spaceV_last, int1d v);
-void ResidueInplace(int2dIt spaceV_first, int2dIt spaceV_last, int1d& v);
+void ResidueInplace(int2dIt spaceV_first, int2dIt spaceV_last, int1d& v, Workspace& ws);
+inline void ResidueInplace(int2dIt spaceV_first, int2dIt spaceV_last, int1d& v)
+{
+    ResidueInplace(spaceV_first, spaceV_last, v, ThreadWorkspace());
+}
 inline int1d Residue(const int2d& spaceV, int1d v)
 {
     return Residue(spaceV.begin(), spaceV.end(), std::move(v));
 }
+inline void ResidueInplace(const int2d& spaceV, int1d& v, Workspace& ws)
+{
+    ResidueInplace(spaceV.begin(), spaceV.end(), v, ws);
+}
 inline void ResidueInplace(const int2d& spaceV, int1d& v)
 {
-	ResidueInplace(spaceV.begin(), spaceV.end(), v);
+    ResidueInplace(spaceV.begin(), spaceV.end(), v, ThreadWorkspace());
 }
 
 /* g[i] = f^{-1}image[i] */
@@ -65,6 +91,82 @@ void SetLinearMapV3(const int2d& x, const int2d& fx, int2d& domain, int2d& f, in
 /* Compute the quotient of linear spaces V/W assuming that W is a subspace of V */
 [[nodiscard]] int2d QuotientSpace(const int2d& spaceV, const int2d& spaceW);
 
+/*****************************************************************
+** Dense backend
+**
+** The functions above switch to packed bit matrices when the input
+** is large and dense enough. The results are identical to the
+** sparse algorithms.
+*****************************************************************/
+
+/* Matrix over F_2 with rows packed into uint64_t words */
+class BitMatrix
+{
+private:
+    size_t rows_ = 0, words_ = 0;
+    std::vector<uint64_t> data_;
+
+public:
+    BitMatrix() = default;
+    BitMatrix(size_t rows, size_t words) : rows_(rows), words_(words), data_(rows * words, 0) {}
+
+    size_t rows() const
+    {
+        return rows_;
+    }
+    size_t words() const
+    {
+        return words_;
+    }
+    uint64_t* row(size_t i)
+    {
+        return data_.data() + i * words_;
+    }
+    const uint64_t* row(size_t i) const
+    {
+        return data_.data() + i * words_;
+    }
+    bool test(size_t i, size_t j) const
+    {
+        return (row(i)[j >> 6] >> (j & 63)) & 1;
+    }
+
+    /* Set the bits v[k]+offset of row i */
+    void set(size_t i, const int1d& v, size_t offset = 0);
+    /* Return the compressed vector of the bits of row i in [first, last) shifted by -first */
+    int1d get(size_t i, size_t first, size_t last) const;
+};
+
+inline size_t BitWords(size_t bits)
+{
+    return (bits + 63) / 64;
+}
+
+/* dst ^= src for n words */
+void XorRow(uint64_t* dst, const uint64_t* src, size_t n);
+
+/*
+ * Triangularize the rows of `m` in order using the method of four russians.
+ *
+ * Only the first `words_lead` words are searched for leading bits.
+ * On return leads[i] is the leading bit of row i if row i is independent of the previous rows and -1 otherwise.
+ * Row i is then reduced by the earlier independent rows exactly as in `GetSpace()`.
+ */
+void Triangularize(BitMatrix& m, size_t words_lead, int1d& leads);
+
+/* Return if the dense backend should be used for the vectors */
+bool UseDense(int2dIt first, int2dIt last);
+
+/* The backend is chosen by `UseDense()` unless it is forced for benchmarks.
+ * Not thread safe: set it before any computation starts. */
+enum class Backend
+{
+    automatic,
+    sparse,
+    dense, /* Still sparse when the matrix is larger than the memory bound */
+};
+void SetBackend(Backend backend);
+
 }  // namespace lina
 
 #endif /* LINALG_H */
\ No newline at end of file
@@ -386,6 +386,18 @@ inline int popcount(uint64_t i)
 #endif
 }
 
+/**
+ * Compute the number of trailing zeros of a nonzero integer
+ */
+inline int ctz(uint64_t i)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(i);
+#else
+    return popcount((i & (~i + 1)) - 1);
+#endif
+}
+
 /**
  * For i=0,...,n-1, execute f(i) in sequence.
  */
@@ -438,6 +450,27 @@ void for_each_par32(size_t n, Fn f)
         fu.wait();
 }
 
+/**
+ * For i=0,...,n-1, execute f(i) in parallel.
+ * An exception thrown by f(i) is rethrown after all threads finish. The one with the smallest i wins.
+ */
+template <typename Fn>
+void for_each_par32_rethrow(size_t n, Fn f)
+{
+    std::vector<std::exception_ptr> errors(n);
+    for_each_par32(n, [&f, &errors](size_t i) {
+        try {
+            f(i);
+        }
+        catch (...) {
+            errors[i] = std::current_exception();
+        }
+    });
+    for (auto& e : errors)
+        if (e)
+            std::rethrow_exception(e);
+}
+
 /**
  * For 0<=i<j<n, execute f(i,j) in parallel.
  */
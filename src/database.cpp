@@ -32,6 +32,16 @@ int1d Deserialize<int1d>(const std::string& str)
     return result;
 }
 
+template <>
+int1d DeserializeBlob<int1d>(const uint8_t* data, size_t size)
+{
+    int1d result;
+    const uint8_t* end = data + size;
+    while (data != end)
+        result.push_back(ReadVarint(data, end));
+    return result;
+}
+
 Database::Database(std::string filename) : filename_(std::move(filename))
 {
     if (myio::FileExists(filename_))
@@ -197,6 +207,11 @@ int Statement::column_int(int iCol) const
     return sqlite3_column_int(stmt_, iCol);
 }
 
+int64_t Statement::column_int64(int iCol) const
+{
+    return sqlite3_column_int64(stmt_, iCol);
+}
+
 int Statement::column_type(int iCol) const
 {
     return sqlite3_column_type(stmt_, iCol);
@@ -210,6 +225,13 @@ int Statement::column_blob_size(int iCol) const
     return sqlite3_column_bytes(stmt_, iCol);
 }
 
+RawColumn Statement::column_raw(int iCol) const
+{
+    if (column_type(iCol) == MYSQLITE_BLOB)
+        return {true, std::string((const char*)column_blob(iCol), (size_t)column_blob_size(iCol))};
+    return {false, column_str(iCol)};
+}
+
 void Statement::step_and_reset() const
 {
     if (int rc = step(); rc != SQLITE_DONE) {
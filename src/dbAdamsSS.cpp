@@ -127,6 +127,113 @@ Mod Deserialize<Mod>(const std::string& str)
     return result;
 }
 
+namespace {
+void AppendMon(std::vector<uint8_t>& buffer, const Mon& mon)
+{
+    for (GE p : mon) {
+        AppendVarint(buffer, (int)p.g());
+        AppendVarint(buffer, (int)p.e());
+    }
+}
+
+Mon ReadMon(const uint8_t*& p, const uint8_t* end, size_t size)
+{
+    Mon result;
+    for (size_t i = 0; i < size; ++i) {
+        int gen = ReadVarint(p, end);
+        int exp = ReadVarint(p, end);
+        result.push_back(GE(gen, exp));
+    }
+    return result;
+}
+}  // namespace
+
+std::vector<uint8_t> SerializeBlob(const Mon& mon)
+{
+    std::vector<uint8_t> result;
+    AppendMon(result, mon);
+    return result;
+}
+
+std::vector<uint8_t> SerializeBlob(const MMod& mon)
+{
+    std::vector<uint8_t> result;
+    AppendVarint(result, mon.v);
+    AppendMon(result, mon.m);
+    return result;
+}
+
+std::vector<uint8_t> SerializeBlob(const Poly& poly)
+{
+    std::vector<uint8_t> result;
+    for (auto& m : poly.data) {
+        AppendVarint(result, (int)m.size());
+        AppendMon(result, m);
+    }
+    return result;
+}
+
+std::vector<uint8_t> SerializeBlob(const Mod& x)
+{
+    std::vector<uint8_t> result;
+    for (auto& m : x.data) {
+        AppendVarint(result, (int)m.m.size());
+        AppendVarint(result, m.v);
+        AppendMon(result, m.m);
+    }
+    return result;
+}
+
+template <>
+Mon DeserializeBlob<Mon>(const uint8_t* data, size_t size)
+{
+    Mon result;
+    const uint8_t* end = data + size;
+    while (data != end) {
+        int gen = ReadVarint(data, end);
+        int exp = ReadVarint(data, end);
+        result.push_back(GE(gen, exp));
+    }
+    return result;
+}
+
+template <>
+MMod DeserializeBlob<MMod>(const uint8_t* data, size_t size)
+{
+    if (size == 0)
+        throw MyException(0x7e0c5d13U, "Cannot initialize MMod with an empty BLOB.");
+    const uint8_t* end = data + size;
+    int v = ReadVarint(data, end);
+    Mon m = DeserializeBlob<Mon>(data, size_t(end - data));
+    return MMod(m, v);
+}
+
+template <>
+Poly DeserializeBlob<Poly>(const uint8_t* data, size_t size)
+{
+    Poly result;
+    const uint8_t* end = data + size;
+    while (data != end) {
+        size_t n = (size_t)ReadVarint(data, end);
+        result.data.push_back(ReadMon(data, end, n));
+    }
+    return result;
+}
+
+template <>
+Mod DeserializeBlob<Mod>(const uint8_t* data, size_t size)
+{
+    Mod result;
+    const uint8_t* end = data + size;
+    while (data != end) {
+        size_t n = (size_t)ReadVarint(data, end);
+        int v = ReadVarint(data, end);
+        Mon m = ReadMon(data, end, n);
+        result.data.push_back(MMod(m, v));
+    }
+    return result;
+}
+
 /* Convert auxiliary input Mon to algZ::Mon */
 algZ::Mon MonToMonZ(const Mon& m)
 {
@@ -308,65 +415,96 @@ std::vector<std::string> DbAdamsSS::load_gen_names(const std::string& table_pref
     return result;
 }
 
-Poly1d DbAdamsSS::load_gb(const std::string& table_prefix, int t_max) const
+namespace {
+/* SQL condition for the degrees with t <= t_max and stem <= stem_max */
+std::string WhereDegs(int t_max, int stem_max, const char* prefix = " WHERE ")
+{
+    std::string result;
+    if (t_max != alg2::DEG_MAX)
+        result = "t<=" + std::to_string(t_max);
+    if (stem_max != alg2::DEG_MAX)
+        result += (result.empty() ? "t-s<=" : " AND t-s<=") + std::to_string(stem_max);
+    return result.empty() ? result : prefix + result;
+}
+}  // namespace
+
+Poly1d DbAdamsSS::load_gb(const std::string& table_prefix, int t_max, int stem_max) const
 {
     Poly1d result;
-    Statement stmt(*this, "SELECT rel FROM " + table_prefix + "_relations" + (t_max == alg2::DEG_MAX ? "" : " WHERE t<=" + std::to_string(t_max)) + " ORDER BY t;");
+    Statement stmt(*this, "SELECT rel FROM " + table_prefix + "_relations" + WhereDegs(t_max, stem_max) + " ORDER BY t;");
     while (stmt.step() == MYSQLITE_ROW) {
-        Poly g = Deserialize<Poly>(stmt.column_str(0));
+        Poly g = stmt.column_deserialize<Poly>(0);
         result.push_back(std::move(g));
     }
     return result;
 }
 
-Mod1d DbAdamsSS::load_gb_mod(const std::string& table_prefix, int t_max) const
+Mod1d DbAdamsSS::load_gb_mod(const std::string& table_prefix, int t_max, int stem_max) const
 {
     Mod1d result;
-    Statement stmt(*this, "SELECT rel FROM " + table_prefix + "_relations" + (t_max == alg2::DEG_MAX ? "" : " WHERE t<=" + std::to_string(t_max)) + " ORDER BY t;");
+    Statement stmt(*this, "SELECT rel FROM " + table_prefix + "_relations" + WhereDegs(t_max, stem_max) + " ORDER BY t;");
     while (stmt.step() == MYSQLITE_ROW) {
-        Mod g = Deserialize<Mod>(stmt.column_str(0));
+        Mod g = stmt.column_deserialize<Mod>(0);
         result.push_back(std::move(g));
     }
     return result;
 }
 
-std::map<AdamsDeg, Mon1d> DbAdamsSS::load_basis(const std::string& table_prefix) const
+RawColumn1d DbAdamsSS::load_gb_raw(const std::string& table_prefix, int t_max, int stem_max) const
+{
+    RawColumn1d result;
+    Statement stmt(*this, "SELECT rel FROM " + table_prefix + "_relations" + WhereDegs(t_max, stem_max) + " ORDER BY t;");
+    while (stmt.step() == MYSQLITE_ROW)
+        result.push_back(stmt.column_raw(0));
+    return result;
+}
+
+std::vector<std::pair<AdamsDeg, RawColumn>> DbAdamsSS::load_basis_raw(const std::string& table_prefix, int stem_max) const
+{
+    std::vector<std::pair<AdamsDeg, RawColumn>> result;
+    Statement stmt(*this, "SELECT s, t, mon FROM " + table_prefix + "_basis" + WhereDegs(DEG_MAX, stem_max) + " ORDER BY id");
+    while (stmt.step() == MYSQLITE_ROW)
+        result.push_back({AdamsDeg(stmt.column_int(0), stmt.column_int(1)), stmt.column_raw(2)});
+    return result;
+}
+
+std::map<AdamsDeg, Mon1d> DbAdamsSS::load_basis(const std::string& table_prefix, int stem_max) const
 {
     std::map<AdamsDeg, Mon1d> result;
-    Statement stmt(*this, "SELECT s, t, mon FROM " + table_prefix + "_basis ORDER BY id");
+    Statement stmt(*this, "SELECT s, t, mon FROM " + table_prefix + "_basis" + WhereDegs(DEG_MAX, stem_max) + " ORDER BY id");
     int count = 0;
     while (stmt.step() == MYSQLITE_ROW) {
         ++count;
         AdamsDeg deg = {stmt.column_int(0), stmt.column_int(1)};
-        result[deg].push_back(Deserialize<Mon>(stmt.column_str(2)));
+        result[deg].push_back(stmt.column_deserialize<Mon>(2));
     }
     return result;
 }
 
-std::map<AdamsDeg, int2d> DbAdamsSS::load_basis_d2(const std::string& table_prefix) const
+std::map<AdamsDeg, int2d> DbAdamsSS::load_basis_d2(const std::string& table_prefix, int stem_max) const
 {
     std::map<AdamsDeg, int2d> result;
     if (has_column(table_prefix + "_basis", "d2")) {
-        Statement stmt(*this, "SELECT s, t, d2 FROM " + table_prefix + "_basis WHERE d2 IS NOT NULL ORDER BY id");
+        Statement stmt(*this, "SELECT s, t, d2 FROM " + table_prefix + "_basis WHERE d2 IS NOT NULL" + WhereDegs(DEG_MAX, stem_max, " AND ") + " ORDER BY id");
         int count = 0;
         while (stmt.step() == MYSQLITE_ROW) {
             ++count;
             AdamsDeg deg = {stmt.column_int(0), stmt.column_int(1)};
-            result[deg].push_back(Deserialize<int1d>(stmt.column_str(2)));
+            result[deg].push_back(stmt.column_deserialize<int1d>(2));
         }
     }
     return result;
 }
 
-std::map<AdamsDeg, MMod1d> DbAdamsSS::load_basis_mod(const std::string& table_prefix) const
+std::map<AdamsDeg, MMod1d> DbAdamsSS::load_basis_mod(const std::string& table_prefix, int stem_max) const
 {
     std::map<AdamsDeg, MMod1d> result;
-    Statement stmt(*this, "SELECT s, t, mon FROM " + table_prefix + "_basis ORDER BY id");
+    Statement stmt(*this, "SELECT s, t, mon FROM " + table_prefix + "_basis" + WhereDegs(DEG_MAX, stem_max) + " ORDER BY id");
     int count = 0;
     while (stmt.step() == MYSQLITE_ROW) {
         ++count;
         AdamsDeg deg = {stmt.column_int(0), stmt.column_int(1)};
-        result[deg].push_back(Deserialize<MMod>(stmt.column_str(2)));
+        result[deg].push_back(stmt.column_deserialize<MMod>(2));
     }
     return result;
 }
@@ -458,6 +596,15 @@ algZ::Mod1d DbAdamsSS::load_pi_gb_mod(const std::string& table_prefix, int t_max
     return result;
 }
 
+RawColumn1d DbAdamsSS::load_pi_gb_raw(const std::string& table_prefix, int t_max) const
+{
+    RawColumn1d result;
+    Statement stmt(*this, "SELECT rel FROM " + table_prefix + "_pi_relations" + (t_max == DEG_MAX ? "" : " WHERE t<=" + std::to_string(t_max)) + " ORDER BY t;");
+    while (stmt.step() == MYSQLITE_ROW)
+        result.push_back(stmt.column_raw(0));
+    return result;
+}
+
 std::map<AdamsDeg, algZ::Mon1d> DbAdamsSS::load_pi_basis(const std::string& table_prefix) const
 {
     std::map<AdamsDeg, algZ::Mon1d> result;
@@ -1,5 +1,12 @@
 #include "linalg.h"
 #include "myexception.h"
+#include "utility.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 #ifndef NDEBUG
 #include <iostream>
@@ -12,13 +19,262 @@ bool is_sorted(const int2d& vectors)
     return std::all_of(vectors.begin(), vectors.end(), [](const int1d& v) { return std::is_sorted(v.begin(), v.end()); });
 }
 
+/*****************************************************************
+** Dense backend
+*****************************************************************/
+
+/* The dense backend is used when there are at least DENSE_MIN_ROWS rows and the density is at least 1/DENSE_INV_DENSITY */
+constexpr size_t DENSE_MIN_ROWS = 128;
+constexpr size_t DENSE_INV_DENSITY = 1024;
+/* Upper bound of the size of a dense matrix in words */
+constexpr size_t DENSE_MAX_WORDS = size_t(1) << 26;
+/* Number of pivots in a table of the method of four russians */
+constexpr size_t M4RI_K = 8;
+/* Tables are only built when they are applied to at least this many rows */
+constexpr size_t M4RI_MIN_ROWS = 64;
+
+void BitMatrix::set(size_t i, const int1d& v, size_t offset)
+{
+    uint64_t* r = row(i);
+    for (int k : v) {
+        size_t j = size_t(k) + offset;
+        r[j >> 6] |= uint64_t(1) << (j & 63);
+    }
+}
+
+int1d BitMatrix::get(size_t i, size_t first, size_t last) const
+{
+    int1d result;
+    const uint64_t* r = row(i);
+    for (size_t w = first >> 6; w < BitWords(last); ++w) {
+        for (uint64_t word = r[w]; word; word &= word - 1) {
+            size_t j = w * 64 + (size_t)ut::ctz(word);
+            if (first <= j && j < last)
+                result.push_back(int(j - first));
+        }
+    }
+    return result;
+}
+
+void XorRow(uint64_t* dst, const uint64_t* src, size_t n)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_xor_si256(a, b));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    for (; i + 2 <= n; i += 2) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(a, b));
+    }
+#endif
+    for (; i < n; ++i)
+        dst[i] ^= src[i];
+}
+
+inline bool TestBit(const uint64_t* r, size_t j)
+{
+    return (r[j >> 6] >> (j & 63)) & 1;
+}
+
+inline int LeadingBit(const uint64_t* r, size_t words_lead)
+{
+    for (size_t w = 0; w < words_lead; ++w)
+        if (r[w])
+            return int(w * 64 + (size_t)ut::ctz(r[w]));
+    return -1;
+}
+
+/* Reduce the rows of index >= first_row by the pivots using one table */
+void ApplyFourRussians(BitMatrix& m, size_t first_row, const size_t* pivots, const int* leads, size_t c, std::vector<uint64_t>& table)
+{
+    size_t w0 = m.words();
+    for (size_t k = 0; k < c; ++k)
+        w0 = std::min(w0, size_t(leads[k]) >> 6);
+    const size_t tw = m.words() - w0;
+    const size_t size = size_t(1) << c;
+
+    /* mask[k] consists of the bits of pivot k at the leads */
+    uint32_t mask[M4RI_K];
+    for (size_t k = 0; k < c; ++k) {
+        mask[k] = 0;
+        for (size_t l = 0; l < c; ++l)
+            if (TestBit(m.row(pivots[k]), (size_t)leads[l]))
+                mask[k] |= uint32_t(1) << l;
+    }
+
+    /* Pivots are applied in order so the bits p at the leads determine the combination sel[p] of pivots */
+    uint32_t sel[size_t(1) << M4RI_K];
+    for (uint32_t p = 0; p < size; ++p) {
+        uint32_t q = p, s = 0;
+        for (size_t k = 0; k < c; ++k) {
+            if ((q >> k) & 1) {
+                s |= uint32_t(1) << k;
+                q ^= mask[k];
+            }
+        }
+        sel[p] = s;
+    }
+
+    /* table[s] is the sum of the pivots in s */
+    table.assign(size * tw, 0);
+    for (size_t s = 1; s < size; ++s) {
+        uint64_t* t = table.data() + s * tw;
+        std::copy_n(table.data() + (s & (s - 1)) * tw, tw, t);
+        XorRow(t, m.row(pivots[ut::ctz(s)]) + w0, tw);
+    }
+
+    for (size_t i = first_row; i < m.rows(); ++i) {
+        uint64_t* r = m.row(i);
+        uint32_t p = 0;
+        for (size_t k = 0; k < c; ++k)
+            p |= uint32_t(TestBit(r, (size_t)leads[k])) << k;
+        if (p)
+            XorRow(r + w0, table.data() + sel[p] * tw, tw);
+    }
+}
+
+void Triangularize(BitMatrix& m, size_t words_lead, int1d& leads)
+{
+    const size_t n = m.rows(), words = m.words();
+    leads.assign(n, -1);
+    std::vector<size_t> pending; /* Pivots which have not been applied to the later rows */
+    int1d leads_pending;
+    std::vector<uint64_t> table;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t* r = m.row(i);
+        for (size_t k = 0; k < pending.size(); ++k) {
+            size_t w = size_t(leads_pending[k]) >> 6;
+            if (TestBit(r, (size_t)leads_pending[k]))
+                XorRow(r + w, m.row(pending[k]) + w, words - w);
+        }
+        int lead = LeadingBit(r, words_lead);
+        if (lead == -1)
+            continue;
+        leads[i] = lead;
+        pending.push_back(i);
+        leads_pending.push_back(lead);
+        if (pending.size() >= M4RI_K && n - i - 1 >= M4RI_MIN_ROWS) {
+            for (size_t k = 0; k < pending.size(); k += M4RI_K)
+                ApplyFourRussians(m, i + 1, pending.data() + k, leads_pending.data() + k, std::min(M4RI_K, pending.size() - k), table);
+            pending.clear();
+            leads_pending.clear();
+        }
+    }
+}
+
+/* Return the number of columns of the vectors */
+size_t NumCols(int2dIt first, int2dIt last)
+{
+    size_t result = 0;
+    for (auto p = first; p != last; ++p)
+        if (!p->empty())
+            result = std::max(result, size_t(p->back()) + 1);
+    return result;
+}
+
+Backend g_backend = Backend::automatic;
+
+void SetBackend(Backend backend)
+{
+    g_backend = backend;
+}
+
+bool UseDense(int2dIt first, int2dIt last)
+{
+    size_t n = size_t(last - first);
+    if (g_backend == Backend::sparse || n == 0 || (g_backend == Backend::automatic && n < DENSE_MIN_ROWS))
+        return false;
+    size_t ncols = NumCols(first, last);
+    if (n * (BitWords(ncols) + BitWords(n)) > DENSE_MAX_WORDS)
+        return false;
+    if (g_backend == Backend::dense)
+        return true;
+    size_t nnz = 0;
+    for (auto p = first; p != last; ++p)
+        nnz += p->size();
+    return nnz * DENSE_INV_DENSITY >= n * ncols;
+}
+
+int2d GetSpaceDense(const int2d& vectors)
+{
+    size_t words = BitWords(NumCols(vectors.begin(), vectors.end()));
+    BitMatrix m(vectors.size(), words);
+    for (size_t i = 0; i < vectors.size(); ++i)
+        m.set(i, vectors[i]);
+    int1d leads;
+    Triangularize(m, words, leads);
+    int2d result;
+    for (size_t i = 0; i < m.rows(); ++i)
+        if (leads[i] != -1)
+            result.push_back(m.get(i, 0, words * 64));
+    return result;
+}
+
+/*
+ * Dense version of `SetLinearMapV2()` where `image`, `kernel` and `g` are initially empty.
+ * set_x(m, i, offset) sets the bits of the i-th source vector shifted by offset.
+ * The kernel is skipped if `kernel` is nullptr.
+ */
+template <typename FnSetX>
+void SetLinearMapDense(size_t n, size_t ncols_x, FnSetX set_x, int2dIt fx_first, int2d& image, int2d* kernel, int2d& g)
+{
+    const size_t wf = BitWords(NumCols(fx_first, fx_first + n)), wx = BitWords(ncols_x);
+    BitMatrix m(n, wf + wx);
+    for (size_t i = 0; i < n; ++i) {
+        m.set(i, *(fx_first + i));
+        set_x(m, i, wf * 64);
+    }
+    int1d leads;
+    Triangularize(m, wf, leads);
+
+    size_t n_kernel = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (leads[i] != -1) {
+            image.push_back(m.get(i, 0, wf * 64));
+            g.push_back(m.get(i, wf * 64, (wf + wx) * 64));
+        }
+        else
+            ++n_kernel;
+    }
+
+    if (kernel && n_kernel) {
+        BitMatrix k(n_kernel, wx);
+        for (size_t i = 0, j = 0; i < n; ++i)
+            if (leads[i] == -1)
+                std::copy_n(m.row(i) + wf, wx, k.row(j++));
+        int1d leads_k;
+        Triangularize(k, wx, leads_k);
+        for (size_t i = 0; i < n_kernel; ++i)
+            if (leads_k[i] != -1)
+                kernel->push_back(k.get(i, 0, wx * 64));
+    }
+}
+
+/*****************************************************************
+** Sparse backend
+*****************************************************************/
+
+Workspace& ThreadWorkspace()
+{
+    thread_local Workspace ws;
+    return ws;
+}
+
 int2d GetSpace(const int2d& vectors)
 {
+    if (UseDense(vectors.begin(), vectors.end()))
+        return GetSpaceDense(vectors);
+    Workspace& ws = ThreadWorkspace();
     int2d result;
     for (int1d v : vectors) { /* Create copy on purpose */
         for (const auto& vi : result)
             if (std::binary_search(v.begin(), v.end(), vi[0]))
-                v = add(v, vi);
+                AddInplace(v, vi, ws);
         if (!v.empty())
             result.push_back(std::move(v));
     }
@@ -36,44 +292,49 @@ int1d GetLeads(const int2d& spaceV)
 
 int2d& SimplifySpace(int2d& spaceV)
 {
+    Workspace& ws = ThreadWorkspace();
     for (size_t i = spaceV.size() - 1; i != -1; i--)
         for (size_t j = 0; j < i; j++)
             if (std::binary_search(spaceV[j].begin(), spaceV[j].end(), spaceV[i][0]))
-                spaceV[j] = add(spaceV[j], spaceV[i]);
+                AddInplace(spaceV[j], spaceV[i], ws);
     return spaceV;
 }
 
 int1d Residue(int2dIt spaceV_first, int2dIt spaceV_last, int1d v)
 {
-    for (auto p_vi = spaceV_first; p_vi != spaceV_last; ++p_vi)
-        if (std::binary_search(v.begin(), v.end(), p_vi->front()))
-            v = add(v, *p_vi);
+    ResidueInplace(spaceV_first, spaceV_last, v, ThreadWorkspace());
     return v;
 }
 
-void ResidueInplace(int2dIt spaceV_first, int2dIt spaceV_last, int1d& v)
+void ResidueInplace(int2dIt spaceV_first, int2dIt spaceV_last, int1d& v, Workspace& ws)
 {
     for (auto p_vi = spaceV_first; p_vi != spaceV_last; ++p_vi)
         if (std::binary_search(v.begin(), v.end(), p_vi->front()))
-            v = add(v, *p_vi);
+            AddInplace(v, *p_vi, ws);
 }
 
-inline void AddToSpace(int2d& spaceV, const int1d& v)
+inline void AddToSpace(int2d& spaceV, int1d v, Workspace& ws)
 {
-    int1d v1 = Residue(spaceV, v);
-    if (!v1.empty())
-        spaceV.push_back(std::move(v1));
+    ResidueInplace(spaceV, v, ws);
+    if (!v.empty())
+        spaceV.push_back(std::move(v));
 }
 
 void GetInvMap(const int2d& fx, int2d& image, int2d& g)
 {
+    Workspace& ws = ThreadWorkspace();
+    if (image.empty() && g.empty() && UseDense(fx.begin(), fx.end())) {
+        SetLinearMapDense(
+            fx.size(), fx.size(), [](BitMatrix& m, size_t i, size_t offset) { m.set(i, {int(i)}, offset); }, fx.begin(), image, nullptr, g);
+        return;
+    }
     for (size_t i = 0; i < fx.size(); ++i) {
         int1d src = {int(i)};
         int1d tgt = fx[i];
         for (size_t j = 0; j < image.size(); j++) {
             if (std::binary_search(tgt.begin(), tgt.end(), image[j][0])) {
-                tgt = add(tgt, image[j]);
-                src = add(src, g[j]);
+                AddInplace(tgt, image[j], ws);
+                AddInplace(src, g[j], ws);
             }
         }
         if (!tgt.empty()) {
@@ -85,22 +346,28 @@ void GetInvMap(const int2d& fx, int2d& image, int2d& g)
 
 void SetLinearMap(const int2d& fx, int2d& image, int2d& kernel, int2d& g)
 {
+    Workspace& ws = ThreadWorkspace();
 #ifdef MYDEBUG
     if (!is_sorted(fx))
         throw MyException(0x98e11820U, "fx is not sorted");
 #endif
+    if (image.empty() && kernel.empty() && g.empty() && UseDense(fx.begin(), fx.end())) {
+        SetLinearMapDense(
+            fx.size(), fx.size(), [](BitMatrix& m, size_t i, size_t offset) { m.set(i, {int(i)}, offset); }, fx.begin(), image, &kernel, g);
+        return;
+    }
     /* f(g[i]) = image[i] */
     for (size_t i = 0; i < fx.size(); ++i) {
         int1d src = {int(i)};
         int1d tgt = fx[i];
         for (size_t j = 0; j < image.size(); j++) {
             if (std::binary_search(tgt.begin(), tgt.end(), image[j][0])) {
-                tgt = add(tgt, image[j]);
-                src = add(src, g[j]);
+                AddInplace(tgt, image[j], ws);
+                AddInplace(src, g[j], ws);
             }
         }
         if (tgt.empty())
-            AddToSpace(kernel, src);
+            AddToSpace(kernel, std::move(src), ws);
         else {
             image.push_back(std::move(tgt));
             g.push_back(std::move(src));
@@ -110,18 +377,25 @@ void SetLinearMap(const int2d& fx, int2d& image, int2d& kernel, int2d& g)
 
 void SetLinearMapV2(int2dIt x_first, int2dIt x_last, int2dIt fx_first, int2d& image, int2d& kernel, int2d& g)
 {
+    Workspace& ws = ThreadWorkspace();
+    const size_t n = size_t(x_last - x_first);
+    if (image.empty() && kernel.empty() && g.empty() && UseDense(fx_first, fx_first + n)) {
+        SetLinearMapDense(
+            n, NumCols(x_first, x_last), [x_first](BitMatrix& m, size_t i, size_t offset) { m.set(i, *(x_first + i), offset); }, fx_first, image, &kernel, g);
+        return;
+    }
     /* f(g[i]) = image[i] */
     for (auto p_x = x_first, p_fx = fx_first; p_x != x_last; ++p_x, ++p_fx) {
         int1d src = *p_x;
         int1d tgt = *p_fx;
         for (size_t j = 0; j < image.size(); j++) {
             if (std::binary_search(tgt.begin(), tgt.end(), image[j][0])) {
-                tgt = add(tgt, image[j]);
-                src = add(src, g[j]);
+                AddInplace(tgt, image[j], ws);
+                AddInplace(src, g[j], ws);
             }
         }
         if (tgt.empty())
-            AddToSpace(kernel, src);
+            AddToSpace(kernel, std::move(src), ws);
         else {
             image.push_back(std::move(tgt));
             g.push_back(std::move(src));
@@ -131,22 +405,29 @@ void SetLinearMapV2(int2dIt x_first, int2dIt x_last, int2dIt fx_first, int2d& im
 
 void SetLinearMapV2(const int1d& x, const int2d& fx, int2d& image, int2d& kernel, int2d& g)
 {
+    Workspace& ws = ThreadWorkspace();
 #ifdef MYDEBUG
     if (!is_sorted(fx))
         throw MyException(0xad97b098U, "fx is not sorted");
 #endif
+    if (image.empty() && kernel.empty() && g.empty() && UseDense(fx.begin(), fx.end())) {
+        size_t ncols_x = x.empty() ? 0 : size_t(*std::max_element(x.begin(), x.end())) + 1;
+        SetLinearMapDense(
+            fx.size(), ncols_x, [&x](BitMatrix& m, size_t i, size_t offset) { m.set(i, {x[i]}, offset); }, fx.begin(), image, &kernel, g);
+        return;
+    }
     /* f(g[i]) = image[i] */
     for (size_t i = 0; i < fx.size(); ++i) {
         int1d src = {x[i]};
         int1d tgt = fx[i];
         for (size_t j = 0; j < image.size(); j++) {
             if (std::binary_search(tgt.begin(), tgt.end(), image[j][0])) {
-                tgt = add(tgt, image[j]);
-                src = add(src, g[j]);
+                AddInplace(tgt, image[j], ws);
+                AddInplace(src, g[j], ws);
             }
         }
         if (tgt.empty())
-            AddToSpace(kernel, src);
+            AddToSpace(kernel, std::move(src), ws);
         else {
             image.push_back(std::move(tgt));
             g.push_back(std::move(src));
@@ -156,14 +437,15 @@ void SetLinearMapV2(const int1d& x, const int2d& fx, int2d& image, int2d& kernel
 
 void SetLinearMapV3(const int2d& x, const int2d& fx, int2d& domain, int2d& f, int2d& image, int2d& g, int2d& kernel)
 {
+    Workspace& ws = ThreadWorkspace();
     /* f(g[i]) = image[i] */
     for (size_t i = 0; i < fx.size(); ++i) {
         int1d src = x[i];
         int1d tgt = fx[i];
         for (size_t k = 0; k < domain.size(); ++k) {
             if (std::binary_search(src.begin(), src.end(), domain[k][0])) {
-                src = add(src, domain[k]);
-                tgt = add(tgt, f[k]);
+                AddInplace(src, domain[k], ws);
+                AddInplace(tgt, f[k], ws);
             }
         }
         if (src.empty()) {
@@ -175,12 +457,12 @@ void SetLinearMapV3(const int2d& x, const int2d& fx, int2d& domain, int2d& f, in
             f.push_back(tgt);
             for (size_t j = 0; j < image.size(); j++) {
                 if (std::binary_search(tgt.begin(), tgt.end(), image[j][0])) {
-                    tgt = add(tgt, image[j]);
-                    src = add(src, g[j]);
+                    AddInplace(tgt, image[j], ws);
+                    AddInplace(src, g[j], ws);
                 }
             }
             if (tgt.empty())
-                AddToSpace(kernel, src);
+                AddToSpace(kernel, std::move(src), ws);
             else {
                 image.push_back(std::move(tgt));
                 g.push_back(std::move(src));
@@ -191,11 +473,12 @@ void SetLinearMapV3(const int2d& x, const int2d& fx, int2d& domain, int2d& f, in
 
 int1d GetImage(int2dIt spaceV_first, int2dIt spaceV_last, int2dIt f_first, int1d v)
 {
+    Workspace& ws = ThreadWorkspace();
     int1d result;
     for (auto p_Vi = spaceV_first, p_fi = f_first; p_Vi != spaceV_last && !v.empty(); ++p_Vi, ++p_fi)
         if (std::binary_search(v.begin(), v.end(), p_Vi->front())) {
-            v = add(v, *p_Vi);
-            result = add(result, *p_fi);
+            AddInplace(v, *p_Vi, ws);
+            AddInplace(result, *p_fi, ws);
         }
 #ifdef MYDEBUG
     if (!v.empty()) {
@@ -207,10 +490,11 @@ int1d GetImage(int2dIt spaceV_first, int2dIt spaceV_last, int2dIt f_first, int1d
 
 int1d GetInvImage(const int2d& spaceV, int1d v)
 {
+    Workspace& ws = ThreadWorkspace();
     int1d result;
     for (size_t j = 0; j < spaceV.size(); j++) {
         if (std::binary_search(v.begin(), v.end(), spaceV[j][0])) {
-            v = add(v, spaceV[j]);
+            AddInplace(v, spaceV[j], ws);
             result.push_back((int)j);
         }
     }
@@ -223,6 +507,7 @@ int1d GetInvImage(const int2d& spaceV, int1d v)
 
 int2d QuotientSpace(const int2d& spaceV, const int2d& spaceW)
 {
+    Workspace& ws = ThreadWorkspace();
     int2d quotient;
     size_t dimQuo = spaceV.size() - spaceW.size();
 #ifdef MYDEBUG
@@ -231,7 +516,9 @@ int2d QuotientSpace(const int2d& spaceV, const int2d& spaceW)
     for (size_t i = 0; i < spaceV.size() && quotient.size() < dimQuo; i++)
 #endif
     {
-        auto v1 = Residue(quotient, Residue(spaceW, spaceV[i]));
+        int1d v1 = spaceV[i];
+        ResidueInplace(spaceW, v1, ws);
+        ResidueInplace(quotient, v1, ws);
         if (!v1.empty())
             quotient.push_back(std::move(v1));
     }
@@ -1,6 +1,7 @@
 #include "algebras/linalg.h"
 #include "main.h"
 #include "mylog.h"
+#include <fmt/ranges.h>
 #include <regex>
 
 using namespace alg2;
@@ -19,6 +20,107 @@ std::ostream& operator<<(std::ostream& sout, const Staircase& sc)
     return sout;
 }
 
+/* Return the reason if x or dx is not a valid element of ss */
+const char* InvalidDiff(const Staircases& ss, AdamsDeg deg_x, const int1d& x, const int1d& dx, int r)
+{
+    if (!x.empty()) {
+        if (!ut::has(ss, deg_x))
+            return "deg_x not found";
+        if (x.front() < 0 || ss.at(deg_x).levels.size() <= (size_t)x.back())
+            return "Invalid x";
+    }
+    if (!dx.empty()) {
+        AdamsDeg deg_dx = deg_x + AdamsDeg(r, r - 1);
+        if (!ut::has(ss, deg_dx))
+            return "deg_dx not found";
+        if (dx.front() < 0 || ss.at(deg_dx).levels.size() <= (size_t)dx.back())
+            return "Invalid dx";
+    }
+    return nullptr;
+}
+
+int Diagram::ImportDiffs(std::vector<ImportDiff> diffs, EnumReason reason, SSFlag flag)
+{
+    if (flag & SSFlag::pi)
+        throw MyException(0x3f1c5a07, "ImportDiffs does not support homotopy");
+    std::stable_sort(diffs.begin(), diffs.end(), [](const ImportDiff& a, const ImportDiff& b) {
+        return std::make_tuple(a.deg_x.stem(), a.deg_x.s, a.r) < std::make_tuple(b.deg_x.stem(), b.deg_x.s, b.r);
+    });
+
+    auto for_each_nodes = [&](auto f) {
+        for (auto& ring : rings_)
+            f(ring.nodes_ss);
+        for (auto& mod : modules_)
+            f(mod.nodes_ss);
+        if (flag & SSFlag::cofseq)
+            for (auto& cofseq : cofseqs_)
+                for (size_t iCs = 0; iCs < 3; ++iCs)
+                    f(cofseq.nodes_cofseq[iCs]);
+    };
+
+    struct Conflict
+    {
+        const ImportDiff* diff;
+        unsigned int code;
+        std::string message;
+    };
+    std::vector<Conflict> conflicts;
+    int count = 0, count_new = 0;
+    LogRow1d rows;
+    std::string out;
+    for (auto& diff : diffs) {
+        IndexCw iCw;
+        try {
+            iCw = GetIndexCwByName(diff.cw);
+        }
+        catch (MyException& e) {
+            conflicts.push_back({&diff, e.id(), e.what()});
+            continue;
+        }
+        if (auto error = InvalidDiff(GetSS(iCw).front(), diff.deg_x, diff.x, diff.dx, diff.r)) {
+            conflicts.push_back({&diff, 0, error});
+            continue;
+        }
+        if (!IsNewDiff(GetSS(iCw), diff.deg_x, diff.x, diff.dx, diff.r))
+            continue;
+
+        /* The logs of a conflicting differential are dropped with its changes */
+        for_each_nodes([](Staircases1d& nodes) { nodes.AddNode(); });
+        Logger::SetBuffer(&rows, &out);
+        try {
+            Logger::LogDiff(0, reason, diff.cw, diff.deg_x, diff.x, diff.dx, diff.r);
+            int count_diff = SetCwDiffGlobal(iCw, diff.deg_x, diff.x, diff.dx, diff.r, false, flag);
+            Logger::SetBuffer(nullptr);
+            for_each_nodes([](Staircases1d& nodes) { nodes.CommitNode(); });
+            Logger::FlushBuffer(rows, out);
+            count += count_diff;
+            ++count_new;
+        }
+        catch (SSException& e) {
+            Logger::SetBuffer(nullptr);
+            for_each_nodes([](Staircases1d& nodes) { nodes.PopNode(); });
+            a_leibniz_ = nullptr;
+            conflicts.push_back({&diff, e.id(), e.what()});
+        }
+        catch (...) {
+            /* Leave no node open and no buffer pointing into this frame */
+            Logger::SetBuffer(nullptr);
+            for_each_nodes([](Staircases1d& nodes) { nodes.PopNode(); });
+            a_leibniz_ = nullptr;
+            throw;
+        }
+        rows.clear();
+        out.clear();
+    }
+
+    Logger::LogSummary("Imported differentials", count_new);
+    Logger::LogSummary("Conflicts", (int)conflicts.size());
+    std::stable_sort(conflicts.begin(), conflicts.end(), [](const Conflict& a, const Conflict& b) { return a.diff->line < b.diff->line; });
+    for (auto& [diff, code, message] : conflicts)
+        fmt::print("line {}: {} {} d_{}{}={} - {:#x} {}\n", diff->line, diff->cw, diff->deg_x, diff->r, diff->x, diff->dx, code, message);
+    return count;
+}
+
 int main_add_diff(int argc, char** argv, int& index, const char* desc)
 {
     int stem = 0, s = 0, r = 0;
@@ -38,7 +140,8 @@ int main_add_diff(int argc, char** argv, int& index, const char* desc)
     int1d x = myio::Deserialize<int1d>(x_str);
     int1d dx = myio::Deserialize<int1d>(dx_str);
 
-    Diagram diagram(diagram_name, flag);
+    std::unique_ptr<Diagram> holder;
+    Diagram& diagram = OpenDiagram(diagram_name, flag, holder);
 
     /* #Check if x, dx are valid */
     auto iCw = diagram.GetIndexCwByName(cw);
@@ -70,7 +173,8 @@ int main_add_diff(int argc, char** argv, int& index, const char* desc)
     count += diagram.SetCwDiffGlobal(iCw, deg_x, x, dx, r, false, flag);
     if (count > 0 && (mode == "try" || mode == "deduce")) {
         Logger::LogSummary("Changed differentials", count);
-        diagram.DeduceDiffs(0, 500, 0, SSFlag::no_op);  ////
+        /* Only the degrees affected since the last deduction are deduced */
+        diagram.DeduceDiffsDirty(0, 500, SSFlag::no_op);  ////
     }
     if (mode == "add" || mode == "deduce") {
         Logger::LogSummary("Changed differentials", count);
@@ -95,38 +199,25 @@ int main_add_diff_from_file(int argc, char** argv, int& index, const char* desc)
     myio::AssertFileExists(filenameLog);
     std::ifstream fileLog(filenameLog);
     std::string line;
-    int count_lines = 0, count_diffs = 0;
+    int count_lines = 0;
     std::regex is_duduce_regex("^(?:deduce - |)((?:\\w|_|)+) \\((\\d+),(?:\\s|)(\\d+)\\) d_(\\d+)\\[((?:\\d|\\s|,)*)\\]=\\[((?:\\d|\\s|,)*)\\]"); /* match example: deduce - S0 (66, 6) d_5[0]=[] */
     std::smatch match;
 
-    std::string cw;
-    int stem = -1, s = -1, r = 0;
-    int1d x, dx;
-    Diagram diagram(diagram_name, flag);
-
+    std::vector<ImportDiff> diffs;
     while (std::getline(fileLog, line) && count_lines++ < lineNum) {
         if (std::regex_search(line, match, is_duduce_regex); match[0].matched) {
-            cw = match[1].str();
-            stem = std::stoi(match[2].str());
-            s = std::stoi(match[3].str());
-            r = std::stoi(match[4].str());
-
-            AdamsDeg deg_x(s, stem + s);
-            x = myio::Deserialize<int1d>(match[5].str());
-            dx = myio::Deserialize<int1d>(match[6].str());
-
-            auto iCw = diagram.GetIndexCwByName(cw);
-            if (diagram.IsNewDiff(diagram.GetSS(iCw), deg_x, x, dx, r)) {
-                Logger::LogDiff(0, EnumReason::manual, diagram.GetCwName(iCw), deg_x, x, dx, r);
-                count_diffs += diagram.SetCwDiffGlobal(iCw, deg_x, x, dx, r, false, flag);
-			}
-        }
-        if (count_lines % 10000 == 0) {
-            fmt::print("Deduce trivial diffs\n\n");
-            diagram.DeduceTrivialDiffs(flag);
+            int stem = std::stoi(match[2].str()), s = std::stoi(match[3].str());
+            diffs.push_back({match[1].str(), AdamsDeg(s, stem + s), myio::Deserialize<int1d>(match[5].str()), myio::Deserialize<int1d>(match[6].str()), std::stoi(match[4].str()), count_lines});
         }
     }
 
+    std::unique_ptr<Diagram> holder;
+    Diagram& diagram = OpenDiagram(diagram_name, flag, holder);
+    int count_diffs = diagram.ImportDiffs(std::move(diffs), EnumReason::manual, flag);
+    Logger::LogSummary("Changed differentials", count_diffs);
+    fmt::print("Deduce trivial diffs\n\n");
+    diagram.DeduceTrivialDiffs(flag);
+
     diagram.save(diagram_name, flag);
     return 0;
 }
@@ -146,36 +237,22 @@ int main_add_diff_from_log(int argc, char** argv, int& index, const char* desc)
 
     myio::AssertFileExists(filenameLog);
     DbLog dbLog(filenameLog);
-    int count_lines = 0, count_diffs = 0;
 
-    std::string cw;
-    int stem = -1, s = -1, r = 0;
-    int1d x, dx;
-    Diagram diagram(diagram_name, flag);
-
-    try {
-        myio::Statement stmt(dbLog, fmt::format("SELECT name, stem, s, r, x, dx FROM log WHERE id<={} AND depth=0 AND reason!=\"Error\" AND reason!=\"nat\"", lineNum));
-        while (stmt.step() == MYSQLITE_ROW && count_lines++ < lineNum) {
-            cw = stmt.column_str(0);
-            stem = stmt.column_int(1);
-            s = stmt.column_int(2);
-            r = stmt.column_int(3);
-
-            AdamsDeg deg_x(s, stem + s);
-            x = myio::Deserialize<int1d>(stmt.column_str(4));
-            dx = myio::Deserialize<int1d>(stmt.column_str(5));
-
-            auto iCw = diagram.GetIndexCwByName(cw);
-            Logger::LogDiff(0, EnumReason::manual, diagram.GetCwName(iCw), deg_x, x, dx, r);
-            count_diffs += diagram.SetCwDiffGlobal(iCw, deg_x, x, dx, r, false, flag);
-        }
-        if (count_lines % 10000 == 0) {
-            fmt::print("Deduce trivial diffs\n\n");
-            diagram.DeduceTrivialDiffs(flag);
+    std::vector<ImportDiff> diffs;
+    {
+        myio::Statement stmt(dbLog, fmt::format("SELECT name, stem, s, r, x, dx, id FROM log WHERE id<={} AND depth=0 AND reason!=\"Error\" AND reason!=\"nat\"", lineNum));
+        while (stmt.step() == MYSQLITE_ROW) {
+            int stem = stmt.column_int(1), s = stmt.column_int(2);
+            diffs.push_back({stmt.column_str(0), AdamsDeg(s, stem + s), ColumnIndices(stmt, 4), ColumnIndices(stmt, 5), stmt.column_int(3), stmt.column_int(6)});
         }
     }
-    catch (SSException&) {
-    }
+
+    std::unique_ptr<Diagram> holder;
+    Diagram& diagram = OpenDiagram(diagram_name, flag, holder);
+    int count_diffs = diagram.ImportDiffs(std::move(diffs), EnumReason::manual, flag);
+    Logger::LogSummary("Changed differentials", count_diffs);
+    fmt::print("Deduce trivial diffs\n\n");
+    diagram.DeduceTrivialDiffs(flag);
 
     diagram.save(diagram_name, flag);
     return 0;
@@ -200,7 +277,8 @@ int main_add_cofseq_diff(int argc, char** argv, int& index, const char* desc)
 
     auto flag = SSFlag::cofseq;
 
-    Diagram diagram(diagram_name, flag);
+    std::unique_ptr<Diagram> holder;
+    Diagram& diagram = OpenDiagram(diagram_name, flag, holder);
 
     /* #Check if x, dx are valid */
     int index_cofseq = diagram.GetCofSeqIndexByName(cofseq_name);
@@ -78,6 +78,7 @@ void generate_db(const std::string& diagram, const std::string& name, int t_max,
     db.save_basis(table_prefix, basis, repr);
     db.drop_and_create_ss(table_prefix);
     db.save_ss(table_prefix, nodes_ss);
+    db.drop_table(name + "_contradictions");
 
     db.drop_and_create_pi_relations(name);
     db.drop_and_create_pi_basis(name);
@@ -1,12 +1,14 @@
 #include "algebras/linalg.h"
 #include "main.h"
 #include "mylog.h"
+#include <fmt/ranges.h>
+#include <thread>
 
 bool IsPossTgtCofseq(const CofSeq& cofseq, size_t iCs, AdamsDeg deg, int r_max)
 {
     const size_t iCs1 = (iCs + 2) % 3;
     const auto& deg_map = cofseq.degMap[iCs1];
-    if (deg.t - deg_map.t > cofseq.t_max[iCs1])
+    if (OutOfRange(deg - deg_map, cofseq.t_max[iCs1], cofseq.nodes_ss[iCs1]->stem_max()))
         return true;
     r_max = std::min(r_max, deg.s);
     if (r_max < 0)
@@ -18,7 +20,7 @@ bool IsPossTgtCofseq(const CofSeq& cofseq, size_t iCs, AdamsDeg deg, int r_max)
     for (int r1 = deg_map.s; r1 <= r_max; ++r1) {
         AdamsDeg d_src = deg - AdamsDeg{r1, deg_map.stem() + r1};
         if (PossEinf(nodes_ss_from, d_src))
-            if (PossMoreEinf(nodes_ss_from, d_src) || GetMaxLevelWithND(ut::GetRecentValue(nodes_cofseq_from, d_src)) >= LEVEL_MAX - r1)
+            if (PossMoreEinf(nodes_ss_from, d_src) || GetMaxLevelWithND(nodes_cofseq_from.GetRecentValue(d_src)) >= LEVEL_MAX - r1)
                 return true;
     }
     return false;
@@ -29,7 +31,7 @@ size_t GetFirstIndexOfFixedLevelsCofseq(const CofSeq& cofseq, size_t iCs, AdamsD
     const size_t iCs_next = (iCs + 1) % 3;
     auto& nodes_ss_next = *cofseq.nodes_ss[iCs_next];
     const int stem_map = cofseq.degMap[iCs].stem();
-    const auto& sc = ut::GetRecentValue(cofseq.nodes_cofseq[iCs], deg);
+    const auto& sc = cofseq.nodes_cofseq[iCs].GetRecentValue(deg);
     size_t result = sc.levels.size();
     for (size_t i = sc.levels.size(); i-- > 0;) {
         if (sc.diffs[i] == NULL_DIFF || sc.levels[i] < level_min)
@@ -51,7 +53,7 @@ int Diagram::GetFirstFixedLevelForPlotCofseq(const CofSeq& cofseq, size_t iCs, A
     const size_t iCs2 = (iCs + 1) % 3;
     auto& nodes_ss2 = *cofseq.nodes_ss[iCs2];
     const int stem_map = cofseq.degMap[iCs].stem();
-    const auto& sc = ut::GetRecentValue(cofseq.nodes_cofseq[iCs], deg);
+    const auto& sc = cofseq.nodes_cofseq[iCs].GetRecentValue(deg);
     int result = LEVEL_MAX + 1;
     for (size_t i = sc.levels.size(); i-- > 0 && sc.levels[i] >= LEVEL_PERM;) {
         if (i == 0 || sc.levels[i - 1] != sc.levels[i]) {
@@ -70,11 +72,11 @@ std::pair<int, int> Diagram::CountPossDrTgtCofseq(const CofSeq& cofseq, size_t i
 {
     std::pair<int, int> result;
     if (ut::has(cofseq.nodes_cofseq[iCs].front(), deg_tgt)) {
-        const auto& sc_tgt = ut::GetRecentValue(cofseq.nodes_cofseq[iCs], deg_tgt);
+        const auto& sc_tgt = cofseq.nodes_cofseq[iCs].GetRecentValue(deg_tgt);
         result.first = (int)GetFirstIndexOnLevel(sc_tgt, r);
         result.second = (int)GetFirstIndexOfFixedLevelsCofseq(cofseq, iCs, deg_tgt, LEVEL_MAX - r + 1) - result.first;
     }
-    else if (deg_tgt.t > cofseq.t_max[(iCs + 1) % 3])
+    else if (OutOfRange(deg_tgt, cofseq.t_max[(iCs + 1) % 3], cofseq.nodes_ss[(iCs + 1) % 3]->stem_max()))
         result = {-1, 100000}; /* Infinitely many possibilities */
     else
         result = {-1, 0};
@@ -85,7 +87,7 @@ std::pair<int, int> Diagram::CountPossDrSrcCofseq(const CofSeq& cofseq, size_t i
 {
     std::pair<int, int> result;
     if (ut::has(cofseq.nodes_cofseq[iCs].front(), deg_src)) {
-        const auto& sc_src = ut::GetRecentValue(cofseq.nodes_cofseq[iCs], deg_src);
+        const auto& sc_src = cofseq.nodes_cofseq[iCs].GetRecentValue(deg_src);
         result.first = (int)GetFirstIndexOnLevel(sc_src, LEVEL_MAX - r);
         result.second = (int)GetFirstIndexOfFixedLevelsCofseq(cofseq, iCs, deg_src, LEVEL_MAX - r + 1) - result.first;
     }
@@ -102,7 +104,7 @@ int Diagram::NextRTgtCofseq(const CofSeq& cofseq, size_t iCs, AdamsDeg deg, int
     int t_max2 = cofseq.t_max[iCs2];
     for (int r1 = r; r1 <= R_PERM; ++r1) {
         AdamsDeg d_tgt = deg + AdamsDeg{r1, r1 + stem_map};
-        if (d_tgt.t > t_max2)
+        if (OutOfRange(d_tgt, t_max2, nodes_ss_tgt.stem_max()))
             return r1;
         if (r1 >= 20 && AboveJ(d_tgt) && BelowCokerJ(deg)) /* Image of J */
             return R_PERM;
@@ -126,7 +128,7 @@ int Diagram::NextRSrcCofseq(const CofSeq& cofseq, size_t iCs, AdamsDeg deg, int
     int stem_map = cofseq.degMap[iCs1].stem();
     for (int r1 = r_max; r1 >= 0; --r1) {
         AdamsDeg d_src = deg - AdamsDeg{r1, r1 + stem_map};
-        if (d_src.t > t_max1)
+        if (OutOfRange(d_src, t_max1, nodes_ss_src.stem_max()))
             return r1;
         if (r1 >= 20 && AboveJ(deg) && BelowCokerJ(d_src)) /* Image of J */
             continue;
@@ -150,7 +152,7 @@ void Diagram::CacheNullDiffsCofseq(const CofSeq& cofseq, size_t iCs, AdamsDeg de
     auto& nodes_ss_next = *cofseq.nodes_ss[iCs_next];
     int stem_map_prev = cofseq.degMap[iCs_prev].stem();
     int stem_map = cofseq.degMap[iCs].stem();
-    const auto& sc = ut::GetRecentValue(nodes_cofseq, deg);
+    const auto& sc = nodes_cofseq.GetRecentValue(deg);
     for (size_t i = 0; i < sc.diffs.size(); ++i) {
         if (sc.diffs[i] != NULL_DIFF)
             continue;
@@ -159,7 +161,7 @@ void Diagram::CacheNullDiffsCofseq(const CofSeq& cofseq, size_t iCs, AdamsDeg de
         if (sc.levels[i] > LEVEL_PERM) {
             int r = LEVEL_MAX - sc.levels[i];
             AdamsDeg deg_tgt = deg + AdamsDeg{r, r + stem_map};
-            if (deg_tgt.t > cofseq.t_max[iCs_next])
+            if (OutOfRange(deg_tgt, cofseq.t_max[iCs_next], cofseq.nodes_ss[iCs_next]->stem_max()))
                 continue;
             auto [index, count] = CountPossDrTgtCofseq(cofseq, iCs_next, deg_tgt, r);
             auto [index_ss, count_ss] = CountPossMorePerm(nodes_ss_next, deg_tgt);
@@ -175,7 +177,7 @@ void Diagram::CacheNullDiffsCofseq(const CofSeq& cofseq, size_t iCs, AdamsDeg de
         else if (sc.levels[i] < LEVEL_MAX / 2) {
             int r = sc.levels[i];
             AdamsDeg deg_src = deg - AdamsDeg{r, r + stem_map_prev};
-            if (deg_src.t > cofseq.t_max[iCs_prev])
+            if (OutOfRange(deg_src, cofseq.t_max[iCs_prev], cofseq.nodes_ss[iCs_prev]->stem_max()))
                 continue;
             auto [index, count] = CountPossDrSrcCofseq(cofseq, iCs_prev, deg_src, r);
             auto [index_ss, count_ss] = CountPossMorePerm(nodes_ss_prev, deg_src);
@@ -220,12 +222,12 @@ bool Diagram::IsNewDiffCofseq(const CofSeq& cofseq, size_t iCs, AdamsDeg deg_x,
     auto& nodes_cofseq_dx = cofseq.nodes_cofseq[iCs2];
     AdamsDeg deg_dx = deg_x + AdamsDeg{r, r + stem_map};
     if (x.empty())
-        return !dx.empty() && !IsZeroOnLevel(ut::GetRecentValue(nodes_cofseq_dx, deg_dx), dx, r);
+        return !dx.empty() && !IsZeroOnLevel(nodes_cofseq_dx.GetRecentValue(deg_dx), dx, r);
     int1d dx1 = GetDiff(cofseq.nodes_cofseq[iCs], deg_x, x, r);  //// TODO: optimize the allocation
     if (dx1 == NULL_DIFF)
         return true;
     int1d diff = lina::add(dx, dx1);
-    return !diff.empty() && !IsZeroOnLevel(ut::GetRecentValue(nodes_cofseq_dx, deg_dx), diff, r);
+    return !diff.empty() && !IsZeroOnLevel(nodes_cofseq_dx.GetRecentValue(deg_dx), diff, r);
 }
 
 void Diagram::ReSetScCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg, SSFlag flag)
@@ -236,9 +238,9 @@ void Diagram::ReSetScCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg, SSFlag fla
 
     auto& nodes_cofseq = cofseq.nodes_cofseq[iCs];
 
-    const auto& sc_ss = ut::GetRecentValue(nodes_ss, deg);
+    const auto& sc_ss = nodes_ss.GetRecentValue(deg);
     size_t first_PC = GetFirstIndexOnLevel(sc_ss, LEVEL_PERM);
-    Staircase sc = ut::GetRecentValue(nodes_cofseq, deg);
+    Staircase sc = nodes_cofseq.GetRecentValue(deg);
 
     int stem_map = cofseq.degMap[iCs].stem();
     int stem_prev = cofseq.degMap[iCs_prev].stem();
@@ -270,7 +272,9 @@ void Diagram::ReSetScCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg, SSFlag fla
         }
     }
 
-    nodes_cofseq.back()[deg] = std::move(sc_new);
+    nodes_cofseq.Set(deg, std::move(sc_new));
+    ++version_;
+    MarkDirtyCofseq(cofseq, iCs, deg);
 
     /* Add images and cycles */
     for (size_t i = 0; i < levels.size(); ++i) {
@@ -390,8 +394,8 @@ int Diagram::DeduceDiffsCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg, int dep
                 unsigned i_max = 1 << (nd.count + nd.count_ss);
                 const Staircase* sc_tgt = nullptr;
                 if (nd.count > 0)
-                    sc_tgt = &ut::GetRecentValue(nodes_cofseq_next, deg_tgt);
-                const auto& sc_ss = ut::GetRecentValue(nodes_ss_next, deg_tgt);
+                    sc_tgt = &nodes_cofseq_next.GetRecentValue(deg_tgt);
+                const auto& sc_ss = nodes_ss_next.GetRecentValue(deg_tgt);
 
                 for (unsigned i = 1; i < i_max; ++i) {
                     dx1.clear();
@@ -449,8 +453,8 @@ int Diagram::DeduceDiffsCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg, int dep
                 unsigned i_max = 1 << (nd.count + nd.count_ss);
                 const Staircase* sc_src = nullptr;
                 if (nd.count > 0)
-                    sc_src = &ut::GetRecentValue(nodes_cofseq_prev, deg_src);
-                const auto& sc_ss = ut::GetRecentValue(nodes_ss_prev, deg_src);
+                    sc_src = &nodes_cofseq_prev.GetRecentValue(deg_src);
+                const auto& sc_ss = nodes_ss_prev.GetRecentValue(deg_src);
 
                 for (unsigned i = 1; i < i_max; ++i) {
                     x1.clear();
@@ -528,13 +532,24 @@ int Diagram::DeduceDiffsCofseq(int stem_min, int stem_max, int depth, SSFlag fla
     count += DeduceTrivialDiffsCofseq(flag);
     count += CommuteCofseq(flag);
     count += DeduceTrivialDiffsCofseq(flag);
+    /* Homotopy is not synchronized to the workers */
+    if (depth == 0 && (flag & SSFlag::par_cofseq) && !(flag & SSFlag::pi))
+        return count + DeduceDiffsCofseqPar(stem_min, stem_max, flag);
+    return count + DeduceDiffsCofseqPass(stem_min, stem_max, depth, flag);
+}
+
+int Diagram::DeduceDiffsCofseqPass(int stem_min, int stem_max, int depth, SSFlag flag)
+{
+    if (depth == 0 && !(flag & SSFlag::full_sweep))
+        return DeduceDiffsCofseqDirty(stem_min, stem_max, flag);
+    int count = 0;
     for (size_t iCof : deduce_list_cofseq_) {
         auto& cofseq = cofseqs_[iCof];
         for (size_t iCs = 0; iCs < 3; ++iCs) {
             auto degs = ut::get_keys(cofseq.nodes_cofseq[iCs].front());
             std::stable_sort(degs.begin(), degs.end(), [](AdamsDeg deg1, AdamsDeg deg2) { return deg1.stem() < deg2.stem(); });
             for (AdamsDeg deg : degs) {
-                if (depth == 0)
+                if (depth == 0 && !Logger::IsBuffered())
                     fmt::print("{}:{} deg={}                        \r", cofseq.name, iCs, deg);
                 if (!BelowS0VanishingLine(deg))
                     continue;
@@ -550,6 +565,139 @@ int Diagram::DeduceDiffsCofseq(int stem_min, int stem_max, int depth, SSFlag fla
     return count;
 }
 
+std::vector<CofSeqComponent> Diagram::GetCofseqComponents() const
+{
+    auto roots = GetCwComponentRoots();
+    auto index = [this](IndexCw iCw) { return iCw.isRing ? iCw.index : rings_.size() + iCw.index; };
+
+    std::vector<CofSeqComponent> result;
+    std::map<size_t, size_t> root_to_component;
+    for (size_t iCof : deduce_list_cofseq_) {
+        auto [p, inserted] = root_to_component.try_emplace(roots[index(cofseqs_[iCof].indexCw[0])], result.size());
+        if (inserted)
+            result.emplace_back();
+        result[p->second].deduce_list.push_back(iCof);
+    }
+    for (size_t iCw = 0; iCw < roots.size(); ++iCw)
+        if (auto p = root_to_component.find(roots[iCw]); p != root_to_component.end())
+            result[p->second].cws.push_back(iCw);
+    for (size_t iCof = 0; iCof < cofseqs_.size(); ++iCof)
+        if (auto p = root_to_component.find(roots[index(cofseqs_[iCof].indexCw[0])]); p != root_to_component.end())
+            result[p->second].cofseqs.push_back(iCof);
+    return result;
+}
+
+int Diagram::DeduceDiffsCofseqPar(int stem_min, int stem_max, SSFlag flag)
+{
+    auto components = GetCofseqComponents();
+    if (components.size() < 2)
+        return DeduceDiffsCofseqPass(stem_min, stem_max, 0, flag);
+
+    const size_t n = components.size();
+    const size_t num_workers = std::min(std::min(size_t(32), n), std::max(size_t(std::thread::hardware_concurrency()), size_t(1)));
+    SyncWorkers(num_workers, flag);
+    const SSFlag flag_worker = SSFlag(uint32_t(flag) & ~uint32_t(SSFlag::par_try));
+
+    /* Worker k deduces the components k, k + num_workers, ... in turn.
+     * The components do not interact so the order does not change the result of each of them.
+     * The trivial differentials are already deduced so a worker does not change the other components. */
+    std::vector<int> counts(n);
+    std::vector<LogRow1d> logs(n);
+    std::vector<std::string> outs(n);
+    std::vector<std::exception_ptr> errors(n);
+    ut::for_each_par32(num_workers, [&](size_t k) {
+        auto& worker = *workers_[k];
+        worker.dirty_ = dirty_;
+        worker.unsynced_cofseq_ = unsynced_cofseq_;
+        for (size_t i = k; i < n; i += num_workers) {
+            worker.deduce_list_cofseq_ = components[i].deduce_list;
+            Logger::SetBuffer(&logs[i], &outs[i]);
+            try {
+                counts[i] = worker.DeduceDiffsCofseqPass(stem_min, stem_max, 0, flag_worker);
+            }
+            catch (...) {
+                errors[i] = std::current_exception();
+            }
+            Logger::SetBuffer(nullptr);
+        }
+        worker.deduce_list_cofseq_ = deduce_list_cofseq_;
+    });
+
+    /* Merge in the order of components. Stop at the first component that failed as the serial loop would. */
+    int count = 0;
+    ++version_; /* The workers are no longer synchronized */
+    for (size_t i = 0; i < n; ++i) {
+        auto& worker = *workers_[i % num_workers];
+        Logger::FlushBuffer(logs[i], outs[i]);
+        for (size_t iCw : components[i].cws)
+            AdoptWorkerCw(worker, iCw);
+        for (size_t iCof : components[i].cofseqs)
+            for (size_t iCs = 0; iCs < 3; ++iCs)
+                cofseqs_[iCof].nodes_cofseq[iCs] = worker.cofseqs_[iCof].nodes_cofseq[iCs];
+        if (errors[i])
+            std::rethrow_exception(errors[i]);
+        count += counts[i];
+    }
+    return count;
+}
+
+void Diagram::MarkDirtyCofseq(const CofSeq& cofseq, size_t iCs, AdamsDeg deg)
+{
+    if (rank_dirty_cofseq_.empty() || depth_ > 0)
+        return;
+    const size_t iCof = size_t(&cofseq - cofseqs_.data());
+    const int rank = rank_dirty_cofseq_[iCof];
+    if (rank < 0)
+        return;
+    const size_t iCs_prev = (iCs + 2) % 3;
+    const size_t iCs_next = (iCs + 1) % 3;
+    dirty_cofseq_.insert({rank, (int)iCs, deg.stem(), deg.s});
+    /* Sources of the differentials hitting deg */
+    ForEachDegInStem(degs_cofseq_[iCof][iCs_prev], deg.stem() - cofseq.degMap[iCs_prev].stem(), [&](AdamsDeg d) {
+        if (d.s < deg.s)
+            dirty_cofseq_.insert({rank, (int)iCs_prev, d.stem(), d.s});
+    });
+    /* Targets of the differentials from deg */
+    ForEachDegInStem(degs_cofseq_[iCof][iCs_next], deg.stem() + cofseq.degMap[iCs].stem(), [&](AdamsDeg d) {
+        if (d.s > deg.s)
+            dirty_cofseq_.insert({rank, (int)iCs_next, d.stem(), d.s});
+    });
+}
+
+int Diagram::DeduceDiffsCofseqDirty(int stem_min, int stem_max, SSFlag flag)
+{
+    rank_dirty_cofseq_.assign(cofseqs_.size(), -1);
+    degs_cofseq_.assign(cofseqs_.size(), {});
+    dirty_cofseq_.clear();
+    for (size_t i = 0; i < deduce_list_cofseq_.size(); ++i) {
+        size_t iCof = deduce_list_cofseq_[i];
+        rank_dirty_cofseq_[iCof] = (int)i;
+        for (size_t iCs = 0; iCs < 3; ++iCs) {
+            degs_cofseq_[iCof][iCs] = OrderDegsByStem(cofseqs_[iCof].nodes_cofseq[iCs].front());
+            for (AdamsDeg deg : degs_cofseq_[iCof][iCs])
+                dirty_cofseq_.insert({(int)i, (int)iCs, deg.stem(), deg.s});
+        }
+    }
+
+    int count = 0;
+    while (!dirty_cofseq_.empty()) {
+        while (!dirty_cofseq_.empty()) {
+            auto [rank, iCs, stem, s] = *dirty_cofseq_.begin();
+            dirty_cofseq_.erase(dirty_cofseq_.begin());
+            AdamsDeg deg(s, stem + s);
+            if (stem < stem_min || stem > stem_max || !BelowS0VanishingLine(deg))
+                continue;
+            auto& cofseq = cofseqs_[deduce_list_cofseq_[rank]];
+            if (!Logger::IsBuffered())
+                fmt::print("{}:{} deg={}                        \r", cofseq.name, iCs, deg);
+            count += DeduceDiffsCofseq(cofseq, (size_t)iCs, deg, 0, flag);
+        }
+        DeduceTrivialDiffsCofseq(flag);
+    }
+    rank_dirty_cofseq_.clear();
+    return count;
+}
+
 int Diagram::DeduceDiffsNbhdCofseq(CofSeq& cofseq, size_t iCs_, int stem, int depth, SSFlag flag)
 {
     int count = 0;
@@ -570,36 +718,114 @@ int Diagram::DeduceDiffsNbhdCofseq(CofSeq& cofseq, size_t iCs_, int stem, int de
     return count;
 }
 
+void Diagram::MarkUnsyncedCofseq(IndexCw iCw, AdamsDeg deg)
+{
+    if (unsynced_cofseq_.empty() || depth_ > 0)
+        return;
+    auto& unsynced = unsynced_cofseq_[iCw.isRing ? iCw.index : rings_.size() + iCw.index];
+    if (unsynced)
+        unsynced->insert({deg.stem(), deg.s});
+}
+
+void Diagram::SyncCofseq(size_t iCw, const AdamsDeg1d& degs, SSFlag flag)
+{
+    size_t size_rings = rings_.size();
+    auto& nodes_ss = iCw < size_rings ? rings_[iCw].nodes_ss : modules_[iCw - size_rings].nodes_ss;
+    const auto& ind_cofs = iCw < size_rings ? rings_[iCw].ind_cofs : modules_[iCw - size_rings].ind_cofs;
+    for (AdamsDeg d : degs) {
+        const auto& sc = nodes_ss.GetRecentValue(d);
+        for (size_t i = 0; i < sc.levels.size(); ++i) {
+            if (sc.levels[i] == LEVEL_PERM) {
+                for (auto& ind_cof : ind_cofs) {
+                    auto& cofseq = cofseqs_[ind_cof.iCof];
+                    auto iCs = (size_t)ind_cof.iCs;
+                    cofseq.nodes_cofseq[iCs].AddToFront(d);
+                    SetDiffScCofseq(cofseq, ind_cof.iCs, d, sc.basis[i], NULL_DIFF, 0, flag);  ////
+                }
+            }
+        }
+    }
+    for (AdamsDeg d : degs) {
+        for (auto& ind_cof : ind_cofs) {
+            auto& cofseq = cofseqs_[ind_cof.iCof];
+            auto iCs = (size_t)ind_cof.iCs;
+            if (ut::has(cofseq.nodes_cofseq[iCs].front(), d))
+                ReSetScCofseq(cofseq, ind_cof.iCs, d, flag);
+        }
+    }
+}
+
 void Diagram::SyncCofseq(SSFlag flag)
 {
     size_t size_rings = rings_.size();
     const size_t num_cw = size_rings + modules_.size();
-    for (size_t iCw = 0; iCw < num_cw; ++iCw) {
-        auto& nodes_ss = iCw < size_rings ? rings_[iCw].nodes_ss : modules_[iCw - size_rings].nodes_ss;
-        const auto& ind_cofs = iCw < size_rings ? rings_[iCw].ind_cofs : modules_[iCw - size_rings].ind_cofs;
-        for (auto& [d, _] : nodes_ss.front()) {
-            const auto& sc = ut::GetRecentValue(nodes_ss, d);
-            for (size_t i = 0; i < sc.levels.size(); ++i) {
-                if (sc.levels[i] == LEVEL_PERM) {
-                    for (auto& ind_cof : ind_cofs) {
-                        auto& cofseq = cofseqs_[ind_cof.iCof];
-                        auto iCs = (size_t)ind_cof.iCs;
-                        if (!ut::has(cofseq.nodes_cofseq[iCs].front(), d))
-                            cofseq.nodes_cofseq[iCs].front()[d] = {};
-                        SetDiffScCofseq(cofseq, ind_cof.iCs, d, sc.basis[i], NULL_DIFF, 0, flag);  ////
-                    }
+    auto sync_full = [&]() {
+        for (size_t iCw = 0; iCw < num_cw; ++iCw) {
+            auto& nodes_ss = iCw < size_rings ? rings_[iCw].nodes_ss : modules_[iCw - size_rings].nodes_ss;
+            SyncCofseq(iCw, ut::get_keys(nodes_ss.front()), flag);
+        }
+    };
+    if (flag & SSFlag::full_sync) {
+        sync_full();
+    }
+    else {
+        for (size_t iCw = 0; iCw < num_cw; ++iCw) {
+            auto& nodes_ss = iCw < size_rings ? rings_[iCw].nodes_ss : modules_[iCw - size_rings].nodes_ss;
+            const auto& ind_cofs = iCw < size_rings ? rings_[iCw].ind_cofs : modules_[iCw - size_rings].ind_cofs;
+            /* A cofseq without a table has never been synchronized */
+            bool full = !unsynced_cofseq_[iCw] || std::any_of(ind_cofs.begin(), ind_cofs.end(), [&](IndexCof ind_cof) { return !cofseqs_[ind_cof.iCof].in_db; });
+            AdamsDeg1d degs;
+            if (full)
+                degs = ut::get_keys(nodes_ss.front());
+            else {
+                for (auto [stem, s] : *unsynced_cofseq_[iCw]) {
+                    AdamsDeg d(s, stem + s);
+                    if (ut::has(nodes_ss.front(), d))
+                        degs.push_back(d);
                 }
+                std::sort(degs.begin(), degs.end());
             }
+            SyncCofseq(iCw, degs, flag);
         }
-        for (auto& [d, _] : nodes_ss.front()) {
-            for (auto& ind_cof : ind_cofs) {
-                auto& cofseq = cofseqs_[ind_cof.iCof];
-                auto iCs = (size_t)ind_cof.iCs;
-                if (ut::has(cofseq.nodes_cofseq[iCs].front(), d))
-                    ReSetScCofseq(cofseq, ind_cof.iCs, d, flag);
+
+        if (flag & SSFlag::check_sync) {
+            std::vector<std::array<Staircases1d, 3>> nodes_incremental;
+            for (auto& cofseq : cofseqs_)
+                nodes_incremental.push_back(cofseq.nodes_cofseq);
+            sync_full();
+            int count_diff = 0;
+            for (size_t iCof = 0; iCof < cofseqs_.size(); ++iCof) {
+                auto& cofseq = cofseqs_[iCof];
+                for (size_t iCs = 0; iCs < 3; ++iCs) {
+                    auto& nodes_full = cofseq.nodes_cofseq[iCs];
+                    auto& nodes_inc = nodes_incremental[iCof][iCs];
+                    std::set<AdamsDeg> degs;
+                    for (auto& [d, _] : nodes_full.front())
+                        degs.insert(d);
+                    for (auto& [d, _] : nodes_inc.front())
+                        degs.insert(d);
+                    for (AdamsDeg d : degs) {
+                        if (!ut::has(nodes_full.front(), d) || !ut::has(nodes_inc.front(), d)) {
+                            fmt::print("check_sync: {} {} {} is missing in the {} sync\n", cofseq.name, iCs, d, ut::has(nodes_full.front(), d) ? "incremental" : "full");
+                            ++count_diff;
+                            continue;
+                        }
+                        auto& sc_full = nodes_full.GetRecentValue(d);
+                        auto& sc_inc = nodes_inc.GetRecentValue(d);
+                        if (sc_full.basis != sc_inc.basis || sc_full.diffs != sc_inc.diffs || sc_full.levels != sc_inc.levels) {
+                            fmt::print("check_sync: {} {} {}\nfull={}\nincremental={}\n", cofseq.name, iCs, d, sc_full, sc_inc);
+                            ++count_diff;
+                        }
+                    }
+                }
             }
+            if (count_diff)
+                throw MyException(0x2d7c41e9U, fmt::format("The incremental sync of cofseq differs from the full sync in {} degrees", count_diff));
+            fmt::print("check_sync: the incremental sync of cofseq agrees with the full sync\n");
         }
     }
+    for (auto& unsynced : unsynced_cofseq_)
+        unsynced = std::set<std::pair<int, int>>{};
 }
 
 /* Return the minimal length of the crossing differentials */
@@ -622,7 +848,7 @@ int GetCofseqCrossR(const Staircases1d& nodes_cofseq, const Staircases1d& nodes_
                 return result;
             continue;
         }
-        auto& sc = ut::GetRecentValue(nodes_cofseq, deg_x);
+        auto& sc = nodes_cofseq.GetRecentValue(deg_x);
         for (size_t i = sc.levels.size(); i-- > 0;) {
             if (sc.levels[i] < LEVEL_MAX / 2)
                 break;
@@ -686,7 +912,7 @@ int Diagram::CommuteCofseq(size_t iComm, SSFlag flag)
 
     if (comm.g0 == -1) {
         for (auto& [deg, _] : nodes_cof_f0_tgt.front()) {
-            Staircase sc = ut::GetRecentValue(nodes_cof_f0_tgt, deg);
+            Staircase sc = nodes_cof_f0_tgt.GetRecentValue(deg);
             for (size_t i = 0; i < sc.levels.size(); ++i) {
                 if (sc.levels[i] < LEVEL_MAX / 2) {
                     if (IsNewDiffCofseq(cofseq_f1, f1->ind_cof.iCs, deg, sc.basis[i], int1d{}, R_PERM - 1)) {
@@ -713,7 +939,7 @@ int Diagram::CommuteCofseq(size_t iComm, SSFlag flag)
         int1d f0x, f1f0x, g0x;
         if (comm.g1 == -1) {
             for (auto& [deg_x, _] : nodes_cof_f0_src.front()) {
-                Staircase sc_f0 = ut::GetRecentValue(nodes_cof_f0_src, deg_x);
+                Staircase sc_f0 = nodes_cof_f0_src.GetRecentValue(deg_x);
                 for (size_t i = 0; i < sc_f0.levels.size(); ++i) {
                     GetRAndDiff(sc_f0, i, r_f0, f0x);
                     AdamsDeg deg_f0x = deg_x + AdamsDeg(r_f0, r_f0 + stem_f0);
@@ -797,7 +1023,7 @@ int Diagram::CommuteCofseq(size_t iComm, SSFlag flag)
             int r_g1 = -1;
             int1d g1g0x;
             for (auto& [deg_x, _] : nodes_cof_f0_src.front()) {
-                Staircase sc_f0 = ut::GetRecentValue(nodes_cof_f0_src, deg_x);
+                Staircase sc_f0 = nodes_cof_f0_src.GetRecentValue(deg_x);
                 for (size_t i = 0; i < sc_f0.levels.size(); ++i) {
                     /* f1(f0x) = g1(g0x)
                      * We choose {x} such that g0{x}={g0x}
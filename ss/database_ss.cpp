@@ -16,6 +16,63 @@ AdamsDeg1d OrderDegsV2(const T& cont)
     return result;
 }
 
+/* Call `f(base, diff)` with the staircase row encoded as TEXT or BLOB */
+template <typename Fn>
+void EncodeSSRow(bool blob, const int1d& base, const int1d& diff, Fn f)
+{
+    if (blob)
+        f(myio::SerializeBlob(base), SerializeDiffBlob(diff));
+    else
+        f(myio::Serialize(base), SerializeDiff(diff));
+}
+
+template <typename T>
+int ConvertColumn(const DBSS& db, const std::string& table, const std::string& column, bool to_text)
+{
+    std::vector<int64_t> rowids;
+    std::vector<T> values;
+    {
+        myio::Statement stmt(db, "SELECT rowid, " + column + " FROM " + table + " WHERE " + column + " IS NOT NULL;");
+        while (stmt.step() == MYSQLITE_ROW) {
+            rowids.push_back(stmt.column_int64(0));
+            values.push_back(stmt.column_deserialize<T>(1));
+        }
+    }
+    myio::Statement stmt(db, "UPDATE " + table + " SET " + column + "=?1 WHERE rowid=?2;");
+    for (size_t i = 0; i < rowids.size(); ++i) {
+        if (to_text)
+            stmt.bind_and_step(myio::Serialize(values[i]), rowids[i]);
+        else
+            stmt.bind_and_step(myio::SerializeBlob(values[i]), rowids[i]);
+    }
+    return (int)rowids.size();
+}
+
+int DBSS::convert_format(const std::string& table_prefix, bool isRing, bool to_text) const
+{
+    int count = 0;
+    if (isRing) {
+        count += ConvertColumn<Mon>(*this, table_prefix + "_basis", "mon", to_text);
+        count += ConvertColumn<Poly>(*this, table_prefix + "_relations", "rel", to_text);
+    }
+    else {
+        count += ConvertColumn<MMod>(*this, table_prefix + "_basis", "mon", to_text);
+        count += ConvertColumn<Mod>(*this, table_prefix + "_relations", "rel", to_text);
+    }
+    if (has_column(table_prefix + "_basis", "d2"))
+        count += ConvertColumn<int1d>(*this, table_prefix + "_basis", "d2", to_text);
+    count += ConvertColumn<int1d>(*this, table_prefix + "_ss", "base", to_text);
+    count += ConvertColumn<int1d>(*this, table_prefix + "_ss", "diff", to_text);
+    return count;
+}
+
+int DBSS::convert_cofseq_format(const std::string& table, bool to_text) const
+{
+    int count = ConvertColumn<int1d>(*this, table, "base", to_text);
+    count += ConvertColumn<int1d>(*this, table, "diff", to_text);
+    return count;
+}
+
 void DBSS::save_pi_generators_mod(const std::string& table_prefix, const AdamsDeg1d& gen_degs, const Mod1d& gen_Einf) const
 {
     Statement stmt(*this, "INSERT INTO " + table_prefix + "_pi_generators (id, Einf, s, t) VALUES (?1, ?2, ?3, ?4);");
@@ -26,10 +83,68 @@ void DBSS::save_pi_generators_mod(const std::string& table_prefix, const AdamsDe
 void DBSS::update_ss(const std::string& table_prefix, const Staircases& nodes_ss) const
 {
     std::map<AdamsDeg, int> indices = load_basis_indices(table_prefix);
+    bool blob = has_blob(table_prefix + "_ss", "base");
     Statement stmt(*this, "UPDATE " + table_prefix + "_ss SET base=?1, diff=?2, level=?3 WHERE id=?4;");
     for (const auto& [deg, basis_ss_d] : nodes_ss)
         for (size_t i = 0; i < basis_ss_d.basis.size(); ++i)
-            stmt.bind_and_step(myio::Serialize(basis_ss_d.basis[i]), SerializeDiff(basis_ss_d.diffs[i]), basis_ss_d.levels[i], indices[deg] + (int)i);
+            EncodeSSRow(blob, basis_ss_d.basis[i], basis_ss_d.diffs[i], [&](auto&& base, auto&& diff) { stmt.bind_and_step(base, diff, basis_ss_d.levels[i], indices[deg] + (int)i); });
+}
+
+void DBSS::update_ss(const std::string& table_prefix, const Staircases& nodes_ss, const std::set<AdamsDeg>& degs) const
+{
+    if (degs.empty())
+        return;
+    std::map<AdamsDeg, int> indices = load_basis_indices(table_prefix);
+    bool blob = has_blob(table_prefix + "_ss", "base");
+    Statement stmt(*this, "UPDATE " + table_prefix + "_ss SET base=?1, diff=?2, level=?3 WHERE id=?4;");
+    for (AdamsDeg deg : degs) {
+        auto& basis_ss_d = nodes_ss.at(deg);
+        for (size_t i = 0; i < basis_ss_d.basis.size(); ++i)
+            EncodeSSRow(blob, basis_ss_d.basis[i], basis_ss_d.diffs[i], [&](auto&& base, auto&& diff) { stmt.bind_and_step(base, diff, basis_ss_d.levels[i], indices[deg] + (int)i); });
+    }
+}
+
+void DBSS::save_degs(const std::string& table, const std::set<std::pair<int, int>>& degs, const std::set<std::pair<int, int>>& degs_saved) const
+{
+    create_degs(table);
+    Statement stmt(*this, "INSERT OR IGNORE INTO " + table + " (s, t) VALUES (?1, ?2);");
+    Statement stmt_del(*this, "DELETE FROM " + table + " WHERE s=?1 AND t=?2;");
+    for (auto [stem, s] : degs)
+        if (!ut::has(degs_saved, std::make_pair(stem, s)))
+            stmt.bind_and_step(s, stem + s);
+    for (auto [stem, s] : degs_saved)
+        if (!ut::has(degs, std::make_pair(stem, s)))
+            stmt_del.bind_and_step(s, stem + s);
+}
+
+void DBSS::save_migrate_ss(const std::string& table_prefix, const std::string& source) const
+{
+    create_migrate_ss(table_prefix);
+    execute_cmd("DELETE FROM " + table_prefix + "_migrate_ss;");
+    Statement stmt(*this, "INSERT INTO " + table_prefix + "_migrate_ss (source) VALUES (?1);");
+    stmt.bind_and_step(source);
+}
+
+void DBSS::save_pi_fingerprint(const std::string& table_prefix, uint64_t fingerprint) const
+{
+    create_pi_fingerprint(table_prefix);
+    execute_cmd("DELETE FROM " + table_prefix + "_pi_fingerprint;");
+    Statement stmt(*this, "INSERT INTO " + table_prefix + "_pi_fingerprint (fingerprint) VALUES (?1);");
+    stmt.bind_and_step((int64_t)fingerprint);
+}
+
+void DBSS::save_contradictions(const std::string& table_prefix, const ContraMap& contras, const std::set<ContraKey>& keys_changed) const
+{
+    create_contradictions(table_prefix);
+    Statement stmt(*this, "INSERT OR REPLACE INTO " + table_prefix + "_contradictions (s, t, r, tryY, x, dx, fingerprint) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7);");
+    Statement stmt_del(*this, "DELETE FROM " + table_prefix + "_contradictions WHERE s=?1 AND t=?2 AND r=?3 AND tryY=?4 AND x=?5 AND dx=?6;");
+    for (auto& key : keys_changed) {
+        auto p = contras.find(key);
+        if (p != contras.end())
+            stmt.bind_and_step(key.deg.s, key.deg.t, key.r, (int)key.tryY, myio::Serialize(key.x), myio::Serialize(key.dx), (int64_t)p->second);
+        else
+            stmt_del.bind_and_step(key.deg.s, key.deg.t, key.r, (int)key.tryY, myio::Serialize(key.x), myio::Serialize(key.dx));
+    }
 }
 
 void DBSS::save_ss(const std::string& table_prefix, const Staircases& nodes_ss) const
@@ -47,27 +162,27 @@ void DBSS::save_ss(const std::string& table_prefix, const Staircases& nodes_ss)
 void DBSS::save_cofseq(const std::string& table, const CofSeq& cofseq) const
 {
     Statement stmt(*this, "INSERT INTO " + table + " (iC, base, diff, level, s, t) VALUES (?1, ?2, ?3, ?4, ?5, ?6);");
+    bool blob = has_blob(table, "base");
     if (get_int("SELECT COUNT(*) FROM " + table) == 0) {
         for (size_t iC = 0; iC < cofseq.nodes_cofseq.size(); ++iC) {
             auto& node = cofseq.nodes_cofseq[iC].front();
             auto degs = OrderDegsV2(node);
             for (const auto& deg : degs) {
-                const auto& basis_ss_d = ut::GetRecentValue(cofseq.nodes_cofseq[iC], deg);
+                const auto& basis_ss_d = cofseq.nodes_cofseq[iC].GetRecentValue(deg);
                 for (size_t i = 0; i < basis_ss_d.basis.size(); ++i)
-                    stmt.bind_and_step((int)iC, myio::Serialize(basis_ss_d.basis[i]), SerializeDiff(basis_ss_d.diffs[i]), basis_ss_d.levels[i], deg.s, deg.t);
+                    EncodeSSRow(blob, basis_ss_d.basis[i], basis_ss_d.diffs[i], [&](auto&& base, auto&& diff) { stmt.bind_and_step((int)iC, base, diff, basis_ss_d.levels[i], deg.s, deg.t); });
             }
         }
     }
     else {
         Statement stmt_del(*this, "DELETE FROM " + table + " WHERE iC=?1 AND s=?2 AND t=?3;");
         for (size_t iC = 0; iC < cofseq.nodes_cofseq.size(); ++iC) {
-            auto& node = cofseq.nodes_cofseq[iC][1];
-            auto degs = OrderDegsV2(node);
-            for (const auto& deg : degs) {
+            auto& node = cofseq.nodes_cofseq[iC].changes();
+            for (const auto& deg : cofseq.nodes_cofseq[iC].unsaved()) {
                 auto& basis_ss_d = node.at(deg);
                 stmt_del.bind_and_step((int)iC, deg.s, deg.t);
                 for (size_t i = 0; i < basis_ss_d.basis.size(); ++i)
-                    stmt.bind_and_step((int)iC, myio::Serialize(basis_ss_d.basis[i]), SerializeDiff(basis_ss_d.diffs[i]), basis_ss_d.levels[i], deg.s, deg.t);
+                    EncodeSSRow(blob, basis_ss_d.basis[i], basis_ss_d.diffs[i], [&](auto&& base, auto&& diff) { stmt.bind_and_step((int)iC, base, diff, basis_ss_d.levels[i], deg.s, deg.t); });
             }
         }
     }
@@ -136,25 +251,82 @@ std::map<AdamsDeg, int> DBSS::load_basis_indices(const std::string& table_prefix
     return result;
 }
 
-Staircases DBSS::load_ss(const std::string& table_prefix) const
+Staircases DBSS::load_ss(const std::string& table_prefix, int stem_max) const
+{
+    return ParseStaircases(load_ss_raw(table_prefix, stem_max));
+}
+
+StaircaseRowRaw1d DBSS::load_ss_raw(const std::string& table_prefix, int stem_max) const
+{
+    StaircaseRowRaw1d rows;
+    Statement stmt(*this, "SELECT base, COALESCE(diff, \"-1\"), level, s, t FROM " + table_prefix + "_ss" + (stem_max == DEG_MAX ? "" : " WHERE t-s<=" + std::to_string(stem_max)) + ";");
+    while (stmt.step() == MYSQLITE_ROW)
+        rows.push_back({AdamsDeg(stmt.column_int(3), stmt.column_int(4)), stmt.column_raw(0), stmt.column_raw(1), stmt.column_int(2)});
+    return rows;
+}
+
+Staircases ParseStaircases(const StaircaseRowRaw1d& rows)
 {
     Staircases nodes_ss;
-    Statement stmt(*this, "SELECT base, COALESCE(diff, \"-1\"), level, s, t FROM " + table_prefix + "_ss;");
-    int count = 0;
-    while (stmt.step() == MYSQLITE_ROW) {
-        ++count;
-        int1d base = myio::Deserialize<int1d>(stmt.column_str(0));
-        int1d diff = myio::Deserialize<int1d>(stmt.column_str(1));
-        int level = stmt.column_int(2);
-        AdamsDeg deg = {stmt.column_int(3), stmt.column_int(4)};
-
-        nodes_ss[deg].basis.push_back(std::move(base));
-        nodes_ss[deg].diffs.push_back(std::move(diff));
-        nodes_ss[deg].levels.push_back(level);
+    for (auto& row : rows) {
+        auto& sc = nodes_ss[row.deg];
+        sc.basis.push_back(row.base.deserialize<int1d>());
+        sc.diffs.push_back(row.diff.deserialize<int1d>());
+        sc.levels.push_back(row.level);
     }
     return nodes_ss;
 }
 
+bool DBSS::load_degs(const std::string& table, std::set<std::pair<int, int>>& degs) const
+{
+    if (!has_table(table))
+        return false;
+    Statement stmt(*this, "SELECT s, t FROM " + table + ";");
+    while (stmt.step() == MYSQLITE_ROW) {
+        int s = stmt.column_int(0), t = stmt.column_int(1);
+        degs.insert({t - s, s});
+    }
+    return true;
+}
+
+std::string DBSS::load_migrate_ss(const std::string& table_prefix) const
+{
+    if (!has_table(table_prefix + "_migrate_ss"))
+        return {};
+    Statement stmt(*this, "SELECT source FROM " + table_prefix + "_migrate_ss;");
+    if (stmt.step() == MYSQLITE_ROW)
+        return stmt.column_str(0);
+    return {};
+}
+
+uint64_t DBSS::load_pi_fingerprint(const std::string& table_prefix) const
+{
+    if (!has_table(table_prefix + "_pi_fingerprint"))
+        return 0;
+    Statement stmt(*this, "SELECT fingerprint FROM " + table_prefix + "_pi_fingerprint;");
+    if (stmt.step() == MYSQLITE_ROW)
+        return (uint64_t)stmt.column_int64(0);
+    return 0;
+}
+
+ContraMap DBSS::load_contradictions(const std::string& table_prefix) const
+{
+    ContraMap result;
+    if (!has_table(table_prefix + "_contradictions"))
+        return result;
+    Statement stmt(*this, "SELECT s, t, r, tryY, x, dx, fingerprint FROM " + table_prefix + "_contradictions;");
+    while (stmt.step() == MYSQLITE_ROW) {
+        ContraKey key;
+        key.deg = {stmt.column_int(0), stmt.column_int(1)};
+        key.r = stmt.column_int(2);
+        key.tryY = stmt.column_int(3);
+        key.x = myio::Deserialize<int1d>(stmt.column_str(4));
+        key.dx = myio::Deserialize<int1d>(stmt.column_str(5));
+        result[std::move(key)] = (uint64_t)stmt.column_int64(6);
+    }
+    return result;
+}
+
 std::array<Staircases, 3> DBSS::load_cofseq(const std::string& table) const
 {
     std::array<Staircases, 3> node_cofseq;
@@ -163,8 +335,8 @@ std::array<Staircases, 3> DBSS::load_cofseq(const std::string& table) const
     while (stmt.step() == MYSQLITE_ROW) {
         ++count;
         size_t index = (size_t)stmt.column_int(0);
-        int1d base = myio::Deserialize<int1d>(stmt.column_str(1));
-        int1d diff = myio::Deserialize<int1d>(stmt.column_str(2));
+        int1d base = stmt.column_deserialize<int1d>(1);
+        int1d diff = stmt.column_deserialize<int1d>(2);
         int level = stmt.column_int(3);
         AdamsDeg deg = {stmt.column_int(4), stmt.column_int(5)};
 
@@ -240,6 +412,10 @@ void generate_ss(const std::string& name, const std::string& path, bool isRing,
     db.begin_transaction();
     db.drop_and_create_ss(table_prefix);
     db.save_ss(table_prefix, nodes_ss);
+    db.drop_table(name + "_dirty");           /* Every degree is to be deduced again */
+    db.drop_table(name + "_cofseq_unsynced"); /* cofseq is to be synchronized with the new ss in full */
+    db.drop_table(name + "_migrate_ss");      /* An unfinished migration has to start over */
+    db.drop_table(name + "_contradictions");  /* The contradictions were found with the old differentials */
 
     db.drop_and_create_pi_relations(name);
     db.drop_and_create_pi_basis(name);
@@ -1,7 +1,9 @@
 #include "algebras/linalg.h"
+#include "algebras/myhash.h"
 #include "main.h"
 #include "mylog.h"
 #include <set>
+#include <thread>
 
 /* Deduce zero differentials for degree reason */
 int Diagram::DeduceTrivialDiffs(SSFlag flag)
@@ -12,12 +14,12 @@ int Diagram::DeduceTrivialDiffs(SSFlag flag)
         for (size_t jCw = 0; jCw < num_cw; ++jCw) {
             auto iCw = jCw < rings_.size() ? IndexRing(jCw) : IndexMod(jCw - rings_.size());
             auto& nodes_ss = GetSS(iCw);
-            if (depth_ > 0 && nodes_ss.back().empty())
+            if (depth_ > 0 && nodes_ss.IsLastNodeEmpty())
                 continue;
             auto& name = GetCwName(iCw);
             int t_max = GetTMax(iCw);
             for (auto& [d, _] : nodes_ss.front()) {
-                const auto& sc = ut::GetRecentValue(nodes_ss, d);
+                const auto& sc = nodes_ss.GetRecentValue(d);
                 for (size_t i = 0; i < sc.levels.size(); ++i) {
                     if (sc.diffs[i] == NULL_DIFF) {
                         if (sc.levels[i] > LEVEL_PERM) {
@@ -60,20 +62,20 @@ int Diagram::DeduceTrivialDiffsCofseq(SSFlag flag)
         for (auto& cofseq : cofseqs_) {
             for (size_t iCs = 0; iCs < 3; ++iCs) {
                 auto& nodes_cofseq = cofseq.nodes_cofseq[iCs];
-                if (nodes_cofseq.size() > 2 && nodes_cofseq.back().empty())
+                if (nodes_cofseq.size() > 2 && nodes_cofseq.IsLastNodeEmpty())
                     continue;
                 size_t iCs_prev = (iCs + 2) % 3;
                 size_t iCs_next = (iCs + 1) % 3;
                 const int stem_map1 = cofseq.degMap[iCs_prev].stem();
                 auto& name = cofseq.name;
                 for (auto& [d, _] : nodes_cofseq.front()) {
-                    const auto& sc = ut::GetRecentValue(nodes_cofseq, d);
+                    const auto& sc = nodes_cofseq.GetRecentValue(d);
                     for (size_t i = 0; i < sc.levels.size(); ++i) {
                         if (sc.diffs[i] == NULL_DIFF) {
                             if (sc.levels[i] > LEVEL_PERM) {
                                 const int r = LEVEL_MAX - sc.levels[i];
                                 const auto& map = maps_[cofseq.indexMap[iCs]];
-                                if (r <= cofseq.degMap[iCs].s && d.t <= map->t_max) {
+                                if (r <= cofseq.degMap[iCs].s && !OutOfRange(d, map->t_max, map->stem_max)) {
                                     int1d dx = Residue(map->map(sc.basis[i], d, *this), *cofseq.nodes_ss[iCs_next], d + cofseq.degMap[iCs], LEVEL_PERM);
                                     SetDiffLeibnizCofseq(cofseq, iCs, d, sc.basis[i], dx, cofseq.degMap[iCs].s, flag);
                                     continue;
@@ -130,13 +132,13 @@ int Diagram::DeduceManual(SSFlag flag)
             size_t iCs = 2;
             size_t iCs_prev = (iCs + 2) % 3;
             auto& nodes_cofseq = cofseq.nodes_cofseq[iCs];
-            if (nodes_cofseq.size() > 2 && nodes_cofseq.back().empty())
+            if (nodes_cofseq.size() > 2 && nodes_cofseq.IsLastNodeEmpty())
                 continue;
             const int stem_map_prev = cofseq.degMap[iCs_prev].stem();
             for (auto& [d, _] : nodes_cofseq.front()) {
                 if (d.stem() == 0)
                     continue;
-                const auto& sc = ut::GetRecentValue(nodes_cofseq, d);
+                const auto& sc = nodes_cofseq.GetRecentValue(d);
                 for (size_t i = 0; i < sc.levels.size(); ++i) {
                     if (sc.diffs[i] == NULL_DIFF && sc.levels[i] > LEVEL_PERM) {
                         int r = NextRSrcCofseq(cofseq, iCs, d, R_PERM);
@@ -165,11 +167,11 @@ int Diagram::DeduceDiffBySynthetic(SSFlag flag)
         for (size_t jCw = 0; jCw < num_cw; ++jCw) {
             auto iCw = jCw < rings_.size() ? IndexRing(jCw) : IndexMod(jCw - rings_.size());
             auto& nodes_ss = GetSS(iCw);
-            if (depth_ > 0 && nodes_ss.back().empty())
+            if (depth_ > 0 && nodes_ss.IsLastNodeEmpty())
                 continue;
             auto& degs = iCw.isRing ? rings_[iCw.index].degs_basis_order_by_stem : modules_[iCw.index].degs_basis_order_by_stem;
             for (auto& d : degs) {
-                const auto& sc = ut::GetRecentValue(nodes_ss, d);
+                const auto& sc = nodes_ss.GetRecentValue(d);
                 for (size_t i = 0; i < sc.levels.size(); ++i) {
                     if (sc.levels[i] > LEVEL_PERM && sc.diffs[i] != NULL_DIFF) {
                         const int r = LEVEL_MAX - sc.levels[i];
@@ -200,7 +202,7 @@ int Diagram::DeduceDiffBySyntheticCofseq(SSFlag flag)
                 size_t iCs_next = (iCs + 1) % 3;
                 for (auto& [deg, _] : nodes_cofseq.front()) {
                     // fmt::print("deg={}\n", deg);
-                    const auto& sc = ut::GetRecentValue(nodes_cofseq, deg);
+                    const auto& sc = nodes_cofseq.GetRecentValue(deg);
                     for (size_t i = 0; i < sc.levels.size(); ++i) {
                         if (sc.diffs[i] == NULL_DIFF && sc.levels[i] > LEVEL_MAX / 2) {
                             AdamsDeg deg_fx;
@@ -233,10 +235,58 @@ int Diagram::DeduceDiffBySyntheticCofseq(SSFlag flag)
     return count;
 }
 
+uint64_t Diagram::FingerprintNbhd(IndexCw iCw, AdamsDeg deg_x) const
+{
+    auto& nodes_ss = GetSS(iCw);
+    auto& degs = iCw.isRing ? rings_[iCw.index].degs_basis_order_by_stem : modules_[iCw.index].degs_basis_order_by_stem;
+    const int stem_min = deg_x.stem() - 1, stem_max = deg_x.stem() + 1;
+    auto p = std::lower_bound(degs.begin(), degs.end(), stem_min, [](AdamsDeg d, int stem) { return d.stem() < stem; });
+    uint64_t seed = 0;
+    auto hash_int1d = [&seed](const int1d& a) {
+        ut::hash_combine(seed, a.size());
+        for (int i : a)
+            ut::hash_combine(seed, (uint64_t)i);
+    };
+    for (; p != degs.end() && p->stem() <= stem_max; ++p) {
+        const auto& sc = nodes_ss.GetRecentValue(*p);
+        ut::hash_combine(seed, (uint64_t)p->s);
+        ut::hash_combine(seed, (uint64_t)p->t);
+        for (size_t i = 0; i < sc.levels.size(); ++i) {
+            hash_int1d(sc.basis[i]);
+            hash_int1d(sc.diffs[i]);
+            ut::hash_combine(seed, (uint64_t)sc.levels[i]);
+        }
+    }
+    return seed;
+}
+
 int Diagram::TryDiff(IndexCw iCw, AdamsDeg deg_x, const int1d& x, const int1d& dx, int r, SSFlag flag, bool tryY)
 {
+    /* Contradictions are only cached for the candidates tried on the loaded diagram.
+     * The fingerprint does not cover the other spectra, so it relies on the fact that
+     * deductions only add information elsewhere and a contradiction stays a contradiction. */
+    const bool bCache = (flag & SSFlag::cache_contra) && depth_ == 0;
+    uint64_t fingerprint = 0;
+    size_t jCw = 0;
+    ContraKey key;
+    if (bCache) {
+        fingerprint = FingerprintNbhd(iCw, deg_x);
+        jCw = iCw.isRing ? iCw.index : rings_.size() + iCw.index;
+        key = ContraKey{deg_x, r, tryY, x, dx};
+        std::scoped_lock lock(contra_cache_->mutex);
+        auto& contras = contra_cache_->entries[jCw];
+        auto p = contras.find(key);
+        if (p != contras.end() && p->second == fingerprint) {
+            ++contra_cache_->count_hits;
+            Logger::LogDiff(depth_ + 1, tryY ? EnumReason::try1 : EnumReason::try2, GetCwName(iCw), deg_x, x, dx, r);
+            Logger::LogSSSSException(depth_ + 1, 0x47c1a3d5);
+            return 1;
+        }
+    }
+
     AddNode(flag);
     bool bException = false;
+    bool bContra = false; /* 0x311a only says the candidate is trivial and is not cached */
     try {
         const std::string& name = GetCwName(iCw);
 
@@ -271,11 +321,28 @@ int Diagram::TryDiff(IndexCw iCw, AdamsDeg deg_x, const int1d& x, const int1d& d
             }
         }
     }
-    catch (SSException&) {
+    catch (SSException& e) {
         bException = true;
+        bContra = e.id() != 0x311a;
     }
     PopNode(flag);
 
+    if (bCache) {
+        std::scoped_lock lock(contra_cache_->mutex);
+        auto& contras = contra_cache_->entries[jCw];
+        auto p = contras.find(key);
+        if (bContra) {
+            if (p == contras.end() || p->second != fingerprint) {
+                contras[key] = fingerprint;
+                contra_cache_->keys_changed[jCw].insert(key);
+            }
+        }
+        else if (p != contras.end()) {
+            contras.erase(p);
+            contra_cache_->keys_changed[jCw].insert(key);
+        }
+    }
+
     if (bException)
         return 1;
     else {
@@ -284,6 +351,62 @@ int Diagram::TryDiff(IndexCw iCw, AdamsDeg deg_x, const int1d& x, const int1d& d
     }
 }
 
+int Diagram::TryDiffsPar(IndexCw iCw, AdamsDeg deg_x, const int2d& xs, const int2d& dxs, int r, SSFlag flag, bool tryY, size_t& i_pass, bool& bTrivFails)
+{
+    const size_t n = xs.size() - 1;
+    const size_t num_workers = std::min(std::min(size_t(32), n + 1), std::max(size_t(std::thread::hardware_concurrency()), size_t(1)));
+    SyncWorkers(num_workers, flag);
+
+    std::vector<int> results(n + 1);
+    std::vector<LogRow1d> logs(n + 1);
+    std::vector<std::exception_ptr> errors(n + 1);
+    int count_pass = 0;
+    bTrivFails = false;
+    for (size_t begin = 0; begin <= n; begin += num_workers) {
+        const size_t end = std::min(begin + num_workers, n + 1);
+        bool bError = false;
+        ut::for_each_par32(end - begin, [&, begin](size_t k) {
+            size_t i = begin + k;
+            Logger::SetBuffer(&logs[i]);
+            try {
+                results[i] = workers_[k]->TryDiff(iCw, deg_x, xs[i], dxs[i], r, flag, tryY);
+            }
+            catch (...) {
+                errors[i] = std::current_exception();
+            }
+            Logger::SetBuffer(nullptr);
+        });
+        for (size_t i = begin; i < end; ++i)
+            bError = bError || errors[i];
+        /* A worker that failed may be left inside a node. The workers are copied again next time. */
+        if (bError)
+            workers_.clear();
+
+        /* Replay the serial loop. Candidates beyond the stopping point are discarded. */
+        for (size_t i = begin; i < end; ++i) {
+            if (errors[i]) {
+                Logger::FlushBuffer(logs[i]);
+                std::rethrow_exception(errors[i]);
+            }
+            if (i == n) {
+                if (count_pass == 1) {
+                    Logger::FlushBuffer(logs[i]);
+                    bTrivFails = results[i];
+                }
+                return count_pass;
+            }
+            Logger::FlushBuffer(logs[i]);
+            if (!results[i]) {
+                ++count_pass;
+                i_pass = i;
+                if (!(flag & SSFlag::try_all) && count_pass > 1)
+                    return count_pass;
+            }
+        }
+    }
+    return count_pass;
+}
+
 int Diagram::DeduceDiffs(IndexCw iCw, AdamsDeg deg, int depth, SSFlag flag)
 {
     auto& nodes_ss = GetSS(iCw);
@@ -293,6 +416,8 @@ int Diagram::DeduceDiffs(IndexCw iCw, AdamsDeg deg, int depth, SSFlag flag)
     int count = 0;
     NullDiff1d nds;
     CacheNullDiffs(nodes_ss, t_max, deg, flag, nds);
+    /* Homotopy is not synchronized to the workers */
+    const bool bPar = (flag & SSFlag::par_try) && depth_ == 0 && !(flag & SSFlag::pi);
 
     size_t index_nd = 0;
     while (index_nd < nds.size()) {
@@ -316,33 +441,59 @@ int Diagram::DeduceDiffs(IndexCw iCw, AdamsDeg deg, int depth, SSFlag flag)
                 int count_pass = 0;
                 unsigned i_max = 1 << nd.count;
                 const AdamsDeg deg_tgt = deg_src + AdamsDeg{r, r - 1};
-                const auto& sc_tgt = ut::GetRecentValue(nodes_ss, deg_tgt);
-
-                for (unsigned i = 1; i < i_max; ++i) {
-                    dx1.clear();
-                    for (int j : ut::two_exp(i))
-                        dx1 = lina::add(dx1, sc_tgt.basis[(size_t)(nd.first + j)]);
-
-                    if (!TryDiff(iCw, deg_src, x, dx1, r, flag, true)) {
-                        ++count_pass;
-                        if (!(flag & SSFlag::try_all) && count_pass > 1)
-                            break;
-                        dx = std::move(dx1);
+                const auto& sc_tgt = nodes_ss.GetRecentValue(deg_tgt);
+
+                if (bPar) {
+                    int2d dxs;
+                    for (unsigned i = 1; i < i_max; ++i) {
+                        dx1.clear();
+                        for (int j : ut::two_exp(i))
+                            dx1 = lina::add(dx1, sc_tgt.basis[(size_t)(nd.first + j)]);
+                        dxs.push_back(std::move(dx1));
                     }
+                    dxs.push_back({});
+                    const int2d xs(dxs.size(), x);
+                    size_t i_pass = 0;
+                    bool bTrivFails = false;
+                    count_pass = TryDiffsPar(iCw, deg_src, xs, dxs, r, flag, true, i_pass, bTrivFails);
+                    if (count_pass == 0) {
+                        dx.clear();
+                        bNewDiff = true;
+                    }
+                    else if (count_pass == 1 && bTrivFails) {
+                        dx = std::move(dxs[i_pass]);
+                        bNewDiff = true;
+                    }
+                    else
+                        ++index_nd;
                 }
-                if (count_pass == 0) {
-                    dx.clear();
-                    bNewDiff = true;
-                }
-                else if (count_pass == 1) {
-                    dx1.clear();
-                    if (TryDiff(iCw, deg_src, x, dx1, r, flag, true))
+                else {
+                    for (unsigned i = 1; i < i_max; ++i) {
+                        dx1.clear();
+                        for (int j : ut::two_exp(i))
+                            dx1 = lina::add(dx1, sc_tgt.basis[(size_t)(nd.first + j)]);
+
+                        if (!TryDiff(iCw, deg_src, x, dx1, r, flag, true)) {
+                            ++count_pass;
+                            if (!(flag & SSFlag::try_all) && count_pass > 1)
+                                break;
+                            dx = std::move(dx1);
+                        }
+                    }
+                    if (count_pass == 0) {
+                        dx.clear();
                         bNewDiff = true;
+                    }
+                    else if (count_pass == 1) {
+                        dx1.clear();
+                        if (TryDiff(iCw, deg_src, x, dx1, r, flag, true))
+                            bNewDiff = true;
+                        else
+                            ++index_nd;
+                    }
                     else
                         ++index_nd;
                 }
-                else
-                    ++index_nd;
             }
         }
         /* Fixed target, find source. */
@@ -359,32 +510,58 @@ int Diagram::DeduceDiffs(IndexCw iCw, AdamsDeg deg, int depth, SSFlag flag)
                 int1d x1;
                 int count_pass = 0;
                 unsigned i_max = 1 << nd.count;
-                const auto& sc_src = ut::GetRecentValue(nodes_ss, deg_src);
-
-                for (unsigned i = 1; i < i_max; ++i) {
-                    x1.clear();
-                    for (int j : ut::two_exp(i))
-                        x1 = lina::add(x1, sc_src.basis[(size_t)(nd.first + j)]);
-
-                    if (!TryDiff(iCw, deg_src, x1, dx, r, flag, false)) {
-                        ++count_pass;
-                        if (!(flag & SSFlag::try_all) && count_pass > 1)
-                            break;
-                        x = std::move(x1);
+                const auto& sc_src = nodes_ss.GetRecentValue(deg_src);
+
+                if (bPar) {
+                    int2d xs;
+                    for (unsigned i = 1; i < i_max; ++i) {
+                        x1.clear();
+                        for (int j : ut::two_exp(i))
+                            x1 = lina::add(x1, sc_src.basis[(size_t)(nd.first + j)]);
+                        xs.push_back(std::move(x1));
                     }
+                    xs.push_back({});
+                    const int2d dxs(xs.size(), dx);
+                    size_t i_pass = 0;
+                    bool bTrivFails = false;
+                    count_pass = TryDiffsPar(iCw, deg_src, xs, dxs, r, flag, false, i_pass, bTrivFails);
+                    if (count_pass == 0) {
+                        x.clear();
+                        bNewDiff = true;
+                    }
+                    else if (count_pass == 1 && bTrivFails) {
+                        x = std::move(xs[i_pass]);
+                        bNewDiff = true;
+                    }
+                    else
+                        ++index_nd;
                 }
-                if (count_pass == 0) {
-                    x.clear();
-                    bNewDiff = true;
-                }
-                else if (count_pass > 1)
-                    ++index_nd;
                 else {
-                    x1.clear();
-                    if (TryDiff(iCw, deg_src, x1, dx, r, flag, false))
+                    for (unsigned i = 1; i < i_max; ++i) {
+                        x1.clear();
+                        for (int j : ut::two_exp(i))
+                            x1 = lina::add(x1, sc_src.basis[(size_t)(nd.first + j)]);
+
+                        if (!TryDiff(iCw, deg_src, x1, dx, r, flag, false)) {
+                            ++count_pass;
+                            if (!(flag & SSFlag::try_all) && count_pass > 1)
+                                break;
+                            x = std::move(x1);
+                        }
+                    }
+                    if (count_pass == 0) {
+                        x.clear();
                         bNewDiff = true;
-                    else
+                    }
+                    else if (count_pass > 1)
                         ++index_nd;
+                    else {
+                        x1.clear();
+                        if (TryDiff(iCw, deg_src, x1, dx, r, flag, false))
+                            bNewDiff = true;
+                        else
+                            ++index_nd;
+                    }
                 }
             }
         }
@@ -443,9 +620,115 @@ int Diagram::DeduceDiffs(IndexCw& iCw, int stem_min, int stem_max, int s_min, in
 
 int Diagram::DeduceDiffs(int stem_min, int stem_max, int depth, SSFlag flag)
 {
+    if (depth == 0 && !(flag & SSFlag::full_sweep))
+        return DeduceDiffsDirty(stem_min, stem_max, flag);
     int count = 0;
-    for (auto iCw : deduce_list_spectra_)
+    for (auto iCw : deduce_list_spectra_) {
         count += DeduceDiffs(iCw, stem_min, stem_max, 0, R_PERM, depth, flag);
+        if (depth == 0) {
+            auto& dirty = dirty_[iCw.isRing ? iCw.index : rings_.size() + iCw.index];
+            dirty.erase(dirty.lower_bound({stem_min, 0}), dirty.lower_bound({stem_max + 1, 0}));
+        }
+    }
+    return count;
+}
+
+void Diagram::MarkDirtyNbhd(IndexCw iCw, AdamsDeg deg)
+{
+    auto& dirty = dirty_[iCw.isRing ? iCw.index : rings_.size() + iCw.index];
+    auto& degs = iCw.isRing ? rings_[iCw.index].degs_basis_order_by_stem : modules_[iCw.index].degs_basis_order_by_stem;
+    ForEachDegInStem(degs, deg.stem(), [&](AdamsDeg d) {
+        if (d.s == deg.s)
+            dirty.insert({d.stem(), d.s});
+    });
+    /* Sources of the differentials hitting deg */
+    ForEachDegInStem(degs, deg.stem() + 1, [&](AdamsDeg d) {
+        if (d.s < deg.s)
+            dirty.insert({d.stem(), d.s});
+    });
+    /* Targets of the differentials from deg */
+    ForEachDegInStem(degs, deg.stem() - 1, [&](AdamsDeg d) {
+        if (d.s > deg.s)
+            dirty.insert({d.stem(), d.s});
+    });
+}
+
+void Diagram::MarkDirtyLeibniz(IndexCw iCw, AdamsDeg deg)
+{
+    const size_t iRing = iCw.isRing ? iCw.index : modules_[iCw.index].iRing;
+    const auto& basis_ring = *rings_[iRing].basis;
+    for (auto& [deg_a, basis_a] : basis_ring) {
+        /* x * a lands in deg for x in deg - deg_a */
+        if (deg_a.s <= deg.s && deg_a.stem() <= deg.stem())
+            MarkDirtyNbhd(iCw, deg - deg_a);
+        /* The products with the generators of the ring start from deg */
+        if (std::any_of(basis_a.begin(), basis_a.end(), [](const Mon& m) { return m.IsGen(); }))
+            MarkDirtyNbhd(iCw, deg + deg_a);
+    }
+    if (!iCw.isRing) {
+        /* x * y lands in deg for x in the ring and y in the module */
+        for (auto& [deg_y, _] : *modules_[iCw.index].basis) {
+            if (deg_y.t > deg.t)
+                break;
+            if (deg_y.s <= deg.s && deg_y.stem() <= deg.stem())
+                MarkDirtyNbhd(IndexRing(iRing), deg - deg_y);
+        }
+    }
+}
+
+void Diagram::MarkDirty(IndexCw iCw, AdamsDeg deg)
+{
+    if (dirty_.empty() || depth_ > 0)
+        return;
+    MarkDirtyNbhd(iCw, deg);
+    MarkDirtyLeibniz(iCw, deg);
+    auto& ind_maps = iCw.isRing ? rings_[iCw.index].ind_maps : modules_[iCw.index].ind_maps;
+    for (size_t iMap : ind_maps)
+        MarkDirtyNbhd(maps_[iMap]->to, deg + maps_[iMap]->deg);
+    auto& ind_maps_prev = iCw.isRing ? rings_[iCw.index].ind_maps_prev : modules_[iCw.index].ind_maps_prev;
+    for (size_t iMap : ind_maps_prev)
+        MarkDirtyNbhd(maps_[iMap]->from, deg - maps_[iMap]->deg);
+    for (auto& ind_cof : GetIndexCof(iCw)) {
+        auto& cofseq = cofseqs_[ind_cof.iCof];
+        auto iCs = (size_t)ind_cof.iCs;
+        auto iCs_prev = (iCs + 2) % 3;
+        MarkDirtyNbhd(cofseq.indexCw[iCs_prev], deg - cofseq.degMap[iCs_prev]);
+        MarkDirtyNbhd(cofseq.indexCw[(iCs + 1) % 3], deg + cofseq.degMap[iCs]);
+    }
+}
+
+int Diagram::DeduceDiffsDirty(int stem_min, int stem_max, SSFlag flag)
+{
+    /* Find the first dirty degree in the range of the first cw in the deduce list that has one */
+    IndexCw iCw;
+    AdamsDeg deg;
+    auto next_dirty = [&](bool bPop) {
+        for (auto iCw1 : deduce_list_spectra_) {
+            auto& dirty = dirty_[iCw1.isRing ? iCw1.index : rings_.size() + iCw1.index];
+            auto p = dirty.lower_bound({stem_min, 0});
+            if (p != dirty.end() && p->first <= stem_max) {
+                if (bPop) {
+                    iCw = iCw1;
+                    deg = AdamsDeg(p->second, p->first + p->second);
+                    dirty.erase(p);
+                }
+                return true;
+            }
+        }
+        return false;
+    };
+
+    int count = 0;
+    DeduceTrivialDiffs(flag);
+    do {
+        while (next_dirty(true)) {
+            if (!BelowS0VanishingLine(deg))
+                continue;
+            fmt::print("{} deg={}                        \r", GetCwName(iCw), deg);
+            count += DeduceDiffs(iCw, deg, 0, flag);
+        }
+        DeduceTrivialDiffs(flag);
+    } while (next_dirty(false));
     return count;
 }
 
@@ -456,7 +739,7 @@ int Diagram::DeduceDiffsV2()
         auto& ring = rings_[iRing];
         auto& nodes_ss = ring.nodes_ss;
         for (auto& [deg, basis_ss_d] : nodes_ss.front()) {
-            const auto& sc = ut::GetRecentValue(nodes_ss, deg);
+            const auto& sc = nodes_ss.GetRecentValue(deg);
             for (size_t i = 0; i < sc.levels.size(); ++i) {
                 if (sc.diffs[i] == NULL_DIFF) {
                     if (sc.levels[i] > LEVEL_PERM) {
@@ -474,7 +757,7 @@ int Diagram::DeduceDiffsV2()
         auto& nodes_ss = mod.nodes_ss;
         for (auto& [deg, basis_ss_d] : nodes_ss.front()) {
             fmt::print("{} deg={}                        \r", name, deg);
-            const auto& sc = ut::GetRecentValue(nodes_ss, deg);
+            const auto& sc = nodes_ss.GetRecentValue(deg);
             for (size_t i = 0; i < sc.levels.size(); ++i) {
                 if (sc.diffs[i] == NULL_DIFF) {
                     if (sc.levels[i] > LEVEL_PERM) {
@@ -519,6 +802,16 @@ int main_deduce_diff(int argc, char** argv, int& index, const char* desc)
                 flag = flag | SSFlag::pi;
             else if (f == "try_all")
                 flag = flag | SSFlag::try_all;
+            else if (f == "par")
+                flag = flag | SSFlag::par_try;
+            else if (f == "cache")
+                flag = flag | SSFlag::cache_contra;
+            else if (f == "sweep")
+                flag = flag | SSFlag::full_sweep;
+            else if (f == "full_sync")
+                flag = flag | SSFlag::full_sync;
+            else if (f == "check_sync")
+                flag = flag | SSFlag::check_sync;
             else {
                 std::cout << "Not a supported flag: " << f << '\n';
                 return 100;
@@ -526,7 +819,8 @@ int main_deduce_diff(int argc, char** argv, int& index, const char* desc)
         }
     }
 
-    Diagram diagram(diagram_name, flag);
+    std::unique_ptr<Diagram> holder;
+    Diagram& diagram = OpenDiagram(diagram_name, flag, holder);
     if (ut::has(options, "deduce"))
         diagram.SetDeduceList(options.at("deduce"));
 
@@ -543,6 +837,12 @@ int main_deduce_diff(int argc, char** argv, int& index, const char* desc)
     }
     diagram.save(diagram_name, flag);
     Logger::LogSummary("Changed differentials", count);
+    size_t bytes_journaled, count_nodes;
+    diagram.GetJournalStats(bytes_journaled, count_nodes);
+    if (count_nodes)
+        Logger::LogSummary("Bytes journaled per try", int(bytes_journaled / count_nodes));
+    if (flag & SSFlag::cache_contra)
+        Logger::LogSummary("Cached contradictions used", diagram.GetContraCacheHits());
 
     return 0;
 }
@@ -584,6 +884,14 @@ int main_deduce_cofseq(int argc, char** argv, int& index, const char* desc)
             flag = flag | SSFlag::xy;
         else if (f == "pi")
             flag = flag | SSFlag::pi;
+        else if (f == "sweep")
+            flag = flag | SSFlag::full_sweep;
+        else if (f == "par_cofseq")
+            flag = flag | SSFlag::par_cofseq;
+        else if (f == "full_sync")
+            flag = flag | SSFlag::full_sync;
+        else if (f == "check_sync")
+            flag = flag | SSFlag::check_sync;
         else {
             std::cout << "Not a supported flag: " << f << '\n';
             return 100;
@@ -596,6 +904,10 @@ int main_deduce_cofseq(int argc, char** argv, int& index, const char* desc)
     count = diagram.DeduceDiffsCofseq(stem_min, stem_max, 0, flag);
     diagram.save(diagram_name, flag);
     Logger::LogSummary("Changed differentials", count);
+    size_t bytes_journaled, count_nodes;
+    diagram.GetJournalStats(bytes_journaled, count_nodes);
+    if (count_nodes)
+        Logger::LogSummary("Bytes journaled per try", int(bytes_journaled / count_nodes));
 
     return 0;
 }
@@ -3,19 +3,194 @@
 #include "algebras/linalg.h"
 #include "main.h"
 #include "mylog.h"
+#include <thread>
+
+namespace {
+
+template <typename TCw>
+TCw CopyForWorker(const TCw& cw)
+{
+    TCw result;
+    result.name = cw.name;
+    result.t_max = cw.t_max;
+    result.stem_max = cw.stem_max;
+    result.ind_maps = cw.ind_maps;
+    result.ind_maps_prev = cw.ind_maps_prev;
+    result.ind_cofs = cw.ind_cofs;
+    result.gb = cw.gb;
+    result.basis = cw.basis;
+    result.degs_basis_order_by_stem = cw.degs_basis_order_by_stem;
+    result.nodes_ss = cw.nodes_ss;
+    return result;
+}
+
+}  // namespace
+
+Diagram::Diagram(const Diagram& diagram)
+    : maps_(diagram.maps_),
+      cofseqs_(diagram.cofseqs_),
+      comms_(diagram.comms_),
+      js_(diagram.js_),
+      deduce_list_spectra_(diagram.deduce_list_spectra_),
+      deduce_list_cofseq_(diagram.deduce_list_cofseq_),
+      depth_(diagram.depth_),
+      deduce_count_max_(diagram.deduce_count_max_),
+      contra_cache_(diagram.contra_cache_)
+{
+    for (auto& ring : diagram.rings_) {
+        rings_.push_back(CopyForWorker(ring));
+        rings_.back().ind_mods = ring.ind_mods;
+    }
+    for (auto& mod : diagram.modules_) {
+        modules_.push_back(CopyForWorker(mod));
+        modules_.back().iRing = mod.iRing;
+    }
+    for (auto& cofseq : cofseqs_)
+        for (size_t iCs = 0; iCs < 3; ++iCs)
+            cofseq.nodes_ss[iCs] = &GetSS(cofseq.indexCw[iCs]);
+}
+
+void Diagram::SyncWorkers(size_t num_workers, SSFlag flag)
+{
+    bool bNew = workers_.size() < num_workers;
+    while (workers_.size() < num_workers)
+        workers_.push_back(std::unique_ptr<Diagram>(new Diagram(*this)));
+    if (!bNew && version_workers_ == version_)
+        return;
+
+    /* The first node of ss is constant after loading so only the changes at depth 0 are copied */
+    ut::for_each_par32(workers_.size(), [this, flag](size_t i) {
+        auto& worker = *workers_[i];
+        for (size_t iRing = 0; iRing < rings_.size(); ++iRing)
+            worker.rings_[iRing].nodes_ss.AssignChanges(rings_[iRing].nodes_ss);
+        for (size_t iMod = 0; iMod < modules_.size(); ++iMod)
+            worker.modules_[iMod].nodes_ss.AssignChanges(modules_[iMod].nodes_ss);
+        if (flag & SSFlag::cofseq) {
+            for (size_t iCof = 0; iCof < cofseqs_.size(); ++iCof)
+                for (size_t iCs = 0; iCs < 3; ++iCs)
+                    worker.cofseqs_[iCof].nodes_cofseq[iCs] = cofseqs_[iCof].nodes_cofseq[iCs];
+        }
+        worker.depth_ = depth_;
+    });
+    version_workers_ = version_;
+}
+
+void Diagram::AdoptWorkerCw(const Diagram& worker, size_t iCw)
+{
+    const size_t size_rings = rings_.size();
+    if (iCw < size_rings)
+        rings_[iCw].nodes_ss.AdoptChanges(worker.rings_[iCw].nodes_ss);
+    else
+        modules_[iCw - size_rings].nodes_ss.AdoptChanges(worker.modules_[iCw - size_rings].nodes_ss);
+    if (!dirty_.empty())
+        dirty_[iCw] = worker.dirty_[iCw];
+    if (!unsynced_cofseq_.empty())
+        unsynced_cofseq_[iCw] = worker.unsynced_cofseq_[iCw];
+}
+
+size_t1d Diagram::GetCwComponentRoots() const
+{
+    const size_t num_cw = rings_.size() + modules_.size();
+    auto index = [this](IndexCw iCw) { return iCw.isRing ? iCw.index : rings_.size() + iCw.index; };
+    size_t1d parent(num_cw);
+    for (size_t i = 0; i < num_cw; ++i)
+        parent[i] = i;
+    auto find = [&parent](size_t i) {
+        while (parent[i] != i)
+            i = parent[i] = parent[parent[i]];
+        return i;
+    };
+    auto unite = [&](size_t i, size_t j) {
+        i = find(i);
+        j = find(j);
+        if (i != j)
+            parent[std::max(i, j)] = std::min(i, j);
+    };
+
+    for (size_t iMod = 0; iMod < modules_.size(); ++iMod)
+        unite(rings_.size() + iMod, modules_[iMod].iRing);
+    for (auto& map : maps_)
+        unite(index(map->from), index(map->to));
+    for (auto& cofseq : cofseqs_)
+        for (size_t iCs = 1; iCs < 3; ++iCs)
+            unite(index(cofseq.indexCw[0]), index(cofseq.indexCw[iCs]));
+
+    for (size_t i = 0; i < num_cw; ++i)
+        parent[i] = find(i);
+    return parent;
+}
+
+std::vector<size_t1d> Diagram::GetCwComponents() const
+{
+    auto roots = GetCwComponentRoots();
+    std::vector<size_t1d> result;
+    std::map<size_t, size_t> root_to_component;
+    for (size_t iCw = 0; iCw < roots.size(); ++iCw) {
+        auto [p, inserted] = root_to_component.try_emplace(roots[iCw], result.size());
+        if (inserted)
+            result.emplace_back();
+        result[p->second].push_back(iCw);
+    }
+    return result;
+}
+
+int Diagram::RunCwJobsPar(const std::vector<size_t1d>& cws, SSFlag flag, const std::function<int(Diagram&, size_t)>& f)
+{
+    const size_t n = cws.size();
+    const size_t num_workers = std::min(std::min(size_t(32), n), std::max(size_t(std::thread::hardware_concurrency()), size_t(1)));
+    SyncWorkers(num_workers, flag);
+    std::vector<int> counts(n);
+    std::vector<LogRow1d> logs(n);
+    std::vector<std::string> outs(n);
+    std::vector<std::exception_ptr> errors(n);
+    ut::for_each_par32(num_workers, [&](size_t k) {
+        auto& worker = *workers_[k];
+        worker.dirty_ = dirty_;
+        worker.unsynced_cofseq_ = unsynced_cofseq_;
+        for (size_t i = k; i < n; i += num_workers) {
+            Logger::SetBuffer(&logs[i], &outs[i]);
+            try {
+                counts[i] = f(worker, i);
+            }
+            catch (...) {
+                errors[i] = std::current_exception();
+            }
+            Logger::SetBuffer(nullptr);
+        }
+    });
+
+    ++version_; /* The workers are no longer synchronized */
+    /* All or nothing: a job that threw discards the changes and logs of every job */
+    for (size_t i = 0; i < n; ++i) {
+        if (errors[i]) {
+            Logger::FlushBuffer({}, outs[i]);
+            std::rethrow_exception(errors[i]);
+        }
+    }
+    int count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        auto& worker = *workers_[i % num_workers];
+        Logger::FlushBuffer(logs[i], outs[i]);
+        for (size_t iCw : cws[i])
+            AdoptWorkerCw(worker, iCw);
+        count += counts[i];
+    }
+    return count;
+}
 
 /* Add a node */
 void Diagram::AddNode(SSFlag flag)
 {
     ++depth_;
+    ++count_nodes_;
     for (auto& ring : rings_)
-        ring.nodes_ss.push_back({});
+        ring.nodes_ss.AddNode();
     for (auto& mod : modules_)
-        mod.nodes_ss.push_back({});
+        mod.nodes_ss.AddNode();
     if (flag & SSFlag::cofseq) {
         for (auto& cofseq : cofseqs_)
             for (size_t iCs = 0; iCs < 3; ++iCs)
-                cofseq.nodes_cofseq[iCs].push_back({});
+                cofseq.nodes_cofseq[iCs].AddNode();
     }
 
     if (flag & SSFlag::pi) {
@@ -37,13 +212,13 @@ void Diagram::PopNode(SSFlag flag)
 {
     --depth_;
     for (auto& ring : rings_)
-        ring.nodes_ss.pop_back();
+        ring.nodes_ss.PopNode();
     for (auto& mod : modules_)
-        mod.nodes_ss.pop_back();
+        mod.nodes_ss.PopNode();
     if (flag & SSFlag::cofseq) {
         for (auto& cofseq : cofseqs_)
             for (size_t iCs = 0; iCs < 3; ++iCs)
-                cofseq.nodes_cofseq[iCs].pop_back();
+                cofseq.nodes_cofseq[iCs].PopNode();
     }
 
     if (flag & SSFlag::pi) {
@@ -60,15 +235,34 @@ void Diagram::PopNode(SSFlag flag)
     }
 }
 
+void Diagram::GetJournalStats(size_t& bytes, size_t& count_nodes) const
+{
+    bytes = 0;
+    count_nodes = count_nodes_;
+    for (auto& ring : rings_)
+        bytes += ring.nodes_ss.bytes_journaled() + ring.pi_gb.bytes_journaled();
+    for (auto& mod : modules_)
+        bytes += mod.nodes_ss.bytes_journaled() + mod.pi_gb.bytes_journaled();
+    for (auto& cofseq : cofseqs_)
+        for (size_t iCs = 0; iCs < 3; ++iCs)
+            bytes += cofseq.nodes_cofseq[iCs].bytes_journaled();
+    for (auto& worker : workers_) {
+        size_t bytes_w, count_nodes_w;
+        worker->GetJournalStats(bytes_w, count_nodes_w);
+        bytes += bytes_w;
+        count_nodes += count_nodes_w;
+    }
+}
+
 int1d MapRing2Ring::map(const int1d& x, AdamsDeg deg_x, const Diagram& diagram) const
 {
     int1d result;
     if (!x.empty()) {
         auto& rings = diagram.GetRings();
-        auto x_alg = Indices2Poly(x, rings[from.index].basis.at(deg_x));
-        auto fx_alg = rings[to.index].gb.Reduce(subs(x_alg, images));
+        auto x_alg = Indices2Poly(x, rings[from.index].basis->at(deg_x));
+        auto fx_alg = rings[to.index].gb->Reduce(subs(x_alg, images));
         if (fx_alg)
-            result = Poly2Indices(fx_alg, rings[to.index].basis.at(deg_x));
+            result = Poly2Indices(fx_alg, rings[to.index].basis->at(deg_x));
     }
     return result;
 }
@@ -78,11 +272,11 @@ int1d MapMod2Mod::map(const int1d& x, AdamsDeg deg_x, const Diagram& diagram) co
     int1d result;
     if (!x.empty()) {
         auto& mods = diagram.GetModules();
-        auto x_alg = Indices2Mod(x, mods[from.index].basis.at(deg_x));
-        auto fx_alg = mods[to.index].gb.Reduce(subs(x_alg, images));
+        auto x_alg = Indices2Mod(x, mods[from.index].basis->at(deg_x));
+        auto fx_alg = mods[to.index].gb->Reduce(subs(x_alg, images));
         if (fx_alg) {
             AdamsDeg deg_fx = deg_x + deg;
-            result = Mod2Indices(fx_alg, mods[to.index].basis.at(deg_fx));
+            result = Mod2Indices(fx_alg, mods[to.index].basis->at(deg_fx));
         }
     }
     return result;
@@ -93,20 +287,22 @@ void MapMod2Mod::Verify(const Diagram& diagram, const AdamsDeg2d& ring_gen_degs)
     fmt::print("Verifying {}\n", name);
     auto& mods = diagram.GetModules();
     auto& gen_degs = ring_gen_degs[mods[from.index].iRing];
-    for (auto& [deg_x, basis_d] : mods[from.index].basis) {
+    for (auto& [deg_x, basis_d] : *mods[from.index].basis) {
         for (size_t g = 0; g < gen_degs.size(); ++g) {
             AdamsDeg deg_gx = deg_x + gen_degs[g];
             if (deg_gx.t > t_max)
                 break;
+            if (deg_gx.stem() > stem_max)
+                continue;
             Poly poly_g = Poly::Gen((uint32_t)g);
             for (size_t i = 0; i < basis_d.size(); ++i) {
-                Mod alg_gx = mods[from.index].gb.Reduce(poly_g * basis_d[i]);
-                int1d gx = alg_gx ? Mod2Indices(alg_gx, mods[from.index].basis.at(deg_gx)) : int1d{};
+                Mod alg_gx = mods[from.index].gb->Reduce(poly_g * basis_d[i]);
+                int1d gx = alg_gx ? Mod2Indices(alg_gx, mods[from.index].basis->at(deg_gx)) : int1d{};
                 int1d fgx = map(gx, deg_gx, diagram);
                 int1d fx = map(int1d{(int)i}, deg_x, diagram);
-                Mod alg_fx = fx.empty() ? Mod() : Indices2Mod(fx, mods[to.index].basis.at(deg_x + deg));
-                Mod alg_gfx = mods[to.index].gb.Reduce(poly_g * alg_fx);
-                int1d gfx = alg_gfx ? Mod2Indices(alg_gfx, mods[to.index].basis.at(deg_gx + deg)) : int1d{};
+                Mod alg_fx = fx.empty() ? Mod() : Indices2Mod(fx, mods[to.index].basis->at(deg_x + deg));
+                Mod alg_gfx = mods[to.index].gb->Reduce(poly_g * alg_fx);
+                int1d gfx = alg_gfx ? Mod2Indices(alg_gfx, mods[to.index].basis->at(deg_gx + deg)) : int1d{};
                 if (fgx != gfx) {
                     fmt::print("Incorrect map: {} deg_x={}, x={}, deg_g={}, g={}\n", name, deg_x, i, gen_degs[g], poly_g.Str());
                     throw MyException(0x18a1700f, "Incorrect map");
@@ -137,11 +333,11 @@ int1d MapMod2ModV2::map(const int1d& x, AdamsDeg deg_x, const Diagram& diagram)
     if (!x.empty()) {
         auto& mods = diagram.GetModules();
         auto& maps = diagram.GetMaps();
-        auto x_alg = Indices2Mod(x, mods[from.index].basis.at(deg_x));
-        auto fx_alg = mods[to.index].gb.Reduce(subs(x_alg, ((MapRing2Ring*)maps[over].get())->images, images));
+        auto x_alg = Indices2Mod(x, mods[from.index].basis->at(deg_x));
+        auto fx_alg = mods[to.index].gb->Reduce(subs(x_alg, ((MapRing2Ring*)maps[over].get())->images, images));
         if (fx_alg) {
             AdamsDeg deg_fx = deg_x + deg;
-            result = Mod2Indices(fx_alg, mods[to.index].basis.at(deg_fx));
+            result = Mod2Indices(fx_alg, mods[to.index].basis->at(deg_fx));
         }
     }
     return result;
@@ -153,21 +349,23 @@ void MapMod2ModV2::Verify(const Diagram& diagram, const AdamsDeg2d& ring_gen_deg
     auto& mods = diagram.GetModules();
     auto& maps = diagram.GetMaps();
     auto& gen_degs = ring_gen_degs[mods[from.index].iRing];
-    for (auto& [deg_x, basis_d] : mods[from.index].basis) {
+    for (auto& [deg_x, basis_d] : *mods[from.index].basis) {
         for (size_t g = 0; g < gen_degs.size(); ++g) {
             AdamsDeg deg_gx = deg_x + gen_degs[g];
             if (deg_gx.t > t_max)
                 break;
+            if (deg_gx.stem() > stem_max)
+                continue;
             Poly poly_g = Poly::Gen((uint32_t)g);
             Poly poly_fg = ((MapRing2Ring*)maps[over].get())->images[g];
             for (size_t i = 0; i < basis_d.size(); ++i) {
-                Mod alg_gx = mods[from.index].gb.Reduce(poly_g * basis_d[i]);
-                int1d gx = alg_gx ? Mod2Indices(alg_gx, mods[from.index].basis.at(deg_gx)) : int1d{};
+                Mod alg_gx = mods[from.index].gb->Reduce(poly_g * basis_d[i]);
+                int1d gx = alg_gx ? Mod2Indices(alg_gx, mods[from.index].basis->at(deg_gx)) : int1d{};
                 int1d fgx = map(gx, deg_gx, diagram);
                 int1d fx = map(int1d{(int)i}, deg_x, diagram);
-                Mod alg_fx = fx.empty() ? Mod() : Indices2Mod(fx, mods[to.index].basis.at(deg_x + deg));
-                Mod alg_fgfx = mods[to.index].gb.Reduce(poly_fg * alg_fx);
-                int1d fgfx = alg_fgfx ? Mod2Indices(alg_fgfx, mods[to.index].basis.at(deg_gx + deg)) : int1d{};
+                Mod alg_fx = fx.empty() ? Mod() : Indices2Mod(fx, mods[to.index].basis->at(deg_x + deg));
+                Mod alg_fgfx = mods[to.index].gb->Reduce(poly_fg * alg_fx);
+                int1d fgfx = alg_fgfx ? Mod2Indices(alg_fgfx, mods[to.index].basis->at(deg_gx + deg)) : int1d{};
                 if (fgx != fgfx) {
                     fmt::print("Incorrect map: {} deg_x={}, x={}, deg_g={}, g={}\n", name, deg_x, i, gen_degs[g], poly_g.Str());
                     throw MyException(0x18a1700f, "Incorrect map");
@@ -183,11 +381,11 @@ int1d MapMod2Ring::map(const int1d& x, AdamsDeg deg_x, const Diagram& diagram) c
     if (!x.empty()) {
         auto& rings = diagram.GetRings();
         auto& mods = diagram.GetModules();
-        auto x_alg = Indices2Mod(x, mods[from.index].basis.at(deg_x));
-        auto fx_alg = rings[to.index].gb.Reduce(subs(x_alg, images));
+        auto x_alg = Indices2Mod(x, mods[from.index].basis->at(deg_x));
+        auto fx_alg = rings[to.index].gb->Reduce(subs(x_alg, images));
         if (fx_alg) {
             AdamsDeg deg_fx = deg_x + deg;
-            result = Poly2Indices(fx_alg, rings[to.index].basis.at(deg_fx));
+            result = Poly2Indices(fx_alg, rings[to.index].basis->at(deg_fx));
         }
     }
     return result;
@@ -199,20 +397,22 @@ void MapMod2Ring::Verify(const Diagram& diagram, const AdamsDeg2d& ring_gen_degs
     auto& mods = diagram.GetModules();
     auto& rings = diagram.GetRings();
     auto& gen_degs = ring_gen_degs[mods[from.index].iRing];
-    for (auto& [deg_x, basis_d] : mods[from.index].basis) {
+    for (auto& [deg_x, basis_d] : *mods[from.index].basis) {
         for (size_t g = 0; g < gen_degs.size(); ++g) {
             AdamsDeg deg_gx = deg_x + gen_degs[g];
             if (deg_gx.t > t_max)
                 break;
+            if (deg_gx.stem() > stem_max)
+                continue;
             Poly poly_g = Poly::Gen((uint32_t)g);
             for (size_t i = 0; i < basis_d.size(); ++i) {
-                Mod alg_gx = mods[from.index].gb.Reduce(poly_g * basis_d[i]);
-                int1d gx = alg_gx ? Mod2Indices(alg_gx, mods[from.index].basis.at(deg_gx)) : int1d{};
+                Mod alg_gx = mods[from.index].gb->Reduce(poly_g * basis_d[i]);
+                int1d gx = alg_gx ? Mod2Indices(alg_gx, mods[from.index].basis->at(deg_gx)) : int1d{};
                 int1d fgx = map(gx, deg_gx, diagram);
                 int1d fx = map(int1d{(int)i}, deg_x, diagram);
-                auto alg_fx = fx.empty() ? Poly() : Indices2Poly(fx, rings[to.index].basis.at(deg_x + deg));
-                auto alg_gfx = rings[to.index].gb.Reduce(poly_g * alg_fx);
-                int1d gfx = alg_gfx ? Poly2Indices(alg_gfx, rings[to.index].basis.at(deg_gx + deg)) : int1d{};
+                auto alg_fx = fx.empty() ? Poly() : Indices2Poly(fx, rings[to.index].basis->at(deg_x + deg));
+                auto alg_gfx = rings[to.index].gb->Reduce(poly_g * alg_fx);
+                int1d gfx = alg_gfx ? Poly2Indices(alg_gfx, rings[to.index].basis->at(deg_gx + deg)) : int1d{};
                 if (fgx != gfx) {
                     fmt::print("Incorrect map: {} deg_x={}, x={}, deg_g={}, g={}\n", name, deg_x, i, gen_degs[g], poly_g.Str());
                     throw MyException(0x18a1700f, "Incorrect map");
@@ -243,11 +443,11 @@ int1d MapMod2RingV2::map(const int1d& x, AdamsDeg deg_x, const Diagram& diagram)
         auto& rings = diagram.GetRings();
         auto& mods = diagram.GetModules();
         auto& maps = diagram.GetMaps();
-        auto x_alg = Indices2Mod(x, mods[from.index].basis.at(deg_x));
-        auto fx_alg = rings[to.index].gb.Reduce(subs(x_alg, ((MapRing2Ring*)maps[over].get())->images, images));
+        auto x_alg = Indices2Mod(x, mods[from.index].basis->at(deg_x));
+        auto fx_alg = rings[to.index].gb->Reduce(subs(x_alg, ((MapRing2Ring*)maps[over].get())->images, images));
         if (fx_alg) {
             AdamsDeg deg_fx = deg_x + deg;
-            result = Poly2Indices(fx_alg, rings[to.index].basis.at(deg_fx));
+            result = Poly2Indices(fx_alg, rings[to.index].basis->at(deg_fx));
         }
     }
     return result;
@@ -260,21 +460,23 @@ void MapMod2RingV2::Verify(const Diagram& diagram, const AdamsDeg2d& ring_gen_de
     auto& rings = diagram.GetRings();
     auto& maps = diagram.GetMaps();
     auto& gen_degs = ring_gen_degs[mods[from.index].iRing];
-    for (auto& [deg_x, basis_d] : mods[from.index].basis) {
+    for (auto& [deg_x, basis_d] : *mods[from.index].basis) {
         for (size_t g = 0; g < gen_degs.size(); ++g) {
             AdamsDeg deg_gx = deg_x + gen_degs[g];
             if (deg_gx.t > t_max)
                 break;
+            if (deg_gx.stem() > stem_max)
+                continue;
             Poly poly_g = Poly::Gen((uint32_t)g);
             Poly poly_fg = ((MapRing2Ring*)maps[over].get())->images[g];
             for (size_t i = 0; i < basis_d.size(); ++i) {
-                Mod alg_gx = mods[from.index].gb.Reduce(poly_g * basis_d[i]);
-                int1d gx = alg_gx ? Mod2Indices(alg_gx, mods[from.index].basis.at(deg_gx)) : int1d{};
+                Mod alg_gx = mods[from.index].gb->Reduce(poly_g * basis_d[i]);
+                int1d gx = alg_gx ? Mod2Indices(alg_gx, mods[from.index].basis->at(deg_gx)) : int1d{};
                 int1d fgx = map(gx, deg_gx, diagram);
                 int1d fx = map(int1d{(int)i}, deg_x, diagram);
-                auto alg_fx = fx.empty() ? Poly() : Indices2Poly(fx, rings[to.index].basis.at(deg_x + deg));
-                auto alg_fgfx = rings[to.index].gb.Reduce(poly_fg * alg_fx);
-                int1d fgfx = alg_fgfx ? Poly2Indices(alg_fgfx, rings[to.index].basis.at(deg_gx + deg)) : int1d{};
+                auto alg_fx = fx.empty() ? Poly() : Indices2Poly(fx, rings[to.index].basis->at(deg_x + deg));
+                auto alg_fgfx = rings[to.index].gb->Reduce(poly_fg * alg_fx);
+                int1d fgfx = alg_fgfx ? Poly2Indices(alg_fgfx, rings[to.index].basis->at(deg_gx + deg)) : int1d{};
                 if (fgx != fgfx) {
                     fmt::print("Incorrect map: {} deg_x={}, x={}, deg_g={}, g={}\n", name, deg_x, i, gen_degs[g], poly_g.Str());
                     throw MyException(0x18a1700f, "Incorrect map");
@@ -289,11 +491,11 @@ int1d MapMulRing2Ring::map(const int1d& x, AdamsDeg deg_x, const Diagram& diagra
     int1d result;
     if (!x.empty()) {
         auto& rings = diagram.GetRings();
-        auto x_alg = Indices2Poly(x, rings[from.index].basis.at(deg_x));
-        auto fx_alg = rings[to.index].gb.Reduce(x_alg * factor);
+        auto x_alg = Indices2Poly(x, rings[from.index].basis->at(deg_x));
+        auto fx_alg = rings[to.index].gb->Reduce(x_alg * factor);
         if (fx_alg) {
             AdamsDeg deg_fx = deg_x + deg;
-            result = Poly2Indices(fx_alg, rings[to.index].basis.at(deg_fx));
+            result = Poly2Indices(fx_alg, rings[to.index].basis->at(deg_fx));
         }
     }
     return result;
@@ -305,11 +507,11 @@ int1d MapMulRing2Mod::map(const int1d& x, AdamsDeg deg_x, const Diagram& diagram
     if (!x.empty()) {
         auto& rings = diagram.GetRings();
         auto& mods = diagram.GetModules();
-        auto x_alg = Indices2Poly(x, rings[from.index].basis.at(deg_x));
-        auto fx_alg = mods[to.index].gb.Reduce(x_alg * factor);
+        auto x_alg = Indices2Poly(x, rings[from.index].basis->at(deg_x));
+        auto fx_alg = mods[to.index].gb->Reduce(x_alg * factor);
         if (fx_alg) {
             AdamsDeg deg_fx = deg_x + deg;
-            result = Mod2Indices(fx_alg, mods[to.index].basis.at(deg_fx));
+            result = Mod2Indices(fx_alg, mods[to.index].basis->at(deg_fx));
         }
     }
     return result;
@@ -320,11 +522,11 @@ int1d MapMulMod2Mod::map(const int1d& x, AdamsDeg deg_x, const Diagram& diagram)
     int1d result;
     if (!x.empty()) {
         auto& mods = diagram.GetModules();
-        auto x_alg = Indices2Mod(x, mods[from.index].basis.at(deg_x));
-        auto fx_alg = mods[to.index].gb.Reduce(factor * x_alg);
+        auto x_alg = Indices2Mod(x, mods[from.index].basis->at(deg_x));
+        auto fx_alg = mods[to.index].gb->Reduce(factor * x_alg);
         if (fx_alg) {
             AdamsDeg deg_fx = deg_x + deg;
-            result = Mod2Indices(fx_alg, mods[to.index].basis.at(deg_fx));
+            result = Mod2Indices(fx_alg, mods[to.index].basis->at(deg_fx));
         }
     }
     return result;
@@ -352,9 +554,9 @@ int Diagram::SetRingDiffGlobal(size_t iRing, AdamsDeg deg_x, const int1d& x, con
 
         for (size_t iMap : ring.ind_maps) {
             auto map = (MapRing2Ring*)maps_[iMap].get();
-            if (deg_x.t <= map->t_max) {
+            if (!OutOfRange(deg_x, map->t_max, map->stem_max)) {
                 int1d fdx;
-                if (deg_dx.t <= map->t_max)
+                if (!OutOfRange(deg_dx, map->t_max, map->stem_max))
                     fdx = map->map(dx, deg_dx, *this);
                 else if (!dx.empty())
                     continue;
@@ -368,13 +570,13 @@ int Diagram::SetRingDiffGlobal(size_t iRing, AdamsDeg deg_x, const int1d& x, con
 
         /* x^2 are cycles in E_r */
         auto deg_xx = deg_x * 2;
-        if (deg_xx.t <= ring.t_max && !x.empty() && dx.empty() && r < R_PERM - 1) {
-            Poly poly_x = Indices2Poly(x, ring.basis.at(deg_x));
+        if (!OutOfRange(deg_xx, ring.t_max, ring.stem_max) && !x.empty() && dx.empty() && r < R_PERM - 1) {
+            Poly poly_x = Indices2Poly(x, ring.basis->at(deg_x));
             Poly poly_xx;
             poly_x.frobP(poly_xx);
-            poly_xx = ring.gb.Reduce(std::move(poly_xx));
+            poly_xx = ring.gb->Reduce(std::move(poly_xx));
             if (poly_xx) {
-                int1d xx = Poly2Indices(poly_xx, ring.basis.at(deg_xx));
+                int1d xx = Poly2Indices(poly_xx, ring.basis->at(deg_xx));
                 if (IsNewDiff(nodes_ss, deg_xx, xx, {}, r + 1)) {
                     Logger::LogDiff(depth, EnumReason::deduce_xx, ring.name, deg_xx, xx, {}, r + 1);
                     count += SetRingDiffGlobal(iRing, deg_xx, xx, {}, r + 1, true, flag);
@@ -407,9 +609,9 @@ int Diagram::SetModuleDiffGlobal(size_t iMod, AdamsDeg deg_x, const int1d& x, co
 
         for (size_t iMap : mod.ind_maps) {
             auto& map = maps_[iMap];
-            if (deg_x.t <= map->t_max) {
+            if (!OutOfRange(deg_x, map->t_max, map->stem_max)) {
                 int1d fdx;
-                if (deg_dx.t <= map->t_max)
+                if (!OutOfRange(deg_dx, map->t_max, map->stem_max))
                     fdx = map->map(dx, deg_dx, *this);
                 else if (!dx.empty())
                     continue;
@@ -506,7 +708,7 @@ int Diagram::GetSynImage(IndexCof iCof, AdamsDeg deg_x, const int1d& x, int leve
     auto& f_next = maps_[cof.indexMap[iCs_next]];
     auto& f_prev = maps_[cof.indexMap[iCs_prev]];
 
-    if (deg_x.t > f->t_max)
+    if (OutOfRange(deg_x, f->t_max, f->stem_max))
         return 1;
     fx = f->map(x, deg_x, *this);
 
@@ -527,7 +729,7 @@ int Diagram::GetSynImage(IndexCof iCof, AdamsDeg deg_x, const int1d& x, int leve
          */
         if (dinv_fx == NULL_DIFF)
             return 2;
-        if (deg_fx.t > f_next->t_max)
+        if (OutOfRange(deg_fx, f_next->t_max, f_next->stem_max))
             return 3;
         auto deg_dinv_fx = deg_fx - AdamsDeg(level_fx, level_fx - 1);
         xtop = f_next->map(dinv_fx, deg_dinv_fx, *this);
@@ -547,7 +749,7 @@ int Diagram::GetSynImage(IndexCof iCof, AdamsDeg deg_x, const int1d& x, int leve
         if (deg_x1 != deg_x)
             return 8; /* failed to confirm that xtop extends to x */
         auto& nodes_ss = *cof.nodes_ss[iCs];
-        auto& sc_x = ut::GetRecentValue(nodes_ss, deg_x);
+        auto& sc_x = nodes_ss.GetRecentValue(deg_x);
         size_t iFirst_level_x = GetFirstIndexOnLevel(sc_x, level_x);
         if (lina::Residue(sc_x.basis.begin(), sc_x.basis.begin() + iFirst_level_x, lina::add(x, x1)).size())
             return 9;
@@ -559,9 +761,9 @@ int Diagram::GetSynImage(IndexCof iCof, AdamsDeg deg_x, const int1d& x, int leve
          * xtop --f_prev--> x
          */
         deg_xtop = deg_x - f_prev->deg;
-        if (deg_xtop.t > f_prev->t_max)
+        if (OutOfRange(deg_xtop, f_prev->t_max, f_prev->stem_max))
             return 10;
-        auto& sc_xtop = ut::GetRecentValue(nodes_ss_prev, deg_xtop);
+        auto& sc_xtop = nodes_ss_prev.GetRecentValue(deg_xtop);
         int2d l_x, l_fx, l_domain, l_f, image, g, kernel;
         for (size_t i = 0; i < sc_xtop.basis.size(); ++i) { /* Make sure that level(xtop) is as small as possible */
             l_x.push_back(sc_xtop.basis[i]);
@@ -581,7 +783,7 @@ int Diagram::GetSynImage(IndexCof iCof, AdamsDeg deg_x, const int1d& x, int leve
             return 12;
     }
     deg_dxtop = deg_xtop + AdamsDeg(r_xtop, r_xtop - 1);
-    if (deg_dxtop.t > f_prev->t_max)
+    if (OutOfRange(deg_dxtop, f_prev->t_max, f_prev->stem_max))
         return 13;
 
     /* compute fx
@@ -589,12 +791,12 @@ int Diagram::GetSynImage(IndexCof iCof, AdamsDeg deg_x, const int1d& x, int leve
      */
     int2d l_fx, image, kernel, g;
     deg_fx = deg_dxtop - f_next->deg;
-    if (deg_fx.t > f_next->t_max)
+    if (OutOfRange(deg_fx, f_next->t_max, f_next->stem_max))
         return 14;
     Staircase sc_empty;
     auto& nodes_ss_next = *cof.nodes_ss[iCs_next];
-    auto& sc_fx = ut::has(nodes_ss_next.front(), deg_fx) ? ut::GetRecentValue(nodes_ss_next, deg_fx) : sc_empty;
-    auto& sc_dxtop = dxtop.size() ? ut::GetRecentValue(nodes_ss_prev, deg_dxtop) : sc_empty;
+    auto& sc_fx = ut::has(nodes_ss_next.front(), deg_fx) ? nodes_ss_next.GetRecentValue(deg_fx) : sc_empty;
+    auto& sc_dxtop = dxtop.size() ? nodes_ss_prev.GetRecentValue(deg_dxtop) : sc_empty;
     size_t iFirst_level_dxtop = GetFirstIndexOnLevel(sc_dxtop, r_xtop);
     if (level_x <= LEVEL_PERM) {
         int2d l_x, l_domain, l_f;
@@ -638,7 +840,7 @@ int Diagram::GetSynImage(IndexCof iCof, AdamsDeg deg_x, const int1d& x, int leve
             auto deg_x1 = AdamsDeg(s1, deg_x.stem() + s1);
             if (!ut::has(nodes_ss.front(), deg_x1))
                 continue;
-            auto& sc_x1 = ut::GetRecentValue(nodes_ss, deg_x1);
+            auto& sc_x1 = nodes_ss.GetRecentValue(deg_x1);
             size_t iFirst_x1 = 0, iLast_x1 = sc_x1.basis.size();
             /*if (level_x <= LEVEL_PERM && sc_x1.basis.size() && deg_fx.s == cross_min) {
                 iFirst_x1 = GetFirstIndexOnLevel(sc_x1, s1 - deg_x.s + 2);
@@ -651,7 +853,7 @@ int Diagram::GetSynImage(IndexCof iCof, AdamsDeg deg_x, const int1d& x, int leve
                 if (int error = GetSynImage(iCof, deg_x1, sc_x1.basis[i], sc_x1.levels[i], deg_fx1, fx1, s_f_dinv_x, R_PERM); error == 0) {
                     if (deg_fx1.s <= deg_fx.s && deg_fx1.s >= cross_min) {
                         if (level_x <= LEVEL_PERM) {
-                            auto& sc_fx1 = ut::GetRecentValue(nodes_ss_next, deg_fx1);
+                            auto& sc_fx1 = nodes_ss_next.GetRecentValue(deg_fx1);
                             size_t iLast_fx1 = GetFirstIndexOfFixedLevels(nodes_ss_next, deg_fx1, LEVEL_PERM + 1);
                             if (fx1.size() && lina::Residue(sc_fx1.basis.begin(), sc_fx1.basis.begin() + iLast_fx1, fx1).empty()) {
                                 return 19;
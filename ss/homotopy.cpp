@@ -19,9 +19,12 @@ Mod Proj(const algZ::MMod& mon, const Poly1d& map, const Mod1d& map_v)
 int2d QuotientSpace(const int2d& spaceV, const int2d& spaceW)
 {
     int2d quotient;
+    lina::Workspace& ws = lina::ThreadWorkspace();
     size_t dimQuo = spaceV.size() - spaceW.size();
     for (size_t i = 0; i < spaceV.size(); i++) {
-        auto v1 = lina::Residue(quotient, lina::Residue(spaceW, spaceV[i]));
+        int1d v1 = spaceV[i];
+        lina::ResidueInplace(spaceW, v1, ws);
+        lina::ResidueInplace(quotient, v1, ws);
         if (!v1.empty())
             quotient.push_back(std::move(v1));
     }
@@ -286,7 +289,7 @@ const PiBaseMod* Diagram::GetRecentPiBasis(const PiBasisMod1d& nodes_pi_basis, A
 int PossEinf(const Staircases1d& nodes_ss, AdamsDeg deg)
 {
     if (ut::has(nodes_ss.front(), deg)) {
-        const auto& sc = ut::GetRecentValue(nodes_ss, deg);
+        const auto& sc = nodes_ss.GetRecentValue(deg);
         size_t i_start_perm = GetFirstIndexOnLevel(sc, LEVEL_MAX / 2);
         size_t i_stable = GetFirstIndexOfFixedLevels(nodes_ss, deg, LEVEL_PERM + 1);
         return int(i_stable - i_start_perm);
@@ -303,7 +306,7 @@ void Diagram::UpdatePossEinf(const Staircases1d& nodes_ss, ut::map_seq2d<int, 0>
 int PossMoreEinf(const Staircases1d& nodes_ss, AdamsDeg deg)  //// TODO: improve
 {
     if (ut::has(nodes_ss.front(), deg)) {
-        const auto& sc = ut::GetRecentValue(nodes_ss, deg);
+        const auto& sc = nodes_ss.GetRecentValue(deg);
         size_t i_end_perm = GetFirstIndexOnLevel(sc, LEVEL_PERM + 1);
         size_t i_stable = GetFirstIndexOfFixedLevels(nodes_ss, deg, LEVEL_PERM + 1);
         return int(i_stable - i_end_perm);
@@ -421,23 +424,21 @@ int Diagram::ExtendRelCofV2(size_t iCof, int stem, algZ::Mod& rel, ut::map_seq<i
     return 0;
 }
 
-int2d Diagram::GetRingGbEinf(size_t iRing, AdamsDeg deg) const
+int2d Diagram::ComputeRingGbEinf(size_t iRing, AdamsDeg deg, const algZ::Poly1d& gb_Einf) const
 {
     auto& ring = rings_[iRing];
-    auto& gb = ring.gb;
-    auto& pi_gb = ring.pi_gb;
+    auto& gb = *ring.gb;
     auto& pi_gen_Einf = ring.pi_gen_Einf;
 
     int2d result;
     Poly tmp;
-    algZ::Poly1d gb_Einf = pi_gb.RelsLF(deg);
     for (auto& f_Einf : gb_Einf) {
         Poly LF;
         for (auto& m : f_Einf.data)
             LF.iaddP(Proj(m, pi_gen_Einf), tmp);
         LF = gb.Reduce(std::move(LF));
         if (LF)
-            result.push_back(Poly2Indices(LF, ring.basis.at(deg)));
+            result.push_back(Poly2Indices(LF, ring.basis->at(deg)));
         else
             result.push_back(int1d{});
     }
@@ -445,24 +446,22 @@ int2d Diagram::GetRingGbEinf(size_t iRing, AdamsDeg deg) const
     return result;
 }
 
-int2d Diagram::GetModuleGbEinf(size_t iMod, AdamsDeg deg) const
+int2d Diagram::ComputeModuleGbEinf(size_t iMod, AdamsDeg deg, const algZ::Mod1d& gb_Einf) const
 {
     auto& mod = modules_[iMod];
     auto& ring = rings_[mod.iRing];
-    auto& gb = mod.gb;
-    auto& pi_gb = mod.pi_gb;
+    auto& gb = *mod.gb;
     auto& pi_gen_Einf = mod.pi_gen_Einf;
 
     int2d result;
     Mod tmp;
-    algZ::Mod1d gb_Einf = pi_gb.RelsLF(deg);
     for (auto& f_Einf : gb_Einf) {
         Mod LF;
         for (auto& m : f_Einf.data)
             LF.iaddP(Proj(m, ring.pi_gen_Einf, pi_gen_Einf), tmp);
         LF = gb.Reduce(std::move(LF));
         if (LF)
-            result.push_back(Mod2Indices(LF, modules_[iMod].basis.at(deg)));
+            result.push_back(Mod2Indices(LF, modules_[iMod].basis->at(deg)));
         else
             result.push_back(int1d{});
     }
@@ -470,19 +469,53 @@ int2d Diagram::GetModuleGbEinf(size_t iMod, AdamsDeg deg) const
     return result;
 }
 
+int2d Diagram::GetRingGbEinf(size_t iRing, AdamsDeg deg) const
+{
+    auto& ring = rings_[iRing];
+    uint64_t stamp = std::max(ring.pi_gb.stamps().deg(deg), ring.pi_gb.stamps().gens());
+    return ring.pi_gb_Einf.Get(deg, stamp, [this, iRing](AdamsDeg d) { return ComputeRingGbEinf(iRing, d, rings_[iRing].pi_gb.RelsLF(d)); });
+}
+
+int2d Diagram::GetModuleGbEinf(size_t iMod, AdamsDeg deg) const
+{
+    auto& mod = modules_[iMod];
+    uint64_t stamp = std::max({mod.pi_gb.stamps().deg(deg), mod.pi_gb.stamps().gens(), rings_[mod.iRing].pi_gb.stamps().gens()});
+    return mod.pi_gb_Einf.Get(deg, stamp, [this, iMod](AdamsDeg d) { return ComputeModuleGbEinf(iMod, d, modules_[iMod].pi_gb.RelsLF(d)); });
+}
+
+/* Only the degrees whose relations changed since the last call are recomputed */
 std::map<AdamsDeg, int2d> Diagram::GetRingGbEinf(size_t iRing) const
 {
+    auto& ring = rings_[iRing];
+    AdamsDeg1d degs;
+    std::vector<uint64_t> stamps;
+    for (auto& [deg, _] : ring.pi_gb.leads_group_by_deg()) {
+        degs.push_back(deg);
+        stamps.push_back(std::max(ring.pi_gb.stamps().deg(deg), ring.pi_gb.stamps().gens()));
+    }
+    ring.pi_gb_Einf.Update(degs, stamps, [this, iRing](AdamsDeg d) { return ComputeRingGbEinf(iRing, d, rings_[iRing].pi_gb.RelsLF(d)); });
+
     std::map<AdamsDeg, int2d> result;
-    for (auto& [deg, _] : rings_[iRing].pi_gb.leads_group_by_deg())
-        result[deg] = GetRingGbEinf(iRing, deg);
+    for (AdamsDeg deg : degs)
+        result[deg] = ring.pi_gb_Einf.at(deg);
     return result;
 }
 
 std::map<AdamsDeg, int2d> Diagram::GetModuleGbEinf(size_t iMod) const
 {
+    auto& mod = modules_[iMod];
+    AdamsDeg1d degs;
+    std::vector<uint64_t> stamps;
+    uint64_t stamp_gens = std::max(mod.pi_gb.stamps().gens(), rings_[mod.iRing].pi_gb.stamps().gens());
+    for (auto& [deg, _] : mod.pi_gb.leads_group_by_deg()) {
+        degs.push_back(deg);
+        stamps.push_back(std::max(mod.pi_gb.stamps().deg(deg), stamp_gens));
+    }
+    mod.pi_gb_Einf.Update(degs, stamps, [this, iMod](AdamsDeg d) { return ComputeModuleGbEinf(iMod, d, modules_[iMod].pi_gb.RelsLF(d)); });
+
     std::map<AdamsDeg, int2d> result;
-    for (auto& [deg, _] : modules_[iMod].pi_gb.leads_group_by_deg())
-        result[deg] = GetModuleGbEinf(iMod, deg);
+    for (AdamsDeg deg : degs)
+        result[deg] = mod.pi_gb_Einf.at(deg);
     return result;
 }
 
@@ -490,7 +523,7 @@ std::map<AdamsDeg, int2d> Diagram::GetModuleGbEinf(size_t iMod) const
 //{
 //     auto& nodes_ss = modules_[iMod].nodes_ss;
 //     if (nodes_ss.front().find(deg_x) != nodes_ss.front().end()) {
-//         const auto& sc = ut::GetRecentValue(nodes_ss, deg_x);
+//         const auto& sc = nodes_ss.GetRecentValue(deg_x);
 //         size_t i_end_perm = GetFirstIndexOnLevel(sc, LEVEL_PERM + 1);
 //         size_t i_stable = GetFirstIndexOfFixedLevels(nodes_ss, deg_x, LEVEL_PERM + 1);
 //         if (i_stable - i_end_perm == 1) {
@@ -518,8 +551,8 @@ void Diagram::AddPiRelsRing(size_t iRing, algZ::Poly1d rels)
 {
     auto& ring = rings_[iRing];
     ring.pi_gb.AddRels(std::move(rels), ring.t_max, ring.basis_ss_possEinf);
-    for (size_t iCof = 0; iCof < modules_.size(); ++iCof)
-        modules_[iCof].pi_gb.AddRels({}, modules_[iCof].t_max, modules_[iCof].basis_ss_possEinf);
+    /* A module only reads the Groebner basis of its ring, so the modules are completed concurrently */
+    ut::for_each_par32_rethrow(modules_.size(), [this](size_t iCof) { modules_[iCof].pi_gb.AddRels({}, modules_[iCof].t_max, modules_[iCof].basis_ss_possEinf); });
     ////TODO: add pi_maps
 }
 
@@ -623,7 +656,7 @@ algZ::MMod1d Diagram::GenBasis(const algZ::GroebnerMod& gb, AdamsDeg deg, const
 //            auto& basis_d = basis.at(deg);
 //            int2d projs;
 //            {
-//                const auto& sc = ut::GetRecentValue(nodes_ss, deg);
+//                const auto& sc = nodes_ss.GetRecentValue(deg);
 //                size_t first_PC = GetFirstIndexOnLevel(sc, LEVEL_MAX / 2);
 //                for (auto& m : pi_basis_d) {
 //                    int1d proj = Poly2Indices(gb.Reduce(Proj(m, pi_gen_Einf)), basis_d);
@@ -655,7 +688,7 @@ algZ::MMod1d Diagram::GenBasis(const algZ::GroebnerMod& gb, AdamsDeg deg, const
 //            /* Add new generators in homotopy */
 //            int2d Einf;
 //            {
-//                const auto& sc = ut::GetRecentValue(nodes_ss, deg);
+//                const auto& sc = nodes_ss.GetRecentValue(deg);
 //                size_t first_PC = GetFirstIndexOnLevel(sc, LEVEL_MAX / 2);
 //                size_t last_PC = GetFirstIndexOnLevel(sc, LEVEL_PERM + 1);
 //                for (size_t i = first_PC; i < last_PC; ++i)
@@ -741,7 +774,7 @@ algZ::MMod1d Diagram::GenBasis(const algZ::GroebnerMod& gb, AdamsDeg deg, const
 //            auto& basis_d = basis.at(deg);
 //            int2d projs;
 //            {
-//                const auto& sc = ut::GetRecentValue(nodes_ss, deg);
+//                const auto& sc = nodes_ss.GetRecentValue(deg);
 //                size_t first_PC = GetFirstIndexOnLevel(sc, LEVEL_MAX / 2);
 //                for (auto& m : pi_basis_d) {
 //                    int1d proj = Mod2Indices(gb.Reduce(Proj(m, rings_.pi_gen_Einf, pi_gen_Einf)), basis_d);
@@ -773,7 +806,7 @@ algZ::MMod1d Diagram::GenBasis(const algZ::GroebnerMod& gb, AdamsDeg deg, const
 //            /* Add new generators in homotopy */
 //            int2d Einf;
 //            {
-//                const auto& sc = ut::GetRecentValue(nodes_ss, deg);
+//                const auto& sc = nodes_ss.GetRecentValue(deg);
 //                size_t first_PC = GetFirstIndexOnLevel(sc, LEVEL_MAX / 2);
 //                size_t last_PC = GetFirstIndexOnLevel(sc, LEVEL_PERM + 1);
 //                for (size_t i = first_PC; i < last_PC; ++i)
@@ -793,7 +826,7 @@ algZ::MMod1d Diagram::GenBasis(const algZ::GroebnerMod& gb, AdamsDeg deg, const
 //                AdamsDeg deg_S0 = deg - ssCof.deg_qt;
 //                if (fx) {
 //                    int1d ifx = Poly2Indices(fx, rings_.basis.at(deg_S0));
-//                    const auto& sc = ut::GetRecentValue(rings_.nodes_ss, deg_S0);
+//                    const auto& sc = rings_.nodes_ss.GetRecentValue(deg_S0);
 //                    size_t first = GetFirstIndexOnLevel(sc, LEVEL_MAX / 2);
 //                    ifx = lina::Residue(sc.basis.begin(), sc.basis.begin() + first, std::move(ifx));
 
@@ -1971,3 +2004,74 @@ int main_deduce_ext_2tor(int argc, char** argv, int& index, const char* desc)
     // bench::Counter::print();
     return 0;
 }
+
+/* Check that the change stamps of algZ::Groebner and algZ::GroebnerMod invalidate EinfCache entries on a small algebra */
+int main_check_einf_cache(int argc, char** argv, int& index, const char* desc)
+{
+    myio::CmdArg1d args = {};
+    myio::CmdArg1d op_args = {};
+    if (int error = myio::ParseArguments(argc, argv, index, PROGRAM, desc, VERSION, args, op_args))
+        return error;
+
+    /* h0, h1, h2 and a module generated by one vector in degree 0 */
+    algZ::Groebner gb(100, {AdamsDeg(1, 1), AdamsDeg(1, 2), AdamsDeg(1, 4)});
+    algZ::GroebnerMod gbm(&gb, 100, {AdamsDeg(0, 0)});
+    const AdamsDeg deg(2, 4), deg_other(2, 8);
+
+    EinfCache cache, cache_mod;
+    int count_computes = 0;
+    auto compute = [&count_computes](AdamsDeg) {
+        ++count_computes;
+        return int2d{};
+    };
+    auto ring_stamp = [&gb](AdamsDeg d) { return std::max(gb.stamps().deg(d), gb.stamps().gens()); };
+    auto mod_stamp = [&gb, &gbm](AdamsDeg d) { return std::max({gbm.stamps().deg(d), gbm.stamps().gens(), gb.stamps().gens()}); };
+
+    int count_failed = 0;
+    /* Look up `d` in both caches and compare the number of recomputations with `expected` */
+    auto check = [&](const char* step, AdamsDeg d, int expected, int expected_mod) {
+        count_computes = 0;
+        cache.Get(d, ring_stamp(d), compute);
+        int computed = count_computes;
+        count_computes = 0;
+        cache_mod.Get(d, mod_stamp(d), compute);
+        int computed_mod = count_computes;
+        bool ok = computed == expected && computed_mod == expected_mod;
+        if (!ok)
+            ++count_failed;
+        fmt::print("{:24} deg={} ring={} module={} {}\n", step, d, computed, computed_mod, ok ? "ok" : "FAILED");
+    };
+
+    check("first lookup", deg, 1, 1);
+    check("second lookup", deg, 0, 0);
+    check("other degree", deg_other, 1, 1);
+
+    gb.AddNode();
+    gbm.AddNode();
+    gb.push_back_data(algZ::Poly(gb.Gen(1, 2)), deg);
+    gbm.push_back_data(algZ::Mod(algZ::Poly(gb.Gen(1, 2)), 0, 0), deg);
+    check("push relation", deg, 1, 1);
+    check("push, other degree", deg_other, 0, 0);
+    gb.PopNode();
+    gbm.PopNode();
+    check("pop relation", deg, 1, 1);
+    check("pop, other degree", deg_other, 0, 0);
+
+    gb.AddNode();
+    gb.AddGen(AdamsDeg(1, 8));
+    check("add ring generator", deg, 1, 1);
+    gb.PopNode();
+    check("pop ring generator", deg, 1, 1);
+
+    gbm.AddNode();
+    gbm.AddGen(AdamsDeg(1, 2));
+    check("add module generator", deg, 0, 1);
+    gbm.PopNode();
+    check("pop module generator", deg, 0, 1);
+
+    gb.ResetRels();
+    check("reset relations", deg, 1, 0);
+
+    fmt::print("{}\n", count_failed ? "FAILED" : "passed");
+    return count_failed ? 1 : 0;
+}
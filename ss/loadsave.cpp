@@ -3,6 +3,7 @@
  */
 
 #include "main.h"
+#include "algebras/myhash.h"
 #include "mylog.h"
 #include <filesystem>
 #include <fstream>
@@ -121,6 +122,9 @@ Diagram::Diagram(std::string diagram_name, SSFlag flag, bool log, bool loadD2)
 
         /*# Load rings and modules */
 
+        if (flag & SSFlag::cache_contra)
+            contra_cache_ = std::make_shared<ContraCache>();
+
         auto& json_rings = js_.at("rings");
         auto& json_mods = js_.at("modules");
         AdamsDeg2d ring_gen_degs;
@@ -129,80 +133,193 @@ Diagram::Diagram(std::string diagram_name, SSFlag flag, bool log, bool loadD2)
         modules_.reserve(json_mods.size());
         std::vector<std::map<AdamsDeg, int2d>> basis_d2;
         {
-            size_t iCw = 0;
-            for (auto& json_ring : json_rings) {
-                std::string name = json_ring.at("name").get<std::string>(), path = json_ring.at("path").get<std::string>();
-                if (myio::get(json_ring, "deduce", "on") == "on")
-                    deduce_list_spectra_.push_back(IndexRing(iCw));
-                std::string abs_path = fmt::format("{}/{}", diagram_name, path);
-                std::string table_prefix = fmt::format("{}_AdamsE2", name);
-
+            /* SQLite is built single-threaded, so the databases are read sequentially into raw columns.
+             * The columns are parsed and the Groebner bases and staircases are constructed in parallel. */
+            struct CwLoaded
+            {
+                std::string table_prefix;
+                std::vector<std::pair<AdamsDeg, myio::RawColumn>> basis_raw; /* Read serially and parsed in parallel */
+                StaircaseRowRaw1d ss_raw;
+                myio::RawColumn1d gb_raw, pi_gb_raw;
+                std::map<AdamsDeg, Mon1d> basis_ring;
+                std::map<AdamsDeg, MMod1d> basis_mod;
+                Staircases nodes_ss;
+                Poly1d gb_ring;
+                Mod1d gb_mod;
+                AdamsDeg1d pi_gen_degs;
+                algZ::Poly1d pi_gb_ring;
+                algZ::Mod1d pi_gb_mod;
+                std::map<AdamsDeg, int2d> basis_d2;
+                ContraMap contras;
+                std::set<std::pair<int, int>> dirty;
+                bool has_dirty = false;
+                std::optional<std::set<std::pair<int, int>>> unsynced_cofseq;
+                uint64_t pi_fingerprint = 0;
+                AdamsDeg1d gen_degs;
+            };
+            const size_t n_rings = json_rings.size(), n_mods = json_mods.size();
+            std::vector<CwLoaded> loaded(n_rings + n_mods);
+            /* stem_trunc: the degrees with larger stems are not loaded and are deemed unknown. A cw can override the default of the diagram. */
+            const int stem_max_default = myio::get(js_, "stem_max", DEG_MAX);
+            auto open_db = [&](const nlohmann::json& json_cw, std::string& name, CwLoaded& cw) {
+                name = json_cw.at("name").get<std::string>();
+                std::string abs_path = fmt::format("{}/{}", diagram_name, json_cw.at("path").get<std::string>());
+                cw.table_prefix = fmt::format("{}_AdamsE2", name);
                 myio::AssertFileExists(abs_path);
-                DBSS db(abs_path);
-                RingSp ring;
-                ring.name = name;
-                ring.basis = db.load_basis(table_prefix);
+                return DBSS(abs_path);
+            };
+            auto load_common = [&](DBSS& db, const std::string& name, int stem_max, CwLoaded& cw) {
                 if (loadD2)
-                    basis_d2.push_back(db.load_basis_d2(table_prefix));
-                ring.degs_basis_order_by_stem = OrderDegsByStem(ring.basis);
-                ring.t_max = ring.basis.rbegin()->first.t;
-                ring.nodes_ss = {db.load_ss(table_prefix), {}};
-                ring.nodes_ss.reserve(MAX_DEPTH + 2);
-                ring.gb = Groebner(ring.t_max, {}, db.load_gb(table_prefix, DEG_MAX));
+                    cw.basis_d2 = db.load_basis_d2(cw.table_prefix, stem_max);
+                if (contra_cache_)
+                    cw.contras = db.load_contradictions(name);
+                cw.has_dirty = db.load_dirty(name, cw.dirty);
+                if (std::set<std::pair<int, int>> unsynced; db.load_cofseq_unsynced(name, unsynced))
+                    cw.unsynced_cofseq = std::move(unsynced);
+                cw.pi_fingerprint = (flag & SSFlag::pi) ? db.load_pi_fingerprint(name) : 0;
+                cw.gen_degs = db.load_gen_adamsdegs(cw.table_prefix);
+            };
+
+            rings_.resize(n_rings);
+            for (size_t iRing = 0; iRing < n_rings; ++iRing) {
+                auto& json_ring = json_rings.at(iRing);
+                auto& ring = rings_[iRing];
+                auto& cw = loaded[iRing];
+                DBSS db = open_db(json_ring, ring.name, cw);
+                ring.stem_max = myio::get(json_ring, "stem_max", stem_max_default);
+                cw.basis_raw = db.load_basis_raw(cw.table_prefix, ring.stem_max);
+                ring.t_max = db.get_int("SELECT MAX(t) FROM " + cw.table_prefix + "_basis");
+                cw.ss_raw = db.load_ss_raw(cw.table_prefix, ring.stem_max);
+                cw.gb_raw = db.load_gb_raw(cw.table_prefix, DEG_MAX, ring.stem_max);
+                load_common(db, ring.name, ring.stem_max, cw);
 
                 if (flag & SSFlag::pi) {
-                    ring.pi_gen_Einf = db.get_column_from_str<Poly>(name + "_pi_generators", "Einf", "ORDER BY id", myio::Deserialize<Poly>);
-                    ring.pi_gb = algZ::Groebner(ring.t_max, db.load_pi_gen_adamsdegs(name), db.load_pi_gb(name, DEG_MAX));
-                    ring.nodes_pi_basis.reserve(MAX_DEPTH + 1);
+                    ring.pi_gen_Einf = db.get_column_from_str<Poly>(ring.name + "_pi_generators", "Einf", "ORDER BY id", myio::Deserialize<Poly>);
+                    cw.pi_gen_degs = db.load_pi_gen_adamsdegs(ring.name);
+                    cw.pi_gb_raw = db.load_pi_gb_raw(ring.name, DEG_MAX);
                     if (flag & SSFlag::pi_def)
-                        db.load_pi_def(name, ring.pi_gen_defs, ring.pi_gen_def_mons);
+                        db.load_pi_def(ring.name, ring.pi_gen_defs, ring.pi_gen_def_mons);
                 }
-
-                ring_gen_degs.push_back(db.load_gen_adamsdegs(table_prefix));
-                rings_.push_back(std::move(ring));
-                ++iCw;
             }
 
-            iCw = 0;
-            for (auto& json_mod : json_mods) {
-                std::string name = json_mod.at("name").get<std::string>(), path = json_mod.at("path").get<std::string>();
-                std::string over = json_mod.at("over").get<std::string>();
-                if (myio::get(json_mod, "deduce", "on") == "on")
-                    deduce_list_spectra_.push_back(IndexMod(iCw));
-                std::string abs_path = fmt::format("{}/{}", diagram_name, path);
-                std::string table_prefix = fmt::format("{}_AdamsE2", name);
-
-                myio::AssertFileExists(abs_path);
-                DBSS db(abs_path);
-                ModSp mod;
-                mod.name = name;
-                auto indexRing = GetIndexCwByName(over);
+            modules_.resize(n_mods);
+            for (size_t iMod = 0; iMod < n_mods; ++iMod) {
+                auto& json_mod = json_mods.at(iMod);
+                auto& mod = modules_[iMod];
+                auto& cw = loaded[n_rings + iMod];
+                auto indexRing = GetIndexCwByName(json_mod.at("over").get<std::string>());
                 MyException::Assert(indexRing.isRing, "indexRing.isRing");
                 mod.iRing = indexRing.index;
-                auto& ring = rings_[mod.iRing];
-                mod.basis = db.load_basis_mod(table_prefix);
-                if (loadD2)
-                    basis_d2.push_back(db.load_basis_d2(table_prefix));
-                mod.degs_basis_order_by_stem = OrderDegsByStem(mod.basis);
-                mod.t_max = mod.basis.rbegin()->first.t;
-                mod.nodes_ss = {db.load_ss(table_prefix), {}};
-                mod.nodes_ss.reserve(MAX_DEPTH + 2);
-                Mod1d xs = db.load_gb_mod(table_prefix, DEG_MAX);
-                mod.gb = GroebnerMod(&ring.gb, mod.t_max, {}, std::move(xs));
+                DBSS db = open_db(json_mod, mod.name, cw);
+                mod.stem_max = myio::get(json_mod, "stem_max", stem_max_default);
+                cw.basis_raw = db.load_basis_raw(cw.table_prefix, mod.stem_max);
+                mod.t_max = db.get_int("SELECT MAX(t) FROM " + cw.table_prefix + "_basis");
+                cw.ss_raw = db.load_ss_raw(cw.table_prefix, mod.stem_max);
+                cw.gb_raw = db.load_gb_raw(cw.table_prefix, DEG_MAX, mod.stem_max);
+                load_common(db, mod.name, mod.stem_max, cw);
 
                 if (flag & SSFlag::pi) {
-                    mod.pi_gen_Einf = db.get_column_from_str<Mod>(name + "_pi_generators", "Einf", "ORDER BY id", myio::Deserialize<Mod>);
-                    mod.pi_gb = algZ::GroebnerMod(&ring.pi_gb, mod.t_max, db.load_pi_gen_adamsdegs(name), db.load_pi_gb_mod(name, DEG_MAX));
-                    mod.nodes_pi_basis.reserve(MAX_DEPTH + 1);
+                    mod.pi_gen_Einf = db.get_column_from_str<Mod>(mod.name + "_pi_generators", "Einf", "ORDER BY id", myio::Deserialize<Mod>);
+                    cw.pi_gen_degs = db.load_pi_gen_adamsdegs(mod.name);
+                    cw.pi_gb_raw = db.load_pi_gb_raw(mod.name, DEG_MAX);
                     if (flag & SSFlag::pi_def)
-                        db.load_pi_def(name, mod.pi_gen_defs, mod.pi_gen_def_mons);
+                        db.load_pi_def(mod.name, mod.pi_gen_defs, mod.pi_gen_def_mons);
+                }
+            }
+
+            /* Parse the columns read above. The basis, ss and the Groebner bases of a cw are parsed by separate tasks. */
+            ut::for_each_par32_rethrow(loaded.size() * 4, [&](size_t i) {
+                auto& cw = loaded[i / 4];
+                const bool is_ring = i / 4 < n_rings;
+                if (i % 4 == 0) {
+                    auto raw = std::move(cw.basis_raw);
+                    for (auto& [deg, mon] : raw) {
+                        if (is_ring)
+                            cw.basis_ring[deg].push_back(mon.deserialize<Mon>());
+                        else
+                            cw.basis_mod[deg].push_back(mon.deserialize<MMod>());
+                    }
+                }
+                else if (i % 4 == 1) {
+                    auto raw = std::move(cw.ss_raw);
+                    cw.nodes_ss = ParseStaircases(raw);
+                }
+                else if (i % 4 == 2) {
+                    auto raw = std::move(cw.gb_raw);
+                    for (auto& rel : raw) {
+                        if (is_ring)
+                            cw.gb_ring.push_back(rel.deserialize<Poly>());
+                        else
+                            cw.gb_mod.push_back(rel.deserialize<Mod>());
+                    }
+                }
+                else {
+                    auto raw = std::move(cw.pi_gb_raw);
+                    for (auto& rel : raw) {
+                        if (is_ring)
+                            cw.pi_gb_ring.push_back(myio::Deserialize<algZ::Poly>(rel.data));
+                        else
+                            cw.pi_gb_mod.push_back(myio::Deserialize<algZ::Mod>(rel.data));
+                    }
+                }
+            });
+
+            ut::for_each_par32_rethrow(n_rings, [&](size_t iRing) {
+                auto& ring = rings_[iRing];
+                auto& cw = loaded[iRing];
+                ring.basis = std::make_shared<const std::map<AdamsDeg, Mon1d>>(std::move(cw.basis_ring));
+                ring.degs_basis_order_by_stem = OrderDegsByStem(*ring.basis);
+                ring.nodes_ss = Staircases1d(std::move(cw.nodes_ss), ring.stem_max);
+                ring.gb = std::make_shared<const Groebner>(ring.t_max, int1d{}, std::move(cw.gb_ring));
+                if (flag & SSFlag::pi) {
+                    ring.pi_gb = algZ::Groebner(ring.t_max, std::move(cw.pi_gen_degs), std::move(cw.pi_gb_ring));
+                    ring.nodes_pi_basis.reserve(MAX_DEPTH + 1);
                 }
+            });
 
-                modules_.push_back(std::move(mod));
-                module_gen_degs.push_back(db.load_gen_adamsdegs(table_prefix));
-                ring.ind_mods.push_back(modules_.size() - 1);
-                ++iCw;
+            /* Modules refer to the Groebner bases of the rings */
+            ut::for_each_par32_rethrow(n_mods, [&](size_t iMod) {
+                auto& mod = modules_[iMod];
+                auto& ring = rings_[mod.iRing];
+                auto& cw = loaded[n_rings + iMod];
+                mod.basis = std::make_shared<const std::map<AdamsDeg, MMod1d>>(std::move(cw.basis_mod));
+                mod.degs_basis_order_by_stem = OrderDegsByStem(*mod.basis);
+                mod.nodes_ss = Staircases1d(std::move(cw.nodes_ss), mod.stem_max);
+                mod.gb = std::make_shared<const GroebnerMod>(ring.gb.get(), mod.t_max, int1d{}, std::move(cw.gb_mod));
+                if (flag & SSFlag::pi) {
+                    mod.pi_gb = algZ::GroebnerMod(&ring.pi_gb, mod.t_max, std::move(cw.pi_gen_degs), std::move(cw.pi_gb_mod));
+                    mod.nodes_pi_basis.reserve(MAX_DEPTH + 1);
+                }
+            });
+
+            for (size_t iRing = 0; iRing < n_rings; ++iRing)
+                if (myio::get(json_rings.at(iRing), "deduce", "on") == "on")
+                    deduce_list_spectra_.push_back(IndexRing(iRing));
+            for (size_t iMod = 0; iMod < n_mods; ++iMod) {
+                if (myio::get(json_mods.at(iMod), "deduce", "on") == "on")
+                    deduce_list_spectra_.push_back(IndexMod(iMod));
+                rings_[modules_[iMod].iRing].ind_mods.push_back(iMod);
             }
+            for (size_t iCw = 0; iCw < loaded.size(); ++iCw) {
+                auto& cw = loaded[iCw];
+                if (loadD2)
+                    basis_d2.push_back(std::move(cw.basis_d2));
+                if (contra_cache_)
+                    contra_cache_->entries.push_back(std::move(cw.contras));
+                if (!cw.has_dirty) { /* Never deduced with a worklist */
+                    auto& basis_degs = iCw < n_rings ? rings_[iCw].degs_basis_order_by_stem : modules_[iCw - n_rings].degs_basis_order_by_stem;
+                    for (auto& d : basis_degs)
+                        cw.dirty.insert({d.stem(), d.s});
+                }
+                dirty_saved_.push_back(cw.has_dirty ? std::optional(cw.dirty) : std::nullopt);
+                dirty_.push_back(std::move(cw.dirty));
+                unsynced_cofseq_saved_.push_back(cw.unsynced_cofseq);
+                unsynced_cofseq_.push_back(std::move(cw.unsynced_cofseq));
+                pi_fingerprints_.push_back(cw.pi_fingerprint);
+                (iCw < n_rings ? ring_gen_degs : module_gen_degs).push_back(std::move(cw.gen_degs));
+            }
+            if (contra_cache_)
+                contra_cache_->keys_changed.resize(contra_cache_->entries.size());
         }
 
         /*# Load maps */
@@ -231,12 +348,12 @@ Diagram::Diagram(std::string diagram_name, SSFlag flag, bool log, bool loadD2)
                 if (auto ifrom = GetIndexCwByName(from); ifrom.isRing) {
                     if (auto ito = GetIndexCwByName(to); ito.isRing) {
                         MyException::Assert(ifrom == ito, "index_from == index_to");
-                        Poly poly_factor = factor.size() ? Indices2Poly(factor, rings_[ifrom.index].basis.at(deg_factor)): Poly();
+                        Poly poly_factor = factor.size() ? Indices2Poly(factor, rings_[ifrom.index].basis->at(deg_factor)): Poly();
                         int t_max = rings_[ito.index].t_max - deg_factor.t;
                         map = std::make_unique<MapMulRing2Ring>(name, display, t_max, deg_factor, ifrom.index, std::move(poly_factor));
                     }
                     else {
-                        Mod mod_factor = factor.size() ? Indices2Mod(factor, modules_[ito.index].basis.at(deg_factor)) : Mod();
+                        Mod mod_factor = factor.size() ? Indices2Mod(factor, modules_[ito.index].basis->at(deg_factor)) : Mod();
                         int t_max = modules_[ito.index].t_max - deg_factor.t;
                         map = std::make_unique<MapMulRing2Mod>(name, display, t_max, deg_factor, ifrom.index, ito.index, std::move(mod_factor));
                     }
@@ -244,7 +361,7 @@ Diagram::Diagram(std::string diagram_name, SSFlag flag, bool log, bool loadD2)
                 else {
                     auto ito = GetIndexCwByName(to);
                     MyException::Assert(ifrom == ito, "index_from == index_to");
-                    Poly poly_factor = factor.size() ? Indices2Poly(factor, rings_[modules_[ifrom.index].iRing].basis.at(deg_factor)) : Poly();
+                    Poly poly_factor = factor.size() ? Indices2Poly(factor, rings_[modules_[ifrom.index].iRing].basis->at(deg_factor)) : Poly();
                     int t_max = modules_[ito.index].t_max - deg_factor.t;
                     map = std::make_unique<MapMulMod2Mod>(name, display, t_max, deg_factor, ifrom.index, std::move(poly_factor));
                 }
@@ -267,7 +384,7 @@ Diagram::Diagram(std::string diagram_name, SSFlag flag, bool log, bool loadD2)
                     auto& gen_degs = ring_gen_degs[ifrom.index];
                     int2d generators;
                     for (size_t i = 0; i < gen_degs.size(); ++i) {
-                        int index = ut::IndexOf(rings_[ifrom.index].basis.at(gen_degs[i]), Mon::Gen((uint32_t)i));
+                        int index = ut::IndexOf(rings_[ifrom.index].basis->at(gen_degs[i]), Mon::Gen((uint32_t)i));
                         generators.push_back({index});
                     }
                     get_composition_info(json_maps, maps_, indices, from, to, rings_[ifrom.index].t_max, t_max_map, deg_map);
@@ -277,7 +394,7 @@ Diagram::Diagram(std::string diagram_name, SSFlag flag, bool log, bool loadD2)
                         if (gen_degs[i].t > t_max_map)
                             break;
                         int1d fx = get_compostion(generators[i], gen_degs[i], *this, maps_, indices);
-                        images_map.push_back(Indices2Poly(fx, rings_[ito.index].basis.at(gen_degs[i] + deg_map)));
+                        images_map.push_back(Indices2Poly(fx, rings_[ito.index].basis->at(gen_degs[i] + deg_map)));
                     }
                     map = std::make_unique<MapRing2Ring>(name, display, t_max_map, deg_map, ifrom.index, ito.index, std::move(images_map));
                 }
@@ -285,7 +402,7 @@ Diagram::Diagram(std::string diagram_name, SSFlag flag, bool log, bool loadD2)
                     auto& gen_degs = module_gen_degs[ifrom.index];
                     int2d generators;
                     for (size_t i = 0; i < gen_degs.size(); ++i) {
-                        int index = ut::IndexOf(modules_[ifrom.index].basis.at(gen_degs[i]), MMod({}, (uint32_t)i));
+                        int index = ut::IndexOf(modules_[ifrom.index].basis->at(gen_degs[i]), MMod({}, (uint32_t)i));
                         generators.push_back({index});
                     }
                     get_composition_info(json_maps, maps_, indices, from, to, modules_[ifrom.index].t_max, t_max_map, deg_map);
@@ -300,7 +417,7 @@ Diagram::Diagram(std::string diagram_name, SSFlag flag, bool log, bool loadD2)
                                 if (fx.empty())
                                     images_map.push_back({});
                                 else
-                                    images_map.push_back(Indices2Poly(fx, rings_[ito.index].basis.at(gen_degs[i] + deg_map)));
+                                    images_map.push_back(Indices2Poly(fx, rings_[ito.index].basis->at(gen_degs[i] + deg_map)));
                             }
                         }
                         map = std::make_unique<MapMod2Ring>(name, display, t_max_map, deg_map, ifrom.index, ito.index, std::move(images_map));
@@ -315,7 +432,7 @@ Diagram::Diagram(std::string diagram_name, SSFlag flag, bool log, bool loadD2)
                                 if (fx.empty())
                                     images_map.push_back({});
                                 else
-                                    images_map.push_back(Indices2Mod(fx, modules_[ito.index].basis.at(gen_degs[i] + deg_map)));
+                                    images_map.push_back(Indices2Mod(fx, modules_[ito.index].basis->at(gen_degs[i] + deg_map)));
                             }
                         }
                         map = std::make_unique<MapMod2Mod>(name, display, t_max_map, deg_map, ifrom.index, ito.index, std::move(images_map));
@@ -358,7 +475,7 @@ Diagram::Diagram(std::string diagram_name, SSFlag flag, bool log, bool loadD2)
                         }
                         else {
                             std::string over = json_map.at("over").get<std::string>();
-                            int index_map = ut::IndexOf(maps_, [&over](const std::unique_ptr<Map>& map) { return map->name == over; });
+                            int index_map = ut::IndexOf(maps_, [&over](const std::shared_ptr<Map>& map) { return map->name == over; });
                             map = std::make_unique<MapMod2RingV2>(name, display, t_max, deg, ifrom.index, ito.index, index_map, std::move(images));
                             //((MapMod2RingV2&)(*map)).Verify(*this, ring_gen_degs);  ////
                         }
@@ -372,7 +489,7 @@ Diagram::Diagram(std::string diagram_name, SSFlag flag, bool log, bool loadD2)
                         }
                         else {
                             std::string over = json_map.at("over").get<std::string>();
-                            int index_map = ut::IndexOf(maps_, [&over](const std::unique_ptr<Map>& map) { return map->name == over; });
+                            int index_map = ut::IndexOf(maps_, [&over](const std::shared_ptr<Map>& map) { return map->name == over; });
                             map = std::make_unique<MapMod2ModV2>(name, display, t_max, deg, ifrom.index, ito.index, index_map, std::move(images));
                             //((MapMod2ModV2&)(*map)).Verify(*this, ring_gen_degs);  ////
                         }
@@ -383,6 +500,17 @@ Diagram::Diagram(std::string diagram_name, SSFlag flag, bool log, bool loadD2)
             }
             maps_.push_back(std::move(map));
         }
+        /* A map is defined on the sources within both truncations */
+        for (auto& map : maps_) {
+            map->stem_max = GetStemMax(map->from);
+            if (int stem_max_to = GetStemMax(map->to); stem_max_to != DEG_MAX)
+                map->stem_max = std::min(map->stem_max, stem_max_to - map->deg.stem());
+        }
+        if (flag & SSFlag::pi) {
+            for (size_t iCw = 0; iCw < rings_.size() + modules_.size(); ++iCw)
+                if ((iCw < rings_.size() ? rings_[iCw].stem_max : modules_[iCw - rings_.size()].stem_max) != DEG_MAX)
+                    throw MyException(0x4e27a1c3, "stem_max is not supported by homotopy yet");
+        }
 
         /*# Load cofseqs */
         if (flag & SSFlag::cofseq) {
@@ -409,15 +537,16 @@ Diagram::Diagram(std::string diagram_name, SSFlag flag, bool log, bool loadD2)
                     cofseq.nameCw[iCs] = GetCwName(cofseq.indexCw[iCs]);
                     cofseq.t_max[iCs] = GetTMax(cofseq.indexCw[iCs]);
                     cofseq.nodes_ss[iCs] = &GetSS(cofseq.indexCw[iCs]);
-                    cofseq.nodes_cofseq[iCs].resize(cofseq.nodes_ss[iCs]->size());
-                    cofseq.nodes_cofseq[iCs].reserve(cofseq.nodes_ss[iCs]->capacity());
+                    cofseq.nodes_cofseq[iCs] = Staircases1d(Staircases{});
                 }
                 if (myio::FileExists(abs_path_cofseq)) { /* Load cofseq from database */
                     DBSS db(abs_path_cofseq);
                     db.create_cofseq(fmt::format("cofseq_{}", cofseq.name));
                     auto node_cofseq = db.load_cofseq(fmt::format("cofseq_{}", cofseq.name));
-                    for (size_t i = 0; i < cofseq.nodes_cofseq.size(); ++i)
-                        cofseq.nodes_cofseq[i].front() = std::move(node_cofseq[i]);
+                    for (size_t i = 0; i < cofseq.nodes_cofseq.size(); ++i) {
+                        cofseq.in_db = cofseq.in_db || !node_cofseq[i].empty();
+                        cofseq.nodes_cofseq[i].SetFront(std::move(node_cofseq[i]));
+                    }
                 }
                 cofseqs_.push_back(cofseq);
                 ++iCof;
@@ -500,6 +629,7 @@ Diagram::Diagram(std::string diagram_name, SSFlag flag, bool log, bool loadD2)
     }*/
     catch (NoException&) {
     }
+    deduce_list_loaded_ = deduce_list_spectra_;
 
     /*if (flag & SSFlag::homotopy)
         UpdateAllPossEinf();*/
@@ -516,9 +646,89 @@ void Diagram::SetDeduceList(const std::vector<std::string>& cws)
     }
 }
 
+uint64_t Diagram::FingerprintPi(IndexCw iCw, SSFlag flag) const
+{
+    uint64_t seed = (flag & SSFlag::pi_def) ? 1 : 0;
+    auto hash_str = [&seed](const std::string& str) { ut::hash_combine(seed, std::hash<std::string>{}(str)); };
+    auto hash_deg = [&seed](AdamsDeg deg) { ut::hash_combine(seed, ((uint64_t)deg.s << 32) | (uint64_t)deg.t); };
+    auto hash_int2d = [&seed](const int2d& a) {
+        for (auto& v : a) {
+            ut::hash_combine(seed, v.size());
+            for (int i : v)
+                ut::hash_combine(seed, (uint64_t)i);
+        }
+    };
+    auto hash_defs = [&](const std::vector<EnumDef>& defs, const std::vector<std::vector<GenConstraint>>& def_mons) {
+        if (!(flag & SSFlag::pi_def))
+            return;
+        for (size_t i = 0; i < defs.size(); ++i) {
+            ut::hash_combine(seed, (uint64_t)defs[i]);
+            for (auto& gd : def_mons[i]) {
+                ut::hash_combine(seed, (uint64_t)gd.map_index);
+                hash_str(myio::Serialize(gd.m));
+                ut::hash_combine(seed, (uint64_t)gd.O);
+            }
+        }
+    };
+    if (iCw.isRing) {
+        auto& ring = rings_[iCw.index];
+        for (AdamsDeg deg : ring.pi_gb.gen_degs())
+            hash_deg(deg);
+        for (auto& Einf : ring.pi_gen_Einf)
+            hash_str(myio::Serialize(Einf));
+        auto gb_Einf = GetRingGbEinf(iCw.index);
+        for (auto& [deg, polys] : ring.pi_gb.OutputForDatabase()) {
+            hash_deg(deg);
+            for (auto& poly : polys)
+                hash_str(myio::Serialize(poly));
+            hash_int2d(gb_Einf.at(deg));
+        }
+        for (auto& [deg, basis_d] : ring.nodes_pi_basis.front()) {
+            hash_deg(deg);
+            for (auto& m : basis_d.nodes_pi_basis)
+                hash_str(myio::Serialize(m));
+            hash_int2d(basis_d.Einf);
+        }
+        hash_defs(ring.pi_gen_defs, ring.pi_gen_def_mons);
+    }
+    else {
+        auto& mod = modules_[iCw.index];
+        for (AdamsDeg deg : mod.pi_gb.v_degs())
+            hash_deg(deg);
+        for (auto& Einf : mod.pi_gen_Einf)
+            hash_str(myio::Serialize(Einf));
+        auto gb_Einf = GetModuleGbEinf(iCw.index);
+        for (auto& [deg, polys] : mod.pi_gb.OutputForDatabase()) {
+            hash_deg(deg);
+            for (auto& poly : polys)
+                hash_str(myio::Serialize(poly));
+            hash_int2d(gb_Einf.at(deg));
+        }
+        for (auto& [deg, basis_d] : mod.nodes_pi_basis.front()) {
+            hash_deg(deg);
+            for (auto& m : basis_d.nodes_pi_basis)
+                hash_str(myio::Serialize(m));
+            hash_int2d(basis_d.Einf);
+        }
+        hash_defs(mod.pi_gen_defs, mod.pi_gen_def_mons);
+    }
+    return seed;
+}
+
 void Diagram::save(std::string diagram_name, SSFlag flag)
 {
+    ++count_saves_;
+    if (defer_save_) {
+        save_pending_ = true;
+        save_pending_flag_ = save_pending_flag_ | flag;
+        return;
+    }
+    Logger::Flush();
     std::map<std::string, std::string> paths;
+    /* Drop the record if cofseq has been synchronized in memory but is not saved this time */
+    auto unsynced_cofseq_to_save = [&](size_t iCw) {
+        return cofseqs_.empty() || (flag & SSFlag::cofseq) ? unsynced_cofseq_[iCw] : std::nullopt;
+    };
     try {
         /* #save rings */
         auto& json_rings = js_["rings"];
@@ -527,13 +737,34 @@ void Diagram::save(std::string diagram_name, SSFlag flag)
             std::string abs_path = fmt::format("{}/{}", diagram_name, path);
             std::string table_prefix = fmt::format("{}_AdamsE2", name);
 
-            DBSS db(abs_path);
-            db.begin_transaction();
             size_t iRing = GetIndexCwByName(name).index;
             auto& ring = rings_[iRing];
-            db.update_ss(table_prefix, ring.nodes_ss[1]);
+            const bool ss_changed = !ring.nodes_ss.unsaved().empty();
+            const bool dirty_changed = !dirty_saved_[iRing] || dirty_[iRing] != *dirty_saved_[iRing];
+            const bool contra_changed = contra_cache_ && !contra_cache_->keys_changed[iRing].empty();
+            const uint64_t fp_pi = (flag & SSFlag::pi) ? FingerprintPi(IndexRing(iRing), flag) : 0;
+            const bool pi_changed = (flag & SSFlag::pi) && fp_pi != pi_fingerprints_[iRing];
+            const auto unsynced = unsynced_cofseq_to_save(iRing);
+            const bool unsynced_changed = unsynced != unsynced_cofseq_saved_[iRing];
+            if (!ss_changed && !dirty_changed && !unsynced_changed && !contra_changed && !pi_changed)
+                continue;
 
-            if (flag & SSFlag::pi) {
+            DBSS db(abs_path);
+            db.begin_transaction();
+            if (ss_changed)
+                db.update_ss(table_prefix, ring.nodes_ss.changes(), ring.nodes_ss.unsaved());
+            if (dirty_changed)
+                db.save_dirty(name, dirty_[iRing], dirty_saved_[iRing].value_or(std::set<std::pair<int, int>>{}));
+            if (unsynced_changed) {
+                if (unsynced)
+                    db.save_cofseq_unsynced(name, *unsynced, unsynced_cofseq_saved_[iRing].value_or(std::set<std::pair<int, int>>{}));
+                else
+                    db.drop_table(name + "_cofseq_unsynced");
+            }
+            if (contra_changed)
+                db.save_contradictions(name, contra_cache_->entries[iRing], contra_cache_->keys_changed[iRing]);
+
+            if (pi_changed) {
                 db.drop_and_create_pi_relations(name);
                 db.drop_and_create_pi_basis(name);
 
@@ -545,8 +776,16 @@ void Diagram::save(std::string diagram_name, SSFlag flag)
                     db.drop_and_create_pi_definitions(name);
                     db.save_pi_def(name, ring.pi_gen_defs, ring.pi_gen_def_mons);
                 }
+                db.save_pi_fingerprint(name, fp_pi);
             }
             db.end_transaction();
+
+            ring.nodes_ss.MarkSaved();
+            dirty_saved_[iRing] = dirty_[iRing];
+            unsynced_cofseq_saved_[iRing] = unsynced;
+            if (contra_cache_)
+                contra_cache_->keys_changed[iRing].clear();
+            pi_fingerprints_[iRing] = fp_pi;
         }
 
         /* #save modules */
@@ -557,13 +796,35 @@ void Diagram::save(std::string diagram_name, SSFlag flag)
             std::string abs_path = fmt::format("{}/{}", diagram_name, path);
             std::string table_prefix = fmt::format("{}_AdamsE2", name);
 
-            DBSS db(abs_path);
-            db.begin_transaction();
             size_t iMod = GetIndexCwByName(name).index;
+            size_t jCw = rings_.size() + iMod;
             auto& mod = modules_[iMod];
-            db.update_ss(table_prefix, mod.nodes_ss[1]);
+            const bool ss_changed = !mod.nodes_ss.unsaved().empty();
+            const bool dirty_changed = !dirty_saved_[jCw] || dirty_[jCw] != *dirty_saved_[jCw];
+            const bool contra_changed = contra_cache_ && !contra_cache_->keys_changed[jCw].empty();
+            const uint64_t fp_pi = (flag & SSFlag::pi) ? FingerprintPi(IndexMod(iMod), flag) : 0;
+            const bool pi_changed = (flag & SSFlag::pi) && fp_pi != pi_fingerprints_[jCw];
+            const auto unsynced = unsynced_cofseq_to_save(jCw);
+            const bool unsynced_changed = unsynced != unsynced_cofseq_saved_[jCw];
+            if (!ss_changed && !dirty_changed && !unsynced_changed && !contra_changed && !pi_changed)
+                continue;
+
+            DBSS db(abs_path);
+            db.begin_transaction();
+            if (ss_changed)
+                db.update_ss(table_prefix, mod.nodes_ss.changes(), mod.nodes_ss.unsaved());
+            if (dirty_changed)
+                db.save_dirty(name, dirty_[jCw], dirty_saved_[jCw].value_or(std::set<std::pair<int, int>>{}));
+            if (unsynced_changed) {
+                if (unsynced)
+                    db.save_cofseq_unsynced(name, *unsynced, unsynced_cofseq_saved_[jCw].value_or(std::set<std::pair<int, int>>{}));
+                else
+                    db.drop_table(name + "_cofseq_unsynced");
+            }
+            if (contra_changed)
+                db.save_contradictions(name, contra_cache_->entries[jCw], contra_cache_->keys_changed[jCw]);
 
-            if (flag & SSFlag::pi) {
+            if (pi_changed) {
                 db.drop_and_create_pi_relations(name);
                 db.drop_and_create_pi_basis(name);
                 if (flag & SSFlag::pi_def)
@@ -575,8 +836,16 @@ void Diagram::save(std::string diagram_name, SSFlag flag)
                     db.drop_and_create_pi_definitions(name);
                     db.save_pi_def(name, mod.pi_gen_defs, mod.pi_gen_def_mons);
                 }
+                db.save_pi_fingerprint(name, fp_pi);
             }
             db.end_transaction();
+
+            mod.nodes_ss.MarkSaved();
+            dirty_saved_[jCw] = dirty_[jCw];
+            unsynced_cofseq_saved_[jCw] = unsynced;
+            if (contra_cache_)
+                contra_cache_->keys_changed[jCw].clear();
+            pi_fingerprints_[jCw] = fp_pi;
         }
 
         /* #save cofseq */
@@ -584,6 +853,9 @@ void Diagram::save(std::string diagram_name, SSFlag flag)
             auto& json_cofseqs = js_.at("cofseqs");
             std::vector<std::string> cofseq_maps;
             for (size_t i = 0; i < cofseqs_.size(); ++i) {
+                auto& cofseq = cofseqs_[i];
+                if (cofseq.in_db && std::all_of(cofseq.nodes_cofseq.begin(), cofseq.nodes_cofseq.end(), [](const Staircases1d& nodes) { return nodes.unsaved().empty(); }))
+                    continue;
                 auto path_cofseq = json_cofseqs[i].at("path").get<std::string>();
                 auto abs_path_cofseq = fmt::format("{}/{}", diagram_name, path_cofseq);
                 auto name = json_cofseqs[i].at("name").get<std::string>();
@@ -591,8 +863,11 @@ void Diagram::save(std::string diagram_name, SSFlag flag)
                 db.begin_transaction();
                 auto table = fmt::format("cofseq_{}", name);
                 db.create_cofseq(table);
-                db.save_cofseq(table, cofseqs_[i]);
+                db.save_cofseq(table, cofseq);
                 db.end_transaction();
+                for (auto& nodes : cofseq.nodes_cofseq)
+                    nodes.MarkSaved();
+                cofseq.in_db = true;
             }
         }
     }
@@ -601,3 +876,60 @@ void Diagram::save(std::string diagram_name, SSFlag flag)
         throw e;
     }
 }
+
+void Diagram::SavePending(const std::string& diagram_name)
+{
+    if (!save_pending_)
+        return;
+    bool defer_save = defer_save_;
+    defer_save_ = false;
+    save(diagram_name, save_pending_flag_);
+    defer_save_ = defer_save;
+    save_pending_ = false;
+    save_pending_flag_ = SSFlag::no_op;
+}
+
+DiagramCheckpoint Diagram::MakeCheckpoint() const
+{
+    DiagramCheckpoint checkpoint;
+    for (auto& ring : rings_)
+        checkpoint.rings.emplace_back(ring);
+    for (auto& mod : modules_)
+        checkpoint.modules.emplace_back(mod);
+    for (auto& cofseq : cofseqs_)
+        checkpoint.nodes_cofseq.push_back(cofseq.nodes_cofseq);
+    checkpoint.dirty = dirty_;
+    checkpoint.unsynced_cofseq = unsynced_cofseq_;
+    if (contra_cache_) {
+        std::scoped_lock lock(contra_cache_->mutex);
+        checkpoint.contra_entries = contra_cache_->entries;
+        checkpoint.contra_keys_changed = contra_cache_->keys_changed;
+    }
+    checkpoint.save_pending = save_pending_;
+    checkpoint.save_pending_flag = save_pending_flag_;
+    return checkpoint;
+}
+
+void Diagram::Restore(const DiagramCheckpoint& checkpoint)
+{
+    for (size_t iRing = 0; iRing < rings_.size(); ++iRing)
+        checkpoint.rings[iRing].Restore(rings_[iRing]);
+    for (size_t iMod = 0; iMod < modules_.size(); ++iMod)
+        checkpoint.modules[iMod].Restore(modules_[iMod]);
+    for (size_t iCof = 0; iCof < cofseqs_.size(); ++iCof)
+        cofseqs_[iCof].nodes_cofseq = checkpoint.nodes_cofseq[iCof];
+    dirty_ = checkpoint.dirty;
+    unsynced_cofseq_ = checkpoint.unsynced_cofseq;
+    rank_dirty_cofseq_.clear();
+    dirty_cofseq_.clear();
+    if (contra_cache_) {
+        std::scoped_lock lock(contra_cache_->mutex);
+        contra_cache_->entries = checkpoint.contra_entries;
+        contra_cache_->keys_changed = checkpoint.contra_keys_changed;
+    }
+    save_pending_ = checkpoint.save_pending;
+    save_pending_flag_ = checkpoint.save_pending_flag;
+    depth_ = 0;
+    a_leibniz_ = nullptr;
+    ++version_; /* The workers are no longer synchronized */
+}
@@ -27,13 +27,16 @@ int main_name(int, char**, int&, const char*);
 
 int main_add_basis(int argc, char** argv, int& index, const char* desc);
 int main_mul(int argc, char** argv, int& index, const char* desc);
+int main_convert_log(int argc, char** argv, int& index, const char* desc);
+int main_migrate_db_format(int argc, char** argv, int& index, const char* desc);
+int main_bench_staircase(int argc, char** argv, int& index, const char* desc);
+int main_check_einf_cache(int argc, char** argv, int& index, const char* desc);
 
-int main(int argc, char** argv)
-{
-    Logger::SetOutMain("ss.log");
-    Logger::LogCmd(argc, argv);
+int main_serve(int argc, char** argv, int& index, const char* desc);
+int main_client(int argc, char** argv, int& index, const char* desc);
 
-    bench::Timer timer;
+int RunSubCmd(int argc, char** argv)
+{
     myio::SubCmdArg1d subcmds = {
         {"reset_ss", "Initialize the ss tables", main_reset_ss},
         {"reset_cofseq", "Initialize the cofseq tables", main_reset_cofseq},
@@ -54,9 +57,24 @@ int main(int argc, char** argv)
         {"name", "Manage generator names", main_name},
         {"add_basis", "Add basis from generators and relations", main_add_basis},
         {"mul", "Display the product", main_mul},
+        {"convert_log", "Convert x, dx of a log database between blob and readable text", main_convert_log},
+        {"migrate_db_format", "Convert basis, relations and staircases of a diagram between blob and readable text", main_migrate_db_format},
+        {"bench_staircase", "Compare the sparse and the bitset triangularization on the staircases of a diagram", main_bench_staircase},
+        {"check_einf_cache", "Check that relation and generator changes invalidate the cached E∞ images", main_check_einf_cache},
+        {"serve", "Keep a diagram in memory and run commands from a local socket", main_serve},
+        {"client", "Forward a command to ss serve", main_client},
     };
     int index = 1;
-    if (int error = myio::ParseSubCmd(argc, argv, index, PROGRAM, "Manage spectral sequences and homotopy groups", VERSION, subcmds))
+    return myio::ParseSubCmd(argc, argv, index, PROGRAM, "Manage spectral sequences and homotopy groups", VERSION, subcmds);
+}
+
+int main(int argc, char** argv)
+{
+    Logger::SetOutMain("ss.log");
+    Logger::LogCmd(argc, argv);
+
+    bench::Timer timer;
+    if (int error = RunSubCmd(argc, argv))
         return error;
 
     Logger::LogTime(timer.print2str());
@@ -6,8 +6,11 @@
 #include "algebras/linalg.h"
 #include "json.h"
 #include "pigroebner.h"
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <stdexcept>
 #include <variant>
 
 inline const char* PROGRAM = "ss";
@@ -20,6 +23,7 @@ constexpr int R_PERM = 1000;
 constexpr int LEVEL_PERM = LEVEL_MAX - R_PERM; /* Level of Permanant cycles */
 
 constexpr size_t MAX_DEPTH = 3; /* Maximum deduction depth */
+constexpr size_t MUL_CACHE_MAX_BYTES = size_t(1) << 28; /* Memory budget of each E2 multiplication table */
 
 inline const auto NULL_DIFF = int1d{-1};
 inline const algZ::Mod MOD_V0 = algZ::MMod(algZ::Mon(), 0, 0);
@@ -39,6 +43,12 @@ enum class SSFlag : uint32_t
     naming = 256,         /* naming mode */
     try_all = 512,        /* Try all possible differentials */
     synthetic = 1024,     /* Sync method */
+    par_try = 2048,       /* Try the candidate differentials on worker copies in parallel */
+    cache_contra = 4096,  /* Skip the candidates recorded in the contradiction cache */
+    full_sweep = 8192,    /* Deduce every degree in the range once instead of running the worklist */
+    full_sync = 16384,    /* Propagate every permanent cycle and boundary of ss to cofseq when loading */
+    check_sync = 32768,   /* Compare the incremental sync of cofseq with the full sync when loading */
+    par_cofseq = 65536,   /* Deduce the independent components of cofseqs on worker copies in parallel */
 };
 
 enum class CrossType
@@ -81,7 +91,138 @@ struct Staircase
     int1d levels;
 };
 using Staircases = std::map<AdamsDeg, Staircase>;
-using Staircases1d = std::vector<Staircases>;
+
+/* History of staircases with one node per depth of deduction.
+ *
+ * The first node is loaded from the database and the second node holds the changes at depth 0.
+ * Nodes above depth 0 are not materialized: changes are applied in place to the second node and
+ * the overwritten rows are recorded in an undo journal, which PopNode replays backwards.
+ *
+ * The most recent staircase of each degree is indexed in a dense (stem, s) array so that
+ * GetRecentValue does not search the maps.
+ *
+ * Use AddToFront, SetFront, Set and Modify to change the staircases.
+ */
+class Staircases1d
+{
+private:
+    struct UndoEntry
+    {
+        AdamsDeg deg;
+        bool inserted;  /* deg was absent from changes_ */
+        size_t first;   /* Rows [first, end) are saved */
+        Staircase rows;
+    };
+
+    std::shared_ptr<Staircases> base_ = std::make_shared<Staircases>(); /* Shared by copies and copied before a write while shared */
+    Staircases changes_;
+    std::vector<UndoEntry> journal_;
+    std::vector<size_t> nodes_journal_size_;            /* journal_.size() when each node above depth 0 was added */
+    std::vector<std::vector<const Staircase*>> recent_; /* recent_[stem - stem_min_][s] */
+    int stem_min_ = 0;
+    int stem_max_ = DEG_MAX; /* Degrees with larger stems are truncated and unknown */
+    size_t bytes_journaled_ = 0;
+    std::set<AdamsDeg> unsaved_; /* Degrees changed at depth 0 since the last save */
+
+public:
+    Staircases1d() = default;
+    explicit Staircases1d(Staircases base, int stem_max = DEG_MAX) : base_(std::make_shared<Staircases>(std::move(base))), stem_max_(stem_max)
+    {
+        Reindex();
+    }
+    Staircases1d(const Staircases1d& other)
+        : base_(other.base_), changes_(other.changes_), journal_(other.journal_), nodes_journal_size_(other.nodes_journal_size_), stem_max_(other.stem_max_), bytes_journaled_(other.bytes_journaled_), unsaved_(other.unsaved_)
+    {
+        Reindex();
+    }
+    Staircases1d(Staircases1d&&) = default;
+    Staircases1d& operator=(const Staircases1d& other)
+    {
+        if (this != &other)
+            *this = Staircases1d(other);
+        return *this;
+    }
+    Staircases1d& operator=(Staircases1d&&) = default;
+
+public:
+    /* The number of nodes, which is depth + 2 */
+    size_t size() const
+    {
+        return nodes_journal_size_.size() + 2;
+    }
+    const Staircases& front() const
+    {
+        return *base_;
+    }
+    /* The changes at depth 0 */
+    const Staircases& changes() const
+    {
+        return changes_;
+    }
+    /* Return if nothing has changed since the last AddNode */
+    bool IsLastNodeEmpty() const
+    {
+        return nodes_journal_size_.empty() ? changes_.empty() : journal_.size() == nodes_journal_size_.back();
+    }
+    size_t bytes_journaled() const
+    {
+        return bytes_journaled_;
+    }
+    int stem_max() const
+    {
+        return stem_max_;
+    }
+    /* The degrees of changes() that are not saved to the database yet */
+    const std::set<AdamsDeg>& unsaved() const
+    {
+        return unsaved_;
+    }
+    void MarkSaved()
+    {
+        unsaved_.clear();
+    }
+
+    /* Return the current staircase at deg */
+    const Staircase& GetRecentValue(AdamsDeg deg) const
+    {
+        size_t i = size_t(deg.stem() - stem_min_);
+        if (i < recent_.size() && size_t(deg.s) < recent_[i].size())
+            if (auto p = recent_[i][deg.s])
+                return *p;
+        throw std::out_of_range("Recent Value not found");
+    }
+
+    void AddNode()
+    {
+        nodes_journal_size_.push_back(journal_.size());
+    }
+    void PopNode();
+    /* Merge the last node into the one below it. Changes merged into depth 0 become unsaved. */
+    void CommitNode();
+
+    /* Add an empty staircase at deg to the first node if it is absent */
+    void AddToFront(AdamsDeg deg);
+    /* Replace the first node */
+    void SetFront(Staircases node);
+    /* Replace the changes at depth 0 by those of `other`. Both must be at depth 0. */
+    void AssignChanges(const Staircases1d& other);
+    /* AssignChanges and also take the degrees that `other` has not saved yet */
+    void AdoptChanges(const Staircases1d& other);
+    /* Replace the current staircase at deg */
+    void Set(AdamsDeg deg, Staircase sc);
+    /* Return the current staircase at deg for modification of rows [first, end).
+     * sc_init must be the current staircase at deg. */
+    Staircase& Modify(AdamsDeg deg, const Staircase& sc_init, size_t first);
+
+private:
+    const Staircase*& Slot(AdamsDeg deg);
+    /* Return base_ for modification after copying it if it is shared */
+    Staircases& WritableBase();
+    void Refresh(AdamsDeg deg);
+    void Reindex();
+    /* Record the rows [first, end) of changes_[deg] or its absence. At depth 0 only mark deg as unsaved. */
+    void Journal(AdamsDeg deg, size_t first);
+};
 
 template <>
 struct fmt::formatter<Staircase>
@@ -147,9 +288,30 @@ struct CofSeq
     std::array<int, 3> t_max;
     std::array<Staircases1d*, 3> nodes_ss;
     std::array<Staircases1d, 3> nodes_cofseq; /* size = depth + 2 */
+    bool in_db = false;                       /* The cofseq table has been populated */
 };
 using CofSeq1d = std::vector<CofSeq>;
 
+/* Cofseqs that interact through cws, maps or the rings of modules. Different components are deduced independently. */
+struct CofSeqComponent
+{
+    std::vector<size_t> deduce_list; /* Subsequence of Diagram::deduce_list_cofseq_ */
+    std::vector<size_t> cws;         /* Indexed by rings and then modules */
+    std::vector<size_t> cofseqs;
+};
+
+enum class EnumReason : uint32_t;
+
+/* A differential read by an import. x is empty if dx is a boundary. */
+struct ImportDiff
+{
+    std::string cw;
+    AdamsDeg deg_x;
+    int1d x, dx;
+    int r;
+    int line; /* Position in the input for the report of conflicts */
+};
+
 struct PiBase
 {
     algZ::Mon1d nodes_pi_basis;
@@ -226,25 +388,155 @@ struct GenConstraint
     int O;
 };
 
+/* Lazily filled E2 multiplication table.
+ * The block of (deg_a, deg_b) stores the reduced product of the i-th basis element in deg_a and
+ * the j-th basis element in deg_b as a packed row of bits indexed by the basis of deg_a + deg_b.
+ * A block is one allocation and a separate bitmask records which products are computed.
+ * The whole table is dropped when it exceeds MUL_CACHE_MAX_BYTES. */
+class MulCache
+{
+private:
+    struct Block
+    {
+        size_t dim_b = 0, words = 0;  /* words is the length of each row */
+        std::vector<uint64_t> rows;   /* rows[(i * dim_b + j) * words + k] */
+        std::vector<uint64_t> known;  /* bit i * dim_b + j is set once the product is computed */
+    };
+    std::map<std::pair<AdamsDeg, AdamsDeg>, Block> blocks_;
+    size_t bytes_ = 0;
+
+public:
+    /* result = a * b, where prod(i, j) computes the product of two basis elements
+     * as indices in the basis of deg_a + deg_b which has dimension dim_ab */
+    template <typename FnProd>
+    void Mul(AdamsDeg deg_a, const int1d& a, size_t dim_a, AdamsDeg deg_b, const int1d& b, size_t dim_b, size_t dim_ab, int1d& result, FnProd&& prod)
+    {
+        result.clear();
+        if (a.empty() || b.empty())
+            return;
+        if (bytes_ > MUL_CACHE_MAX_BYTES) {
+            blocks_.clear();
+            bytes_ = 0;
+        }
+        auto& block = blocks_[std::make_pair(deg_a, deg_b)];
+        if (block.rows.empty()) {
+            block.dim_b = dim_b;
+            block.words = (dim_ab + 63) / 64;
+            block.rows.assign(dim_a * dim_b * block.words, 0);
+            block.known.assign((dim_a * dim_b + 63) / 64, 0);
+            bytes_ += (block.rows.size() + block.known.size()) * sizeof(uint64_t);
+        }
+        const size_t words = block.words;
+        thread_local std::vector<uint64_t> acc;
+        acc.assign(words, 0);
+        for (int i : a) {
+            for (int j : b) {
+                const size_t ij = (size_t)i * block.dim_b + (size_t)j;
+                uint64_t* row = block.rows.data() + ij * words;
+                if (!(block.known[ij / 64] & (uint64_t(1) << (ij % 64)))) {
+                    for (int k : prod(i, j))
+                        row[k / 64] ^= uint64_t(1) << (k % 64);
+                    block.known[ij / 64] |= uint64_t(1) << (ij % 64);
+                }
+                for (size_t k = 0; k < words; ++k)
+                    acc[k] ^= row[k];
+            }
+        }
+        for (size_t k = 0; k < words; ++k)
+            for (uint64_t w = acc[k]; w; w &= w - 1)
+                result.push_back(int(k * 64 + ut::ctz(w)));
+    }
+
+    void clear()
+    {
+        blocks_.clear();
+        bytes_ = 0;
+    }
+};
+
+/* E∞ images of the leading forms of pi relations by degree.
+ * An entry is valid as long as its stamp is unchanged, where the stamp is the maximum of
+ * the ChangeStamps of the relations in its degree and of the generators it is projected with.
+ * pi_gen_Einf grows and shrinks with the generators of pi_gb, so its changes are covered. */
+class EinfCache
+{
+private:
+    struct Entry
+    {
+        uint64_t stamp = 0;
+        int2d Einf;
+    };
+    std::map<AdamsDeg, Entry> entries_;
+
+    bool Valid(AdamsDeg deg, uint64_t stamp) const
+    {
+        auto p = entries_.find(deg);
+        return p != entries_.end() && p->second.stamp == stamp;
+    }
+
+public:
+    /* `compute(deg)` returns the E∞ images of the relations in `deg` */
+    template <typename FnCompute>
+    const int2d& Get(AdamsDeg deg, uint64_t stamp, FnCompute&& compute)
+    {
+        if (!Valid(deg, stamp))
+            entries_[deg] = Entry{stamp, compute(deg)};
+        return entries_.at(deg).Einf;
+    }
+
+    /* Make the entries of `degs` valid. The stale degrees are computed in parallel. */
+    template <typename FnCompute>
+    void Update(const AdamsDeg1d& degs, const std::vector<uint64_t>& stamps, FnCompute&& compute)
+    {
+        std::vector<size_t> stale;
+        for (size_t i = 0; i < degs.size(); ++i)
+            if (!Valid(degs[i], stamps[i]))
+                stale.push_back(i);
+        int3d results(stale.size());
+        ut::for_each_par32_rethrow(stale.size(), [&](size_t j) { results[j] = compute(degs[stale[j]]); });
+        for (size_t j = 0; j < stale.size(); ++j)
+            entries_[degs[stale[j]]] = Entry{stamps[stale[j]], std::move(results[j])};
+    }
+
+    const int2d& at(AdamsDeg deg) const
+    {
+        return entries_.at(deg).Einf;
+    }
+
+    void clear()
+    {
+        entries_.clear();
+    }
+};
+
+/* Whether deg is beyond the range t <= t_max, stem <= stem_max of a cw, where the groups are unknown */
+inline bool OutOfRange(AdamsDeg deg, int t_max, int stem_max)
+{
+    return deg.t > t_max || deg.stem() > stem_max;
+}
+
 struct RingSp
 {
     /* #metadata */
     std::string name;
     int t_max = -1;
+    int stem_max = DEG_MAX; /* stem_trunc */
     std::vector<size_t> ind_mods, ind_maps, ind_maps_prev;
     std::vector<IndexCof> ind_cofs;
 
     /* #ss */
-    Groebner gb;
-    std::map<AdamsDeg, Mon1d> basis;
-    AdamsDeg1d degs_basis_order_by_stem;      /* Constant after initialization */
-    Staircases1d nodes_ss;                    /* size = depth + 2 */
-    ut::map_seq2d<int, 0> basis_ss_possEinf;  //// TODO: change to int2d
+    std::shared_ptr<const Groebner> gb;                         /* Constant after loading and shared with the workers */
+    std::shared_ptr<const std::map<AdamsDeg, Mon1d>> basis;     /* Constant after loading and shared with the workers */
+    AdamsDeg1d degs_basis_order_by_stem;                        /* Constant after initialization */
+    Staircases1d nodes_ss;                                      /* size = depth + 2 */
+    ut::map_seq2d<int, 0> basis_ss_possEinf;                    //// TODO: change to int2d
+    MulCache mul_cache;                                         /* ring * ring */
 
     /* #pi */
     algZ::Groebner pi_gb;
     Poly1d pi_gen_Einf = {Poly::Gen(0)};
     PiBasis1d nodes_pi_basis = {{{AdamsDeg(0, 0), {{algZ::Mon()}, {{0}}}}}}; /* size = depth + 1 */
+    mutable EinfCache pi_gb_Einf; /* Cache of GetRingGbEinf */
 
     std::vector<EnumDef> pi_gen_defs;
     std::vector<std::vector<GenConstraint>> pi_gen_def_mons;
@@ -256,21 +548,24 @@ struct ModSp
     /* #metadata */
     std::string name;
     int t_max = -1;
+    int stem_max = DEG_MAX; /* stem_trunc */
     size_t iRing;
     std::vector<size_t> ind_maps, ind_maps_prev;
     std::vector<IndexCof> ind_cofs;
 
     /* #ss */
-    GroebnerMod gb;
-    std::map<AdamsDeg, MMod1d> basis;
-    AdamsDeg1d degs_basis_order_by_stem;      /* Constant after initialization */
-    Staircases1d nodes_ss;                    /* size = depth + 2 */
-    ut::map_seq2d<int, 0> basis_ss_possEinf;  //// TODO: change to int2d
+    std::shared_ptr<const GroebnerMod> gb;                      /* Constant after loading and shared with the workers */
+    std::shared_ptr<const std::map<AdamsDeg, MMod1d>> basis;    /* Constant after loading and shared with the workers */
+    AdamsDeg1d degs_basis_order_by_stem;                        /* Constant after initialization */
+    Staircases1d nodes_ss;                                      /* size = depth + 2 */
+    ut::map_seq2d<int, 0> basis_ss_possEinf;                    //// TODO: change to int2d
+    MulCache mul_cache;                                         /* ring * module */
 
     /* #pi */
     algZ::GroebnerMod pi_gb;
     Mod1d pi_gen_Einf;
     PiBasisMod1d nodes_pi_basis = {{}}; /* size = depth + 1 */
+    mutable EinfCache pi_gb_Einf; /* Cache of GetModuleGbEinf */
 
     std::vector<EnumDef> pi_gen_defs;
     std::vector<std::vector<GenConstraint>> pi_gen_def_mons;
@@ -284,6 +579,7 @@ class Map
 public:
     std::string name, display;
     int t_max = -1;
+    int stem_max = DEG_MAX; /* The sources x with x.stem() <= stem_max */
     AdamsDeg deg;
     IndexCw from, to;
     IndexCof ind_cof;
@@ -298,7 +594,7 @@ public:
     }
     virtual int1d map(const int1d& x, AdamsDeg deg_x, const Diagram& diagram) const = 0;
 };
-using PMap1d = std::vector<std::unique_ptr<Map>>;
+using PMap1d = std::vector<std::shared_ptr<Map>>; /* Shared by the worker copies of a diagram */
 
 class MapRing2Ring : public Map  ////TODO: Add pi_images
 {
@@ -395,6 +691,76 @@ struct Commutativity
 };
 using Commutativity1d = std::vector<Commutativity>;
 
+/* A candidate d_r(x)=dx at deg tried by TryDiff. x and dx are in the E2 basis. */
+struct ContraKey
+{
+    AdamsDeg deg;
+    int r;
+    bool tryY;
+    int1d x, dx;
+
+    bool operator<(const ContraKey& rhs) const
+    {
+        return std::tie(deg, r, tryY, x, dx) < std::tie(rhs.deg, rhs.r, rhs.tryY, rhs.x, rhs.dx);
+    }
+};
+using ContraMap = std::map<ContraKey, uint64_t>; /* key -> fingerprint of the neighborhood when the contradiction was found */
+
+/* Candidates proven impossible in previous runs, stored in the database of each cw.
+ * An entry is valid as long as the fingerprint of the staircases around it is unchanged.
+ * Shared by the worker copies of a diagram.
+ */
+struct ContraCache
+{
+    std::mutex mutex;
+    std::vector<ContraMap> entries;               /* Indexed by rings and then modules */
+    std::vector<std::set<ContraKey>> keys_changed; /* Keys to be written back or deleted by save() */
+    int count_hits = 0;
+};
+
+/* The state of a cw that the commands of `ss serve` change */
+template <typename CwSp>
+struct CwCheckpoint
+{
+    Staircases1d nodes_ss;
+    ut::map_seq2d<int, 0> basis_ss_possEinf;
+    decltype(CwSp::pi_gb) pi_gb;
+    decltype(CwSp::pi_gen_Einf) pi_gen_Einf;
+    decltype(CwSp::nodes_pi_basis) nodes_pi_basis;
+    std::vector<EnumDef> pi_gen_defs;
+    std::vector<std::vector<GenConstraint>> pi_gen_def_mons;
+
+    explicit CwCheckpoint(const CwSp& cw)
+        : nodes_ss(cw.nodes_ss), basis_ss_possEinf(cw.basis_ss_possEinf), pi_gb(cw.pi_gb), pi_gen_Einf(cw.pi_gen_Einf), nodes_pi_basis(cw.nodes_pi_basis), pi_gen_defs(cw.pi_gen_defs),
+          pi_gen_def_mons(cw.pi_gen_def_mons)
+    {
+    }
+    void Restore(CwSp& cw) const
+    {
+        cw.nodes_ss = nodes_ss;
+        cw.basis_ss_possEinf = basis_ss_possEinf;
+        cw.pi_gb = pi_gb;
+        cw.pi_gen_Einf = pi_gen_Einf;
+        cw.nodes_pi_basis = nodes_pi_basis;
+        cw.pi_gen_defs = pi_gen_defs;
+        cw.pi_gen_def_mons = pi_gen_def_mons;
+    }
+};
+
+/* Everything a command may change in a diagram at depth 0. The loaded staircases are shared, not copied. */
+struct DiagramCheckpoint
+{
+    std::vector<CwCheckpoint<RingSp>> rings;
+    std::vector<CwCheckpoint<ModSp>> modules;
+    std::vector<std::array<Staircases1d, 3>> nodes_cofseq;
+    std::vector<std::set<std::pair<int, int>>> dirty;
+    std::vector<std::optional<std::set<std::pair<int, int>>>> unsynced_cofseq;
+    std::vector<ContraMap> contra_entries;
+    std::vector<std::set<ContraKey>> contra_keys_changed;
+    bool save_pending = false;
+    SSFlag save_pending_flag = SSFlag::no_op;
+};
+
 class Diagram
 {
 protected:
@@ -412,6 +778,61 @@ protected:
     int deduce_count_max_ = 10;
     AdamsDeg deg_leibniz_;             /* For logging */
     const int1d* a_leibniz_ = nullptr; /* For logging */
+    size_t count_nodes_ = 0;           /* Number of AddNode calls. For statistics */
+
+protected: /* SSFlag::par_try */
+    std::vector<std::unique_ptr<Diagram>> workers_;
+    uint64_t version_ = 0;         /* Incremented whenever a staircase is changed */
+    uint64_t version_workers_ = 0; /* version_ when workers_ were last synchronized */
+
+protected: /* SSFlag::cache_contra */
+    std::shared_ptr<ContraCache> contra_cache_;
+
+protected: /* Worklists of DeduceDiffs and DeduceDiffsCofseq. Only changes at depth 0 are tracked. */
+    std::vector<std::set<std::pair<int, int>>> dirty_;   /* (stem, s) of the degrees to be deduced in each cw. Saved in the database. */
+    int1d rank_dirty_cofseq_;                            /* Index in deduce_list_cofseq_ of each cofseq or -1. Empty if not tracking */
+    std::vector<std::array<AdamsDeg1d, 3>> degs_cofseq_; /* Degrees of nodes_cofseq ordered by stem */
+    std::set<std::array<int, 4>> dirty_cofseq_;          /* (rank, iCs, stem, s) */
+
+    /* Mark deg and the degrees whose candidate differentials involve deg */
+    void MarkDirtyNbhd(IndexCw iCw, AdamsDeg deg);
+    /* Mark the degrees whose differentials reach deg through the products of the Leibniz rule */
+    void MarkDirtyLeibniz(IndexCw iCw, AdamsDeg deg);
+
+protected: /* Incremental SyncCofseq. Only changes at depth 0 are tracked. */
+    /* (stem, s) of the degrees of each cw with new permanent cycles or boundaries not propagated to cofseq yet.
+     * nullopt if unknown, in which case the next sync is a full one. Saved in the database. */
+    std::vector<std::optional<std::set<std::pair<int, int>>>> unsynced_cofseq_;
+    std::vector<std::optional<std::set<std::pair<int, int>>>> unsynced_cofseq_saved_; /* unsynced_cofseq_ as in the database */
+
+    void MarkUnsyncedCofseq(IndexCw iCw, AdamsDeg deg);
+    /* Propagate the permanent cycles and boundaries of iCw in degrees `degs` to cofseq */
+    void SyncCofseq(size_t iCw, const AdamsDeg1d& degs, SSFlag flag);
+
+protected: /* Bookkeeping of save. Databases without changes are not opened for writing. */
+    std::vector<std::optional<std::set<std::pair<int, int>>>> dirty_saved_; /* dirty_ as in the database. nullopt if there is no table */
+    std::vector<uint64_t> pi_fingerprints_;                  /* FingerprintPi of the pi data in the database */
+
+protected: /* ss serve */
+    std::vector<IndexCw> deduce_list_loaded_; /* deduce_list_spectra_ right after loading */
+    bool defer_save_ = false;                 /* save() only records the request */
+    size_t count_saves_ = 0;                  /* Number of save() calls */
+    bool save_pending_ = false;
+    SSFlag save_pending_flag_ = SSFlag::no_op;
+
+    /* Hash of the pi data of iCw that save writes */
+    uint64_t FingerprintPi(IndexCw iCw, SSFlag flag) const;
+
+    /* Copy for a worker thread. Maps, the contradiction cache, the E2 data and the loaded staircases are shared.
+     * Workers never deduce homotopy, so the pi data is not copied. Neither are the multiplication tables and the workers. */
+    Diagram(const Diagram& diagram);
+    /* Create the workers on first use and bring their staircases up to date */
+    void SyncWorkers(size_t num_workers, SSFlag flag);
+    /* Bring back the changes a worker made in the ss of iCw and in its worklists */
+    void AdoptWorkerCw(const Diagram& worker, size_t iCw);
+    /* The root of the component of each cw (rings and then modules).
+     * A differential set in a cw propagates to its ring or modules, along maps and to the other cws of its cofseqs. */
+    size_t1d GetCwComponentRoots() const;
 
 public:
     Diagram(std::string diagram_name, SSFlag flag, bool log = true, bool loadD2 = false);
@@ -424,6 +845,30 @@ public:
     }
     void save(std::string diagram_name, SSFlag flag);
 
+    /* Used by `ss serve` to keep the diagram in memory across commands */
+    void SetDeferSave(bool defer)
+    {
+        defer_save_ = defer;
+    }
+    bool IsSavePending() const
+    {
+        return save_pending_;
+    }
+    /* Write the saves requested while deferred */
+    void SavePending(const std::string& diagram_name);
+    void ResetDeduceList()
+    {
+        deduce_list_spectra_ = deduce_list_loaded_;
+    }
+    size_t GetCountSaves() const
+    {
+        return count_saves_;
+    }
+    /* Called at depth 0 */
+    DiagramCheckpoint MakeCheckpoint() const;
+    /* Discard the changes made since `checkpoint`, including those of nodes left by an exception */
+    void Restore(const DiagramCheckpoint& checkpoint);
+
 public: /* Getters */
     static auto GetRecentPiBasis(const PiBasis1d& nodes_pi_basis, AdamsDeg deg) -> const PiBase*;
     static auto GetRecentPiBasis(const PiBasisMod1d& nodes_pi_basis, AdamsDeg deg) -> const PiBaseMod*;
@@ -488,6 +933,11 @@ public: /* Getters */
         return iCw.isRing ? rings_[iCw.index].t_max : modules_[iCw.index].t_max;
     }
 
+    auto& GetStemMax(IndexCw iCw) const
+    {
+        return iCw.isRing ? rings_[iCw.index].stem_max : modules_[iCw.index].stem_max;
+    }
+
     auto& GetSS(IndexCw iCw) const
     {
         return iCw.isRing ? rings_[iCw.index].nodes_ss : modules_[iCw.index].nodes_ss;
@@ -569,7 +1019,7 @@ private:
     /*
      * Return the smallest r1>=r such that d_{r1} has a possible target
      *
-     * Range >= t_max is unknown and thus always possible.
+     * Range > t_max or > nodes_ss.stem_max() is unknown and thus always possible.
      * Return R_PERM if not found
      */
     int NextRTgt(const Staircases1d& nodes_ss, int t_max, AdamsDeg deg, int r) const;
@@ -598,6 +1048,11 @@ private:
     /* Retriangulate when ss changes */
     void ReSetScCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg, SSFlag flag);
 
+    /* result = a * b in E2 of a ring using its multiplication table. deg_a + deg_b must be within t_max. */
+    void MulRing(size_t iRing, AdamsDeg deg_a, const int1d& a, AdamsDeg deg_b, const int1d& b, int1d& result);
+    /* result = a * x where a is in the E2 of the underlying ring and x is in the E2 of a module. deg_a + deg_x must be within t_max. */
+    void MulMod(size_t iMod, AdamsDeg deg_a, const int1d& a, AdamsDeg deg_x, const int1d& x, int1d& result);
+
     /**
      * Add d_r(x)=dx;
      * Add d_s(xy)=d_s(x)y+xd_s(y) for y with level=LEVEL_MAX-s and s>=r_min.
@@ -619,6 +1074,14 @@ public:
     /* Pop the lastest node */
     void PopNode(SSFlag flag);
 
+    /* Bytes recorded in the undo journals and the number of nodes added so far, including those of the workers */
+    void GetJournalStats(size_t& bytes, size_t& count_nodes) const;
+    /* Number of candidates skipped by the contradiction cache */
+    int GetContraCacheHits() const
+    {
+        return contra_cache_ ? contra_cache_->count_hits : 0;
+    }
+
     /* Apply the change of the staircase to the current history */
     void UpdateStaircase(Staircases1d& nodes_ss, AdamsDeg deg, const Staircase& sc_i, size_t i_insert, const int1d& x, const int1d& dx, int level, int1d& image, int& level_image);
 
@@ -636,6 +1099,17 @@ public:
     int SetModuleDiffGlobal(size_t iMod, AdamsDeg deg_x, const int1d& x, const int1d& dx, int r, bool newCertain, SSFlag flag);
     int SetCwDiffGlobal(IndexCw iCw, AdamsDeg deg_x, const int1d& x, const int1d& dx, int r, bool newCertain, SSFlag flag);
 
+    /* Add the differentials in the order of (stem, s, r), skipping the known ones.
+     * Each one is set in a node of the staircases that is rolled back if it is invalid or contradicts the diagram.
+     * These conflicts are reported at the end instead of aborting the import. Return the number of changed degrees. */
+    int ImportDiffs(std::vector<ImportDiff> diffs, EnumReason reason, SSFlag flag);
+
+    /* The cws of each component ordered by their first cw. Differentials set in different components do not interact. */
+    std::vector<size_t1d> GetCwComponents() const;
+    /* Run f(worker, i) at depth 0 for the jobs i in parallel. Job i may only change the ss of the cws in cws[i].
+     * The changes and logs are merged back in the order of jobs. If a job throws, none is merged and the exception is rethrown. Return the sum of f. */
+    int RunCwJobsPar(const std::vector<size_t1d>& cws, SSFlag flag, const std::function<int(Diagram&, size_t)>& f);
+
     [[nodiscard]] int GetSynImage(IndexCof iCof, AdamsDeg deg_x, const int1d& x, int level_x, AdamsDeg& deg_fx, int1d& fx, int s_f_dinv_x, int cross_min);
     int SetCwDiffSynthetic(IndexCw iCw, AdamsDeg deg_x, const int1d& x, const int1d& dx, int r, bool hasCross, SSFlag flag);
 
@@ -656,8 +1130,16 @@ public: /* Differentials */
     int DeduceManual(SSFlag flag);
     int DeduceDiffBySynthetic(SSFlag flag);
     int DeduceDiffBySyntheticCofseq(SSFlag flag);
+    /* Hash of the staircases of iCw in stems deg_x.stem()-1 to deg_x.stem()+1 */
+    uint64_t FingerprintNbhd(IndexCw iCw, AdamsDeg deg_x) const;
     /* Return 0 if there is no exception */
     int TryDiff(IndexCw iCw, AdamsDeg deg_x, const int1d& x, const int1d& dx, int r, SSFlag flag, bool tryY);
+    /* Parallel version of the loop over candidates in DeduceDiffs.
+     * Try (xs[i], dxs[i]) on the workers for i < n and then the trivial candidate (xs[n], dxs[n]) if exactly one passes.
+     * Stop after two passes unless try_all. Logs are written in the order of the serial loop.
+     * Return count_pass and set `i_pass` to the last passing index and `bTrivFails` to whether the trivial candidate fails.
+     */
+    int TryDiffsPar(IndexCw iCw, AdamsDeg deg_x, const int2d& xs, const int2d& dxs, int r, SSFlag flag, bool tryY, size_t& i_pass, bool& bTrivFails);
     int TryDiffCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg_x, AdamsDeg deg_dx, const int1d& x, const int1d& dx, const int1d& perm, int r, int depth, SSFlag flag, bool tryY);
     int DeduceDiffs(IndexCw iCw, AdamsDeg deg, int depth, SSFlag flag);
     int DeduceDiffs(IndexCw& iCw, int stem_min, int stem_max, int s_min, int s_max, int depth, SSFlag flag);
@@ -665,12 +1147,28 @@ public: /* Differentials */
     /* Deduce d(xy) no matter what dx is */
     int DeduceDiffsV2();
 
+    /* Mark the degrees affected by a change of the staircase of iCw at deg. Includes the degrees related by products, maps and cofseqs. */
+    void MarkDirty(IndexCw iCw, AdamsDeg deg);
+    void MarkDirtyCofseq(const CofSeq& cofseq, size_t iCs, AdamsDeg deg);
+    /* Deduce the dirty degrees in the range in the order of deduce_list_spectra_ until none is left */
+    int DeduceDiffsDirty(int stem_min, int stem_max, SSFlag flag);
+
     int DeduceDiffsCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg, int depth, SSFlag flag);
     int DeduceDiffsCofseq(int stem_min, int stem_max, int depth, SSFlag flag);
+    /* DeduceDiffsCofseq(stem_min, stem_max, depth, flag) without the trivial differentials and commutativities first */
+    int DeduceDiffsCofseqPass(int stem_min, int stem_max, int depth, SSFlag flag);
+    /* Components of the cofseqs in deduce_list_cofseq_ ordered by their first cofseq in the list */
+    std::vector<CofSeqComponent> GetCofseqComponents() const;
+    /* Run DeduceDiffsCofseqPass at depth 0 for each component on a worker and merge the results in the order of components */
+    int DeduceDiffsCofseqPar(int stem_min, int stem_max, SSFlag flag);
+    /* Worklist version of DeduceDiffsCofseq(stem_min, stem_max, 0, flag) */
+    int DeduceDiffsCofseqDirty(int stem_min, int stem_max, SSFlag flag);
     int DeduceDiffsNbhdCofseq(CofSeq& cofseq, size_t iCs, int stem, int depth, SSFlag flag);
 
     int CommuteCofseq(size_t iComm, SSFlag flag);
     int CommuteCofseq(SSFlag flag);
+    /* Propagate the changes of ss since the last sync to cofseq. Everything is propagated with SSFlag::full_sync.
+     * SSFlag::check_sync also runs the full sync and throws if the results differ. */
     void SyncCofseq(SSFlag flag);
 
 public:
@@ -698,6 +1196,8 @@ public:
     int ExtendRelMod(size_t iCof, int stem, algZ::Mod& rel) const;
     int ExtendRelRingV2(size_t iRing, int stem, algZ::Poly& rel, ut::map_seq<int, 0>& num_leads) const;
     int ExtendRelCofV2(size_t iCof, int stem, algZ::Mod& rel, ut::map_seq<int, 0>& num_leads) const;
+    int2d ComputeRingGbEinf(size_t iRing, AdamsDeg deg, const algZ::Poly1d& gb_Einf) const;
+    int2d ComputeModuleGbEinf(size_t iMod, AdamsDeg deg, const algZ::Mod1d& gb_Einf) const;
     int2d GetRingGbEinf(size_t iRing, AdamsDeg deg) const;
     std::map<AdamsDeg, int2d> GetRingGbEinf(size_t iRing) const;
     int2d GetModuleGbEinf(size_t iMod, AdamsDeg deg) const;
@@ -708,12 +1208,11 @@ public: /* homotopy groups */
     void AddPiRelsRing(size_t iRing, algZ::Poly1d rels);
     void AddPiRelsCof(size_t iMod, algZ::Mod1d rels);
     // void AddPiRelsByNat(size_t iMod);
+    /* The rings are independent and a module only reads its ring, so each stage runs in parallel */
     void SimplifyPiRels()
     {
-        for (auto& ring : rings_)
-            ring.pi_gb.SimplifyRels();
-        for (size_t iCof = 0; iCof < modules_.size(); ++iCof)
-            modules_[iCof].pi_gb.SimplifyRels();
+        ut::for_each_par32_rethrow(rings_.size(), [this](size_t iRing) { rings_[iRing].pi_gb.SimplifyRels(); });
+        ut::for_each_par32_rethrow(modules_.size(), [this](size_t iCof) { modules_[iCof].pi_gb.SimplifyRels(); });
     }
     static algZ::Mon1d GenBasis(const algZ::Groebner& gb, AdamsDeg deg, const PiBasis1d& nodes_pi_basis);
     static algZ::MMod1d GenBasis(const algZ::GroebnerMod& gb, AdamsDeg deg, const PiBasis1d& basis);
@@ -737,6 +1236,20 @@ public: /* homotopy groups */
     // int DefineDependenceInExtensionsV2(int stem_min, int stem_max, int stem_max_mult, int depth);
 };
 
+/* Return the diagram kept in memory by `ss serve` if it is `diagram_name`.
+ * Otherwise load the diagram into `holder`. */
+Diagram& OpenDiagram(const std::string& diagram_name, SSFlag flag, std::unique_ptr<Diagram>& holder);
+
+/* A row of the ss table with base and diff left unparsed */
+struct StaircaseRowRaw
+{
+    AdamsDeg deg;
+    myio::RawColumn base, diff;
+    int level;
+};
+using StaircaseRowRaw1d = std::vector<StaircaseRowRaw>;
+Staircases ParseStaircases(const StaircaseRowRaw1d& rows);
+
 class DBSS : public myio::DbAdamsSS
 {
     using Statement = myio::Statement;
@@ -755,6 +1268,26 @@ public:
         execute_cmd("CREATE TABLE IF NOT EXISTS " + table + " (iC SMALLINT, s SMALLINT, t SMALLINT, base TEXT, diff TEXT, level SMALLINT)");
     }
 
+    void create_degs(const std::string& table) const
+    {
+        execute_cmd("CREATE TABLE IF NOT EXISTS " + table + " (s SMALLINT, t SMALLINT, PRIMARY KEY (s, t))");
+    }
+
+    void create_migrate_ss(const std::string& table_prefix) const
+    {
+        execute_cmd("CREATE TABLE IF NOT EXISTS " + table_prefix + "_migrate_ss (source TEXT)");
+    }
+
+    void create_pi_fingerprint(const std::string& table_prefix) const
+    {
+        execute_cmd("CREATE TABLE IF NOT EXISTS " + table_prefix + "_pi_fingerprint (fingerprint INTEGER)");
+    }
+
+    void create_contradictions(const std::string& table_prefix) const
+    {
+        execute_cmd("CREATE TABLE IF NOT EXISTS " + table_prefix + "_contradictions (s SMALLINT, t SMALLINT, r SMALLINT, tryY TINYINT, x TEXT, dx TEXT, fingerprint INTEGER, PRIMARY KEY (s, t, r, tryY, x, dx))");
+    }
+
     void create_pi_generators_mod(const std::string& table_prefix) const
     {
         execute_cmd("CREATE TABLE IF NOT EXISTS " + table_prefix + "_pi_generators (id INTEGER PRIMARY KEY, name TEXT UNIQUE, Einf TEXT, to_S0 TEXT, s SMALLINT, t SMALLINT)");
@@ -789,8 +1322,42 @@ public:
         create_pi_def(table_prefix);
     }
 
+    /* Also invalidate the fingerprint of the saved pi data */
+    void drop_and_create_pi_relations(const std::string& table_prefix) const
+    {
+        DbAdamsSS::drop_and_create_pi_relations(table_prefix);
+        drop_table(table_prefix + "_pi_fingerprint");
+    }
+
+    /* Whether `column` of `table` has been converted by `migrate_db_format` */
+    bool has_blob(const std::string& table, const std::string& column) const
+    {
+        return get_int("SELECT COUNT(*) FROM (SELECT 1 FROM " + table + " WHERE typeof(" + column + ")='blob' LIMIT 1)");
+    }
+
+    /* Rewrite basis, relations and staircases of `table_prefix` as BLOB or TEXT. Return the number of rows. */
+    int convert_format(const std::string& table_prefix, bool isRing, bool to_text) const;
+    int convert_cofseq_format(const std::string& table, bool to_text) const;
+
 public:
     void update_ss(const std::string& table_prefix, const Staircases& nodes_ss) const;
+    /* Update only the degrees in `degs` */
+    void update_ss(const std::string& table_prefix, const Staircases& nodes_ss, const std::set<AdamsDeg>& degs) const;
+    /* Write the difference between the set of (stem, s) `degs` and the saved set `degs_saved` */
+    void save_degs(const std::string& table, const std::set<std::pair<int, int>>& degs, const std::set<std::pair<int, int>>& degs_saved) const;
+    void save_dirty(const std::string& table_prefix, const std::set<std::pair<int, int>>& dirty, const std::set<std::pair<int, int>>& dirty_saved) const
+    {
+        save_degs(table_prefix + "_dirty", dirty, dirty_saved);
+    }
+    void save_cofseq_unsynced(const std::string& table_prefix, const std::set<std::pair<int, int>>& unsynced, const std::set<std::pair<int, int>>& unsynced_saved) const
+    {
+        save_degs(table_prefix + "_cofseq_unsynced", unsynced, unsynced_saved);
+    }
+    /* Mark the cw as done by an unfinished `migrate_ss` from the diagram `source` */
+    void save_migrate_ss(const std::string& table_prefix, const std::string& source) const;
+    void save_pi_fingerprint(const std::string& table_prefix, uint64_t fingerprint) const;
+    /* Write back the changed keys. Keys no longer in `contras` are deleted. */
+    void save_contradictions(const std::string& table_prefix, const ContraMap& contras, const std::set<ContraKey>& keys_changed) const;
     void save_ss(const std::string& table_prefix, const Staircases& nodes_ss) const;
     void save_cofseq(const std::string& table, const CofSeq& cofseq) const;
     void save_pi_generators_mod(const std::string& table_prefix, const AdamsDeg1d& gen_degs, const Mod1d& gen_Einf) const;
@@ -801,7 +1368,23 @@ public:
 public:
     /* load the minimum id in every degree */
     std::map<AdamsDeg, int> load_basis_indices(const std::string& table_prefix) const;
-    Staircases load_ss(const std::string& table_prefix) const;
+    Staircases load_ss(const std::string& table_prefix, int stem_max = DEG_MAX) const;
+    StaircaseRowRaw1d load_ss_raw(const std::string& table_prefix, int stem_max = DEG_MAX) const;
+    /* Return false if the table does not exist */
+    bool load_degs(const std::string& table, std::set<std::pair<int, int>>& degs) const;
+    bool load_dirty(const std::string& table_prefix, std::set<std::pair<int, int>>& dirty) const
+    {
+        return load_degs(table_prefix + "_dirty", dirty);
+    }
+    bool load_cofseq_unsynced(const std::string& table_prefix, std::set<std::pair<int, int>>& unsynced) const
+    {
+        return load_degs(table_prefix + "_cofseq_unsynced", unsynced);
+    }
+    /* The source of the unfinished `migrate_ss` that has done the cw. Empty if there is none. */
+    std::string load_migrate_ss(const std::string& table_prefix) const;
+    /* Return 0 if the pi data has never been saved with a fingerprint */
+    uint64_t load_pi_fingerprint(const std::string& table_prefix) const;
+    ContraMap load_contradictions(const std::string& table_prefix) const;
     std::array<Staircases, 3> load_cofseq(const std::string& table) const;
     void load_pi_def(const std::string& table_prefix, std::vector<EnumDef>& pi_gen_defs, std::vector<std::vector<GenConstraint>>& pi_gen_def_mons) const;
 };
@@ -814,6 +1397,15 @@ inline std::optional<std::string> SerializeDiff(const int1d& dx)
     result = myio::Serialize(dx);
     return result;
 }
+inline std::optional<std::vector<uint8_t>> SerializeDiffBlob(const int1d& dx)
+{
+    std::optional<std::vector<uint8_t>> result;
+    if (dx == NULL_DIFF)
+        return result;
+    result = myio::SerializeBlob(dx);
+    return result;
+}
+
 std::ostream& operator<<(std::ostream& sout, const int1d& arr);
 
 /* Order by (t, -s) */
@@ -828,6 +1420,15 @@ AdamsDeg1d OrderDegsByStem(const T& cont)
     return result;
 }
 
+/* Call f(d) for d in degs with d.stem()==stem. degs is ordered by stem. */
+template <typename Fn>
+void ForEachDegInStem(const AdamsDeg1d& degs, int stem, Fn&& f)
+{
+    auto p = std::lower_bound(degs.begin(), degs.end(), stem, [](AdamsDeg d, int stem) { return d.stem() < stem; });
+    for (; p != degs.end() && p->stem() == stem; ++p)
+        f(*p);
+}
+
 inline bool BelowS0VanishingLine(AdamsDeg deg)
 {
     return 3 * deg.s <= deg.t + 3;
@@ -865,7 +1466,7 @@ bool IsZeroOnLevel(const Staircase& sc, const int1d& x, int level);
 ---------------------------------------------------------------------------------------------*/
 
 /* Warning: The following IsPoss functions do not check if ss[deg] exists */
-/* Check if deg can be hit by dr for r<=r_max */
+/* Check if deg can be hit by dr for r<=r_max. Sources beyond nodes_ss.stem_max() are unknown and thus always possible. */
 bool IsPossTgt(const Staircases1d& nodes_ss, AdamsDeg deg, int r_max);
 inline bool IsPossTgt(const Staircases1d& nodes_ss, AdamsDeg deg)
 {
@@ -916,7 +1517,7 @@ inline int1d Residue(int1d x, const Staircases1d& nodes_ss, AdamsDeg deg, int le
 {
     if (x.empty())
         return x;
-    ResidueInplace(x, ut::GetRecentValue(nodes_ss, deg), level);
+    ResidueInplace(x, nodes_ss.GetRecentValue(deg), level);
     return x;
 }
 
@@ -3,105 +3,155 @@
 #include "mylog.h"
 #include <fstream>
 
+/* A differential of diagram1 to be added to diagram2. x is empty if dx is a boundary. */
+struct MigrateEntry
+{
+    AdamsDeg deg_x;
+    int1d x, dx;
+    int r;
+};
+using MigrateEntry1d = std::vector<MigrateEntry>;
+
+/* The differentials of nodes_ss1 in the degrees t <= t_max2, stem <= stem_max2 in the order they are added */
+MigrateEntry1d CollectMigration(const Staircases1d& nodes_ss1, int t_max2, int stem_max2)
+{
+    MigrateEntry1d result;
+    for (auto& [deg, _] : nodes_ss1.front()) {
+        if (deg.t > t_max2)
+            break;
+        if (deg.stem() > stem_max2)
+            continue;
+        const auto& sc1 = nodes_ss1.GetRecentValue(deg);
+        for (size_t i = 0; i < sc1.levels.size(); ++i) {
+            if (sc1.levels[i] > LEVEL_MAX / 2) {
+                int r = LEVEL_MAX - sc1.levels[i];
+                if (deg.t + r - 1 > t_max2 || sc1.diffs[i] == NULL_DIFF)
+                    result.push_back({deg, sc1.basis[i], int1d{}, r - 1});
+                else
+                    result.push_back({deg, sc1.basis[i], sc1.diffs[i], r});
+            }
+            else if (sc1.levels[i] < LEVEL_MAX / 2 && sc1.diffs[i] == NULL_DIFF) {
+                int r = sc1.levels[i] + 1;
+                result.push_back({deg - AdamsDeg(r, r - 1), int1d{}, sc1.basis[i], r});
+            }
+        }
+    }
+    return result;
+}
+
+/* Add the new differentials among `entries` to iCw2 of diagram2 */
+int ApplyMigration(Diagram& diagram2, IndexCw iCw2, const std::string& name, const MigrateEntry1d& entries, SSFlag flag)
+{
+    int count = 0;
+    const auto& nodes_ss2 = diagram2.GetSS(iCw2);
+    for (auto& [deg_x, x, dx, r] : entries) {
+        if (diagram2.IsNewDiff(nodes_ss2, deg_x, x, dx, r)) {
+            if (x.empty())
+                Logger::LogDiffInv(0, EnumReason::migrate, name, deg_x, deg_x + AdamsDeg(r, r - 1), {}, dx, r);
+            else
+                Logger::LogDiff(0, EnumReason::migrate, name, deg_x, x, dx, r);
+            count += diagram2.SetCwDiffGlobal(iCw2, deg_x, x, dx, r, true, flag);
+        }
+    }
+    return count;
+}
+
+/* The cw of diagram2 with the name of iCw1 in diagram1 */
+IndexCw GetMigrateTarget(const Diagram& diagram1, const Diagram& diagram2, size_t iCw1)
+{
+    const size_t size_rings1 = diagram1.GetRings().size();
+    auto& name = iCw1 < size_rings1 ? diagram1.GetRings()[iCw1].name : diagram1.GetModules()[iCw1 - size_rings1].name;
+    auto indCw2 = diagram2.GetIndexCwByName(name);
+    if (iCw1 < size_rings1)
+        MyException::Assert(indCw2.isRing, fmt::format("indCw2({}).isRing", name));
+    else
+        MyException::Assert(!indCw2.isRing, fmt::format("!indCw2({}).isRing", name));
+    return indCw2;
+}
+
 /* Add the differentials from diagram1 to diagram2 */
 void Migrate_ss(const Diagram& diagram1, Diagram& diagram2)
 {
     auto flag = SSFlag::no_op;
     int count = 0;
-    int1d diff;
     const size_t num_cw = diagram1.GetRings().size() + diagram1.GetModules().size();
     for (size_t iCw = 0; iCw < num_cw; ++iCw) {
-        if (iCw < diagram1.GetRings().size()) {
-            auto& name = diagram1.GetRings()[iCw].name;
-            auto indCw2 = diagram2.GetIndexCwByName(name);
-            MyException::Assert(indCw2.isRing, fmt::format("indCw2({}).isRing", name));
-            auto iRing2 = indCw2.index;
-
-            auto& nodes_ss1 = diagram1.GetRings()[iCw].nodes_ss;
-            auto& nodes_ss2 = diagram2.GetRings()[iRing2].nodes_ss;
-
-            int t_max2 = nodes_ss2.front().rbegin()->first.t;
-            for (auto& [deg, _] : nodes_ss1.front()) {
-                if (deg.t > t_max2)
-                    break;
-                const auto& sc1 = ut::GetRecentValue(nodes_ss1, deg);
-                for (size_t i = 0; i < sc1.levels.size(); ++i) {
-                    if (sc1.levels[i] > LEVEL_MAX / 2) {
-                        int r = LEVEL_MAX - sc1.levels[i];
-                        if (deg.t + r - 1 > t_max2 && sc1.diffs[i] != NULL_DIFF)
-                            diff = NULL_DIFF;
-                        else
-                            diff = sc1.diffs[i];
-                        if (diff != NULL_DIFF) {
-                            if (diagram2.IsNewDiff(nodes_ss2, deg, sc1.basis[i], diff, r)) {
-                                Logger::LogDiff(0, EnumReason::migrate, name, deg, sc1.basis[i], diff, r);
-                                count += diagram2.SetRingDiffGlobal(iRing2, deg, sc1.basis[i], diff, r, true, flag);
-                            }
-                        }
-                        else {
-                            if (diagram2.IsNewDiff(nodes_ss2, deg, sc1.basis[i], int1d{}, r - 1)) {
-                                Logger::LogDiff(0, EnumReason::migrate, name, deg, sc1.basis[i], int1d{}, r - 1);
-                                count += diagram2.SetRingDiffGlobal(iRing2, deg, sc1.basis[i], int1d{}, r - 1, true, flag);
-                            }
-                        }
-                    }
-                    else if (sc1.levels[i] < LEVEL_MAX / 2 && sc1.diffs[i] == NULL_DIFF) {
-                        int r = sc1.levels[i] + 1;
-                        const AdamsDeg deg_src = deg - AdamsDeg(r, r - 1);
-                        if (diagram2.IsNewDiff(nodes_ss2, deg_src, {}, sc1.basis[i], r)) {
-                            Logger::LogDiffInv(0, EnumReason::migrate, name, deg_src, deg, {}, sc1.basis[i], r);
-                            count += diagram2.SetRingDiffGlobal(iRing2, deg_src, {}, sc1.basis[i], r, true, flag);
-                        }
-                    }
-                }
-            }
+        IndexCw iCw1 = iCw < diagram1.GetRings().size() ? IndexRing(iCw) : IndexMod(iCw - diagram1.GetRings().size());
+        IndexCw iCw2 = GetMigrateTarget(diagram1, diagram2, iCw);
+        int t_max2 = diagram2.GetSS(iCw2).front().rbegin()->first.t;
+        count += ApplyMigration(diagram2, iCw2, diagram1.GetCwName(iCw1), CollectMigration(diagram1.GetSS(iCw1), t_max2, diagram2.GetStemMax(iCw2)), flag);
+    }
+    Logger::LogSummary("Changed differentials", count);
+}
+
+/* Migrate_ss in rounds with diagram2 saved after each round.
+ * The differentials of all cws of diagram1 are collected first.
+ * Round k adds them to the k-th cw of every component of diagram2 in parallel.
+ * The cws done are marked in their databases so that an interrupted migration from the same diagram resumes after the last round. */
+void Migrate_ss_bulk(const std::string& diagram_name1, const Diagram& diagram1, const std::string& diagram_name2, Diagram& diagram2)
+{
+    auto flag = SSFlag::no_op;
+    const size_t size_rings1 = diagram1.GetRings().size(), size_rings2 = diagram2.GetRings().size();
+    const size_t num_cw1 = size_rings1 + diagram1.GetModules().size();
+    auto index2 = [size_rings2](IndexCw iCw) { return iCw.isRing ? iCw.index : size_rings2 + iCw.index; };
+    myio::string1d names2, paths2;
+    int1d isRing2;
+    GetAllDbNames(diagram_name2, names2, paths2, isRing2, false);
+
+    std::vector<IndexCw> indCw2(names2.size());
+    std::vector<std::optional<MigrateEntry1d>> entries(names2.size()); /* Indexed by the cws of diagram2 */
+    for (size_t iCw1 = 0; iCw1 < num_cw1; ++iCw1) {
+        IndexCw iCw2 = GetMigrateTarget(diagram1, diagram2, iCw1);
+        indCw2[index2(iCw2)] = iCw2;
+        entries[index2(iCw2)].emplace();
+    }
+    ut::for_each_par32_rethrow(num_cw1, [&](size_t iCw1) {
+        IndexCw iCw2 = GetMigrateTarget(diagram1, diagram2, iCw1);
+        IndexCw indCw1 = iCw1 < size_rings1 ? IndexRing(iCw1) : IndexMod(iCw1 - size_rings1);
+        int t_max2 = diagram2.GetSS(iCw2).front().rbegin()->first.t;
+        *entries[index2(iCw2)] = CollectMigration(diagram1.GetSS(indCw1), t_max2, diagram2.GetStemMax(iCw2));
+    });
+
+    /* The cws left in each component */
+    std::vector<size_t1d> todo;
+    for (auto& component : diagram2.GetCwComponents()) {
+        size_t1d cws;
+        for (size_t iCw2 : component) {
+            if (!entries[iCw2])
+                continue;
+            if (DBSS(paths2[iCw2]).load_migrate_ss(names2[iCw2]) == diagram_name1)
+                fmt::print("Skip {} which is already migrated\n", names2[iCw2]);
+            else
+                cws.push_back(iCw2);
         }
-        else {
-            size_t iMod = iCw - diagram1.GetRings().size();
-            const auto& name = diagram1.GetModules()[iMod].name;
-            auto indCw2 = diagram2.GetIndexCwByName(name);
-            MyException::Assert(!indCw2.isRing, fmt::format("!indCw2({}).isRing", name));
-            size_t iMod2 = indCw2.index;
-
-            const auto& nodes_ss1 = diagram1.GetModules()[iMod].nodes_ss;
-            const auto& nodes_ss2 = diagram2.GetModules()[iMod2].nodes_ss;
-            int t_max2 = nodes_ss2.front().rbegin()->first.t;
-            for (auto& [deg, _] : nodes_ss1.front()) {
-                if (deg.t > t_max2)
-                    break;
-                const auto& sc1 = ut::GetRecentValue(nodes_ss1, deg);
-                for (size_t i = 0; i < sc1.levels.size(); ++i) {
-                    if (sc1.levels[i] > LEVEL_MAX / 2) {
-                        int r = LEVEL_MAX - sc1.levels[i];
-                        if (deg.t + r - 1 > t_max2 && sc1.diffs[i] != NULL_DIFF)
-                            diff = NULL_DIFF;
-                        else
-                            diff = sc1.diffs[i];
-                        if (diff != NULL_DIFF) {
-                            if (diagram2.IsNewDiff(nodes_ss2, deg, sc1.basis[i], diff, r)) {
-                                Logger::LogDiff(0, EnumReason::migrate, name, deg, sc1.basis[i], diff, r);
-                                count += diagram2.SetModuleDiffGlobal(iMod2, deg, sc1.basis[i], diff, r, true, flag);
-                            }
-                        }
-                        else {
-                            if (diagram2.IsNewDiff(nodes_ss2, deg, sc1.basis[i], int1d{}, r - 1)) {
-                                Logger::LogDiff(0, EnumReason::migrate, name, deg, sc1.basis[i], int1d{}, r - 1);
-                                count += diagram2.SetModuleDiffGlobal(iMod2, deg, sc1.basis[i], int1d{}, r - 1, true, flag);
-                            }
-                        }
-                    }
-                    else if (sc1.levels[i] < LEVEL_MAX / 2 && sc1.diffs[i] == NULL_DIFF) {
-                        int r = sc1.levels[i] + 1;
-                        const AdamsDeg deg_src = deg - AdamsDeg(r, r - 1);
-                        if (diagram2.IsNewDiff(nodes_ss2, deg_src, {}, sc1.basis[i], r)) {
-                            Logger::LogDiffInv(0, EnumReason::migrate, name, deg_src, deg, {}, sc1.basis[i], r);
-                            count += diagram2.SetModuleDiffGlobal(iMod2, deg_src, {}, sc1.basis[i], r, true, flag);
-                        }
-                    }
-                }
+        if (!cws.empty())
+            todo.push_back(std::move(cws));
+    }
+
+    int count = 0;
+    for (size_t round = 0;; ++round) {
+        std::vector<size_t1d> jobs;
+        size_t1d cws_round;
+        for (auto& cws : todo) {
+            if (round < cws.size()) {
+                jobs.push_back(cws);
+                cws_round.push_back(cws[round]);
             }
         }
+        if (cws_round.empty())
+            break;
+        count += diagram2.RunCwJobsPar(jobs, flag, [&](Diagram& diagram, size_t i) {
+            size_t iCw2 = cws_round[i];
+            return ApplyMigration(diagram, indCw2[iCw2], names2[iCw2], *entries[iCw2], flag);
+        });
+        diagram2.save(diagram_name2, flag);
+        for (size_t iCw2 : cws_round)
+            DBSS(paths2[iCw2]).save_migrate_ss(names2[iCw2], diagram_name1);
     }
+
+    for (size_t iCw2 = 0; iCw2 < entries.size(); ++iCw2)
+        if (entries[iCw2])
+            DBSS(paths2[iCw2]).drop_table(names2[iCw2] + "_migrate_ss");
     Logger::LogSummary("Changed differentials", count);
 }
 
@@ -249,10 +299,13 @@ void ImportChuaD2(Diagram& diagram)
         }
     }
 
+    std::vector<ImportDiff> diffs;
     for (auto& [deg, x_d] : x) {
         for (size_t i = 0; i < x_d.size(); ++i)
-            diagram.SetRingDiffGlobal(0, deg, x_d[i], dx[deg][i], 2, false, SSFlag::no_op);
+            diffs.push_back({diagram.GetCwName(IndexRing(0)), deg, x_d[i], dx[deg][i], 2, (int)diffs.size()});
     }
+    int count = diagram.ImportDiffs(std::move(diffs), EnumReason::d2, SSFlag::no_op);
+    Logger::LogSummary("Changed differentials", count);
 }
 
 int main_import_chua_d2(int argc, char** argv, int& index, const char* desc)
@@ -287,18 +340,32 @@ int main_import_chua_d2(int argc, char** argv, int& index, const char* desc)
 int main_migrate_ss(int argc, char** argv, int& index, const char* desc)
 {
     std::string diagram_name1, diagram_name2;
+    std::string mode = "serial";
 
     myio::CmdArg1d args = {{"diagram1", &diagram_name1}, {"diagram2", &diagram_name2}};
-    myio::CmdArg1d op_args = {};
-    if (int error = myio::ParseArguments(argc, argv, index, PROGRAM, desc, VERSION, args, op_args))
+    myio::CmdArg1d op_args = {{"mode:serial/bulk", &mode}};
+    std::string help = fmt::format(
+        "{}\n"
+        "mode=bulk migrates the components of diagram2 in parallel rounds and saves diagram2 after each round.\n"
+        "A round in which a component fails is discarded as a whole and an interrupted migration resumes after the last saved round.\n"
+        "The propagation is not deferred: each differential is propagated by the Leibniz rule and the maps when it is added.",
+        desc);
+    if (int error = myio::ParseArguments(argc, argv, index, PROGRAM, help.c_str(), VERSION, args, op_args))
         return error;
+    if (mode != "serial" && mode != "bulk") {
+        fmt::print("Invalid mode={}. It should be serial or bulk.\n", mode);
+        return -1;
+    }
 
     auto flag_no_op = SSFlag::no_op;
     Diagram diagram1(diagram_name1, flag_no_op, false);
     Diagram diagram2(diagram_name2, flag_no_op);
 
     try {
-        Migrate_ss(diagram1, diagram2);
+        if (mode == "bulk")
+            Migrate_ss_bulk(diagram_name1, diagram1, diagram_name2, diagram2);
+        else
+            Migrate_ss(diagram1, diagram2);
         diagram2.save(diagram_name2, flag_no_op);
     }
     /*catch (SSException& e) {
@@ -399,6 +466,7 @@ int main_truncate(int argc, char** argv, int index, const char* desc)
 
         db.begin_transaction();
         db.update_ss(names[k], nodes_ss);
+        db.drop_table(names[k] + "_contradictions"); /* Some of them may rely on the removed differentials */
         db.end_transaction();
     }
 
@@ -6,13 +6,56 @@ std::ofstream Logger::fout_main_;
 std::string Logger::cmd_;
 std::string Logger::line_;
 DbLog Logger::db_deduce_;
-int Logger::id_checkpoint_;
+LogRow1d Logger::rows_;
+size_t Logger::checkpoint_ = SIZE_MAX;
+thread_local LogRow1d* Logger::buffer_ = nullptr;
+thread_local size_t Logger::buffer_checkpoint_ = 0;
+thread_local std::string* Logger::out_buffer_ = nullptr;
 
 std::string_view GetReason(EnumReason reason)
 {
     return REASONS[size_t(reason)];
 }
 
+std::vector<uint8_t> EncodeIndices(const alg::int1d& x)
+{
+    std::vector<uint8_t> result;
+    for (int i : x) {
+        auto v = uint32_t(i + 1);
+        while (v >= 0x80) {
+            result.push_back(uint8_t(v | 0x80));
+            v >>= 7;
+        }
+        result.push_back(uint8_t(v));
+    }
+    return result;
+}
+
+alg::int1d DecodeIndices(const uint8_t* data, size_t size)
+{
+    alg::int1d result;
+    uint32_t v = 0;
+    int shift = 0;
+    for (size_t k = 0; k < size; ++k) {
+        v |= uint32_t(data[k] & 0x7f) << shift;
+        if (data[k] & 0x80)
+            shift += 7;
+        else {
+            result.push_back(int(v) - 1);
+            v = 0;
+            shift = 0;
+        }
+    }
+    return result;
+}
+
+alg::int1d ColumnIndices(const myio::Statement& stmt, int iCol)
+{
+    if (stmt.column_type(iCol) == MYSQLITE_BLOB)
+        return DecodeIndices((const uint8_t*)stmt.column_blob(iCol), (size_t)stmt.column_blob_size(iCol));
+    return myio::Deserialize<alg::int1d>(stmt.column_str(iCol));
+}
+
 /* -1: start time
  * -2: end time
  * -3:
@@ -23,32 +66,45 @@ void DbLog::InsertTag(int depth, const std::string& tag)
     stmt.bind_and_step(depth, std::string(tag));
 }
 
-void DbLog::InsertError(int depth, const std::string& name, alg::AdamsDeg deg_dx, const alg::int1d& dx, int r, const std::string& tag)
-{
-    Statement stmt(*this, "INSERT INTO log (depth, reason, name, s, t, r, dx, tag) VALUES (?1, \"Error\", ?2, ?3, ?4, ?5, ?6, ?7)");
-    stmt.bind_and_step(depth, name, deg_dx.s, deg_dx.t, r, myio::Serialize(dx), tag);
-}
-
-void DbLog::InsertError(int depth, const std::string& tag)
+void DbLog::InsertRows(LogRow1d::const_iterator first, LogRow1d::const_iterator last)
 {
-    Statement stmt(*this, "INSERT INTO log (depth, reason, tag) VALUES (?1, \"Error\", ?2)");
-    stmt.bind_and_step(depth, tag);
+    Statement stmt(*this, "INSERT INTO log (depth, reason, name, s, t, r, x, dx, tag) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9)");
+    for (auto p = first; p != last; ++p)
+        stmt.bind_and_step(p->depth, p->reason, p->name, p->s, p->t, p->r, p->x, p->dx, p->tag);
 }
 
-void DbLog::InsertDiff(int depth, EnumReason reason, const std::string& name, alg::AdamsDeg deg_x, const alg::int1d& x, const alg::int1d& dx, int r)
+int DbLog::ConvertIndices(bool to_text)
 {
-    Statement stmt(*this, "INSERT INTO log (depth, reason, name, s, t, r, x, dx) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8)");
-    stmt.bind_and_step(depth, std::string(GetReason(reason)), name, deg_x.s, deg_x.t, r, myio::Serialize(x), myio::Serialize(dx));
-}
-
-void DbLog::InsertNullDiff(int depth, const std::string& name, alg::AdamsDeg deg_x, const alg::int1d& x, int r)
-{
-    Statement stmt(*this, "INSERT INTO log (depth, name, s, t, r, x) VALUES (?1, ?2, ?3, ?4, ?5, ?6)");
-    stmt.bind_and_step(depth, name, deg_x.s, deg_x.t, r, myio::Serialize(x));
+    std::vector<int64_t> ids;
+    std::vector<std::optional<alg::int1d>> xs, dxs;
+    {
+        Statement stmt(*this, fmt::format("SELECT id, x, dx FROM log WHERE typeof(x)=\"{0}\" OR typeof(dx)=\"{0}\"", to_text ? "blob" : "text"));
+        while (stmt.step() == MYSQLITE_ROW) {
+            ids.push_back(stmt.column_int64(0));
+            xs.push_back(stmt.column_type(1) == MYSQLITE_BLOB || stmt.column_type(1) == MYSQLITE3_TEXT ? std::optional(ColumnIndices(stmt, 1)) : std::nullopt);
+            dxs.push_back(stmt.column_type(2) == MYSQLITE_BLOB || stmt.column_type(2) == MYSQLITE3_TEXT ? std::optional(ColumnIndices(stmt, 2)) : std::nullopt);
+        }
+    }
+    Statement stmt(*this, "UPDATE log SET x=?1, dx=?2 WHERE id=?3");
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (to_text) {
+            auto x = xs[i] ? std::optional(myio::Serialize(*xs[i])) : std::nullopt;
+            auto dx = dxs[i] ? std::optional(myio::Serialize(*dxs[i])) : std::nullopt;
+            stmt.bind_and_step(x, dx, ids[i]);
+        }
+        else {
+            auto x = xs[i] ? std::optional(EncodeIndices(*xs[i])) : std::nullopt;
+            auto dx = dxs[i] ? std::optional(EncodeIndices(*dxs[i])) : std::nullopt;
+            stmt.bind_and_step(x, dx, ids[i]);
+        }
+    }
+    return (int)ids.size();
 }
 
 void Logger::DeleteFromLog()
 {
+    rows_.clear();
+    checkpoint_ = SIZE_MAX;
     db_deduce_.execute_cmd("DELETE FROM log");
     db_deduce_.end_transaction();
     db_deduce_.execute_cmd("VACUUM");
@@ -101,22 +157,78 @@ void Logger::LogTime(const std::string& time)
 {
     fmt::print(fmt::fg(fmt::color::green), "{}\n", time);
     fmt::print(fout_main_, "{}\n", time);
-    db_deduce_.InsertTag(-2, time);
+    AddRow(LogRow{-2, {}, {}, {}, {}, {}, {}, {}, time});
+    Flush();
+}
+
+void Logger::AddRow(LogRow row)
+{
+    if (buffer_)
+        buffer_->push_back(std::move(row));
+    else {
+        rows_.push_back(std::move(row));
+        FlushCommitted();
+    }
+}
+
+void Logger::FlushCommitted()
+{
+    size_t n = std::min(checkpoint_, rows_.size());
+    if (n >= LOG_BATCH_SIZE && db_deduce_.is_open()) {
+        db_deduce_.InsertRows(rows_.begin(), rows_.begin() + n);
+        rows_.erase(rows_.begin(), rows_.begin() + n);
+        if (checkpoint_ != SIZE_MAX)
+            checkpoint_ -= n;
+    }
+}
+
+void Logger::Flush()
+{
+    if (!rows_.empty() && db_deduce_.is_open()) {
+        db_deduce_.InsertRows(rows_.begin(), rows_.end());
+        rows_.clear();
+        checkpoint_ = SIZE_MAX;
+    }
 }
 
+/* The rollback only happens in memory. Rows before the last checkpoint are never rolled back. */
 void Logger::Checkpoint()
 {
-    id_checkpoint_ = db_deduce_.get_int("SELECT max(id) FROM log");
+    if (buffer_)
+        buffer_checkpoint_ = buffer_->size();
+    else {
+        checkpoint_ = rows_.size();
+        FlushCommitted();
+    }
 }
 
-void Logger::RollBackToCheckpoint() {
-    db_deduce_.execute_cmd(fmt::format("DELETE FROM log WHERE id>{}", id_checkpoint_));
+void Logger::RollBackToCheckpoint()
+{
+    if (buffer_)
+        buffer_->resize(buffer_checkpoint_);
+    else if (checkpoint_ < rows_.size())
+        rows_.resize(checkpoint_);
+}
+
+void Logger::SetBuffer(LogRow1d* buffer, std::string* out)
+{
+    buffer_ = buffer;
+    buffer_checkpoint_ = 0;
+    out_buffer_ = out;
+}
+
+void Logger::FlushBuffer(const LogRow1d& rows, const std::string& out)
+{
+    if (!out.empty())
+        fmt::print("{}", out);
+    rows_.insert(rows_.end(), rows.begin(), rows.end());
+    FlushCommitted();
 }
 
 void Logger::LogSSException(int depth, const std::string& name, alg::AdamsDeg deg_dx, const alg::int1d& dx, int r, unsigned code, alg::AdamsDeg deg_leibniz, const alg::int1d* a_leibniz)
 {
     if (depth == 0)
-        fmt::print("Error({:#x}) No source for the image. {} deg_dx={}, dx={}, r={}\n", code, name, deg_dx, dx, r);
+        Print({}, "Error({:#x}) No source for the image. {} deg_dx={}, dx={}, r={}\n", code, name, deg_dx, dx, r);
     std::string tag;
     if (a_leibniz) {
         tag = fmt::format("{:#x} {} {}", code, deg_leibniz, *a_leibniz);
@@ -124,45 +236,45 @@ void Logger::LogSSException(int depth, const std::string& name, alg::AdamsDeg de
     }
     else
         tag = fmt::format("{:#x}", code);
-    db_deduce_.InsertError(depth, name, deg_dx, dx, r, tag);
+    AddRow(LogRow{depth, "Error", name, deg_dx.s, deg_dx.t, r, {}, EncodeIndices(dx), tag});
 }
 
 void Logger::LogSSSSException(int depth, unsigned code)
 {
     std::string tag = fmt::format("{:#x}", code);
-    db_deduce_.InsertError(depth, tag);
+    AddRow(LogRow{depth, "Error", {}, {}, {}, {}, {}, {}, tag});
 }
 
 void Logger::LogDiff(int depth, EnumReason reason, const std::string& name, alg::AdamsDeg deg_x, const alg::int1d& x, const alg::int1d& dx, int r)
 {
     std::string_view indent(INDENT, depth * 2);
     if (depth == 0)
-        fmt::print(fmt::fg(dx.empty() ? fmt::color::white_smoke : fmt::color::light_green), "{}{} - {} {} d_{}{}={}\n", indent, GetReason(reason), name, deg_x, r, x, dx);
-    db_deduce_.InsertDiff(depth, reason, name, deg_x, x, dx, r);
+        Print(fmt::fg(dx.empty() ? fmt::color::white_smoke : fmt::color::light_green), "{}{} - {} {} d_{}{}={}\n", indent, GetReason(reason), name, deg_x, r, x, dx);
+    AddRow(LogRow{depth, std::string(GetReason(reason)), name, deg_x.s, deg_x.t, r, EncodeIndices(x), EncodeIndices(dx), {}});
 }
 
 void Logger::LogDiff(int depth, const std::string& name, alg::AdamsDeg deg_x, const alg::int1d& x, const alg::int1d& dx, int r)
 {
     std::string_view indent(INDENT, depth * 2);
     if (depth == 0)
-        fmt::print(fmt::fg(fmt::color::gray), "{}{} {} d_{}{}={}\n", indent, name, deg_x, r, x, dx);
-    db_deduce_.InsertNullDiff(depth, name, deg_x, x, r);
+        Print(fmt::fg(fmt::color::gray), "{}{} {} d_{}{}={}\n", indent, name, deg_x, r, x, dx);
+    AddRow(LogRow{depth, {}, name, deg_x.s, deg_x.t, r, EncodeIndices(x), {}, {}});
 }
 
 void Logger::LogNullDiff(int depth, const std::string& name, alg::AdamsDeg deg_x, const alg::int1d& x, int r)
 {
     std::string_view indent(INDENT, depth * 2);
     if (depth == 0)
-        fmt::print(fmt::fg(fmt::color::gray), "{}{} {} d_{}{}=?\n", indent, name, deg_x, r, x);
-    db_deduce_.InsertNullDiff(depth, name, deg_x, x, r);
+        Print(fmt::fg(fmt::color::gray), "{}{} {} d_{}{}=?\n", indent, name, deg_x, r, x);
+    AddRow(LogRow{depth, {}, name, deg_x.s, deg_x.t, r, EncodeIndices(x), {}, {}});
 }
 
 void Logger::LogDiffInv(int depth, EnumReason reason, const std::string& name, alg::AdamsDeg deg_x, alg::AdamsDeg deg_dx, const alg::int1d& x, const alg::int1d& dx, int r)
 {
     std::string_view indent(INDENT, depth * 2);
     if (depth == 0)
-        fmt::print(fmt::fg(x.empty() ? fmt::color::white_smoke : fmt::color::light_green), "{}{} - {} {} {}=d_{}{}\n", indent, GetReason(reason), name, deg_dx, dx, r, x);
-    db_deduce_.InsertDiff(depth, reason, name, deg_x, x, dx, r);
+        Print(fmt::fg(x.empty() ? fmt::color::white_smoke : fmt::color::light_green), "{}{} - {} {} {}=d_{}{}\n", indent, GetReason(reason), name, deg_dx, dx, r, x);
+    AddRow(LogRow{depth, std::string(GetReason(reason)), name, deg_x.s, deg_x.t, r, EncodeIndices(x), EncodeIndices(dx), {}});
 }
 
 //void Logger::LogDiffBoun(int depth, EnumReason reason, const std::string& name, alg::AdamsDeg deg_dx, const alg::int1d& dx)
@@ -4,6 +4,7 @@
 #include <fmt/color.h>
 #include <fmt/core.h>
 #include <fmt/ostream.h>
+#include <optional>
 
 enum class EnumReason : uint32_t
 {
@@ -29,6 +30,24 @@ enum class EnumReason : uint32_t
 };
 constexpr std::array REASONS = {"manual", "degree", "deduce", "dd_cof", "dd_cof_p", "nat", "synnat", "synext", "synext_p", "deduce_xx", "deduce_xy", "deduce_fx", "comm", "def", "cofseq_b", "try1", "try2", "migrate", "d2"};
 inline const char* INDENT = "          ";
+constexpr size_t LOG_BATCH_SIZE = 4096; /* Number of committed rows written to the log database at once */
+
+/* Compact BLOB encoding of x and dx in the log table: LEB128 varints of i+1 so that NULL_DIFF is a single byte 0 */
+std::vector<uint8_t> EncodeIndices(const alg::int1d& x);
+alg::int1d DecodeIndices(const uint8_t* data, size_t size);
+/* Read x or dx of the log table stored either as a compact BLOB or as TEXT */
+alg::int1d ColumnIndices(const myio::Statement& stmt, int iCol);
+
+/* A row of the log table kept in memory. Null columns are left empty. */
+struct LogRow
+{
+    int depth;
+    std::optional<std::string> reason, name;
+    std::optional<int> s, t, r;
+    std::optional<std::vector<uint8_t>> x, dx;
+    std::optional<std::string> tag;
+};
+using LogRow1d = std::vector<LogRow>;
 
 class DbLog : public myio::Database
 {
@@ -41,14 +60,13 @@ public:
 
     void create_log() const
     {
-        execute_cmd("CREATE TABLE IF NOT EXISTS log (id INTEGER PRIMARY KEY, depth TINYINT, reason TEXT, name TEXT, stem SMALLINT as (t-s), s SMALLINT, t SMALLINT, r SMALLINT, x TEXT, dx TEXT, tag TEXT);");
+        execute_cmd("CREATE TABLE IF NOT EXISTS log (id INTEGER PRIMARY KEY, depth TINYINT, reason TEXT, name TEXT, stem SMALLINT as (t-s), s SMALLINT, t SMALLINT, r SMALLINT, x BLOB, dx BLOB, tag TEXT);");
     }
 
     void InsertTag(int depth, const std::string& tag);
-    void InsertError(int depth, const std::string& name, alg::AdamsDeg deg_dx, const alg::int1d& dx, int r, const std::string& tag);
-    void InsertError(int depth, const std::string& tag);
-    void InsertDiff(int depth, EnumReason reason, const std::string& name, alg::AdamsDeg deg_x, const alg::int1d& x, const alg::int1d& dx, int r);
-    void InsertNullDiff(int depth, const std::string& name, alg::AdamsDeg deg_x, const alg::int1d& x, int r);
+    void InsertRows(LogRow1d::const_iterator first, LogRow1d::const_iterator last);
+    /* Convert the columns x, dx between the compact BLOB format and the readable TEXT format. Return the number of rows converted. */
+    int ConvertIndices(bool to_text);
 };
 
 /* There should be at least one global instance to close the files */
@@ -59,10 +77,28 @@ private:
     static std::string cmd_;
     static std::string line_;
     static DbLog db_deduce_;
-    static int id_checkpoint_;
+    /* Rows not written to the database yet. Rows before checkpoint_ can no longer be rolled back. */
+    static LogRow1d rows_;
+    static size_t checkpoint_;
+    /* When set, the rows of the current thread are appended to the buffer instead of rows_ */
+    static thread_local LogRow1d* buffer_;
+    static thread_local size_t buffer_checkpoint_;
+    static thread_local std::string* out_buffer_; /* Console output of the current thread when the rows are buffered */
 
 private:
     static std::string GetCmd(int argc, char** argv);
+    static void AddRow(LogRow row);
+    /* Write the rows that can no longer be rolled back once there are enough of them */
+    static void FlushCommitted();
+    template <typename... T>
+    static void Print(const fmt::text_style& ts, fmt::format_string<T...> fmt, T&&... args)
+    {
+        std::string line = fmt::vformat(ts, fmt.get(), fmt::make_format_args(args...));
+        if (out_buffer_)
+            out_buffer_->append(line);
+        else
+            std::fputs(line.c_str(), stdout);
+    }
 
 public:
     Logger() {}
@@ -77,6 +113,17 @@ public:
 
     static void Checkpoint();
     static void RollBackToCheckpoint();
+    /* Write all pending rows to the database */
+    static void Flush();
+
+    /* Redirect the rows logged by the current thread to `buffer` and its console output to `out`. Pass nullptr to restore. */
+    static void SetBuffer(LogRow1d* buffer, std::string* out = nullptr);
+    static bool IsBuffered()
+    {
+        return buffer_ != nullptr;
+    }
+    /* Append the buffered rows of a worker to the log in order */
+    static void FlushBuffer(const LogRow1d& rows, const std::string& out = {});
 
     static void LogDiff(int depth, EnumReason reason, const std::string& name, alg::AdamsDeg deg_x, const alg::int1d& x, const alg::int1d& dx, int r);
     static void LogDiff(int depth, const std::string& name, alg::AdamsDeg deg_x, const alg::int1d& x, const alg::int1d& dx, int r);
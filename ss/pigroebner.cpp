@@ -2,10 +2,17 @@
 #include "algebras/benchmark.h"  ////
 #include "algebras/myio.h"
 #include "algebras/utility.h"
+#include <atomic>
 #include <set>
 
 namespace algZ {
 
+uint64_t ChangeStamps::Next()
+{
+    static std::atomic<uint64_t> counter{0};
+    return ++counter;
+}
+
 namespace detail {
     /*
      * Return if `mon1` and `mon2` have a nontrivial common factor.
@@ -252,13 +259,13 @@ void ExtendO(const ut::map_seq2d<int, 0>& possEinf, int t_max, int stem, Mod& re
     TplExtendO(possEinf, t_max, stem, rel);
 }
 
-Groebner::Groebner(int deg_trunc, AdamsDeg1d gen_degs, Poly1d polys) : criticals_(deg_trunc), gen_degs_(std::move(gen_degs)), nodes_gen_2tor_degs_({})
+Groebner::Groebner(int deg_trunc, AdamsDeg1d gen_degs, Poly1d polys) : criticals_(deg_trunc), gen_degs_(std::move(gen_degs))
 {
     for (AdamsDeg deg : gen_degs_) {
         if (deg == AdamsDeg(1, 1))
-            nodes_gen_2tor_degs_.back().push_back(FIL_MAX + 1);
+            gen_2tor_degs_.push_back(FIL_MAX + 1);
         else
-            nodes_gen_2tor_degs_.back().push_back((deg.stem() + 5) / 2); ////TODO: fix
+            gen_2tor_degs_.push_back((deg.stem() + 5) / 2); ////TODO: fix
     }
     for (auto& p : polys) {
         AdamsDeg deg = GetDeg(p.GetLead(), gen_degs_);
@@ -276,42 +283,51 @@ void Groebner::AddNode()
 {
     nodes_gen_size_.push_back(gen_degs().size());
     nodes_data_size_.push_back(data().size());
-    nodes_gen_2tor_degs_.push_back(gen_2tor_degs());
+    nodes_journal_2tor_size_.push_back(journal_2tor_.size());
 }
 
 void Groebner::PopNode()
 {
-    gen_degs_.resize(nodes_gen_size_.back());
-
+    /* Only the groups of the data added in this node are touched */
     size_t old_data_size = nodes_data_size_.back();
+    for (size_t i = data_.size(); i-- > old_data_size;) {
+        AdamsDeg deg = journal_degs_.back();
+        journal_degs_.pop_back();
+        stamps_.TouchDeg(deg);
+        leads_trie_.pop_back(TriePath(leads_[i]), (int)old_data_size);
+        pop_indices_by_ub(leads_group_by_deg_[deg], (int)old_data_size);
+        pop_indices_by_ub(leads_group_by_t_[deg.t], (int)old_data_size);
+        pop_indices_by_ub(leads_group_by_last_gen_[leads_[i].backg()], (int)old_data_size);
+    }
     data_.resize(old_data_size);
     leads_.resize(old_data_size);
     traces_.resize(old_data_size);
     data_O_.resize(old_data_size);
-    for (auto& [_, indices] : leads_group_by_key_)
-        pop_indices_by_ub(indices, (int)old_data_size);
-    for (auto& [_, indices] : leads_group_by_deg_)
-        pop_indices_by_ub(indices, (int)old_data_size);
-    for (auto& [_, indices] : leads_group_by_t_)
-        pop_indices_by_ub(indices, (int)old_data_size);
-    for (auto& indices : leads_group_by_last_gen_)
-        pop_indices_by_ub(indices, (int)old_data_size);
+
+    size_t old_journal_2tor_size = nodes_journal_2tor_size_.back();
+    while (journal_2tor_.size() > old_journal_2tor_size) {
+        auto [i, value] = journal_2tor_.back();
+        if (i < gen_2tor_degs_.size())
+            gen_2tor_degs_[i] = value;
+        journal_2tor_.pop_back();
+    }
+    if (gen_degs_.size() != nodes_gen_size_.back())
+        stamps_.TouchGens();
+    gen_degs_.resize(nodes_gen_size_.back());
+    gen_2tor_degs_.resize(nodes_gen_size_.back());
 
     nodes_gen_size_.pop_back();
     nodes_data_size_.pop_back();
-    nodes_gen_2tor_degs_.pop_back();
+    nodes_journal_2tor_size_.pop_back();
 }
 
 void Groebner::debug_print() const
 {
     std::cout << "gen_degs_.size()=" << gen_degs_.size() << '\n';
     std::cout << "data_.size()=" << data_.size() << '\n';
-    size_t sum = 0;
-    for (auto& [_, indices] : leads_group_by_key_)
-        sum += indices.size();
-    std::cout << "leads_group_by_key_=" << sum << '\n';
+    std::cout << "leads_trie_=" << leads_trie_.size() << '\n';
 
-    sum = 0;
+    size_t sum = 0;
     for (auto& [_, indices] : leads_group_by_deg_)
         sum += indices.size();
     std::cout << "leads_group_by_deg_=" << sum << '\n';
@@ -327,9 +343,21 @@ void Groebner::debug_print() const
     std::cout << "leads_group_by_last_gen_=" << sum << '\n';
 }
 
+/* Generators of `mon` in increasing order */
+static LeadTrie::Path GensOf(const Mon& mon)
+{
+    LeadTrie::Path result;
+    result.reserve(mon.m().size());
+    for (size_t i = 0; i < mon.m().size(); ++i)
+        result.push_back(mon.m()[i].g());
+    return result;
+}
+
 int Groebner::IndexOfDivisibleLeading(const Mon& mon, int eff_min) const
 {
     auto t = mon.Trace();
+    auto gens = GensOf(mon);
+    auto pass = [&](int k) { return divisible(leads_[k], mon, traces_[k], t) && data_[k].EffNum() >= eff_min; };
     for (int i = mon.c() > 0 ? -1 : 0; i < (int)mon.m().size(); ++i) {
         for (int j = mon.c() > 0 ? -2 : -1; j < i; ++j) {
             uint32_t g1 = i == -1 ? 0 : mon.m()[i].g();
@@ -338,13 +366,12 @@ int Groebner::IndexOfDivisibleLeading(const Mon& mon, int eff_min) const
                 g2 = 1;
             else if (j >= 0)
                 g2 = mon.m()[j].g() + 1;
-            auto key = TypeIndexKey{g1 + (g2 << 16)};
-            auto p = leads_group_by_key_.find(key);
-            if (p != leads_group_by_key_.end()) {
-                for (int k : p->second) {
-                    if (divisible(leads_[k], mon, traces_[k], t) && data_[k].EffNum() >= eff_min)
-                        return k;
-                }
+            const uint32_t key[2] = {g1, g2};
+            uint32_t node = leads_trie_.Find(key, 2);
+            if (node != NULL_INDEX32) {
+                int k = leads_trie_.FirstInSubtree(node, gens.data(), gens.size(), eff_min, pass);
+                if (k != -1)
+                    return k;
             }
         }
     }
@@ -354,6 +381,9 @@ int Groebner::IndexOfDivisibleLeading(const Mon& mon, int eff_min) const
 int Groebner::IndexOfDivisibleLeadingV2(const Mon& mon) const
 {
     auto t = mon.Trace();
+    auto gens = GensOf(mon);
+    auto pass = [&](int k) { return divisible(leads_[k], mon, traces_[k], t); };
+    auto eff_of = [this](int k) { return data_[k].EffNum(); };
     int result = -1, eff = 0;
     for (int i = mon.c() > 0 ? -1 : 0; i < (int)mon.m().size(); ++i) {
         for (int j = mon.c() > 0 ? -2 : -1; j < i; ++j) {
@@ -363,16 +393,13 @@ int Groebner::IndexOfDivisibleLeadingV2(const Mon& mon) const
                 g2 = 1;
             else if (j >= 0)
                 g2 = mon.m()[j].g() + 1;
-            auto key = TypeIndexKey{g1 + (g2 << 16)};
-            auto p = leads_group_by_key_.find(key);
-            if (p != leads_group_by_key_.end()) {
-                for (int k : p->second) {
-                    if (divisible(leads_[k], mon, traces_[k], t)) {
-                        if (data_[k].EffNum() > eff) {
-                            result = k;
-                            eff = data_[k].EffNum();
-                        }
-                    }
+            const uint32_t key[2] = {g1, g2};
+            uint32_t node = leads_trie_.Find(key, 2);
+            if (node != NULL_INDEX32) {
+                int k = leads_trie_.BestInSubtree(node, gens.data(), gens.size(), eff, pass, eff_of);
+                if (k != -1) {
+                    result = k;
+                    eff = data_[k].EffNum();
                 }
             }
         }
@@ -472,8 +499,6 @@ void Groebner::AddRels(Poly1d rels, int t_max, const ut::map_seq2d<int, 0>& poss
     int d_trunc = deg_trunc();
     if (t_max > d_trunc)
         throw MyException(0x42e4ce5dU, "deg is bigger than the truncation degree.");
-    Poly tmp;
-
     /* Calculate the degrees of `rels` and group them by degree */
     std::map<int, Poly1d> rels_graded;
     for (auto& rel : rels) {
@@ -496,14 +521,6 @@ void Groebner::AddRels(Poly1d rels, int t_max, const ut::map_seq2d<int, 0>& poss
         size_t pairs_d_size = pairs_d.size();
         auto& rels_d = rels_graded[t];
         Poly1d rels_tmp(pairs_d_size + rels_d.size());
-        for (size_t i = 0; i < pairs_d_size; ++i) {
-            pairs_d[i].SijP(*this, rels_tmp[i], tmp);
-            /*if (rels_tmp[i].Str() == "x_8x_{51}+x_{13}x_{43}+O(29)") {
-                std::cout << pairs_d[i].i1 << ' ' << pairs_d[i].i2 << '\n';
-                std::cout << data_[pairs_d[i].i1] << ' ' << data_[pairs_d[i].i2] << '\n';
-                std::cout << "debug\n";
-            }*/
-        }
         for (size_t i = 0; i < rels_d.size(); ++i) {
             rels_tmp[pairs_d_size + i] = std::move(rels_d[i]);
             /*if (rels_tmp[pairs_d_size + i].Str() == "x_8x_{51}+x_{13}x_{43}+O(29)") {
@@ -511,7 +528,19 @@ void Groebner::AddRels(Poly1d rels, int t_max, const ut::map_seq2d<int, 0>& poss
                 std::cout << "debug\n";
             }*/
         }
-        ut::for_each_par128(rels_tmp.size(), [this, &rels_tmp](size_t i) { rels_tmp[i] = Reduce(std::move(rels_tmp[i])); });
+        /* The S-polynomials of degree t only read the basis, so they are formed and reduced in parallel */
+        ut::for_each_par128(rels_tmp.size(), [this, &rels_tmp, &pairs_d, pairs_d_size](size_t i) {
+            if (i < pairs_d_size) {
+                Poly tmp;
+                pairs_d[i].SijP(*this, rels_tmp[i], tmp);
+                /*if (rels_tmp[i].Str() == "x_8x_{51}+x_{13}x_{43}+O(29)") {
+                    std::cout << pairs_d[i].i1 << ' ' << pairs_d[i].i2 << '\n';
+                    std::cout << data_[pairs_d[i].i1] << ' ' << data_[pairs_d[i].i2] << '\n';
+                    std::cout << "debug\n";
+                }*/
+            }
+            rels_tmp[i] = Reduce(std::move(rels_tmp[i]));
+        });
         std::sort(rels_tmp.begin(), rels_tmp.end(), [](const Poly& p1, const Poly& p2) { return p1.UnknownFil() > p2.UnknownFil(); });
 
         for (auto& rel : rels_tmp) {
@@ -581,6 +610,7 @@ void Groebner::SimplifyRels()
         g1 = Reduce(std::move(g1));
         g.data.resize(1);
         std::copy(g1.data.begin(), g1.data.end(), std::back_inserter(g.data));
+        leads_trie_.raise_eff(TriePath(g.GetLead()), g.EffNum());
     }
 }
 
@@ -698,21 +728,25 @@ void GroebnerMod::AddNode()
 void GroebnerMod::PopNode()
 {
     old_pGb_size_ = pGb_->leads_.size();
+    if (v_degs_.size() != nodes_gen_size_.back())
+        stamps_.TouchGens();
     v_degs_.resize(nodes_gen_size_.back());
 
+    /* Only the groups of the data added in this node are touched */
     size_t old_data_size = nodes_data_size_.back();
+    for (size_t i = data_.size(); i-- > old_data_size;) {
+        AdamsDeg deg = journal_degs_.back();
+        journal_degs_.pop_back();
+        stamps_.TouchDeg(deg);
+        leads_trie_.pop_back(TriePath(leads_[i]), (int)old_data_size);
+        pop_indices_by_ub(leads_group_by_deg_[deg], (int)old_data_size);
+        pop_indices_by_ub(leads_group_by_t_[deg.t], (int)old_data_size);
+        pop_indices_by_ub(leads_group_by_v_[leads_[i].v], (int)old_data_size);
+    }
     data_.resize(old_data_size);
     leads_.resize(old_data_size);
     traces_.resize(old_data_size);
     data_O_.resize(old_data_size);
-    for (auto& [_, indices] : leads_group_by_key_)
-        pop_indices_by_ub(indices, (int)old_data_size);
-    for (auto& [_, indices] : leads_group_by_deg_)
-        pop_indices_by_ub(indices, (int)old_data_size);
-    for (auto& [_, indices] : leads_group_by_t_)
-        pop_indices_by_ub(indices, (int)old_data_size);
-    for (auto& indices : leads_group_by_v_)
-        pop_indices_by_ub(indices, (int)old_data_size);
 
     nodes_gen_size_.pop_back();
     nodes_data_size_.pop_back();
@@ -722,12 +756,9 @@ void GroebnerMod::debug_print() const
 {
     std::cout << "v_degs_.size()=" << v_degs_.size() << '\n';
     std::cout << "data_.size()=" << data_.size() << '\n';
-    size_t sum = 0;
-    for (auto& [_, indices] : leads_group_by_key_)
-        sum += indices.size();
-    std::cout << "leads_group_by_key_=" << sum << '\n';
+    std::cout << "leads_trie_=" << leads_trie_.size() << '\n';
 
-    sum = 0;
+    size_t sum = 0;
     for (auto& [_, indices] : leads_group_by_deg_)
         sum += indices.size();
     std::cout << "leads_group_by_deg_=" << sum << '\n';
@@ -746,6 +777,8 @@ void GroebnerMod::debug_print() const
 int GroebnerMod::IndexOfDivisibleLeading(const MMod& mon, int eff_min) const
 {
     const auto t = mon.m.Trace();
+    auto gens = GensOf(mon.m);
+    auto pass = [&](int k) { return divisible(leads_[k].m, mon.m, traces_[k], t) && data_[k].EffNum() >= eff_min; };
     const int i_max = int(mon.m.m().size());
     for (int i = mon.m.c() > 0 ? -2 : -1; i < i_max; ++i) {
         uint32_t backg = 0;
@@ -753,13 +786,12 @@ int GroebnerMod::IndexOfDivisibleLeading(const MMod& mon, int eff_min) const
             backg = 1;
         else if (i >= 0)
             backg = mon.m.m()[i].g() + 1;
-        auto key = TypeIndexKey{mon.v + (backg << 16)};
-        auto p = leads_group_by_key_.find(key);
-        if (p != leads_group_by_key_.end()) {
-            for (int k : p->second) {
-                if (divisible(leads_[k].m, mon.m, traces_[k], t) && data_[k].EffNum() >= eff_min)
-                    return k;
-            }
+        const uint32_t key[2] = {mon.v, backg};
+        uint32_t node = leads_trie_.Find(key, 2);
+        if (node != NULL_INDEX32) {
+            int k = leads_trie_.FirstInSubtree(node, gens.data(), gens.size(), eff_min, pass);
+            if (k != -1)
+                return k;
         }
     }
     return -1;
@@ -769,6 +801,9 @@ int GroebnerMod::IndexOfDivisibleLeadingV2(const MMod& mon) const
 {
     int result = -1, eff = 0;
     auto t = mon.m.Trace();
+    auto gens = GensOf(mon.m);
+    auto pass = [&](int k) { return divisible(leads_[k].m, mon.m, traces_[k], t); };
+    auto eff_of = [this](int k) { return data_[k].EffNum(); };
     const int i_max = int(mon.m.m().size());
     for (int i = mon.m.c() > 0 ? -2 : -1; i < i_max; ++i) {
         uint32_t backg = 0;
@@ -776,16 +811,13 @@ int GroebnerMod::IndexOfDivisibleLeadingV2(const MMod& mon) const
             backg = 1;
         else if (i >= 0)
             backg = mon.m.m()[i].g() + 1;
-        auto key = TypeIndexKey{mon.v + (backg << 16)};
-        auto p = leads_group_by_key_.find(key);
-        if (p != leads_group_by_key_.end()) {
-            for (int k : p->second) {
-                if (divisible(leads_[k].m, mon.m, traces_[k], t)) {
-                    if (data_[k].EffNum() > eff) {
-                        result = k;
-                        eff = data_[k].EffNum();
-                    }
-                }
+        const uint32_t key[2] = {mon.v, backg};
+        uint32_t node = leads_trie_.Find(key, 2);
+        if (node != NULL_INDEX32) {
+            int k = leads_trie_.BestInSubtree(node, gens.data(), gens.size(), eff, pass, eff_of);
+            if (k != -1) {
+                result = k;
+                eff = data_[k].EffNum();
             }
         }
     }
@@ -952,7 +984,6 @@ void GroebnerMod::AddRels(Mod1d rels, int t_max, const ut::map_seq2d<int, 0>& po
         }
     }
 
-    Mod tmp;
     for (int t = 0; t <= t_max && ((!rels_graded.empty() && t <= rels_graded.rbegin()->first) || !criticals_.empty()); ++t) {
         int next_stem = criticals_.NextD();
         if (next_stem != -1 && next_stem < t) {
@@ -965,13 +996,15 @@ void GroebnerMod::AddRels(Mod1d rels, int t_max, const ut::map_seq2d<int, 0>& po
         size_t pairs_d_size = pairs_d.size();
         auto& rels_d = rels_graded[t];
         Mod1d rels_tmp(pairs_d_size + rels_d.size());
-        for (size_t i = 0; i < pairs_d.size(); ++i) {
-            pairs_d[i].SijMod(*pGb_, *this, rels_tmp[i], tmp);
-            debug_hook(rels_tmp[i], "i1={}, i2={}\n", (pairs_d[i].i1 & FLAG_INDEX_X) ? pGb_->data_[pairs_d[i].i1 ^ FLAG_INDEX_X].Str() : data_[pairs_d[i].i1].Str(), data_[pairs_d[i].i2].Str());
-        }
         for (size_t i = 0; i < rels_d.size(); ++i)
             rels_tmp[pairs_d_size + i] = std::move(debug_hook(rels_d[i], ""));
-        ut::for_each_par128(rels_tmp.size(), [this, &rels_tmp](size_t i) {
+        /* The S-polynomials of degree t only read the bases, so they are formed and reduced in parallel */
+        ut::for_each_par128(rels_tmp.size(), [this, &rels_tmp, &pairs_d, pairs_d_size](size_t i) {
+            if (i < pairs_d_size) {
+                Mod tmp;
+                pairs_d[i].SijMod(*pGb_, *this, rels_tmp[i], tmp);
+                debug_hook(rels_tmp[i], "i1={}, i2={}\n", (pairs_d[i].i1 & FLAG_INDEX_X) ? pGb_->data_[pairs_d[i].i1 ^ FLAG_INDEX_X].Str() : data_[pairs_d[i].i1].Str(), data_[pairs_d[i].i2].Str());
+            }
             auto tmp = rels_tmp[i];
             rels_tmp[i] = Reduce(std::move(rels_tmp[i]));
             debug_hook(rels_tmp[i], "{}\n", tmp.Str());
@@ -1045,6 +1078,7 @@ void GroebnerMod::SimplifyRels()
         g1 = Reduce(std::move(g1));
         g.data.resize(1);
         std::copy(g1.data.begin(), g1.data.end(), std::back_inserter(g.data));
+        leads_trie_.raise_eff(TriePath(g.GetLead()), g.EffNum());
     }
 }
 
@@ -37,6 +37,42 @@ using CriPair1d = std::vector<CriPair>;
 using CriPair2d = std::vector<CriPair1d>;
 
 /* Groebner basis of critical pairs */
+/* Stamps of the changes of the relations by degree and of the generators.
+ * The values are unique across all instances and increase over time, so the maximum of several stamps
+ * changes whenever one of them does. Caches of data derived from a Groebner basis are validated with them. */
+class ChangeStamps
+{
+private:
+    std::map<AdamsDeg, uint64_t> degs_;
+    uint64_t reset_ = Next(); /* Stamp of the last change of all degrees */
+    uint64_t gens_ = reset_;
+
+    static uint64_t Next();
+
+public:
+    void TouchDeg(AdamsDeg deg)
+    {
+        degs_[deg] = Next();
+    }
+    void TouchAll()
+    {
+        reset_ = Next();
+    }
+    void TouchGens()
+    {
+        gens_ = Next();
+    }
+    uint64_t deg(AdamsDeg deg) const
+    {
+        auto p = degs_.find(deg);
+        return p == degs_.end() ? reset_ : std::max(reset_, p->second);
+    }
+    uint64_t gens() const
+    {
+        return gens_;
+    }
+};
+
 class GbCriPairs
 {
 public:
@@ -94,39 +130,208 @@ public:
 
 int NextO(const ut::map_seq2d<int, 0>& possEinf, int t_max, int stem, int O_min);
 
+/* Trie of leading monomials for the divisibility search.
+ *
+ * The first symbols of a path are the keys the leads were grouped by, so that the search visits the groups in the same order.
+ * The remaining symbols are the other generators of the lead in decreasing order.
+ * A lead can only divide `mon` if all of its generators occur in `mon`, which prunes the subtrees.
+ * Every node keeps an upper bound of EffNum and a lower bound of the indices in its subtree.
+ * Indices are inserted increasingly and removed from the back, which is what AddNode/PopNode need.
+ */
+class LeadTrie
+{
+public:
+    using Path = std::vector<uint32_t>;
+
+private:
+    struct Node
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> children; /* (symbol, node) sorted by symbol */
+        int1d indices;                                       /* Increasing */
+        int eff_max = INT_MIN;
+        int index_min = INT_MAX;
+    };
+    std::vector<Node> nodes_;
+    size_t size_ = 0;
+
+public:
+    LeadTrie() : nodes_(1) {}
+
+    void clear()
+    {
+        nodes_.clear();
+        nodes_.emplace_back();
+        size_ = 0;
+    }
+    size_t size() const
+    {
+        return size_;
+    }
+
+    void push_back(const Path& path, int index, int eff)
+    {
+        uint32_t node = 0;
+        for (uint32_t symbol : path) {
+            node = Child(node, symbol);
+            nodes_[node].eff_max = std::max(nodes_[node].eff_max, eff);
+            nodes_[node].index_min = std::min(nodes_[node].index_min, index);
+        }
+        nodes_[node].indices.push_back(index);
+        ++size_;
+    }
+
+    /* Keep the bounds valid when the EffNum of a lead at `path` is changed to `eff` */
+    void raise_eff(const Path& path, int eff)
+    {
+        uint32_t node = 0;
+        for (uint32_t symbol : path) {
+            node = FindChild(node, symbol);
+            nodes_[node].eff_max = std::max(nodes_[node].eff_max, eff);
+        }
+    }
+
+    /* Remove the indices >= ub at `path`. The bounds of the nodes are kept, which is still valid for pruning. */
+    void pop_back(const Path& path, int ub)
+    {
+        uint32_t node = Find(path.data(), path.size());
+        if (node != NULL_INDEX32) {
+            auto& indices = nodes_[node].indices;
+            while (!indices.empty() && indices.back() >= ub) {
+                indices.pop_back();
+                --size_;
+            }
+        }
+    }
+
+    /* Return the node at `path` or NULL_INDEX32 */
+    uint32_t Find(const uint32_t* path, size_t n) const
+    {
+        uint32_t node = 0;
+        for (size_t i = 0; i < n && node != NULL_INDEX32; ++i)
+            node = FindChild(node, path[i]);
+        return node;
+    }
+
+    /* The smallest index k in the subtree of `node` with `pass(k)`.
+     * Below the keys only the generators in `gens` (increasing) are visited. */
+    template <typename FnPass>
+    int FirstInSubtree(uint32_t node, const uint32_t* gens, size_t n_gens, int eff_min, FnPass& pass) const
+    {
+        return FirstInSubtree(node, gens, n_gens, eff_min, INT_MAX, pass);
+    }
+
+    /* The index k in the subtree of `node` with `pass(k)`, the biggest `eff(k) > eff_min` and then the smallest k */
+    template <typename FnPass, typename FnEff>
+    int BestInSubtree(uint32_t node, const uint32_t* gens, size_t n_gens, int eff_min, FnPass& pass, FnEff& eff) const
+    {
+        auto& n = nodes_[node];
+        if (n.eff_max <= eff_min)
+            return -1;
+        int result = -1;
+        for (int k : n.indices) {
+            if (eff(k) > eff_min && pass(k)) {
+                result = k;
+                eff_min = eff(k);
+            }
+        }
+        for (auto [symbol, child] : n.children) {
+            if (!std::binary_search(gens, gens + n_gens, symbol))
+                continue;
+            /* Ties are won by the smaller index, so the child also looks for EffNum equal to the current best */
+            int k = BestInSubtree(child, gens, n_gens, result == -1 ? eff_min : eff_min - 1, pass, eff);
+            if (k != -1 && (result == -1 || eff(k) > eff_min || k < result)) {
+                result = k;
+                eff_min = eff(k);
+            }
+        }
+        return result;
+    }
+
+private:
+    uint32_t FindChild(uint32_t node, uint32_t symbol) const
+    {
+        auto& children = nodes_[node].children;
+        auto p = std::lower_bound(children.begin(), children.end(), symbol, [](const std::pair<uint32_t, uint32_t>& c, uint32_t s) { return c.first < s; });
+        return p != children.end() && p->first == symbol ? p->second : NULL_INDEX32;
+    }
+
+    uint32_t Child(uint32_t node, uint32_t symbol)
+    {
+        auto& children = nodes_[node].children;
+        auto p = std::lower_bound(children.begin(), children.end(), symbol, [](const std::pair<uint32_t, uint32_t>& c, uint32_t s) { return c.first < s; });
+        if (p != children.end() && p->first == symbol)
+            return p->second;
+        uint32_t result = (uint32_t)nodes_.size();
+        children.insert(p, {symbol, result});
+        nodes_.emplace_back();
+        return result;
+    }
+
+    template <typename FnPass>
+    int FirstInSubtree(uint32_t node, const uint32_t* gens, size_t n_gens, int eff_min, int bound, FnPass& pass) const
+    {
+        auto& n = nodes_[node];
+        if (n.eff_max < eff_min || n.index_min >= bound)
+            return -1;
+        int result = -1;
+        for (int k : n.indices) {
+            if (k >= bound)
+                break;
+            if (pass(k)) {
+                result = bound = k;
+                break;
+            }
+        }
+        for (auto [symbol, child] : n.children) {
+            if (!std::binary_search(gens, gens + n_gens, symbol))
+                continue;
+            if (int k = FirstInSubtree(child, gens, n_gens, eff_min, bound, pass); k != -1)
+                result = bound = k;
+        }
+        return result;
+    }
+};
+
 /* 2 is considered as the first generator */
 class Groebner
 {
 private:
-    using TypeIndexKey = uint32_t;
     friend class GroebnerMod;
 
 private:
     GbCriPairs criticals_; /* Groebner basis of critical pairs */
 
     Poly1d data_;
-    Mon1d leads_;                                                /* Leading monomials */
-    MonTrace1d traces_;                                          /* Cache for fast divisibility test */
-    int1d data_O_;                                               /* Cache for certainty of data_ */
-    std::unordered_map<TypeIndexKey, int1d> leads_group_by_key_; /* Cache for fast divisibility test */
-    int2d leads_group_by_last_gen_;                              /* Cache for generating a basis */
-    std::map<AdamsDeg, int1d> leads_group_by_deg_;               /* Cache for generating a basis */
-    std::map<int, int1d> leads_group_by_t_;                      /* Cache for iteration */
+    Mon1d leads_;                                  /* Leading monomials */
+    MonTrace1d traces_;                            /* Cache for fast divisibility test */
+    int1d data_O_;                                 /* Cache for certainty of data_ */
+    LeadTrie leads_trie_;                          /* Cache for fast divisibility test */
+    int2d leads_group_by_last_gen_;                /* Cache for generating a basis */
+    std::map<AdamsDeg, int1d> leads_group_by_deg_; /* Cache for generating a basis */
+    std::map<int, int1d> leads_group_by_t_;        /* Cache for iteration */
 
     AdamsDeg1d gen_degs_; /* degree of generators */
-    int2d nodes_gen_2tor_degs_; /* 2 torsion degree of generators */
+    int1d gen_2tor_degs_; /* 2 torsion degree of generators */
+
+    /* Undo journal of AddNode/PopNode */
+    std::vector<std::pair<size_t, int>> journal_2tor_; /* (index, old value) of gen_2tor_degs_ */
+    AdamsDeg1d journal_degs_;                          /* Degrees of data_ added since the first node */
     std::vector<size_t> nodes_gen_size_;
     std::vector<size_t> nodes_data_size_;
+    std::vector<size_t> nodes_journal_2tor_size_;
+    size_t bytes_journaled_ = 0;
+
+    ChangeStamps stamps_;
 
 public:
-    Groebner() : criticals_(DEG_MAX), gen_degs_({AdamsDeg(1, 1)}), nodes_gen_2tor_degs_({{FIL_MAX + 1}}) {}
-    Groebner(int t_trunc, AdamsDeg1d gen_degs) : criticals_(t_trunc), gen_degs_(std::move(gen_degs)), nodes_gen_2tor_degs_({})
+    Groebner() : criticals_(DEG_MAX), gen_degs_({AdamsDeg(1, 1)}), gen_2tor_degs_({FIL_MAX + 1}) {}
+    Groebner(int t_trunc, AdamsDeg1d gen_degs) : criticals_(t_trunc), gen_degs_(std::move(gen_degs))
     {
         for (AdamsDeg deg : gen_degs_) {
             if (deg == AdamsDeg(1, 1))
-                nodes_gen_2tor_degs_.back().push_back(FIL_MAX + 1);
+                gen_2tor_degs_.push_back(FIL_MAX + 1);
             else
-                nodes_gen_2tor_degs_.back().push_back((deg.stem() + 5) / 2);
+                gen_2tor_degs_.push_back((deg.stem() + 5) / 2);
         }
     }
 
@@ -134,9 +339,24 @@ public:
     Groebner(int t_trunc, AdamsDeg1d gen_degs, Poly1d polys);
 
 private:
-    static TypeIndexKey Key(const Mon& lead)
+    /* (last generator, second last generator + 1 or 1 for 2^c) followed by the other generators */
+    static LeadTrie::Path TriePath(const Mon& lead)
+    {
+        LeadTrie::Path result = {lead.backg(), lead.backg2p1()};
+        for (size_t i = lead.m().size(); i-- > 2;)
+            result.push_back(lead.m()[i - 2].g());
+        return result;
+    }
+
+    void set_gen_2tor_deg(size_t i, int value)
     {
-        return TypeIndexKey{lead.backg() + (lead.backg2p1() << 16)};
+        if (gen_2tor_degs_[i] == value)
+            return;
+        if (!nodes_data_size_.empty()) {
+            journal_2tor_.push_back({i, gen_2tor_degs_[i]});
+            bytes_journaled_ += sizeof(std::pair<size_t, int>);
+        }
+        gen_2tor_degs_[i] = value;
     }
 
 public: /* Getters and Setters */
@@ -172,16 +392,21 @@ public: /* Getters and Setters */
         traces_.push_back(m.Trace());
         data_O_.push_back(g.UnknownFil());
         int index = (int)data_.size();
-        leads_group_by_key_[Key(m)].push_back(index);
+        leads_trie_.push_back(TriePath(m), index, g.EffNum());
         leads_group_by_deg_[deg].push_back(index);
         leads_group_by_t_[deg.t].push_back(index);
         uint32_t backg = m.backg();
         ut::get(leads_group_by_last_gen_, backg).push_back(index);
+        stamps_.TouchDeg(deg);
+        if (!nodes_data_size_.empty()) {
+            journal_degs_.push_back(deg);
+            bytes_journaled_ += sizeof(AdamsDeg);
+        }
 
         if (g.data.size() == 1) {
             if (m.frontg() == backg && backg > 0 && m.m().begin()->e_masked() == 1) {
                 size_t i = backg;
-                nodes_gen_2tor_degs_.back()[i] = std::min(m.c(), nodes_gen_2tor_degs_.back()[i]);
+                set_gen_2tor_deg(i, std::min(m.c(), gen_2tor_degs_[i]));
             }
         }
 
@@ -200,19 +425,24 @@ public: /* Getters and Setters */
         leads_.clear();
         traces_.clear();
         data_O_.clear();
-        leads_group_by_key_.clear();
+        leads_trie_.clear();
         leads_group_by_deg_.clear();
         leads_group_by_t_.clear();
         leads_group_by_last_gen_.clear();
         data_.clear();
+        stamps_.TouchAll();
 
         for (size_t i = 1; i < gen_degs_.size(); ++i)
-            nodes_gen_2tor_degs_.back()[i] = (gen_degs_[i].stem() + 5) / 2;  //// TODO: modify
+            set_gen_2tor_deg(i, (gen_degs_[i].stem() + 5) / 2);  //// TODO: modify
     }
 
     /* Restore the algebra to a previous status */
     void AddNode();
     void PopNode();
+    size_t bytes_journaled() const
+    {
+        return bytes_journaled_;
+    }
     void debug_print() const;
 
     bool operator==(const Groebner& rhs) const
@@ -235,9 +465,14 @@ public: /* Getters and Setters */
         return gen_degs_;
     }
 
+    const ChangeStamps& stamps() const
+    {
+        return stamps_;
+    }
+
     const auto& gen_2tor_degs() const
     {
-        return nodes_gen_2tor_degs_.back();
+        return gen_2tor_degs_;
     }
 
     const auto& leads_group_by_deg() const
@@ -293,10 +528,11 @@ public:
     void AddGen(AdamsDeg deg)
     {
         gen_degs_.push_back(deg);
+        stamps_.TouchGens();
         if (deg == AdamsDeg(1, 1))
-            nodes_gen_2tor_degs_.back().push_back(FIL_MAX + 1);
+            gen_2tor_degs_.push_back(FIL_MAX + 1);
         else
-            nodes_gen_2tor_degs_.back().push_back((deg.stem() + 5) / 2); ////TODO: modify
+            gen_2tor_degs_.push_back((deg.stem() + 5) / 2); ////TODO: modify
     }
 
     /**
@@ -353,27 +589,29 @@ inline Poly subsMGb(const Poly& poly, const Groebner& gb, const std::vector<Poly
 
 class GroebnerMod
 {
-private:
-    using TypeIndexKey = uint32_t;
-
 private:
     const Groebner* pGb_;
     size_t old_pGb_size_;
     GbCriPairs criticals_; /* Groebner basis of critical pairs */
 
     Mod1d data_;
-    MMod1d leads_;                                               /* Leading monomials */
-    MonTrace1d traces_;                                          /* Cache for fast divisibility test */
-    int1d data_O_;                                               /* Cache for certainty of data_ */
-    std::unordered_map<TypeIndexKey, int1d> leads_group_by_key_; /* Cache for fast divisibility test */
-    int2d leads_group_by_v_;                                     /* Cache for generating a basis */
-    std::map<AdamsDeg, int1d> leads_group_by_deg_;               /* Cache for iteration */
-    std::map<int, int1d> leads_group_by_t_;                      /* Cache for iteration */
+    MMod1d leads_;                                 /* Leading monomials */
+    MonTrace1d traces_;                            /* Cache for fast divisibility test */
+    int1d data_O_;                                 /* Cache for certainty of data_ */
+    LeadTrie leads_trie_;                          /* Cache for fast divisibility test */
+    int2d leads_group_by_v_;                       /* Cache for generating a basis */
+    std::map<AdamsDeg, int1d> leads_group_by_deg_; /* Cache for iteration */
+    std::map<int, int1d> leads_group_by_t_;        /* Cache for iteration */
 
     AdamsDeg1d v_degs_; /* degree of generators of modules */
 
+    /* Undo journal of AddNode/PopNode */
+    AdamsDeg1d journal_degs_; /* Degrees of data_ added since the first node */
     std::vector<size_t> nodes_gen_size_;
     std::vector<size_t> nodes_data_size_;
+    size_t bytes_journaled_ = 0;
+
+    ChangeStamps stamps_;
 
 public:
     GroebnerMod() : pGb_(nullptr), criticals_(DEG_MAX), old_pGb_size_(0) {}
@@ -383,9 +621,13 @@ public:
     GroebnerMod(const Groebner* pGb, int deg_trunc, AdamsDeg1d v_degs, Mod1d polys);
 
 private:
-    static TypeIndexKey Key(const MMod& lead)
+    /* (v, last generator + 1 or 1 for 2^c) followed by the other generators */
+    static LeadTrie::Path TriePath(const MMod& lead)
     {
-        return TypeIndexKey{lead.v + (lead.m ? ((lead.m.backg() + 1) << 16) : 0)};
+        LeadTrie::Path result = {lead.v, lead.m ? lead.m.backg() + 1 : 0};
+        for (size_t i = lead.m.m().size(); i-- > 1;)
+            result.push_back(lead.m.m()[i - 1].g());
+        return result;
     }
 
 public: /* Getters and Setters */
@@ -418,10 +660,15 @@ public: /* Getters and Setters */
         traces_.push_back(m.m.Trace());
         data_O_.push_back(g.UnknownFil());
         int index = (int)data_.size();
-        leads_group_by_key_[Key(m)].push_back(index);
+        leads_trie_.push_back(TriePath(m), index, g.EffNum());
         leads_group_by_deg_[deg].push_back(index);
         leads_group_by_t_[deg.t].push_back(index);
         ut::get(leads_group_by_v_, m.v).push_back(index);
+        stamps_.TouchDeg(deg);
+        if (!nodes_data_size_.empty()) {
+            journal_degs_.push_back(deg);
+            bytes_journaled_ += sizeof(AdamsDeg);
+        }
         data_.push_back(std::move(g));
     }
     /* This is used for initialization */
@@ -438,15 +685,20 @@ public: /* Getters and Setters */
         leads_.clear();
         traces_.clear();
         data_O_.clear();
-        leads_group_by_key_.clear();
+        leads_trie_.clear();
         leads_group_by_deg_.clear();
         leads_group_by_t_.clear();
         leads_group_by_v_.clear();
         data_.clear();
+        stamps_.TouchAll();
     }
 
     void AddNode();
     void PopNode();
+    size_t bytes_journaled() const
+    {
+        return bytes_journaled_;
+    }
     void debug_print() const;  ////
 
     bool operator==(const GroebnerMod& rhs) const
@@ -469,6 +721,11 @@ public: /* Getters and Setters */
         return v_degs_;
     }
 
+    const ChangeStamps& stamps() const
+    {
+        return stamps_;
+    }
+
     const auto& gen_2tor_degs() const
     {
         return pGb_->gen_2tor_degs();
@@ -528,6 +785,7 @@ public:
     void AddGen(AdamsDeg deg)
     {
         v_degs_.push_back(deg);
+        stamps_.TouchGens();
     }
 
     /**
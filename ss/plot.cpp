@@ -4,6 +4,7 @@
 #include "mylog.h"
 #include <filesystem>
 #include <fmt/os.h>
+#include <fmt/ranges.h>
 #include <fstream>
 #include <regex>
 
@@ -92,60 +93,180 @@ void LoadJson(const std::string& diagram_name, nlohmann::json& root_json, nlohma
 /* -20 degree */
 constexpr double BULLET_ANGLE = -20.0f / 180 * 3.1415926f;
 
-void plotBullets(const Staircases1d& nodes_ss, std::variant<const RingSp*, const ModSp*> pCw, const std::map<AdamsDeg, int>& deg2id, nlohmann::json& js)
+/* Write json text to a file as it is generated instead of building the DOM first */
+class JsonWriter
 {
-    const double COS_BULLET_ANGLE = std::cos(BULLET_ANGLE);
-    const double SIN_BULLET_ANGLE = std::sin(BULLET_ANGLE);
+private:
+    fmt::ostream& out_;
+    std::vector<bool> empty_; /* If the enclosing objects and arrays have no elements yet */
+    bool after_key_ = false;
+
+    /* Separate a new element from the previous one. Elements of the outermost two levels start on a new line. */
+    void Sep()
+    {
+        if (after_key_) {
+            after_key_ = false;
+            return;
+        }
+        if (!empty_.empty()) {
+            if (!empty_.back())
+                out_.print(",");
+            empty_.back() = false;
+            if (empty_.size() <= 2)
+                out_.print("\n");
+        }
+    }
+
+public:
+    explicit JsonWriter(fmt::ostream& out) : out_(out) {}
 
+    JsonWriter& BeginObject()
+    {
+        Sep();
+        out_.print("{{");
+        empty_.push_back(true);
+        return *this;
+    }
+    JsonWriter& EndObject()
+    {
+        empty_.pop_back();
+        out_.print("}}");
+        return *this;
+    }
+    JsonWriter& BeginArray()
+    {
+        Sep();
+        out_.print("[");
+        empty_.push_back(true);
+        return *this;
+    }
+    JsonWriter& EndArray()
+    {
+        empty_.pop_back();
+        out_.print("]");
+        return *this;
+    }
+    JsonWriter& Key(std::string_view key)
+    {
+        Sep();
+        out_.print("\"{}\":", key);
+        after_key_ = true;
+        return *this;
+    }
+    JsonWriter& Value(int x)
+    {
+        Sep();
+        out_.print("{}", x);
+        return *this;
+    }
+    JsonWriter& Value(double x)
+    {
+        Sep();
+        out_.print("{}", x);
+        return *this;
+    }
+    JsonWriter& Value(std::nullptr_t)
+    {
+        Sep();
+        out_.print("null");
+        return *this;
+    }
+    JsonWriter& Value(const std::string& x)
+    {
+        Sep();
+        out_.print("{}", nlohmann::json(x).dump());
+        return *this;
+    }
+    JsonWriter& Value(const char* x)
+    {
+        return Value(std::string(x));
+    }
+    JsonWriter& Value(const int1d& x)
+    {
+        Sep();
+        out_.print("[{}]", fmt::join(x, ","));
+        return *this;
+    }
+};
+
+/* Write `globalThis.DATA_JSON_<var_name> = {...};` to path. `fill` writes the members of the object. */
+template <typename Fn>
+void WriteJs(const std::string& path, const std::string& var_name, Fn fill)
+{
+    auto out = fmt::output_file(path);
+    out.print("globalThis.DATA_JSON_{} = ", var_name);
+    JsonWriter js(out);
+    js.BeginObject();
+    fill(js);
+    js.EndObject();
+    out.print(";\n");
+}
+
+std::map<AdamsDeg, double> GetBulletRadii(const Staircases1d& nodes_ss)
+{
     std::map<AdamsDeg, double> radii;
     for (auto& [d, sc] : nodes_ss.front())
         radii[d] = GetRadius((int)sc.levels.size());
     SmoothenRadii(radii);
+    return radii;
+}
+
+/* Write the bullets in stems [stem_min, stem_max] as elements of an array. `with_id` adds the index "id" of the bullet in the whole cw. */
+void plotBullets(const Staircases1d& nodes_ss, std::variant<const RingSp*, const ModSp*> pCw, const std::map<AdamsDeg, double>& radii, const std::map<AdamsDeg, int>& deg2id, JsonWriter& js, int stem_min, int stem_max, bool with_id)
+{
+    const double COS_BULLET_ANGLE = std::cos(BULLET_ANGLE);
+    const double SIN_BULLET_ANGLE = std::sin(BULLET_ANGLE);
 
     for (auto& [deg, sc] : nodes_ss.front()) {
+        if (deg.stem() < stem_min || deg.stem() > stem_max)
+            continue;
         int n = (int)sc.levels.size();
         double bottom_right_x = (double)deg.stem() + radii.at(deg) * 1.5 * COS_BULLET_ANGLE * (n - 1);
         double bottom_right_y = (double)deg.s + radii.at(deg) * 1.5 * SIN_BULLET_ANGLE * (n - 1);
         int stable_level = Diagram::GetFirstFixedLevelForPlot(nodes_ss, deg);
         for (size_t i = 0; i < sc.levels.size(); ++i) {
-            js["bullets"].push_back(nlohmann::json::object());
-            auto& bullet = js["bullets"].back();
-            bullet["x"] = bottom_right_x - radii.at(deg) * 3 * COS_BULLET_ANGLE * double((int)i);
-            bullet["y"] = bottom_right_y - radii.at(deg) * 3 * SIN_BULLET_ANGLE * double((int)i);
-            bullet["r"] = radii.at(deg);
-            bullet["b"] = sc.basis[i];
+            js.BeginObject();
+            js.Key("x").Value(bottom_right_x - radii.at(deg) * 3 * COS_BULLET_ANGLE * double((int)i));
+            js.Key("y").Value(bottom_right_y - radii.at(deg) * 3 * SIN_BULLET_ANGLE * double((int)i));
+            js.Key("r").Value(radii.at(deg));
+            js.Key("b").Value(sc.basis[i]);
 
             if (!sc.basis[i].empty()) {
                 size_t index = (size_t)sc.basis[i].front();
-                bool isGen = std::holds_alternative<const RingSp*>(pCw) ? std::get<const RingSp*>(pCw)->basis.at(deg)[index].IsGen() : std::get<const ModSp*>(pCw)->basis.at(deg)[index].IsGen();
-                bullet["c"] = isGen ? "blue" : "black";
+                bool isGen = std::holds_alternative<const RingSp*>(pCw) ? std::get<const RingSp*>(pCw)->basis->at(deg)[index].IsGen() : std::get<const ModSp*>(pCw)->basis->at(deg)[index].IsGen();
+                js.Key("c").Value(isGen ? "blue" : "black");
             }
             else
-                bullet["c"] = "black";
+                js.Key("c").Value("black");
 
             if (sc.diffs[i] == NULL_DIFF)
-                bullet["d"] = nullptr;
+                js.Key("d").Value(nullptr);
             else
-                bullet["d"] = sc.diffs[i];
+                js.Key("d").Value(sc.diffs[i]);
 
+            js.Key("p");
             if (sc.levels[i] >= stable_level) {
                 if (sc.diffs[i] == NULL_DIFF)
-                    bullet["p"] = R_PERM;
+                    js.Value(R_PERM);
                 else
-                    bullet["p"] = 10000 - sc.levels[i];
+                    js.Value(10000 - sc.levels[i]);
             }
             else if (sc.levels[i] > 5000 || sc.diffs[i] == NULL_DIFF)
-                bullet["p"] = R_PERM;
+                js.Value(R_PERM);
             else
-                bullet["p"] = sc.levels[i];
+                js.Value(sc.levels[i]);
 
-            bullet["l"] = sc.levels[i];
-            bullet["i0"] = deg2id.at(deg);
+            js.Key("l").Value(sc.levels[i]);
+            js.Key("i0").Value(deg2id.at(deg));
+            if (with_id)
+                js.Key("id").Value(deg2id.at(deg) + (int)i);
+            js.EndObject();
         }
     }
 }
 
-void plotBullets(const CofSeq& cofseq, size_t iCs, const Diagram& diagram, const std::map<AdamsDeg, int>& deg2id, nlohmann::json& js)
+/* Write the members "bullets_p" and "bullets" */
+void plotBullets(const CofSeq& cofseq, size_t iCs, const Diagram& diagram, const std::map<AdamsDeg, int>& deg2id, JsonWriter& js)
 {
     const double COS_BULLET_ANGLE = std::cos(BULLET_ANGLE);
     const double SIN_BULLET_ANGLE = std::sin(BULLET_ANGLE);
@@ -159,134 +280,168 @@ void plotBullets(const CofSeq& cofseq, size_t iCs, const Diagram& diagram, const
         radii[d] += 1.0;
     for (auto& [d, _] : radii)
         radii[d] = GetRadius(radii[d]);
-
     SmoothenRadii(radii);
-    for (auto& [deg, _] : radii) {
-        int n = 0;
-        if (ut::has(nodes_cofseq.front(), deg))
-            n = (int)nodes_cofseq.front().at(deg).levels.size();
-        int extra_b = 0;
 
+    auto get_n = [&](AdamsDeg deg) { return ut::has(nodes_cofseq.front(), deg) ? (int)nodes_cofseq.front().at(deg).levels.size() : 0; };
+
+    js.Key("bullets_p").BeginArray();
+    for (auto& [deg, _] : radii) {
         if (PossMoreEinf(nodes_ss, deg)) {
-            extra_b = 1;
-            js["bullets_p"].push_back(nlohmann::json::object());
-            auto& bullet = js["bullets_p"].back();
-
-            bullet["x"] = (double)deg.stem() + radii.at(deg) * 1.5 * COS_BULLET_ANGLE * (n - 1 + extra_b);
-            bullet["y"] = (double)deg.s - radii.at(deg) * 1.5 * SIN_BULLET_ANGLE * (n - 1 + extra_b);
-            bullet["r"] = radii.at(deg);
-            bullet["c"] = "grey";
+            int n = get_n(deg);
+            js.BeginObject();
+            js.Key("x").Value((double)deg.stem() + radii.at(deg) * 1.5 * COS_BULLET_ANGLE * n);
+            js.Key("y").Value((double)deg.s - radii.at(deg) * 1.5 * SIN_BULLET_ANGLE * n);
+            js.Key("r").Value(radii.at(deg));
+            js.Key("c").Value("grey");
+            js.EndObject();
         }
+    }
+    js.EndArray();
 
+    js.Key("bullets").BeginArray();
+    for (auto& [deg, _] : radii) {
         if (!ut::has(nodes_cofseq.front(), deg))
             continue;
-        auto& sc = ut::GetRecentValue(nodes_cofseq, deg);
+        int n = get_n(deg);
+        int extra_b = PossMoreEinf(nodes_ss, deg) ? 1 : 0;
+        auto& sc = nodes_cofseq.GetRecentValue(deg);
         double bottom_right_x = (double)deg.stem() + radii.at(deg) * 1.5 * COS_BULLET_ANGLE * (n - 1 + extra_b);
         double bottom_right_y = (double)deg.s - radii.at(deg) * 1.5 * SIN_BULLET_ANGLE * (n - 1 + extra_b);
         int stable_level = Diagram::GetFirstFixedLevelForPlotCofseq(cofseq, iCs, deg);
         for (size_t i = 0; i < sc.levels.size(); ++i) {
-            js["bullets"].push_back(nlohmann::json::object());
-            auto& bullet = js["bullets"].back();
-            bullet["x"] = bottom_right_x - radii.at(deg) * 3 * COS_BULLET_ANGLE * double((int)i + extra_b);
-            bullet["y"] = bottom_right_y + radii.at(deg) * 3 * SIN_BULLET_ANGLE * double((int)i + extra_b);
-            bullet["r"] = radii.at(deg);
-            bullet["b"] = sc.basis[i];
+            js.BeginObject();
+            js.Key("x").Value(bottom_right_x - radii.at(deg) * 3 * COS_BULLET_ANGLE * double((int)i + extra_b));
+            js.Key("y").Value(bottom_right_y + radii.at(deg) * 3 * SIN_BULLET_ANGLE * double((int)i + extra_b));
+            js.Key("r").Value(radii.at(deg));
+            js.Key("b").Value(sc.basis[i]);
 
             if (!sc.basis[i].empty()) {
                 size_t index = (size_t)sc.basis[i].front();
                 auto iCw = cofseq.indexCw[iCs];
-                bool isGen = iCw.isRing ? diagram.GetRings()[iCw.index].basis.at(deg)[index].IsGen() : diagram.GetModules()[iCw.index].basis.at(deg)[index].IsGen();
-                bullet["c"] = isGen ? "blue" : "black";
+                bool isGen = iCw.isRing ? diagram.GetRings()[iCw.index].basis->at(deg)[index].IsGen() : diagram.GetModules()[iCw.index].basis->at(deg)[index].IsGen();
+                js.Key("c").Value(isGen ? "blue" : "black");
             }
             else
-                bullet["c"] = "black";
+                js.Key("c").Value("black");
 
             if (sc.diffs[i] == NULL_DIFF)
-                bullet["d"] = nullptr;
+                js.Key("d").Value(nullptr);
             else
-                bullet["d"] = sc.diffs[i];
+                js.Key("d").Value(sc.diffs[i]);
 
+            js.Key("p");
             if (sc.levels[i] >= stable_level) {
                 if (sc.diffs[i] == NULL_DIFF)
-                    bullet["p"] = R_PERM;
+                    js.Value(R_PERM);
                 else
-                    bullet["p"] = 10000 - sc.levels[i];
+                    js.Value(10000 - sc.levels[i]);
             }
             else if (sc.levels[i] > 5000 || sc.diffs[i] == NULL_DIFF)
-                bullet["p"] = R_PERM;
+                js.Value(R_PERM);
             else
-                bullet["p"] = sc.levels[i];
+                js.Value(sc.levels[i]);
 
-            bullet["l"] = sc.levels[i];
-            bullet["i0"] = deg2id.at(deg);
+            js.Key("l").Value(sc.levels[i]);
+            js.Key("i0").Value(deg2id.at(deg));
+            js.EndObject();
         }
     }
+    js.EndArray();
 }
 
-void plotRingStrLines(const Staircases1d& nodes_ss, const RingSp& ring, const std::map<AdamsDeg, int>& deg2id, const AdamsDeg1d& degs_factors, const Poly1d& bjs, nlohmann::json& js, int forStrl, bool forCofseq)
+/* Factors of structure lines (forStrl=1) or products (forStrl=0) */
+struct StrLineFactors
 {
-    using json = nlohmann::json;
+    AdamsDeg1d degs;
+    Poly1d bjs;
+    int forStrl;
+};
+
+/* Write one member of "prods" for each bullet in stems [stem_min, stem_max] */
+void WriteProds(JsonWriter& js, int key, const std::vector<std::pair<int1d, int>>& prods)
+{
+    if (prods.empty())
+        return;
+    js.Key(std::to_string(key)).BeginArray();
+    for (auto& [p, l] : prods) {
+        js.BeginObject();
+        js.Key("p").Value(p);
+        js.Key("l").Value(l);
+        js.EndObject();
+    }
+    js.EndArray();
+}
+
+void plotRingStrLines(const Staircases1d& nodes_ss, const RingSp& ring, const std::map<AdamsDeg, int>& deg2id, const std::vector<StrLineFactors>& factors, JsonWriter& js, bool forCofseq, int stem_min, int stem_max)
+{
+    std::vector<std::pair<int1d, int>> prods;
     for (auto& [deg, sc] : nodes_ss.front()) {
+        if (deg.stem() < stem_min || deg.stem() > stem_max)
+            continue;
         for (size_t i = 0; i < sc.levels.size(); ++i) {
-            Poly bi = Indices2Poly(sc.basis[i], ring.basis.at(deg));
-            auto key = std::to_string(deg2id.at(deg) + (int)i);
-            for (size_t j = 0; j < degs_factors.size(); ++j) {
-                const AdamsDeg deg_prod = degs_factors[j] + deg;
-                if (deg_prod.t > ring.t_max)
-                    break;
-                auto alg_prod = ring.gb.Reduce(bjs[j] * bi);
-                if (!alg_prod)
-                    continue;
-                int1d prod = Poly2Indices(alg_prod, ring.basis.at(deg_prod));
-                if (forCofseq) {
-                    prod = Residue(std::move(prod), ring.nodes_ss, deg_prod, LEVEL_PERM);
-                    if (prod.empty())
+            Poly bi = Indices2Poly(sc.basis[i], ring.basis->at(deg));
+            prods.clear();
+            for (auto& f : factors) {
+                for (size_t j = 0; j < f.degs.size(); ++j) {
+                    const AdamsDeg deg_prod = f.degs[j] + deg;
+                    if (deg_prod.t > ring.t_max)
+                        break;
+                    if (deg_prod.stem() > ring.stem_max)
                         continue;
-                }
-
-                prod = lina::GetInvImage(nodes_ss.front().at(deg_prod).basis, prod);
+                    auto alg_prod = ring.gb->Reduce(f.bjs[j] * bi);
+                    if (!alg_prod)
+                        continue;
+                    int1d prod = Poly2Indices(alg_prod, ring.basis->at(deg_prod));
+                    if (forCofseq) {
+                        prod = Residue(std::move(prod), ring.nodes_ss, deg_prod, LEVEL_PERM);
+                        if (prod.empty())
+                            continue;
+                    }
 
-                auto prod_json = json::object();
-                prod_json["p"] = json::array();
-                for (size_t k = 0; k < prod.size(); ++k)
-                    prod_json["p"].push_back(deg2id.at(deg_prod) + prod[k]);
-                prod_json["l"] = forStrl;
-                js["prods"][key].push_back(prod_json);
+                    prod = lina::GetInvImage(nodes_ss.front().at(deg_prod).basis, prod);
+                    for (int& k : prod)
+                        k += deg2id.at(deg_prod);
+                    prods.push_back({std::move(prod), f.forStrl});
+                }
             }
+            WriteProds(js, deg2id.at(deg) + (int)i, prods);
         }
     }
 }
 
-void plotModuleStrLines(const Staircases1d& nodes_ss, const ModSp& mod, const std::map<AdamsDeg, int>& deg2id, const AdamsDeg1d& degs_factors, const Poly1d& bjs, nlohmann::json& js, int forStrl, bool forCofseq = false)
+void plotModuleStrLines(const Staircases1d& nodes_ss, const ModSp& mod, const std::map<AdamsDeg, int>& deg2id, const std::vector<StrLineFactors>& factors, JsonWriter& js, bool forCofseq, int stem_min, int stem_max)
 {
-    using json = nlohmann::json;
+    std::vector<std::pair<int1d, int>> prods;
     for (auto& [deg, sc] : nodes_ss.front()) {
+        if (deg.stem() < stem_min || deg.stem() > stem_max)
+            continue;
         for (size_t i = 0; i < sc.levels.size(); ++i) {
-            Mod bi = Indices2Mod(sc.basis[i], mod.basis.at(deg));
-            auto key = std::to_string(deg2id.at(deg) + (int)i);
-            for (size_t j = 0; j < degs_factors.size(); ++j) {
-                const AdamsDeg deg_prod = degs_factors[j] + deg;
-                if (deg_prod.t > mod.t_max)
-                    break;
-                auto alg_prod = mod.gb.Reduce(bjs[j] * bi);
-                if (!alg_prod)
-                    continue;
-
-                int1d prod = Mod2Indices(alg_prod, mod.basis.at(deg_prod));
-                if (forCofseq) {
-                    prod = Residue(std::move(prod), mod.nodes_ss, deg_prod, LEVEL_PERM);
-                    if (prod.empty())
+            Mod bi = Indices2Mod(sc.basis[i], mod.basis->at(deg));
+            prods.clear();
+            for (auto& f : factors) {
+                for (size_t j = 0; j < f.degs.size(); ++j) {
+                    const AdamsDeg deg_prod = f.degs[j] + deg;
+                    if (deg_prod.t > mod.t_max)
+                        break;
+                    if (deg_prod.stem() > mod.stem_max)
+                        continue;
+                    auto alg_prod = mod.gb->Reduce(f.bjs[j] * bi);
+                    if (!alg_prod)
                         continue;
+
+                    int1d prod = Mod2Indices(alg_prod, mod.basis->at(deg_prod));
+                    if (forCofseq) {
+                        prod = Residue(std::move(prod), mod.nodes_ss, deg_prod, LEVEL_PERM);
+                        if (prod.empty())
+                            continue;
+                    }
+                    prod = lina::GetInvImage(nodes_ss.front().at(deg_prod).basis, prod);
+                    for (int& k : prod)
+                        k += deg2id.at(deg_prod);
+                    prods.push_back({std::move(prod), f.forStrl});
                 }
-                prod = lina::GetInvImage(nodes_ss.front().at(deg_prod).basis, prod);
-
-                auto prod_json = json::object();
-                prod_json["p"] = json::array();
-                for (size_t k = 0; k < prod.size(); ++k)
-                    prod_json["p"].push_back(deg2id.at(deg_prod) + prod[k]);
-                prod_json["l"] = forStrl;
-                js["prods"][key].push_back(prod_json);
             }
+            WriteProds(js, deg2id.at(deg) + (int)i, prods);
         }
     }
 }
@@ -305,9 +460,10 @@ std::map<AdamsDeg, int> get_deg2id(const Staircases1d& nodes_ss)
 int main_plot_ss(int argc, char** argv, int& index, const char* desc)
 {
     std::string diagram_name;
+    int tile = 0;
 
     myio::CmdArg1d args = {{"diagram", &diagram_name}};
-    myio::CmdArg1d op_args = {};
+    myio::CmdArg1d op_args = {{"tile", &tile}};
     if (int error = myio::ParseArguments(argc, argv, index, PROGRAM, desc, VERSION, args, op_args))
         return error;
 
@@ -318,7 +474,8 @@ int main_plot_ss(int argc, char** argv, int& index, const char* desc)
     std::string plot_dir = root_json.at("dir_website_ss").get<std::string>() + "/" + diag_json.at("dir_plot").get<std::string>();
     myio::AssertFolderExists(plot_dir);
 
-    Diagram diagram(diagram_name, SSFlag::no_op);
+    std::unique_ptr<Diagram> holder;
+    Diagram& diagram = OpenDiagram(diagram_name, SSFlag::no_op, holder);
     const auto& rings = diagram.GetRings();
     const auto& mods = diagram.GetModules();
     const auto& maps = diagram.GetMaps();
@@ -335,148 +492,208 @@ int main_plot_ss(int argc, char** argv, int& index, const char* desc)
       "nds": [{"i": 0, "r": 2}],
       "time": "2021-09-01 12:00:00"
     }
+
+    With tile=w > 0 the file <name>.js keeps everything but "bullets", "prods", "diffs" and "nds" and lists the tiles
+      "tiles": [{"stem_min": 0, "stem_max": 9, "name": "S0_tile0"}]
+    and <name>_tile<k>.js has these four members for the bullets in stems [stem_min, stem_max] of the k-th tile.
+    The indices in a tile refer to the bullets of the whole cw and each bullet has its index "id".
     */
 
-    std::vector<std::map<AdamsDeg, int>> all_deg2id;
     size_t cw_size = rings.size() + mods.size();
+    std::vector<std::map<AdamsDeg, int>> all_deg2id;
+    for (size_t iCw = 0; iCw < cw_size; ++iCw)
+        all_deg2id.push_back(get_deg2id(iCw < rings.size() ? rings[iCw].nodes_ss : mods[iCw - rings.size()].nodes_ss));
+
+    /* gen_names. SQLite is not thread-safe in this build, so the databases are read before the parallel loop */
+    std::vector<std::vector<std::string>> all_names(cw_size);
     for (size_t iCw = 0; iCw < cw_size; ++iCw) {
+        bool isRing = iCw < rings.size();
+        size_t iMod = isRing ? -1 : iCw - rings.size();
+        auto& name = isRing ? rings[iCw].name : mods[iMod].name;
+        auto& names = all_names[iCw];
+        auto path = isRing ? diag_json.at("rings")[iCw].at("path").get<std::string>() : diag_json.at("modules")[iMod].at("path").get<std::string>();
+        MyDB db(db_dir + "/" + path);
+        auto gen_names = db.load_gen_names(fmt::format("{}_AdamsE2", name));
+        auto gen_degs = db.load_gen_adamsdegs(fmt::format("{}_AdamsE2", name));
+        std::map<AdamsDeg, int> gen_index;
+        char letter = isRing ? 'x' : 'v';
+        for (size_t i = 0; i < gen_names.size(); ++i) {
+            ++gen_index[gen_degs[i]];
+            if (gen_names[i].empty())
+                names.push_back(fmt::format("{}_{{{},{}{}}}", letter, gen_degs[i].stem(), gen_degs[i].s, gen_index[gen_degs[i]] == 1 ? "" : fmt::format(",{}", gen_index[gen_degs[i]])));
+            else
+                names.push_back(gen_names[i]);
+        }
+    }
+
+    /* Every cw is written to its own files in parallel */
+    ut::for_each_par32_rethrow(cw_size, [&](size_t iCw) {
         bool isRing = iCw < rings.size();
         size_t iMod = isRing ? -1 : iCw - rings.size();
         auto& name = isRing ? rings[iCw].name : mods[iMod].name;
         auto& nodes_ss = isRing ? rings[iCw].nodes_ss : mods[iMod].nodes_ss;
         auto& ring = isRing ? rings[iCw] : rings[mods[iMod].iRing];
-
-        json js;
-        js["type"] = isRing ? "ring" : "module";
-        if (!isRing)
-            js["over"] = ring.name;
+        const auto& deg2id = all_deg2id[iCw];
 
         /* gen_names */
-        {
-            auto path = isRing ? diag_json.at("rings")[iCw].at("path").get<std::string>() : diag_json.at("modules")[iMod].at("path").get<std::string>();
-            MyDB db(db_dir + "/" + path);
-            auto gen_names = db.load_gen_names(fmt::format("{}_AdamsE2", name));
-            auto gen_degs = db.load_gen_adamsdegs(fmt::format("{}_AdamsE2", name));
-            std::map<AdamsDeg, int> gen_index;
-            char letter = isRing ? 'x' : 'v';
-            std::string key = isRing ? "gen_names" : "v_names";
-            for (size_t i = 0; i < gen_names.size(); ++i) {
-                ++gen_index[gen_degs[i]];
-                if (gen_names[i].empty())
-                    js[key].push_back(fmt::format("{}_{{{},{}{}}}", letter, gen_degs[i].stem(), gen_degs[i].s, gen_index[gen_degs[i]] == 1 ? "" : fmt::format(",{}", gen_index[gen_degs[i]])));
-                else
-                    js[key].push_back(gen_names[i]);
+        std::string key_names = isRing ? "gen_names" : "v_names";
+        const auto& names = all_names[iCw];
+
+        /* struct lines and products */
+        std::vector<StrLineFactors> factors;
+        for (int forStrl : {1, 0}) {
+            auto& f = factors.emplace_back();
+            f.forStrl = forStrl;
+            for (auto& strt_factor : diag_json.at("rings")[isRing ? iCw : mods[iMod].iRing].at("plot_factors")[1 - forStrl]) {
+                int stem = strt_factor[0].get<int>(), s = strt_factor[1].get<int>(), i_factor = strt_factor[2].get<int>();
+                f.degs.push_back(AdamsDeg(s, stem + s));
+                f.bjs.push_back(ring.basis->at(f.degs.back())[i_factor]);
             }
         }
 
-        /* basis */
-        if (isRing) {
-            for (auto& [d, basis_d] : ring.basis) {
-                for (auto& m : basis_d) {
-                    js["basis"].push_back(json::array());
-                    for (auto& p : m) {
-                        js["basis"].back().push_back(p.g());
-                        js["basis"].back().push_back(p.e());
+        auto write_header = [&](JsonWriter& js) {
+            js.Key("type").Value(isRing ? "ring" : "module");
+            if (!isRing)
+                js.Key("over").Value(ring.name);
+            if (!names.empty()) {
+                js.Key(key_names).BeginArray();
+                for (auto& n : names)
+                    js.Value(n);
+                js.EndArray();
+            }
+
+            /* basis */
+            js.Key("basis").BeginArray();
+            if (isRing) {
+                int1d b;
+                for (auto& [d, basis_d] : *ring.basis) {
+                    for (auto& m : basis_d) {
+                        b.clear();
+                        for (auto& p : m) {
+                            b.push_back(p.g());
+                            b.push_back(p.e());
+                        }
+                        js.Value(b);
                     }
                 }
             }
-        }
-        else {
-            for (auto& [d, basis_d] : mods[iMod].basis) {
-                for (auto& m : basis_d) {
-                    js["basis"].push_back(json::array());
-                    for (auto& p : m.m) {
-                        js["basis"].back().push_back(p.g());
-                        js["basis"].back().push_back(p.e());
+            else {
+                int1d b;
+                for (auto& [d, basis_d] : *mods[iMod].basis) {
+                    for (auto& m : basis_d) {
+                        b.clear();
+                        for (auto& p : m.m) {
+                            b.push_back(p.g());
+                            b.push_back(p.e());
+                        }
+                        b.push_back(m.v);
+                        js.Value(b);
                     }
-                    js["basis"].back().push_back(m.v);
                 }
             }
-        }
+            js.EndArray();
 
-        /* ss */
-        all_deg2id.push_back(get_deg2id(nodes_ss));
-        const auto& deg2id = all_deg2id.back();
-        if (isRing)
-            plotBullets(nodes_ss, &ring, deg2id, js);
-        else
-            plotBullets(nodes_ss, &mods[iMod], deg2id, js);
-
-        /* struct lines */
-        js["degs_factors"] = json::array();
-        js["prods"] = json::object();
-        AdamsDeg1d degs_factors;
-        Poly1d bjs;
-        for (auto& strt_factor : diag_json.at("rings")[isRing ? iCw : mods[iMod].iRing].at("plot_factors")[0]) {
-            int stem = strt_factor[0].get<int>(), s = strt_factor[1].get<int>(), i_factor = strt_factor[2].get<int>();
-            degs_factors.push_back(AdamsDeg(s, stem + s));
-            js["degs_factors"].push_back(json::array({stem, s}));
-            bjs.push_back(ring.basis.at(degs_factors.back())[i_factor]);
-        }
+            js.Key("degs_factors").BeginArray();
+            for (auto& f : factors)
+                for (AdamsDeg d : f.degs)
+                    js.Value(int1d{d.stem(), d.s});
+            js.EndArray();
+        };
 
-        if (isRing)
-            plotRingStrLines(nodes_ss, ring, deg2id, degs_factors, bjs, js, 1, false);
-        else
-            plotModuleStrLines(nodes_ss, mods[iMod], deg2id, degs_factors, bjs, js, 1, false);
-
-        // Products
-        degs_factors.clear();
-        bjs.clear();
-        for (auto& strt_factor : diag_json.at("rings")[isRing ? iCw : mods[iMod].iRing].at("plot_factors")[1]) {
-            int stem = strt_factor[0].get<int>(), s = strt_factor[1].get<int>(), i_factor = strt_factor[2].get<int>();
-            degs_factors.push_back(AdamsDeg(s, stem + s));
-            js["degs_factors"].push_back(json::array({stem, s}));
-            bjs.push_back(ring.basis.at(degs_factors.back())[i_factor]);
-        }
+        const auto radii = GetBulletRadii(nodes_ss);
+        auto write_body = [&](JsonWriter& js, int stem_min, int stem_max, bool with_id) {
+            /* ss */
+            js.Key("bullets").BeginArray();
+            if (isRing)
+                plotBullets(nodes_ss, &ring, radii, deg2id, js, stem_min, stem_max, with_id);
+            else
+                plotBullets(nodes_ss, &mods[iMod], radii, deg2id, js, stem_min, stem_max, with_id);
+            js.EndArray();
 
-        if (isRing)
-            plotRingStrLines(nodes_ss, ring, deg2id, degs_factors, bjs, js, 0, false);
-        else
-            plotModuleStrLines(nodes_ss, mods[iMod], deg2id, degs_factors, bjs, js, 0, false);
-
-        /* diff lines */
-        js["diffs"] = json::array();
-        for (auto& [deg, sc] : nodes_ss.front()) {
-            for (size_t i = 0; i < sc.levels.size(); ++i) {
-                int src = deg2id.at(deg) + (int)i;
-                if (sc.levels[i] > 9000 && sc.diffs[i] != NULL_DIFF) {
-                    int r = LEVEL_MAX - sc.levels[i];
-                    AdamsDeg deg_tgt = deg + AdamsDeg(r, r - 1);
-                    int1d tgt = lina::GetInvImage(nodes_ss.front().at(deg_tgt).basis, sc.diffs[i]);
-
-                    js["diffs"].push_back(json::object());
-                    auto& diff_json = js["diffs"].back();
-                    diff_json["i"] = src;
-                    diff_json["j"] = json::array();
-                    for (size_t l = 0; l < tgt.size(); ++l)
-                        diff_json["j"].push_back(deg2id.at(deg_tgt) + tgt[l]);
-                    diff_json["r"] = r;
+            /* struct lines */
+            js.Key("prods").BeginObject();
+            if (isRing)
+                plotRingStrLines(nodes_ss, ring, deg2id, factors, js, false, stem_min, stem_max);
+            else
+                plotModuleStrLines(nodes_ss, mods[iMod], deg2id, factors, js, false, stem_min, stem_max);
+            js.EndObject();
+
+            /* diff lines */
+            js.Key("diffs").BeginArray();
+            for (auto& [deg, sc] : nodes_ss.front()) {
+                if (deg.stem() < stem_min || deg.stem() > stem_max)
+                    continue;
+                for (size_t i = 0; i < sc.levels.size(); ++i) {
+                    int src = deg2id.at(deg) + (int)i;
+                    if (sc.levels[i] > 9000 && sc.diffs[i] != NULL_DIFF) {
+                        int r = LEVEL_MAX - sc.levels[i];
+                        AdamsDeg deg_tgt = deg + AdamsDeg(r, r - 1);
+                        int1d tgt = lina::GetInvImage(nodes_ss.front().at(deg_tgt).basis, sc.diffs[i]);
+                        for (int& j : tgt)
+                            j += deg2id.at(deg_tgt);
+                        js.BeginObject();
+                        js.Key("i").Value(src);
+                        js.Key("j").Value(tgt);
+                        js.Key("r").Value(r);
+                        js.EndObject();
+                    }
                 }
             }
-        }
+            js.EndArray();
 
-        /* unknown diff lines */
-        js["nds"] = json::array();
-        for (auto& [deg, sc] : nodes_ss.front()) {
-            if (deg.stem() <= 126) {
+            /* unknown diff lines */
+            js.Key("nds").BeginArray();
+            for (auto& [deg, sc] : nodes_ss.front()) {
+                if (deg.stem() < stem_min || deg.stem() > stem_max || deg.stem() > 126)
+                    continue;
                 for (size_t i = 0; i < sc.levels.size(); ++i) {
                     int src = deg2id.at(deg) + (int)i;
                     if (sc.levels[i] > 9000 && sc.diffs[i] == NULL_DIFF) {
-                        int r = LEVEL_MAX - sc.levels[i];
-                        js["nds"].push_back(json::object());
-                        auto& nd = js["nds"].back();
-                        nd["i"] = src;
-                        nd["r"] = r;
+                        js.BeginObject();
+                        js.Key("i").Value(src);
+                        js.Key("r").Value(LEVEL_MAX - sc.levels[i]);
+                        js.EndObject();
                     }
                 }
             }
+            js.EndArray();
+        };
+
+        if (tile <= 0) {
+            WriteJs(plot_dir + "/" + name + ".js", name, [&](JsonWriter& js) {
+                write_header(js);
+                write_body(js, INT_MIN, INT_MAX, false);
+                js.Key("time").Value(ut::get_time());
+            });
+            return;
         }
 
-        js["time"] = ut::get_time();
-
-        auto out = fmt::output_file(plot_dir + "/" + name + ".js");
-        out.print("globalThis.DATA_JSON_{} = {};\n", name, js.dump(1));
-    }
+        int stem_min = INT_MAX, stem_max = INT_MIN;
+        for (auto& [d, _] : nodes_ss.front()) {
+            stem_min = std::min(stem_min, d.stem());
+            stem_max = std::max(stem_max, d.stem());
+        }
+        std::vector<std::array<int, 2>> tiles;
+        for (int stem = stem_min; stem <= stem_max; stem += tile)
+            tiles.push_back({stem, std::min(stem + tile - 1, stem_max)});
+        WriteJs(plot_dir + "/" + name + ".js", name, [&](JsonWriter& js) {
+            write_header(js);
+            js.Key("tiles").BeginArray();
+            for (size_t k = 0; k < tiles.size(); ++k) {
+                js.BeginObject();
+                js.Key("stem_min").Value(tiles[k][0]);
+                js.Key("stem_max").Value(tiles[k][1]);
+                js.Key("name").Value(fmt::format("{}_tile{}", name, k));
+                js.EndObject();
+            }
+            js.EndArray();
+            js.Key("time").Value(ut::get_time());
+        });
+        for (size_t k = 0; k < tiles.size(); ++k) {
+            auto name_tile = fmt::format("{}_tile{}", name, k);
+            WriteJs(plot_dir + "/" + name_tile + ".js", name_tile, [&](JsonWriter& js) { write_body(js, tiles[k][0], tiles[k][1], true); });
+        }
+    });
 
     /*
     {
@@ -486,91 +703,43 @@ int main_plot_ss(int argc, char** argv, int& index, const char* desc)
       "maps": {"2": [0, 1]}
     }
     */
-    for (auto& map : maps) {
+    ut::for_each_par32_rethrow(maps.size(), [&](size_t iMap) {
+        auto& map = maps[iMap];
         if (map->IsMul())
-            continue;
+            return;
+        if (map->from.isRing && !map->to.isRing)
+            throw MyException(0x189448f, "Incorrect map type");
         size_t from = map->from.index, to = map->to.index;
-        json js;
-        js["type"] = "map";
-        js["maps"] = json::object();
-        auto& map_json = js["maps"];
-
-        if (map->from.isRing) {
-            if (!map->to.isRing)
-                throw MyException(0x189448f, "Incorrect map type");
-            auto& nodes_ss = rings[from].nodes_ss;
-            js["from"] = rings[from].name;
-            js["to"] = rings[to].name;
-            js["sus"] = 0;
-            auto& deg2id1 = all_deg2id[from];
-            auto& deg2id2 = all_deg2id[to];
+        size_t iCw_from = map->from.isRing ? from : from + rings.size();
+        size_t iCw_to = map->to.isRing ? to : to + rings.size();
+        auto& nodes_ss = map->from.isRing ? rings[from].nodes_ss : mods[from].nodes_ss;
+        auto& nodes_ss_to = map->to.isRing ? rings[to].nodes_ss : mods[to].nodes_ss;
+        auto& deg2id1 = all_deg2id[iCw_from];
+        auto& deg2id2 = all_deg2id[iCw_to];
+
+        WriteJs(plot_dir + "/" + map->name + ".js", map->name, [&](JsonWriter& js) {
+            js.Key("type").Value("map");
+            js.Key("from").Value(map->from.isRing ? rings[from].name : mods[from].name);
+            js.Key("to").Value(map->to.isRing ? rings[to].name : mods[to].name);
+            js.Key("sus").Value(map->from.isRing ? 0 : -map->deg.stem());
+            js.Key("maps").BeginObject();
             for (auto& [deg, sc] : nodes_ss.front()) {
-                if (deg.t > map->t_max)
+                if (OutOfRange(deg, map->t_max, map->stem_max))
                     break;
+                AdamsDeg deg_fx = map->from.isRing ? deg : deg + map->deg;
                 for (size_t i = 0; i < sc.levels.size(); ++i) {
                     int1d fx = map->map(sc.basis[i], deg, diagram);
                     if (!fx.empty()) {
-                        auto key = std::to_string(deg2id1.at(deg) + (int)i);
-                        map_json[key] = json::array();
-                        int1d fx_ss = lina::GetInvImage(rings[to].nodes_ss.front().at(deg).basis, fx);
-                        for (int j : fx_ss)
-                            map_json[key].push_back(deg2id2.at(deg) + j);
-                    }
-                }
-            }
-        }
-        else {
-            if (map->to.isRing) {
-                auto& nodes_ss = mods[from].nodes_ss;
-                js["from"] = mods[from].name;
-                js["to"] = rings[to].name;
-                js["sus"] = -map->deg.stem();
-                auto& deg2id1 = all_deg2id[from + rings.size()];
-                auto& deg2id2 = all_deg2id[to];
-                for (auto& [deg, sc] : nodes_ss.front()) {
-                    if (deg.t > map->t_max)
-                        break;
-                    AdamsDeg deg_fx = deg + map->deg;
-                    for (size_t i = 0; i < sc.levels.size(); ++i) {
-                        int1d fx = map->map(sc.basis[i], deg, diagram);
-                        if (!fx.empty()) {
-                            auto key = std::to_string(deg2id1.at(deg) + (int)i);
-                            map_json[key] = json::array();
-                            int1d fx_ss = lina::GetInvImage(rings[to].nodes_ss.front().at(deg_fx).basis, fx);
-                            for (int j : fx_ss)
-                                map_json[key].push_back(deg2id2.at(deg_fx) + j);
-                        }
-                    }
-                }
-            }
-            else {
-                auto& nodes_ss = mods[from].nodes_ss;
-                js["from"] = mods[from].name;
-                js["to"] = mods[to].name;
-                js["sus"] = -map->deg.stem();
-                auto& deg2id1 = all_deg2id[from + rings.size()];
-                auto& deg2id2 = all_deg2id[to + rings.size()];
-                for (auto& [deg, sc] : nodes_ss.front()) {
-                    if (deg.t > map->t_max)
-                        break;
-                    AdamsDeg deg_fx = deg + map->deg;
-                    for (size_t i = 0; i < sc.levels.size(); ++i) {
-                        int1d fx = map->map(sc.basis[i], deg, diagram);
-                        if (!fx.empty()) {
-                            auto key = std::to_string(deg2id1.at(deg) + (int)i);
-                            map_json[key] = json::array();
-                            int1d fx_ss = lina::GetInvImage(mods[to].nodes_ss.front().at(deg_fx).basis, fx);
-                            for (int j : fx_ss)
-                                map_json[key].push_back(deg2id2.at(deg_fx) + j);
-                        }
+                        int1d fx_ss = lina::GetInvImage(nodes_ss_to.front().at(deg_fx).basis, fx);
+                        for (int& j : fx_ss)
+                            j += deg2id2.at(deg_fx);
+                        js.Key(std::to_string(deg2id1.at(deg) + (int)i)).Value(fx_ss);
                     }
                 }
             }
-        }
-
-        auto out = fmt::output_file(plot_dir + "/" + map->name + ".js");
-        out.print("globalThis.DATA_JSON_{} = {};\n", map->name, js.dump(1));
-    }
+            js.EndObject();
+        });
+    });
 
     return 0;
 }
@@ -615,96 +784,101 @@ int main_plot_cofseq(int argc, char** argv, int& index, const char* desc)
     }
     */
 
-    for (auto& cofseq : cofseqs) {
-        json js;
-        js["type"] = "cofseq";
-        js["names"] = cofseq.nameCw;
-        js["degs_maps"] = {{cofseq.degMap[0].stem(), cofseq.degMap[0].s}, {cofseq.degMap[1].stem(), cofseq.degMap[1].s}, {cofseq.degMap[2].stem(), cofseq.degMap[2].s}};
-        js["cofseq_groups"] = {json::object(), json::object(), json::object()};
-        for (size_t iCs = 0; iCs < cofseq.degMap.size(); ++iCs) {
-            /* ss */
-
-            auto& jsi = js["cofseq_groups"][iCs];
-            jsi["type"] = "cofseq_gp";
-
-            const auto& nodes_ss = *cofseq.nodes_ss[iCs];
-            const auto& nodes_cofseq = cofseq.nodes_cofseq[iCs];
-            std::map<AdamsDeg, int> deg2id_ss = get_deg2id(nodes_ss);
-            std::map<AdamsDeg, int> deg2id_cofseq = get_deg2id(nodes_cofseq);
-
-            plotBullets(cofseq, iCs, diagram, deg2id_ss, jsi);
-
-            /* struct lines */
-            jsi["degs_factors"] = json::array();
-            jsi["prods"] = json::object();
-            AdamsDeg1d degs_factors;
-            Poly1d bjs;
-            std::map<AdamsDeg, int> deg2id_ring;
-            size_t iRing = cofseq.indexCw[iCs].isRing ? cofseq.indexCw[iCs].index : mods[cofseq.indexCw[iCs].index].iRing;
-            if (cofseq.indexCw[iCs].isRing)
-                deg2id_ring = deg2id_ss;
-            else
-                deg2id_ring = get_deg2id(rings[iRing].nodes_ss);
-            for (auto& strt_factor : diag_json.at("rings")[iRing].at("plot_factors")[0]) {
-                int stem = strt_factor[0].get<int>();
-                if (stem != 0)
-                    continue;
-                int s = strt_factor[1].get<int>(), i_factor = strt_factor[2].get<int>();
-                degs_factors.push_back(AdamsDeg(s, stem + s));
-                bjs.push_back(rings[iRing].basis.at(degs_factors.back())[i_factor]);
-            }
-
-            if (auto iCw = cofseq.indexCw[iCs]; iCw.isRing)
-                plotRingStrLines(nodes_cofseq, rings[iCw.index], deg2id_cofseq, degs_factors, bjs, jsi, 1, true);
-            else
-                plotModuleStrLines(nodes_cofseq, mods[iCw.index], deg2id_cofseq, degs_factors, bjs, jsi, 1, true);
-
-            /* diff lines */
-            jsi["diffs"] = json::array();
-            int stem_map = cofseq.degMap[iCs].stem();
-            const auto& nodes_cofseq_next = cofseq.nodes_cofseq[(iCs + 1) % 3];
-            std::map<AdamsDeg, int> deg2id_cofseq_next = get_deg2id(nodes_cofseq_next);
-            for (auto& [deg, sc] : nodes_cofseq.front()) {
-                for (size_t i = 0; i < sc.levels.size(); ++i) {
-                    int src = deg2id_cofseq.at(deg) + (int)i;
-                    if (sc.levels[i] > 9000 && sc.diffs[i] != NULL_DIFF) {
-                        int r = LEVEL_MAX - sc.levels[i];
-                        AdamsDeg deg_tgt = deg + AdamsDeg(r, stem_map + r);
-                        int1d tgt = lina::GetInvImage(nodes_cofseq_next.front().at(deg_tgt).basis, Residue(sc.diffs[i], *cofseq.nodes_ss[(iCs + 1) % 3], deg_tgt, LEVEL_PERM));
-
-                        jsi["diffs"].push_back(json::object());
-                        auto& diff_json = jsi["diffs"].back();
-                        diff_json["i"] = src;
-                        diff_json["j"] = json::array();
-                        for (size_t l = 0; l < tgt.size(); ++l)
-                            diff_json["j"].push_back(deg2id_cofseq_next.at(deg_tgt) + tgt[l]);
-                        diff_json["r"] = r;
-                    }
+    /* Every cofseq is written to its own file in parallel */
+    ut::for_each_par32_rethrow(cofseqs.size(), [&](size_t iCof) {
+        auto& cofseq = cofseqs[iCof];
+        WriteJs(plot_dir + "/" + cofseq.name + ".js", cofseq.name, [&](JsonWriter& js) {
+            js.Key("type").Value("cofseq");
+            js.Key("names").BeginArray();
+            for (auto& name : cofseq.nameCw)
+                js.Value(name);
+            js.EndArray();
+            js.Key("degs_maps").BeginArray();
+            for (AdamsDeg d : cofseq.degMap)
+                js.Value(int1d{d.stem(), d.s});
+            js.EndArray();
+
+            js.Key("cofseq_groups").BeginArray();
+            for (size_t iCs = 0; iCs < cofseq.degMap.size(); ++iCs) {
+                js.BeginObject();
+                js.Key("type").Value("cofseq_gp");
+
+                /* ss */
+                const auto& nodes_ss = *cofseq.nodes_ss[iCs];
+                const auto& nodes_cofseq = cofseq.nodes_cofseq[iCs];
+                std::map<AdamsDeg, int> deg2id_ss = get_deg2id(nodes_ss);
+                std::map<AdamsDeg, int> deg2id_cofseq = get_deg2id(nodes_cofseq);
+
+                plotBullets(cofseq, iCs, diagram, deg2id_ss, js);
+
+                /* struct lines */
+                js.Key("degs_factors").BeginArray();
+                js.EndArray();
+                std::vector<StrLineFactors> factors(1);
+                factors[0].forStrl = 1;
+                size_t iRing = cofseq.indexCw[iCs].isRing ? cofseq.indexCw[iCs].index : mods[cofseq.indexCw[iCs].index].iRing;
+                for (auto& strt_factor : diag_json.at("rings")[iRing].at("plot_factors")[0]) {
+                    int stem = strt_factor[0].get<int>();
+                    if (stem != 0)
+                        continue;
+                    int s = strt_factor[1].get<int>(), i_factor = strt_factor[2].get<int>();
+                    factors[0].degs.push_back(AdamsDeg(s, stem + s));
+                    factors[0].bjs.push_back(rings[iRing].basis->at(factors[0].degs.back())[i_factor]);
                 }
-            }
 
-            /* unknown diff lines */
-            jsi["nds"] = json::array();
-            for (auto& [deg, sc] : nodes_cofseq.front()) {
-                if (deg.stem() <= 126) {
+                js.Key("prods").BeginObject();
+                if (auto iCw = cofseq.indexCw[iCs]; iCw.isRing)
+                    plotRingStrLines(nodes_cofseq, rings[iCw.index], deg2id_cofseq, factors, js, true, INT_MIN, INT_MAX);
+                else
+                    plotModuleStrLines(nodes_cofseq, mods[iCw.index], deg2id_cofseq, factors, js, true, INT_MIN, INT_MAX);
+                js.EndObject();
+
+                /* diff lines */
+                js.Key("diffs").BeginArray();
+                int stem_map = cofseq.degMap[iCs].stem();
+                const auto& nodes_cofseq_next = cofseq.nodes_cofseq[(iCs + 1) % 3];
+                std::map<AdamsDeg, int> deg2id_cofseq_next = get_deg2id(nodes_cofseq_next);
+                for (auto& [deg, sc] : nodes_cofseq.front()) {
                     for (size_t i = 0; i < sc.levels.size(); ++i) {
                         int src = deg2id_cofseq.at(deg) + (int)i;
-                        if (sc.levels[i] > 9000 && sc.diffs[i] == NULL_DIFF) {
+                        if (sc.levels[i] > 9000 && sc.diffs[i] != NULL_DIFF) {
                             int r = LEVEL_MAX - sc.levels[i];
-                            jsi["nds"].push_back(json::object());
-                            auto& nd = jsi["nds"].back();
-                            nd["i"] = src;
-                            nd["r"] = r;
+                            AdamsDeg deg_tgt = deg + AdamsDeg(r, stem_map + r);
+                            int1d tgt = lina::GetInvImage(nodes_cofseq_next.front().at(deg_tgt).basis, Residue(sc.diffs[i], *cofseq.nodes_ss[(iCs + 1) % 3], deg_tgt, LEVEL_PERM));
+                            for (int& j : tgt)
+                                j += deg2id_cofseq_next.at(deg_tgt);
+                            js.BeginObject();
+                            js.Key("i").Value(src);
+                            js.Key("j").Value(tgt);
+                            js.Key("r").Value(r);
+                            js.EndObject();
                         }
                     }
                 }
+                js.EndArray();
+
+                /* unknown diff lines */
+                js.Key("nds").BeginArray();
+                for (auto& [deg, sc] : nodes_cofseq.front()) {
+                    if (deg.stem() <= 126) {
+                        for (size_t i = 0; i < sc.levels.size(); ++i) {
+                            int src = deg2id_cofseq.at(deg) + (int)i;
+                            if (sc.levels[i] > 9000 && sc.diffs[i] == NULL_DIFF) {
+                                js.BeginObject();
+                                js.Key("i").Value(src);
+                                js.Key("r").Value(LEVEL_MAX - sc.levels[i]);
+                                js.EndObject();
+                            }
+                        }
+                    }
+                }
+                js.EndArray();
+                js.EndObject();
             }
-        }
-
-        js["time"] = ut::get_time();
-        auto out = fmt::output_file(plot_dir + "/" + cofseq.name + ".js");
-        out.print("globalThis.DATA_JSON_{} = {};\n", cofseq.name, js.dump(1));
-    }
+            js.EndArray();
+            js.Key("time").Value(ut::get_time());
+        });
+    });
 
     return 0;
 }
@@ -1275,7 +1449,7 @@ GenCell TopCell(const Mod& p, const GenCell1d& gen_cells, const RingSp& ring)
         if (gen_cells[m.v].poly.data.size() > 10000) {
             fmt::print("{} {}\n", m.v, gen_cells[m.v].cell);
         }
-        auto poly = ring.gb.Reduce(m.m * gen_cells[m.v].poly);
+        auto poly = ring.gb->Reduce(m.m * gen_cells[m.v].poly);
         if (poly)
             cells.push_back(GenCell{gen_cells[m.v].cell, std::move(poly)});
     }
@@ -1362,7 +1536,7 @@ int main_name_pullback(int argc, char** argv, int& index, const char* desc)
         std::map<AdamsDeg, int> gen_index;
         for (size_t i = 0; i < gen_names.size(); ++i) {
             AdamsDeg deg = gen_degs[i];
-            if (deg.t > map->t_max)
+            if (OutOfRange(deg, map->t_max, map->stem_max))
 				continue;
             ++gen_index[deg];
             if (!gen_names[i].empty())
@@ -1456,9 +1630,9 @@ int main_name_pushforward(int argc, char** argv, int& index, const char* desc)
 
                 for (size_t iMap : ring.ind_maps) {
                     auto& map = maps[iMap];
-                    if (deg.t <= map->t_max) {
+                    if (!OutOfRange(deg, map->t_max, map->stem_max)) {
                         auto& f = std::get<MapRing2Ring>(map.map);
-                        auto& f_gen = rings[to].gb.Reduce(f.images[i]);
+                        auto& f_gen = rings[to].gb->Reduce(f.images[i]);
                         auto& gen_names_tgt = gen_names_rings[to];
                         if (f_gen && IsNamed(f_gen, gen_names_tgt)) {
                             gen_names[i] = StrPoly(f_gen, gen_names_tgt);
@@ -1489,7 +1663,7 @@ int main_name_pushforward(int argc, char** argv, int& index, const char* desc)
                         ++iMap_json;
                     if (!diag_json.at("maps")[iMap_json].contains("type") || diag_json.at("maps")[iMap_json].at("type") != "skeleton")
                         continue;
-                    if (deg.t > map->t_max)
+                    if (OutOfRange(deg, map->t_max, map->stem_max))
                         continue;
                     if (map->deg.s != 0)
                         continue;
@@ -1502,7 +1676,7 @@ int main_name_pushforward(int argc, char** argv, int& index, const char* desc)
                     if (std::all_of(indices_tgt.begin(), indices_tgt.end(), [&gen_names_tgt](int i) { return !gen_names_tgt[i].empty(); }))
                         continue;
                     int2d fxs, image, kernel, g;
-                    for (size_t i = 0; i < mod.basis.at(deg).size(); ++i)
+                    for (size_t i = 0; i < mod.basis->at(deg).size(); ++i)
                         fxs.push_back(map->map({int(i)}, deg, diagram));
                     lina::SetLinearMap(fxs, image, kernel, g);
 
@@ -1513,10 +1687,10 @@ int main_name_pushforward(int argc, char** argv, int& index, const char* desc)
                         if (!gen_names_tgt[i].empty())
                             continue;
                         MMod mi({}, i);
-                        int1d fx = Mod2Indices(mi, mod_tgt.basis.at(deg_tgt));
+                        int1d fx = Mod2Indices(mi, mod_tgt.basis->at(deg_tgt));
                         if (lina::Residue(image, fx).empty()) {
                             int1d x = lina::GetImage(image, g, fx);
-                            Mod x_alg = Indices2Mod(x, mod.basis.at(deg));
+                            Mod x_alg = Indices2Mod(x, mod.basis->at(deg));
                             if (IsNamed(x_alg, gen_cells, gen_names)) {
                                 auto gen_cell = TopCell(x_alg, gen_cells, rings[mod.iRing]);
                                 if (gen_cell.cell != -1 && IsNamed(gen_cell.poly, gen_names_rings[mod.iRing])) {
@@ -0,0 +1,365 @@
+#include "main.h"
+#include "mylog.h"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <optional>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+/*
+ * `ss serve <diagram>` keeps the diagram in memory and runs the usual subcommands sent by `ss client`.
+ *
+ * Protocol: one json object per line in each direction over the Unix socket <diagram>/ss.sock
+ *   {"args": ["deduce", "diff", "0", "80", "<diagram>"]}  -> {"code": 0, "output": "..."}
+ *   {"op": "save"} / {"op": "status"} / {"op": "shutdown"} -> {"code": 0, "output": "..."}
+ *
+ * Subcommands that open their diagram with OpenDiagram() use the resident copy and their saves are deferred.
+ * The server writes them back every `save_interval` seconds, on {"op": "save"} and on shutdown.
+ * The changes of a subcommand that fails or does not save (e.g. `add_diff ... try`) are discarded as in its own process.
+ */
+
+int RunSubCmd(int argc, char** argv);
+
+namespace {
+
+/* Flags that change what the constructor of Diagram loads */
+constexpr uint32_t LOAD_FLAGS = uint32_t(SSFlag::cofseq) | uint32_t(SSFlag::pi) | uint32_t(SSFlag::pi_def) | uint32_t(SSFlag::depth_ss_cofseq) | uint32_t(SSFlag::naming) | uint32_t(SSFlag::cache_contra) |
+                             uint32_t(SSFlag::full_sync) | uint32_t(SSFlag::check_sync);
+
+struct Resident
+{
+    std::unique_ptr<Diagram> diagram;
+    std::string diagram_name;
+    std::string path; /* Canonical path of diagram_name */
+    SSFlag flag = SSFlag::no_op;
+    std::optional<DiagramCheckpoint> checkpoint; /* The diagram after the last kept command */
+    size_t count_saves = 0;                      /* diagram->GetCountSaves() at the checkpoint */
+    size_t count_commands = 0;                   /* Commands since the last save */
+};
+Resident resident;
+
+std::string CanonicalPath(const std::string& diagram_name)
+{
+    std::error_code ec;
+    auto path = std::filesystem::weakly_canonical(diagram_name, ec);
+    return ec ? diagram_name : path.string();
+}
+
+void LoadResident(SSFlag flag)
+{
+    resident.diagram = std::make_unique<Diagram>(resident.diagram_name, flag);
+    resident.diagram->SetDeferSave(true);
+    resident.flag = flag;
+    resident.checkpoint = resident.diagram->MakeCheckpoint();
+    resident.count_saves = resident.diagram->GetCountSaves();
+}
+
+void SaveResident()
+{
+    if (resident.diagram && resident.diagram->IsSavePending()) {
+        resident.diagram->SavePending(resident.diagram_name);
+        resident.checkpoint = resident.diagram->MakeCheckpoint(); /* Without the pending save and the unsaved marks */
+        resident.count_commands = 0;
+    }
+}
+
+}  // namespace
+
+Diagram& OpenDiagram(const std::string& diagram_name, SSFlag flag, std::unique_ptr<Diagram>& holder)
+{
+    if (!resident.path.empty() && CanonicalPath(diagram_name) == resident.path) {
+        uint32_t load_flag = uint32_t(flag) & LOAD_FLAGS;
+        if (!resident.diagram || (load_flag & ~uint32_t(resident.flag))) {
+            SaveResident();
+            LoadResident(SSFlag(uint32_t(resident.flag) | load_flag));
+        }
+        resident.diagram->ResetDeduceList();
+        return *resident.diagram;
+    }
+    holder = std::make_unique<Diagram>(diagram_name, flag);
+    return *holder;
+}
+
+#ifdef _WIN32
+
+int main_serve(int argc, char** argv, int& index, const char* desc)
+{
+    fmt::print("ss serve requires Unix domain sockets\n");
+    return -1;
+}
+
+int main_client(int argc, char** argv, int& index, const char* desc)
+{
+    fmt::print("ss client requires Unix domain sockets\n");
+    return -1;
+}
+
+#else
+
+namespace {
+
+volatile std::sig_atomic_t g_stop = 0;
+
+void OnSignal(int)
+{
+    g_stop = 1;
+}
+
+sockaddr_un SocketAddress(const std::string& diagram_name)
+{
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    std::string path = fmt::format("{}/ss.sock", diagram_name);
+    if (path.size() >= sizeof(addr.sun_path))
+        throw MyException(0x5b0e3a71U, "Socket path too long: " + path);
+    std::strcpy(addr.sun_path, path.c_str());
+    return addr;
+}
+
+bool SendLine(int fd, const std::string& line)
+{
+    std::string buffer = line + '\n';
+    size_t sent = 0;
+    while (sent < buffer.size()) {
+        ssize_t n = send(fd, buffer.data() + sent, buffer.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        sent += (size_t)n;
+    }
+    return true;
+}
+
+/* Return false on EOF */
+bool RecvLine(int fd, std::string& buffer, std::string& line)
+{
+    size_t pos;
+    while ((pos = buffer.find('\n')) == std::string::npos) {
+        char chunk[4096];
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0)
+            return false;
+        buffer.append(chunk, (size_t)n);
+    }
+    line = buffer.substr(0, pos);
+    buffer.erase(0, pos + 1);
+    return true;
+}
+
+/* Run `f` with stdout redirected into the returned string */
+template <typename Fn>
+std::string CaptureStdout(Fn f)
+{
+    std::fflush(stdout);
+    std::cout.flush();
+    int saved = dup(STDOUT_FILENO);
+    FILE* tmp = std::tmpfile();
+    dup2(fileno(tmp), STDOUT_FILENO);
+    auto restore = [&]() {
+        std::fflush(stdout);
+        std::cout.flush();
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+    };
+    try {
+        f();
+    }
+    catch (...) {
+        restore();
+        std::fclose(tmp);
+        throw;
+    }
+    restore();
+    std::string output;
+    std::rewind(tmp);
+    char chunk[4096];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), tmp)) > 0)
+        output.append(chunk, n);
+    std::fclose(tmp);
+    return output;
+}
+
+nlohmann::json RunRequest(const nlohmann::json& request, bool& stop)
+{
+    nlohmann::json response = {{"code", 0}, {"output", ""}};
+    if (request.contains("op")) {
+        auto op = request.at("op").get<std::string>();
+        if (op == "save") {
+            response["output"] = CaptureStdout(SaveResident);
+        }
+        else if (op == "status") {
+            response["output"] = fmt::format("diagram={} loaded={} unsaved_commands={}\n", resident.diagram_name, bool(resident.diagram), resident.count_commands);
+        }
+        else if (op == "shutdown") {
+            response["output"] = CaptureStdout(SaveResident);
+            stop = true;
+        }
+        else {
+            response["code"] = -1;
+            response["output"] = fmt::format("Unknown op={}\n", op);
+        }
+        return response;
+    }
+
+    auto args = request.at("args").get<std::vector<std::string>>();
+    if (args.empty() || args[0] == "serve" || args[0] == "client") {
+        response["code"] = -1;
+        response["output"] = "Invalid command\n";
+        return response;
+    }
+    args.insert(args.begin(), PROGRAM);
+    std::vector<char*> argv;
+    for (auto& arg : args)
+        argv.push_back(arg.data());
+    argv.push_back(nullptr);
+
+    int code = 0;
+    /* Keep the changes of the command if it saved and roll them back otherwise */
+    auto keep_or_discard = [](bool failed) {
+        if (!resident.diagram)
+            return "";
+        if (!failed && resident.diagram->GetCountSaves() != resident.count_saves) {
+            resident.checkpoint = resident.diagram->MakeCheckpoint();
+            resident.count_saves = resident.diagram->GetCountSaves();
+            ++resident.count_commands;
+            return "";
+        }
+        resident.diagram->Restore(*resident.checkpoint);
+        return failed ? "The changes of the command to the resident diagram were discarded\n" : "";
+    };
+    try {
+        response["output"] = CaptureStdout([&]() {
+            Logger::LogCmd((int)args.size(), argv.data());
+            bench::Timer timer;
+            code = RunSubCmd((int)args.size(), argv.data());
+            if (code == 0)
+                Logger::LogTime(timer.print2str());
+        });
+        keep_or_discard(false);
+    }
+    catch (MyException& e) {
+        code = -1;
+        response["output"] = fmt::format("MyException({:#x}): {}\n{}", e.id(), e.what(), keep_or_discard(true));
+    }
+    catch (std::exception& e) {
+        code = -1;
+        response["output"] = fmt::format("Exception: {}\n{}", e.what(), keep_or_discard(true));
+    }
+    response["code"] = code;
+    return response;
+}
+
+}  // namespace
+
+int main_serve(int argc, char** argv, int& index, const char* desc)
+{
+    std::string diagram_name;
+    int save_interval = 60;
+
+    myio::CmdArg1d args = {{"diagram", &diagram_name}};
+    myio::CmdArg1d op_args = {{"save_interval", &save_interval}};
+    if (int error = myio::ParseArguments(argc, argv, index, PROGRAM, desc, VERSION, args, op_args))
+        return error;
+
+    resident.diagram_name = diagram_name;
+    resident.path = CanonicalPath(diagram_name);
+    LoadResident(SSFlag::no_op);
+
+    sockaddr_un addr = SocketAddress(diagram_name);
+    int fd_listen = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_listen < 0)
+        throw MyException(0x1c8f5e02U, "Cannot create socket");
+    unlink(addr.sun_path);
+    if (bind(fd_listen, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd_listen, 8) < 0) {
+        close(fd_listen);
+        throw MyException(0x6e4a9d13U, fmt::format("Cannot listen on {}", addr.sun_path));
+    }
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+    fmt::print("Serving {} on {}\n", diagram_name, addr.sun_path);
+    std::fflush(stdout);
+
+    using clock = std::chrono::steady_clock;
+    auto last_save = clock::now();
+    bool stop = false;
+    while (!stop && !g_stop) {
+        int timeout = -1;
+        if (resident.diagram && resident.diagram->IsSavePending()) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - last_save).count();
+            timeout = (int)std::max<int64_t>(0, (int64_t)save_interval * 1000 - elapsed);
+        }
+        pollfd pfd = {fd_listen, POLLIN, 0};
+        int ready = poll(&pfd, 1, timeout);
+        if (ready > 0) {
+            int fd = accept(fd_listen, nullptr, nullptr);
+            if (fd >= 0) {
+                std::string buffer, line;
+                while (!stop && RecvLine(fd, buffer, line)) {
+                    nlohmann::json response;
+                    try {
+                        response = RunRequest(nlohmann::json::parse(line), stop);
+                    }
+                    catch (nlohmann::detail::exception& e) {
+                        response = {{"code", -1}, {"output", fmt::format("JsonError({}): {}\n", e.id, e.what())}};
+                    }
+                    if (!SendLine(fd, response.dump()))
+                        break;
+                }
+                close(fd);
+            }
+        }
+        if (resident.diagram && resident.diagram->IsSavePending() && clock::now() - last_save >= std::chrono::seconds(save_interval)) {
+            SaveResident();
+            last_save = clock::now();
+        }
+    }
+    SaveResident();
+    close(fd_listen);
+    unlink(addr.sun_path);
+    return 0;
+}
+
+int main_client(int argc, char** argv, int& index, const char* desc)
+{
+    std::string diagram_name;
+    std::vector<std::string> cmd;
+
+    myio::CmdArg1d args = {{"diagram", &diagram_name}};
+    myio::CmdArg1d op_args = {{"cmd...", &cmd}};
+    if (int error = myio::ParseArguments(argc, argv, index, PROGRAM, desc, VERSION, args, op_args))
+        return error;
+
+    nlohmann::json request;
+    if (cmd.size() == 1 && (cmd[0] == "save" || cmd[0] == "status" || cmd[0] == "shutdown"))
+        request["op"] = cmd[0];
+    else
+        request["args"] = cmd;
+
+    sockaddr_un addr = SocketAddress(diagram_name);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        fmt::print("Cannot connect to {}. Is ss serve running?\n", addr.sun_path);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    std::string buffer, line;
+    if (!SendLine(fd, request.dump()) || !RecvLine(fd, buffer, line)) {
+        close(fd);
+        fmt::print("Connection to {} closed\n", addr.sun_path);
+        return -1;
+    }
+    close(fd);
+    auto response = nlohmann::json::parse(line);
+    fmt::print("{}", response.at("output").get<std::string>());
+    return response.at("code").get<int>();
+}
+
+#endif
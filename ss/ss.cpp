@@ -13,9 +13,11 @@ void pop_front(Staircase& sc)
 bool IsPossTgt(const Staircases1d& nodes_ss, AdamsDeg deg, int r_max)
 {
     r_max = std::min(r_max, deg.s);
+    if (deg.stem() >= nodes_ss.stem_max() && r_max >= LEVEL_MIN)
+        return true;
     for (int r1 = LEVEL_MIN; r1 <= r_max; ++r1) {
         AdamsDeg d_src = deg - AdamsDeg{r1, r1 - 1};
-        if (ut::has(nodes_ss.front(), d_src) && GetMaxLevelWithND(ut::GetRecentValue(nodes_ss, d_src)) >= LEVEL_MAX - r1)
+        if (ut::has(nodes_ss.front(), d_src) && GetMaxLevelWithND(nodes_ss.GetRecentValue(d_src)) >= LEVEL_MAX - r1)
             return true;
     }
     return false;
@@ -23,7 +25,7 @@ bool IsPossTgt(const Staircases1d& nodes_ss, AdamsDeg deg, int r_max)
 
 size_t GetFirstIndexOfFixedLevels(const Staircases1d& nodes_ss, AdamsDeg deg, int level_min)
 {
-    const auto& sc = ut::GetRecentValue(nodes_ss, deg);
+    const auto& sc = nodes_ss.GetRecentValue(deg);
     size_t result = sc.levels.size();
     for (size_t i = sc.levels.size(); i-- > 0;) {
         if (sc.diffs[i] == NULL_DIFF || sc.levels[i] < level_min)
@@ -41,7 +43,7 @@ size_t GetFirstIndexOfFixedLevels(const Staircases1d& nodes_ss, AdamsDeg deg, in
 
 int Diagram::GetFirstFixedLevelForPlot(const Staircases1d& nodes_ss, AdamsDeg deg)
 {
-    const auto& sc = ut::GetRecentValue(nodes_ss, deg);
+    const auto& sc = nodes_ss.GetRecentValue(deg);
     int result = LEVEL_MAX - LEVEL_MIN;
     for (size_t i = sc.levels.size(); i-- > 0 && sc.levels[i] >= LEVEL_PERM;) {
         if (i == 0 || sc.levels[i - 1] != sc.levels[i]) {
@@ -59,11 +61,11 @@ std::pair<int, int> Diagram::CountPossDrTgt(const Staircases1d& nodes_ss, int t_
 {
     std::pair<int, int> result;
     if (ut::has(nodes_ss.front(), deg_tgt)) {
-        const auto& sc_tgt = ut::GetRecentValue(nodes_ss, deg_tgt);
+        const auto& sc_tgt = nodes_ss.GetRecentValue(deg_tgt);
         result.first = (int)GetFirstIndexOnLevel(sc_tgt, r);
         result.second = (int)GetFirstIndexOfFixedLevels(nodes_ss, deg_tgt, LEVEL_MAX - r) - result.first;
     }
-    else if (deg_tgt.t > t_max)
+    else if (OutOfRange(deg_tgt, t_max, nodes_ss.stem_max()))
         result = {-1, 100000}; /* Infinitely many possibilities */
     else
         result = {-1, 0};
@@ -74,10 +76,12 @@ std::pair<int, int> Diagram::CountPossDrSrc(const Staircases1d& nodes_ss, const
 {
     std::pair<int, int> result;
     if (ut::has(nodes_ss.front(), deg_src)) {
-        const auto& sc_src = ut::GetRecentValue(nodes_ss, deg_src);
+        const auto& sc_src = nodes_ss.GetRecentValue(deg_src);
         result.first = (int)GetFirstIndexOnLevel(sc_src, LEVEL_MAX - r);
         result.second = (int)GetFirstIndexOfFixedLevels(nodes_ss, deg_src, LEVEL_MAX - r) - result.first;
     }
+    else if (deg_src.stem() > nodes_ss.stem_max())
+        result = {-1, 100000}; /* Infinitely many possibilities */
     else
         result = {-1, 0};
     return result;
@@ -87,7 +91,7 @@ int Diagram::NextRTgt(const Staircases1d& nodes_ss, int t_max, AdamsDeg deg, int
 {
     for (int r1 = r; r1 <= R_PERM; ++r1) {
         AdamsDeg d_tgt = deg + AdamsDeg{r1, r1 - 1};
-        if (d_tgt.t > t_max)
+        if (OutOfRange(d_tgt, t_max, nodes_ss.stem_max()))
             return r1;
         if (r1 >= 20 && AboveJ(d_tgt) && BelowCokerJ(deg)) /* Image of J */
             return R_PERM;
@@ -115,7 +119,7 @@ int Diagram::NextRSrc(const Staircases1d& nodes_ss, AdamsDeg deg, int r) const
 void Diagram::CacheNullDiffs(const Staircases1d& nodes_ss, int t_max, AdamsDeg deg, SSFlag flag, NullDiff1d& nds) const
 {
     nds.clear();
-    const auto& sc = ut::GetRecentValue(nodes_ss, deg);
+    const auto& sc = nodes_ss.GetRecentValue(deg);
     for (size_t i = 0; i < sc.diffs.size(); ++i) {
         if (sc.diffs[i] != NULL_DIFF)
             continue;
@@ -174,7 +178,7 @@ int1d Diagram::GetDiff(const Staircases1d& nodes_ss, AdamsDeg deg_x, const int1d
     int1d result;
     if (x.empty())
         return result;
-    const auto& sc = ut::GetRecentValue(nodes_ss, deg_x);
+    const auto& sc = nodes_ss.GetRecentValue(deg_x);
     size_t first = GetFirstIndexOnLevel(sc, LEVEL_MAX - r);
     size_t last = GetFirstIndexOfNullOnLevel(sc, LEVEL_MAX - r);
     /* Compute x mod [0,first) */
@@ -197,7 +201,7 @@ int1d GetLevelAndDiff(const Staircases1d& nodes_ss, AdamsDeg deg_x, int1d x, int
     MyException::Assert(!x.empty(), "GetLevelAndDiff() para: !x.empty()");
 #endif
 
-    const auto& sc = ut::GetRecentValue(nodes_ss, deg_x);
+    const auto& sc = nodes_ss.GetRecentValue(deg_x);
     for (size_t i = 0; i < sc.levels.size(); ++i) {
         if (sc.levels[i] != level) {
             level = sc.levels[i];
@@ -225,12 +229,12 @@ bool Diagram::IsNewDiff(const Staircases1d& nodes_ss, AdamsDeg deg_x, const int1
 {
     AdamsDeg deg_dx = deg_x + AdamsDeg{r, r - 1};
     if (x.empty())
-        return !dx.empty() && !IsZeroOnLevel(ut::GetRecentValue(nodes_ss, deg_dx), dx, r);
+        return !dx.empty() && !IsZeroOnLevel(nodes_ss.GetRecentValue(deg_dx), dx, r);
     int1d dx1 = GetDiff(nodes_ss, deg_x, x, r);  //// TODO: optimize the allocation
     if (dx1 == NULL_DIFF)
         return true;
     int1d diff = lina::add(dx, dx1);
-    return !diff.empty() && !IsZeroOnLevel(ut::GetRecentValue(nodes_ss, deg_dx), diff, r);
+    return !diff.empty() && !IsZeroOnLevel(nodes_ss.GetRecentValue(deg_dx), diff, r);
 }
 
 /* Return the minimal length of the crossing differentials */
@@ -248,7 +252,7 @@ int GetCrossR(const Staircases1d& nodes_ss, AdamsDeg deg, int t_max, int Er)
                 return result;
             continue;
         }
-        auto& sc = ut::GetRecentValue(nodes_ss, deg_x);
+        auto& sc = nodes_ss.GetRecentValue(deg_x);
         if (!sc.levels.empty() && sc.levels.back() > LEVEL_MAX / 2) {
             int r1 = LEVEL_MAX - sc.levels.back();
             if (r + r1 < result)
@@ -280,7 +284,7 @@ void Diagram::SetDiffSc(IndexCw iCw, AdamsDeg deg_x, const int1d& x_, const int1
         return;
     }
     auto& nodes_ss = GetSS(iCw);
-    const auto& sc = ut::GetRecentValue(nodes_ss, deg_x);
+    const auto& sc = nodes_ss.GetRecentValue(deg_x);
     size_t first_Nmr = GetFirstIndexOnLevel(sc, LEVEL_MAX - r);
     int1d x = lina::Residue(sc.basis.begin(), sc.basis.begin() + first_Nmr, x_);
     if (x.empty()) {
@@ -307,6 +311,8 @@ void Diagram::SetDiffSc(IndexCw iCw, AdamsDeg deg_x, const int1d& x_, const int1
         /* Otherwise insert it to the beginning of level N-r */
         UpdateStaircase(nodes_ss, deg_x, sc, first_Nmr, x, dx, LEVEL_MAX - r, image_new, level_image_new);
     }
+    if (!x.empty())
+        MarkDirty(iCw, deg_x);
 
     /* ss to cofseq */
     if ((flag & SSFlag::cofseq) && r == R_PERM) {
@@ -314,11 +320,12 @@ void Diagram::SetDiffSc(IndexCw iCw, AdamsDeg deg_x, const int1d& x_, const int1
         for (auto& ind_cof : ind_cofs) {
             auto& cofseq = cofseqs_[ind_cof.iCof];
             auto iCs = (size_t)ind_cof.iCs;
-            if (!ut::has(cofseq.nodes_cofseq[iCs].front(), deg_x))
-                cofseq.nodes_cofseq[iCs].front()[deg_x] = {};
+            cofseq.nodes_cofseq[iCs].AddToFront(deg_x);
             SetDiffScCofseq(cofseq, ind_cof.iCs, deg_x, x, NULL_DIFF, 0, flag);
         }
     }
+    else if (r == R_PERM)
+        MarkUnsyncedCofseq(iCw, deg_x);
 
     if (level_image_new != -1) {
         if (level_image_new < LEVEL_MAX / 2) {
@@ -349,7 +356,7 @@ void Diagram::SetImageSc(IndexCw iCw, AdamsDeg deg_dx, const int1d& dx_, const i
     //     throw InteruptAndSaveException(0, "bug");
 
     /* If dx is in Im(d_{r-1}) then x is in Ker(d_r) */
-    const auto& sc = ut::GetRecentValue(nodes_ss, deg_dx);
+    const auto& sc = nodes_ss.GetRecentValue(deg_dx);
     size_t first_r = GetFirstIndexOnLevel(sc, r);
     int1d dx = lina::Residue(sc.basis.begin(), sc.basis.begin() + first_r, dx_);
     if (dx.empty()) {
@@ -378,6 +385,8 @@ void Diagram::SetImageSc(IndexCw iCw, AdamsDeg deg_dx, const int1d& dx_, const i
         /* Otherwise insert it to the beginning of level r */
         UpdateStaircase(nodes_ss, deg_dx, sc, first_r, dx, x, r, image_new, level_image_new);
     }
+    if (!dx.empty())
+        MarkDirty(iCw, deg_dx);
 
     /* ss to cofseq */
     if (flag & SSFlag::cofseq) {
@@ -389,6 +398,8 @@ void Diagram::SetImageSc(IndexCw iCw, AdamsDeg deg_dx, const int1d& dx_, const i
                 ReSetScCofseq(cofseq, ind_cof.iCs, deg_dx, flag);
         }
     }
+    else if (!dx.empty())
+        MarkUnsyncedCofseq(iCw, deg_dx);
 
     if (level_image_new != -1) {
         if (level_image_new < LEVEL_MAX / 2) {
@@ -408,11 +419,11 @@ void Diagram::SetImageSc(IndexCw iCw, AdamsDeg deg_dx, const int1d& dx_, const i
 void Diagram::SetDiffScCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg_x, const int1d& x_, const int1d& dx_, int r, SSFlag flag)
 {
     /*if (cofseq.name == "S0__Ceta__S0" && iCs == 1 && deg_x == AdamsDeg(29, 176)) {
-        auto& sc = ut::GetRecentValue(cofseq.nodes_cofseq[iCs], deg_x);
+        auto& sc = cofseq.nodes_cofseq[iCs].GetRecentValue(deg_x);
         fmt::print("adding d_{}{}={}\n", r, x_, dx_);
         fmt::print("sc at {} =\n{}\n", deg_x, sc);
         AdamsDeg deg_next = deg_x + AdamsDeg{0, cofseq.degMap[iCs].stem() + 0};
-        fmt::print("sc_next at {} =\n{}\n", deg_next, ut::GetRecentValue(cofseq.nodes_cofseq[(iCs + 1) % 3], deg_next));
+        fmt::print("sc_next at {} =\n{}\n", deg_next, cofseq.nodes_cofseq[(iCs + 1) % 3].GetRecentValue(deg_next));
         std::cout << "debug\n";
     }*/
     const size_t iCs_prev = (iCs + 2) % 3;
@@ -439,7 +450,7 @@ void Diagram::SetDiffScCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg_x, const
     int1d dx = dx_;
     if (dx_ != NULL_DIFF && !dx_.empty())
         dx = Residue(std::move(dx), *cofseq.nodes_ss[iCs_next], deg_dx, LEVEL_PERM);
-    const auto& sc = ut::GetRecentValue(nodes_cofseq, deg_x);
+    const auto& sc = nodes_cofseq.GetRecentValue(deg_x);
     size_t first_Nmr = GetFirstIndexOnLevel(sc, LEVEL_MAX - r);
     x = lina::Residue(sc.basis.begin(), sc.basis.begin() + first_Nmr, std::move(x));
     if (x.empty()) {
@@ -465,6 +476,8 @@ void Diagram::SetDiffScCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg_x, const
         /* Otherwise insert it to the beginning of level N-r */
         UpdateStaircase(nodes_cofseq, deg_x, sc, first_Nmr, x, dx, LEVEL_MAX - r, image_new, level_image_new);
     }
+    if (!x.empty())
+        MarkDirtyCofseq(cofseq, iCs, deg_x);
 
     if (level_image_new != -1) {
         if (level_image_new < LEVEL_MAX / 2) {
@@ -485,10 +498,10 @@ void Diagram::SetDiffScCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg_x, const
         SetImageScCofseq(cofseq, iCs_next, deg_dx, dx, x, r, flag);
 
     /*if (cofseq.name == "S0__Ceta__S0" && iCs == 1 && deg_x == AdamsDeg(29, 176)) {
-        auto& sc = ut::GetRecentValue(cofseq.nodes_cofseq[iCs], deg_x);
+        auto& sc = cofseq.nodes_cofseq[iCs].GetRecentValue(deg_x);
         fmt::print("sc at {} =\n{}\n", deg_x, sc);
         AdamsDeg deg_next = deg_x + AdamsDeg{0, cofseq.degMap[iCs].stem() + 0};
-        fmt::print("sc_next at {} =\n{}\n", deg_next, ut::GetRecentValue(cofseq.nodes_cofseq[(iCs + 1) % 3], deg_next));
+        fmt::print("sc_next at {} =\n{}\n", deg_next, cofseq.nodes_cofseq[(iCs + 1) % 3].GetRecentValue(deg_next));
         std::cout << "debug\n";
     }*/
 }
@@ -506,7 +519,7 @@ void Diagram::SetImageScCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg_dx, cons
     int1d x = x_;
     if (x_ != NULL_DIFF && !x_.empty())
         x = Residue(std::move(x), *cofseq.nodes_ss[iCs_prev], deg_x, LEVEL_PERM);
-    const auto& sc = ut::GetRecentValue(nodes_cofseq, deg_dx);
+    const auto& sc = nodes_cofseq.GetRecentValue(deg_dx);
     size_t first_r = GetFirstIndexOnLevel(sc, r);
     dx = lina::Residue(sc.basis.begin(), sc.basis.begin() + first_r, std::move(dx));
     if (dx.empty()) {
@@ -530,7 +543,7 @@ void Diagram::SetImageScCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg_dx, cons
 
             /* cofseq to ss */
             if (r == -1) {
-                pop_front(nodes_cofseq.back().at(deg_dx));
+                pop_front(nodes_cofseq.Modify(deg_dx, sc, 0));
                 Logger::LogDiffInv(int(nodes_cofseq.size() - 2), EnumReason::cofseq_b, cofseq.nameCw[iCs], deg_dx - AdamsDeg(R_PERM + 1, R_PERM), deg_dx, {}, dx, R_PERM + 1);
                 a_leibniz_ = nullptr;
                 SetImageSc(cofseq.indexCw[iCs], deg_dx, dx, NULL_DIFF, R_PERM, flag);
@@ -541,6 +554,8 @@ void Diagram::SetImageScCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg_dx, cons
         /* Otherwise insert it to the beginning of level r */  //// TODO: Improve. Insert it to the end of known level r
         UpdateStaircase(nodes_cofseq, deg_dx, sc, first_r, dx, x, r, image_new, level_image_new);
     }
+    if (!dx.empty())
+        MarkDirtyCofseq(cofseq, iCs, deg_dx);
 
     if (level_image_new != -1) {
         if (level_image_new < LEVEL_MAX / 2) {
@@ -557,35 +572,70 @@ void Diagram::SetImageScCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg_dx, cons
     }
 }
 
+void Diagram::MulRing(size_t iRing, AdamsDeg deg_a, const int1d& a, AdamsDeg deg_b, const int1d& b, int1d& result)
+{
+    if (deg_b < deg_a) /* The ring is commutative. Only store one of the two blocks */
+        return MulRing(iRing, deg_b, b, deg_a, a, result);
+    auto& ring = rings_[iRing];
+    auto p_ab = ring.basis->find(deg_a + deg_b);
+    if (a.empty() || b.empty() || p_ab == ring.basis->end()) {
+        result.clear();
+        return;
+    }
+    const auto& basis_a = ring.basis->at(deg_a);
+    const auto& basis_b = ring.basis->at(deg_b);
+    ring.mul_cache.Mul(deg_a, a, basis_a.size(), deg_b, b, basis_b.size(), p_ab->second.size(), result, [&](int i, int j) {
+        Poly prod = ring.gb->Reduce(Poly(basis_a[i]) * Poly(basis_b[j]));
+        return Poly2Indices(prod, p_ab->second);
+    });
+}
+
+void Diagram::MulMod(size_t iMod, AdamsDeg deg_a, const int1d& a, AdamsDeg deg_x, const int1d& x, int1d& result)
+{
+    auto& mod = modules_[iMod];
+    auto p_ax = mod.basis->find(deg_a + deg_x);
+    if (a.empty() || x.empty() || p_ax == mod.basis->end()) {
+        result.clear();
+        return;
+    }
+    const auto& basis_a = rings_[mod.iRing].basis->at(deg_a);
+    const auto& basis_x = mod.basis->at(deg_x);
+    mod.mul_cache.Mul(deg_a, a, basis_a.size(), deg_x, x, basis_x.size(), p_ax->second.size(), result, [&](int i, int j) {
+        Mod prod = mod.gb->Reduce(Poly(basis_a[i]) * Mod(basis_x[j]));
+        return Mod2Indices(prod, p_ax->second);
+    });
+}
+
 int Diagram::SetRingDiffLeibniz(size_t iRing, AdamsDeg deg_x, const int1d& x, const int1d& dx, int r, int r_min, SSFlag flag)  ////
 {
     int count = 0;
     auto& ring = rings_[iRing];
-    Poly poly_x = Indices2Poly(x, ring.basis.at(deg_x)), poly_zero;
-    Poly poly_drx = !dx.empty() ? Indices2Poly(dx, ring.basis.at(deg_x + AdamsDeg(r, r - 1))) : poly_zero;
-    Poly poly_a, poly_ax, poly_da, poly_dax, poly_tmp1, poly_tmp2;
-    int1d ax, dax;
-    Mod mod_y, mod_xy, mod_dy, mod_dxy, mod_tmp1, mod_tmp2;
-    int1d xy, dxy;
+    const AdamsDeg deg_drx = deg_x + AdamsDeg(r, r - 1);
+    Poly poly_x = Indices2Poly(x, ring.basis->at(deg_x)), poly_zero;
+    Poly poly_drx = !dx.empty() ? Indices2Poly(dx, ring.basis->at(deg_drx)) : poly_zero;
+    Poly poly_a, poly_da, poly_dax, poly_tmp1, poly_tmp2;
+    Mod mod_y, mod_dy, mod_dxy, mod_tmp1, mod_tmp2;
+    int1d ax, dax, xy, dxy, tmp;
+    lina::Workspace& ws = lina::ThreadWorkspace();
 
     int r_zero = dx.empty() ? r : r - 1;
     {
         auto& nodes_ss = ring.nodes_ss;
-        auto& basis = ring.basis;
+        auto& basis = *ring.basis;
         int t_max = ring.t_max;
+        int stem_max = ring.stem_max;
         for (auto& [deg_a, _] : nodes_ss.front()) {
             const AdamsDeg deg_ax = deg_x + deg_a;
-            const auto& sc_a = ut::GetRecentValue(nodes_ss, deg_a);
+            const auto& sc_a = nodes_ss.GetRecentValue(deg_a);
             if (deg_ax.t > t_max)
                 break;
+            if (deg_ax.stem() > stem_max)
+                continue;
             for (size_t i = 0; i < sc_a.levels.size(); ++i) {
                 if (sc_a.levels[i] < LEVEL_MAX / 2 && sc_a.diffs[i] == NULL_DIFF && sc_a.levels[i] >= r_min && sc_a.levels[i] <= r_zero) { /* ax=d_R[?] */
                     const int R = sc_a.levels[i];
-                    Indices2AlgP(sc_a.basis[i], basis.at(deg_a), poly_a);
-                    mulP(poly_a, poly_x, poly_ax); /* poly_ax = poly_a * poly_x */
-                    ring.gb.ReduceP(poly_ax, poly_tmp1, poly_tmp2);
-                    if (poly_ax) {
-                        Alg2IndicesP(poly_ax, basis.at(deg_ax), ax);
+                    MulRing(iRing, deg_a, sc_a.basis[i], deg_x, x, ax);
+                    if (!ax.empty()) {
                         deg_leibniz_ = deg_a;
                         a_leibniz_ = &sc_a.basis[i];
                         SetImageSc(IndexRing(iRing), deg_ax, ax, NULL_DIFF, R, flag);
@@ -598,32 +648,37 @@ int Diagram::SetRingDiffLeibniz(size_t iRing, AdamsDeg deg_x, const int1d& x, co
                     if (r_a < r_min)
                         break;
                     const int R = std::min(r, r_a);
-                    AdamsDeg deg_dx = deg_x + AdamsDeg(R, R - 1);
-                    AdamsDeg deg_dax = deg_ax + AdamsDeg(R, R - 1);
-
-                    const Poly& poly_dx = (R == r) ? poly_drx : poly_zero;
-                    Indices2AlgP(sc_a.basis[i], basis.at(deg_a), poly_a);
-                    mulP(poly_a, poly_x, poly_ax); /* poly_ax = poly_a * poly_x */
-                    ring.gb.ReduceP(poly_ax, poly_tmp1, poly_tmp2);
-                    Alg2IndicesP(poly_ax, basis, deg_ax, ax);
-
-                    if (R == LEVEL_MAX - sc_a.levels[i])
-                        Indices2AlgP(sc_a.diffs[i], basis.at(deg_a + AdamsDeg(R, R - 1)), poly_da);
-                    else
-                        poly_da.data.clear();
-                    /* poly_dax = poly_a * poly_dx + poly_da * poly_x */
-                    mulP(poly_a, poly_dx, poly_dax);
-                    mulP(poly_da, poly_x, poly_tmp1);
-                    poly_dax.iaddP(poly_tmp1, poly_tmp2);
-                    ring.gb.ReduceP(poly_dax, poly_tmp1, poly_tmp2);
-                    if (poly_dax) {
-                        if (deg_dax.t <= t_max)
-                            Alg2IndicesP(poly_dax, basis.at(deg_dax), dax);
+                    const AdamsDeg deg_dax = deg_ax + AdamsDeg(R, R - 1);
+                    const AdamsDeg deg_da = deg_a + AdamsDeg(R, R - 1);
+                    const bool has_da = R == LEVEL_MAX - sc_a.levels[i];
+
+                    MulRing(iRing, deg_a, sc_a.basis[i], deg_x, x, ax);
+                    /* dax = a * dx + da * x */
+                    if (!OutOfRange(deg_dax, t_max, stem_max)) {
+                        if (R == r)
+                            MulRing(iRing, deg_a, sc_a.basis[i], deg_drx, dx, dax);
+                        else
+                            dax.clear();
+                        if (has_da) {
+                            MulRing(iRing, deg_da, sc_a.diffs[i], deg_x, x, tmp);
+                            lina::AddInplace(dax, tmp, ws);
+                        }
+                    }
+                    else { /* Only whether dax vanishes matters */
+                        Indices2AlgP(sc_a.basis[i], basis.at(deg_a), poly_a);
+                        if (has_da)
+                            Indices2AlgP(sc_a.diffs[i], basis.at(deg_da), poly_da);
                         else
+                            poly_da.data.clear();
+                        mulP(poly_a, R == r ? poly_drx : poly_zero, poly_dax);
+                        mulP(poly_da, poly_x, poly_tmp1);
+                        poly_dax.iaddP(poly_tmp1, poly_tmp2);
+                        ring.gb->ReduceP(poly_dax, poly_tmp1, poly_tmp2);
+                        if (poly_dax)
                             dax = NULL_DIFF;
+                        else
+                            dax.clear();
                     }
-                    else
-                        dax.clear();
 
                     if (!ax.empty() || !dax.empty()) {
                         deg_leibniz_ = deg_a;
@@ -639,21 +694,21 @@ int Diagram::SetRingDiffLeibniz(size_t iRing, AdamsDeg deg_x, const int1d& x, co
     for (size_t iMod : ring.ind_mods) {
         auto& mod = modules_[iMod];
         auto& nodes_ss = mod.nodes_ss;
-        auto& basis = mod.basis;
+        auto& basis = *mod.basis;
         int t_max = mod.t_max;
+        int stem_max = mod.stem_max;
         for (auto& [deg_y, _] : nodes_ss.front()) {
             AdamsDeg deg_xy = deg_x + deg_y;
-            const auto& sc_y = ut::GetRecentValue(nodes_ss, deg_y);
+            const auto& sc_y = nodes_ss.GetRecentValue(deg_y);
             if (deg_xy.t > t_max)
                 break;
+            if (deg_xy.stem() > stem_max)
+                continue;
             for (size_t i = 0; i < sc_y.levels.size(); ++i) {
                 if (sc_y.levels[i] < LEVEL_MAX / 2 && sc_y.diffs[i] == NULL_DIFF && sc_y.levels[i] >= r_min && sc_y.levels[i] <= r_zero) { /* xy=d_R[?] */
                     const int R = sc_y.levels[i];
-                    Indices2AlgP(sc_y.basis[i], basis.at(deg_y), mod_y);
-                    mulP(poly_x, mod_y, mod_xy); /* mod_xy = poly_x * mod_y */
-                    mod.gb.ReduceP(mod_xy, poly_tmp1, mod_tmp1, mod_tmp2);
-                    if (mod_xy) {
-                        Alg2IndicesP(mod_xy, basis.at(deg_xy), xy);
+                    MulMod(iMod, deg_x, x, deg_y, sc_y.basis[i], xy);
+                    if (!xy.empty()) {
                         deg_leibniz_ = deg_y;
                         a_leibniz_ = &sc_y.basis[i];
                         SetImageSc(IndexMod(iMod), deg_xy, xy, NULL_DIFF, R, flag);
@@ -666,33 +721,37 @@ int Diagram::SetRingDiffLeibniz(size_t iRing, AdamsDeg deg_x, const int1d& x, co
                     if (r_y < r_min)
                         break;
                     const int R = std::min(r, r_y);
-                    AdamsDeg deg_dx = deg_x + AdamsDeg(R, R - 1);
-                    AdamsDeg deg_dxy = deg_xy + AdamsDeg(R, R - 1);
-
-                    const Poly& poly_dx = (R == r) ? poly_drx : poly_zero;
-                    Indices2AlgP(sc_y.basis[i], basis.at(deg_y), mod_y);
-
-                    mulP(poly_x, mod_y, mod_xy); /* mod_xy = poly_x * mod_y */
-                    mod.gb.ReduceP(mod_xy, poly_tmp1, mod_tmp1, mod_tmp2);
-                    Alg2IndicesP(mod_xy, basis, deg_x + deg_y, xy);
-
-                    if (R == LEVEL_MAX - sc_y.levels[i])
-                        Indices2AlgP(sc_y.diffs[i], basis.at(deg_y + AdamsDeg(R, R - 1)), mod_dy);
-                    else
-                        mod_dy.data.clear();
-                    /* mod_dxy = poly_y * poly_dx + poly_dy * poly_x */
-                    mulP(poly_dx, mod_y, mod_dxy);
-                    mulP(poly_x, mod_dy, mod_tmp1);
-                    mod_dxy.iaddP(mod_tmp1, mod_tmp2);
-                    mod.gb.ReduceP(mod_dxy, poly_tmp1, mod_tmp1, mod_tmp2);
-                    if (mod_dxy) {
-                        if (deg_dxy.t <= t_max)
-                            Alg2IndicesP(mod_dxy, basis.at(deg_dxy), dxy);
+                    const AdamsDeg deg_dxy = deg_xy + AdamsDeg(R, R - 1);
+                    const AdamsDeg deg_dy = deg_y + AdamsDeg(R, R - 1);
+                    const bool has_dy = R == LEVEL_MAX - sc_y.levels[i];
+
+                    MulMod(iMod, deg_x, x, deg_y, sc_y.basis[i], xy);
+                    /* dxy = dx * y + x * dy */
+                    if (!OutOfRange(deg_dxy, t_max, stem_max)) {
+                        if (R == r)
+                            MulMod(iMod, deg_drx, dx, deg_y, sc_y.basis[i], dxy);
                         else
+                            dxy.clear();
+                        if (has_dy) {
+                            MulMod(iMod, deg_x, x, deg_dy, sc_y.diffs[i], tmp);
+                            lina::AddInplace(dxy, tmp, ws);
+                        }
+                    }
+                    else { /* Only whether dxy vanishes matters */
+                        Indices2AlgP(sc_y.basis[i], basis.at(deg_y), mod_y);
+                        if (has_dy)
+                            Indices2AlgP(sc_y.diffs[i], basis.at(deg_dy), mod_dy);
+                        else
+                            mod_dy.data.clear();
+                        mulP(R == r ? poly_drx : poly_zero, mod_y, mod_dxy);
+                        mulP(poly_x, mod_dy, mod_tmp1);
+                        mod_dxy.iaddP(mod_tmp1, mod_tmp2);
+                        mod.gb->ReduceP(mod_dxy, poly_tmp1, mod_tmp1, mod_tmp2);
+                        if (mod_dxy)
                             dxy = NULL_DIFF;
+                        else
+                            dxy.clear();
                     }
-                    else
-                        dxy.clear();
 
                     if (!xy.empty() || !dxy.empty()) {
                         deg_leibniz_ = deg_y;
@@ -714,29 +773,31 @@ int Diagram::SetModuleDiffLeibniz(size_t iMod, AdamsDeg deg_x, const int1d& x, c
 
     auto& mod = modules_[iMod];
     auto& ring = rings_[mod.iRing];
-    auto& basis = mod.basis;
-    auto& gb = mod.gb;
+    auto& basis = *mod.basis;
+    auto& gb = *mod.gb;
     const int t_max = mod.t_max;
+    const int stem_max = mod.stem_max;
+    const AdamsDeg deg_drx = deg_x + AdamsDeg(r, r - 1);
     Mod poly_x = Indices2Mod(x, basis.at(deg_x)), poly_zero;
-    Mod poly_drx = !dx.empty() ? Indices2Mod(dx, basis.at(deg_x + AdamsDeg(r, r - 1))) : poly_zero;
+    Mod poly_drx = !dx.empty() ? Indices2Mod(dx, basis.at(deg_drx)) : poly_zero;
     int r_zero = dx.empty() ? r : r - 1;
     Poly poly_a, poly_da, poly_tmp1;
-    Mod mod_ax, mod_dax, mod_tmp1, mod_tmp2;
-    int1d ax, dax;
+    Mod mod_dax, mod_tmp1, mod_tmp2;
+    int1d ax, dax, tmp;
+    lina::Workspace& ws = lina::ThreadWorkspace();
 
     for (auto& [deg_a, _] : ring.nodes_ss.front()) {
-        const auto& sc_a = ut::GetRecentValue(ring.nodes_ss, deg_a);
+        const auto& sc_a = ring.nodes_ss.GetRecentValue(deg_a);
         AdamsDeg deg_ax = deg_x + deg_a;
         if (deg_ax.t > t_max)
             break;
+        if (deg_ax.stem() > stem_max)
+            continue;
         for (size_t i = 0; i < sc_a.levels.size(); ++i) {
             if (sc_a.levels[i] < LEVEL_MAX / 2 && sc_a.diffs[i] == NULL_DIFF && sc_a.levels[i] >= r_min && sc_a.levels[i] <= r_zero) { /* ax=d_R[?] */
                 const int R = sc_a.levels[i];
-                Indices2AlgP(sc_a.basis[i], ring.basis.at(deg_a), poly_a);
-                mulP(poly_a, poly_x, mod_ax); /* poly_ax = poly_a * poly_x */
-                mod.gb.ReduceP(mod_ax, poly_tmp1, mod_tmp1, mod_tmp2);
-                if (mod_ax) {
-                    Alg2IndicesP(mod_ax, basis.at(deg_ax), ax);
+                MulMod(iMod, deg_a, sc_a.basis[i], deg_x, x, ax);
+                if (!ax.empty()) {
                     deg_leibniz_ = deg_a;
                     a_leibniz_ = &sc_a.basis[i];
                     SetImageSc(IndexMod(iMod), deg_ax, ax, NULL_DIFF, R, flag);
@@ -749,32 +810,37 @@ int Diagram::SetModuleDiffLeibniz(size_t iMod, AdamsDeg deg_x, const int1d& x, c
                 if (r_a < r_min)
                     break;
                 int R = std::min(r, r_a);
-                AdamsDeg deg_dx = deg_x + AdamsDeg(R, R - 1);
-                AdamsDeg deg_dax = deg_ax + AdamsDeg(R, R - 1);
-
-                const Mod& poly_dx = (R == r) ? poly_drx : poly_zero;
-                Indices2AlgP(sc_a.basis[i], ring.basis.at(deg_a), poly_a);
-                mulP(poly_a, poly_x, mod_ax); /* mod_ax = poly_a * mod_x */
-                gb.ReduceP(mod_ax, poly_tmp1, mod_tmp1, mod_tmp2);
-                Alg2IndicesP(mod_ax, basis, deg_x + deg_a, ax);
-
-                if (R == LEVEL_MAX - sc_a.levels[i])
-                    Indices2AlgP(sc_a.diffs[i], ring.basis.at(deg_a + AdamsDeg(R, R - 1)), poly_da);
-                else
-                    poly_da.data.clear();
-                /* mod_dax = poly_a * mod_dx + poly_da * mod_x */
-                mulP(poly_a, poly_dx, mod_dax);
-                mulP(poly_da, poly_x, mod_tmp1);
-                mod_dax.iaddP(mod_tmp1, mod_tmp2);
-                gb.ReduceP(mod_dax, poly_tmp1, mod_tmp1, mod_tmp2);
-                if (mod_dax) {
-                    if (deg_dax.t <= t_max)
-                        Alg2IndicesP(mod_dax, basis.at(deg_dax), dax);
+                const AdamsDeg deg_dax = deg_ax + AdamsDeg(R, R - 1);
+                const AdamsDeg deg_da = deg_a + AdamsDeg(R, R - 1);
+                const bool has_da = R == LEVEL_MAX - sc_a.levels[i];
+
+                MulMod(iMod, deg_a, sc_a.basis[i], deg_x, x, ax);
+                /* dax = a * dx + da * x */
+                if (!OutOfRange(deg_dax, t_max, stem_max)) {
+                    if (R == r)
+                        MulMod(iMod, deg_a, sc_a.basis[i], deg_drx, dx, dax);
                     else
+                        dax.clear();
+                    if (has_da) {
+                        MulMod(iMod, deg_da, sc_a.diffs[i], deg_x, x, tmp);
+                        lina::AddInplace(dax, tmp, ws);
+                    }
+                }
+                else { /* Only whether dax vanishes matters */
+                    Indices2AlgP(sc_a.basis[i], ring.basis->at(deg_a), poly_a);
+                    if (has_da)
+                        Indices2AlgP(sc_a.diffs[i], ring.basis->at(deg_da), poly_da);
+                    else
+                        poly_da.data.clear();
+                    mulP(poly_a, R == r ? poly_drx : poly_zero, mod_dax);
+                    mulP(poly_da, poly_x, mod_tmp1);
+                    mod_dax.iaddP(mod_tmp1, mod_tmp2);
+                    gb.ReduceP(mod_dax, poly_tmp1, mod_tmp1, mod_tmp2);
+                    if (mod_dax)
                         dax = NULL_DIFF;
+                    else
+                        dax.clear();
                 }
-                else
-                    dax.clear();
 
                 if (!ax.empty() || !dax.empty()) {
                     deg_leibniz_ = deg_a;
@@ -797,50 +863,48 @@ int Diagram::SetRingDiffLeibnizV2(size_t iRing, AdamsDeg deg_x, const int1d& x,
     if (!ut::has(ring.nodes_ss.front(), deg_dx))
         return count;
     int depth = int(ring.nodes_ss.size() - 2);
-    const Poly poly_x = Indices2Poly(x, ring.basis.at(deg_x));
-    const auto& sc_dx = ut::GetRecentValue(ring.nodes_ss, deg_dx);
+    const auto& sc_dx = ring.nodes_ss.GetRecentValue(deg_dx);
     auto [first_dx, count_dx] = CountPossDrTgt(ring.nodes_ss, ring.t_max, deg_dx, r);
     if (count_dx == 0 || count_dx > deduce_count_max_)
         return 0;
     unsigned j_max = 1 << count_dx;
-    int1d dx;
+    int1d dx, xy, ydx, dxy;
     bool printed_dx = false;
 
     if (auto& nodes_ss = ring.nodes_ss; ut::has(nodes_ss.front(), deg_dx)) {
-        const auto& basis = ring.basis;
         const int t_max = ring.t_max;
+        const int stem_max = ring.stem_max;
         for (auto& [deg_y, _] : nodes_ss.front()) {
             const AdamsDeg deg_xy = deg_x + deg_y;
             const AdamsDeg deg_dxy = deg_xy + AdamsDeg(r, r - 1);
             if (deg_dxy.t > t_max)
                 break;
-            const auto& sc_y = ut::GetRecentValue(nodes_ss, deg_y);
+            if (deg_xy.stem() > stem_max)
+                continue;
+            const auto& sc_y = nodes_ss.GetRecentValue(deg_y);
             for (size_t i = 0; i < sc_y.levels.size(); ++i) { /* Loop over y */
                 const int r_y = LEVEL_MAX - sc_y.levels[i] - (sc_y.diffs[i] == NULL_DIFF ? 1 : 0);
                 if (r_y < r)
                     break;
 
-                Poly poly_y = Indices2Poly(sc_y.basis[i], basis.at(deg_y));
-                Poly poly_xy = ring.gb.Reduce(poly_x * poly_y);
-                if (poly_xy) {
-                    int1d xy = Poly2Indices(poly_xy, basis.at(deg_xy));
-
+                MulRing(iRing, deg_x, x, deg_y, sc_y.basis[i], xy);
+                if (!xy.empty()) {
                     bool ydx_always_zero = true;
                     for (unsigned j = 1; j < j_max; ++j) { /* Loop over dx */
                         dx.clear();
                         for (int k : ut::two_exp(j))
                             dx = lina::add(dx, sc_dx.basis[(size_t)(first_dx + k)]);
-                        Poly poly_dx = Indices2Poly(dx, basis.at(deg_dx));
-                        Poly poly_ydx = ring.gb.Reduce(poly_dx * poly_y);
-                        if (poly_ydx && !IsZeroOnLevel(ut::GetRecentValue(nodes_ss, deg_dxy), Poly2Indices(poly_ydx, basis.at(deg_dxy)), r)) {
+                        MulRing(iRing, deg_dx, dx, deg_y, sc_y.basis[i], ydx);
+                        if (!ydx.empty() && !IsZeroOnLevel(nodes_ss.GetRecentValue(deg_dxy), ydx, r)) {
                             ydx_always_zero = false;
                             break;
                         }
                     }
                     if (ydx_always_zero) {
-                        Poly poly_dy = (r == LEVEL_MAX - sc_y.levels[i]) ? Indices2Poly(sc_y.diffs[i], basis.at(deg_y + AdamsDeg(r, r - 1))) : Poly();
-                        Poly poly_dxy = ring.gb.Reduce(poly_x * poly_dy);
-                        int1d dxy = poly_dxy ? Poly2Indices(poly_dxy, basis.at(deg_dxy)) : int1d{};
+                        if (r == LEVEL_MAX - sc_y.levels[i])
+                            MulRing(iRing, deg_x, x, deg_y + AdamsDeg(r, r - 1), sc_y.diffs[i], dxy);
+                        else
+                            dxy.clear();
 
                         if (IsNewDiff(nodes_ss, deg_xy, xy, dxy, r)) {
                             if (!printed_dx) {
@@ -858,40 +922,39 @@ int Diagram::SetRingDiffLeibnizV2(size_t iRing, AdamsDeg deg_x, const int1d& x,
     for (size_t iMod : ring.ind_mods) {
         auto& mod = modules_[iMod];
         auto& nodes_ss = mod.nodes_ss;
-        auto& basis = mod.basis;
         int t_max = mod.t_max;
+        int stem_max = mod.stem_max;
         for (auto& [deg_y, _] : nodes_ss.front()) {
             AdamsDeg deg_xy = deg_x + deg_y;
             const AdamsDeg deg_dxy = deg_xy + AdamsDeg(r, r - 1);
             if (deg_dxy.t > t_max)
                 break;
-            const auto& sc_y = ut::GetRecentValue(nodes_ss, deg_y);
+            if (deg_xy.stem() > stem_max)
+                continue;
+            const auto& sc_y = nodes_ss.GetRecentValue(deg_y);
             for (size_t i = 0; i < sc_y.levels.size(); ++i) { /* Loop over y */
                 const int r_y = LEVEL_MAX - sc_y.levels[i] - (sc_y.diffs[i] == NULL_DIFF ? 1 : 0);
                 if (r_y < r)
                     break;
 
-                Mod poly_y = Indices2Mod(sc_y.basis[i], basis.at(deg_y));
-                Mod poly_xy = mod.gb.Reduce(poly_x * poly_y);
-                if (poly_xy) {
-                    int1d xy = poly_xy ? Mod2Indices(poly_xy, basis.at(deg_x + deg_y)) : int1d{};
-
+                MulMod(iMod, deg_x, x, deg_y, sc_y.basis[i], xy);
+                if (!xy.empty()) {
                     bool ydx_always_zero = true;
                     for (unsigned j = 1; j < j_max; ++j) { /* Loop over dx */
                         dx.clear();
                         for (int k : ut::two_exp(j))
                             dx = lina::add(dx, sc_dx.basis[(size_t)(first_dx + k)]);
-                        Poly poly_dx = Indices2Poly(dx, ring.basis.at(deg_dx));
-                        Mod poly_ydx = mod.gb.Reduce(poly_dx * poly_y);
-                        if (poly_ydx && !IsZeroOnLevel(ut::GetRecentValue(nodes_ss, deg_dxy), Mod2Indices(poly_ydx, basis.at(deg_dxy)), r)) {
+                        MulMod(iMod, deg_dx, dx, deg_y, sc_y.basis[i], ydx);
+                        if (!ydx.empty() && !IsZeroOnLevel(nodes_ss.GetRecentValue(deg_dxy), ydx, r)) {
                             ydx_always_zero = false;
                             break;
                         }
                     }
                     if (ydx_always_zero) {
-                        Mod poly_dy = (r == LEVEL_MAX - sc_y.levels[i]) ? Indices2Mod(sc_y.diffs[i], basis.at(deg_y + AdamsDeg(r, r - 1))) : Mod();
-                        Mod poly_dxy = mod.gb.Reduce(poly_x * poly_dy);
-                        int1d dxy = poly_dxy ? Mod2Indices(poly_dxy, basis.at(deg_dxy)) : int1d{};
+                        if (r == LEVEL_MAX - sc_y.levels[i])
+                            MulMod(iMod, deg_x, x, deg_y + AdamsDeg(r, r - 1), sc_y.diffs[i], dxy);
+                        else
+                            dxy.clear();
 
                         if (IsNewDiff(nodes_ss, deg_xy, xy, dxy, r)) {
                             if (!printed_dx) {
@@ -908,7 +971,7 @@ int Diagram::SetRingDiffLeibnizV2(size_t iRing, AdamsDeg deg_x, const int1d& x,
     }
     for (size_t iMap : ring.ind_maps) { /* Loop over map */
         auto map = (MapRing2Ring*)maps_[iMap].get();
-        if (deg_dx.t > map->t_max)
+        if (deg_dx.t > map->t_max || deg_x.stem() > map->stem_max)
             continue;
         auto fx = map->map(x, deg_x, *this);
         if (!fx.empty()) {
@@ -918,7 +981,7 @@ int Diagram::SetRingDiffLeibnizV2(size_t iRing, AdamsDeg deg_x, const int1d& x,
                 for (int k : ut::two_exp(j))
                     dx = lina::add(dx, sc_dx.basis[(size_t)(first_dx + k)]);
                 int1d fdx = map->map(dx, deg_dx, *this);
-                if (!fdx.empty() && !IsZeroOnLevel(ut::GetRecentValue(rings_[map->to.index].nodes_ss, deg_dx), fdx, r)) {
+                if (!fdx.empty() && !IsZeroOnLevel(rings_[map->to.index].nodes_ss.GetRecentValue(deg_dx), fdx, r)) {
                     fdx_always_zero = false;
                     break;
                 }
@@ -947,17 +1010,15 @@ int Diagram::SetModuleDiffLeibnizV2(size_t iMod, AdamsDeg deg_x, const int1d& x,
     const AdamsDeg deg_dx = deg_x + AdamsDeg(r, r - 1);
     if (!ut::has(nodes_ss.front(), deg_dx))
         return count;
-    auto& basis = mod.basis;
-    auto& gb = mod.gb;
     const int t_max = mod.t_max;
+    const int stem_max = mod.stem_max;
     int depth = depth_;
-    const Mod poly_x = Indices2Mod(x, basis.at(deg_x));
-    const auto& sc_dx = ut::GetRecentValue(nodes_ss, deg_dx);
+    const auto& sc_dx = nodes_ss.GetRecentValue(deg_dx);
     auto [first_dx, count_dx] = CountPossDrTgt(nodes_ss, t_max, deg_dx, r);
     if (count_dx == 0 || count_dx > deduce_count_max_)
         return 0;
     unsigned j_max = 1 << count_dx;
-    int1d dx;
+    int1d dx, xy, ydx, dxy;
     bool printed_dx = false;
 
     for (auto& [deg_y, _] : ring.nodes_ss.front()) {
@@ -965,33 +1026,32 @@ int Diagram::SetModuleDiffLeibnizV2(size_t iMod, AdamsDeg deg_x, const int1d& x,
         AdamsDeg deg_dxy = deg_xy + AdamsDeg(r, r - 1);
         if (deg_dxy.t > t_max)
             break;
-        const auto& sc_y = ut::GetRecentValue(ring.nodes_ss, deg_y);
+        if (deg_xy.stem() > stem_max)
+            continue;
+        const auto& sc_y = ring.nodes_ss.GetRecentValue(deg_y);
         for (size_t i = 0; i < sc_y.levels.size(); ++i) { /* Loop over y */
             const int r_y = LEVEL_MAX - sc_y.levels[i] - (sc_y.diffs[i] == NULL_DIFF ? 1 : 0);
             if (r_y < r)
                 break;
 
-            Poly poly_y = Indices2Poly(sc_y.basis[i], ring.basis.at(deg_y));
-            Mod poly_xy = gb.Reduce(poly_y * poly_x);
-            if (poly_xy) {
-                int1d xy = Mod2Indices(poly_xy, basis.at(deg_x + deg_y));
-
+            MulMod(iMod, deg_y, sc_y.basis[i], deg_x, x, xy);
+            if (!xy.empty()) {
                 bool ydx_always_zero = true;
                 for (unsigned j = 1; j < j_max; ++j) { /* Loop over dx */
                     dx.clear();
                     for (int k : ut::two_exp(j))
                         dx = lina::add(dx, sc_dx.basis[(size_t)(first_dx + k)]);
-                    Mod poly_dx = Indices2Mod(dx, basis.at(deg_dx));
-                    Mod poly_ydx = mod.gb.Reduce(poly_y * poly_dx);
-                    if (poly_ydx && !IsZeroOnLevel(ut::GetRecentValue(nodes_ss, deg_dxy), Mod2Indices(poly_ydx, basis.at(deg_dxy)), r)) {
+                    MulMod(iMod, deg_y, sc_y.basis[i], deg_dx, dx, ydx);
+                    if (!ydx.empty() && !IsZeroOnLevel(nodes_ss.GetRecentValue(deg_dxy), ydx, r)) {
                         ydx_always_zero = false;
                         break;
                     }
                 }
                 if (ydx_always_zero) {
-                    Poly poly_dy = (r == LEVEL_MAX - sc_y.levels[i]) ? Indices2Poly(sc_y.diffs[i], ring.basis.at(deg_y + AdamsDeg(r, r - 1))) : Poly();
-                    Mod poly_dxy = gb.Reduce(poly_dy * poly_x);
-                    int1d dxy = poly_dxy ? Mod2Indices(poly_dxy, basis.at(deg_dxy)) : int1d{};
+                    if (r == LEVEL_MAX - sc_y.levels[i])
+                        MulMod(iMod, deg_y + AdamsDeg(r, r - 1), sc_y.diffs[i], deg_x, x, dxy);
+                    else
+                        dxy.clear();
 
                     if (IsNewDiff(nodes_ss, deg_xy, xy, dxy, r)) {
                         if (!printed_dx) {
@@ -1007,7 +1067,7 @@ int Diagram::SetModuleDiffLeibnizV2(size_t iMod, AdamsDeg deg_x, const int1d& x,
     }
     for (size_t iMap : mod.ind_maps) { /* Loop over map */
         auto& map = maps_[iMap];
-        if (deg_dx.t > map->t_max)
+        if (deg_dx.t > map->t_max || deg_x.stem() > map->stem_max)
             continue;
         auto fx = map->map(x, deg_x, *this);
         if (!fx.empty()) {
@@ -1021,7 +1081,7 @@ int Diagram::SetModuleDiffLeibnizV2(size_t iMod, AdamsDeg deg_x, const int1d& x,
                 for (int k : ut::two_exp(j))
                     dx = lina::add(dx, sc_dx.basis[(size_t)(first_dx + k)]);
                 int1d fdx = map->map(dx, deg_dx, *this);
-                if (!fdx.empty() && !IsZeroOnLevel(ut::GetRecentValue(ss_to, deg_fdx), fdx, r)) {
+                if (!fdx.empty() && !IsZeroOnLevel(ss_to.GetRecentValue(deg_fdx), fdx, r)) {
                     fdx_always_zero = false;
                     break;
                 }
@@ -1053,24 +1113,24 @@ int Diagram::SetRingBoundaryLeibniz(size_t iRing, AdamsDeg deg_x, const int1d& x
         throw SSException(0x51274f1dU, "No source for the image.");
     }
 
-    Poly poly_x = Indices2Poly(x, ring.basis.at(deg_x));
+    int1d ax;
     {
         auto& nodes_ss = ring.nodes_ss;
-        auto& basis = ring.basis;
         int t_max = ring.t_max;
+        int stem_max = ring.stem_max;
 
         for (auto& [deg_a, _] : nodes_ss.front()) {
-            const auto& sc_a = ut::GetRecentValue(nodes_ss, deg_a);
+            const auto& sc_a = nodes_ss.GetRecentValue(deg_a);
             AdamsDeg deg_ax = deg_x + deg_a;
             if (deg_ax.t > t_max)
                 break;
+            if (deg_ax.stem() > stem_max)
+                continue;
             for (size_t i = 0; i < sc_a.levels.size(); ++i) {
                 if (sc_a.levels[i] >= LEVEL_MAX - r)
                     break;
-                Poly poly_a = Indices2Poly(sc_a.basis[i], basis.at(deg_a));
-                Poly poly_ax = ring.gb.Reduce(poly_x * poly_a);
-                if (poly_ax) {
-                    int1d ax = Poly2Indices(poly_ax, basis.at(deg_ax));  // TODO: consider moving allocations out of the loop
+                MulRing(iRing, deg_x, x, deg_a, sc_a.basis[i], ax);
+                if (!ax.empty()) {
                     deg_leibniz_ = deg_a;
                     a_leibniz_ = &sc_a.basis[i];
                     SetImageSc(IndexRing(iRing), deg_ax, ax, NULL_DIFF, r, flag);
@@ -1084,19 +1144,20 @@ int Diagram::SetRingBoundaryLeibniz(size_t iRing, AdamsDeg deg_x, const int1d& x
         auto& mod = modules_[iMod];
         auto& nodes_ss = mod.nodes_ss;
         int t_max = mod.t_max;
+        int stem_max = mod.stem_max;
 
         for (auto& [deg_a, _] : nodes_ss.front()) {
-            const auto& sc_a = ut::GetRecentValue(nodes_ss, deg_a);
+            const auto& sc_a = nodes_ss.GetRecentValue(deg_a);
             AdamsDeg deg_ax = deg_x + deg_a;
             if (deg_ax.t > t_max)
                 break;
+            if (deg_ax.stem() > stem_max)
+                continue;
             for (size_t i = 0; i < sc_a.levels.size(); ++i) {
                 if (sc_a.levels[i] >= LEVEL_MAX - r)
                     break;
-                Mod poly_a = Indices2Mod(sc_a.basis[i], mod.basis.at(deg_a));
-                Mod poly_ax = mod.gb.Reduce(poly_x * poly_a);
-                if (poly_ax) {
-                    int1d ax = Mod2Indices(poly_ax, mod.basis.at(deg_ax));
+                MulMod(iMod, deg_x, x, deg_a, sc_a.basis[i], ax);
+                if (!ax.empty()) {
                     deg_leibniz_ = deg_a;
                     a_leibniz_ = &sc_a.basis[i];
                     SetImageSc(IndexMod(iMod), deg_ax, ax, NULL_DIFF, r, flag);
@@ -1116,6 +1177,7 @@ int Diagram::SetModuleBoundaryLeibniz(size_t iMod, AdamsDeg deg_x, const int1d&
     auto& ring = rings_[mod.iRing];
     auto& nodes_ss = mod.nodes_ss;
     int t_max = mod.t_max;
+    int stem_max = mod.stem_max;
 
     const int r_original = r;
     r = NextRSrc(nodes_ss, deg_x, r);
@@ -1125,19 +1187,19 @@ int Diagram::SetModuleBoundaryLeibniz(size_t iMod, AdamsDeg deg_x, const int1d&
         throw SSException(0xda298807U, "No source for the image.");
     }
 
-    Mod poly_x = Indices2Mod(x, mod.basis.at(deg_x));
+    int1d ax;
     for (auto& [deg_a, _] : ring.nodes_ss.front()) {
-        const auto& sc_a = ut::GetRecentValue(ring.nodes_ss, deg_a);
+        const auto& sc_a = ring.nodes_ss.GetRecentValue(deg_a);
         AdamsDeg deg_ax = deg_x + deg_a;
         if (deg_ax.t > t_max)
             break;
+        if (deg_ax.stem() > stem_max)
+            continue;
         for (size_t i = 0; i < sc_a.levels.size(); ++i) {
             if (sc_a.levels[i] >= LEVEL_MAX - r)
                 break;
-            Poly poly_a = Indices2Poly(sc_a.basis[i], ring.basis.at(deg_a));
-            Mod poly_ax = mod.gb.Reduce(poly_a * poly_x);
-            if (poly_ax) {
-                int1d ax = Mod2Indices(poly_ax, mod.basis.at(deg_ax));
+            MulMod(iMod, deg_a, sc_a.basis[i], deg_x, x, ax);
+            if (!ax.empty()) {
                 deg_leibniz_ = deg_a;
                 a_leibniz_ = &sc_a.basis[i];
                 SetImageSc(IndexMod(iMod), deg_ax, ax, NULL_DIFF, r, flag);
@@ -1156,9 +1218,9 @@ int Diagram::SetDiffLeibnizCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg_x, co
     auto iCw = cofseq.indexCw[iCs];
     auto iCw_next = cofseq.indexCw[iCs_next];
     auto& ring = iCw.isRing ? rings_[iCw.index] : rings_[modules_[iCw.index].iRing];  //// Assuming that the rings are the same
-    using BasisVariant = std::variant<std::map<AdamsDeg, Mon1d>*, std::map<AdamsDeg, MMod1d>*>;
-    BasisVariant basis1 = iCw.isRing ? BasisVariant(&ring.basis) : BasisVariant(&modules_[iCw.index].basis);
-    BasisVariant basis2 = iCw_next.isRing ? BasisVariant(&ring.basis) : BasisVariant(&modules_[iCw_next.index].basis);
+    using BasisVariant = std::variant<const std::map<AdamsDeg, Mon1d>*, const std::map<AdamsDeg, MMod1d>*>;
+    BasisVariant basis1 = iCw.isRing ? BasisVariant(ring.basis.get()) : BasisVariant(modules_[iCw.index].basis.get());
+    BasisVariant basis2 = iCw_next.isRing ? BasisVariant(ring.basis.get()) : BasisVariant(modules_[iCw_next.index].basis.get());
     Poly poly_x, poly_dx;
     Mod mod_x, mod_dx;
     if (!x.empty()) {
@@ -1171,35 +1233,35 @@ int Diagram::SetDiffLeibnizCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg_x, co
     AdamsDeg deg_dx = deg_x + AdamsDeg(r, r + stem_map);
     if (!dx.empty()) {
         if (iCw_next.isRing)
-            poly_dx = Indices2Poly(dx, ring.basis.at(deg_dx));
+            poly_dx = Indices2Poly(dx, ring.basis->at(deg_dx));
         else
             mod_dx = Indices2Mod(dx, std::get<1>(basis2)->at(deg_dx));
     }
-    int t_max = cofseq.t_max[iCs];
-    int t_max2 = cofseq.t_max[iCs_next];
+    int t_max = cofseq.t_max[iCs], stem_max = cofseq.nodes_ss[iCs]->stem_max();
+    int t_max2 = cofseq.t_max[iCs_next], stem_max2 = cofseq.nodes_ss[iCs_next]->stem_max();
     for (auto& [deg_a, _] : ring.nodes_ss.front()) {
         const AdamsDeg deg_ax = deg_x + deg_a;
         AdamsDeg deg_adx = deg_ax + AdamsDeg(r, r + stem_map);
-        const auto& sc_a = ut::GetRecentValue(ring.nodes_ss, deg_a);
+        const auto& sc_a = ring.nodes_ss.GetRecentValue(deg_a);
 
         size_t first_PC = GetFirstIndexOnLevel(sc_a, LEVEL_PERM);
         size_t last_PC = GetFirstIndexOnLevel(sc_a, LEVEL_PERM + 1);
         for (size_t i = first_PC; i < last_PC; ++i) {
-            Poly poly_a = Indices2Poly(sc_a.basis[i], ring.basis.at(deg_a));
+            Poly poly_a = Indices2Poly(sc_a.basis[i], ring.basis->at(deg_a));
 
             int1d ax;
             if (x.empty())
                 ;
-            else if (deg_ax.t > t_max)
+            else if (OutOfRange(deg_ax, t_max, stem_max))
                 ax = NULL_DIFF;
             else {
                 if (iCw.isRing) {
-                    Poly poly_ax = ring.gb.Reduce(poly_a * poly_x);
-                    ax = poly_ax ? Poly2Indices(poly_ax, ring.basis.at(deg_ax)) : int1d{};
+                    Poly poly_ax = ring.gb->Reduce(poly_a * poly_x);
+                    ax = poly_ax ? Poly2Indices(poly_ax, ring.basis->at(deg_ax)) : int1d{};
                     ax = Residue(std::move(ax), ring.nodes_ss, deg_ax, LEVEL_PERM);
                 }
                 else {
-                    Mod mod_ax = modules_[iCw.index].gb.Reduce(poly_a * mod_x);
+                    Mod mod_ax = modules_[iCw.index].gb->Reduce(poly_a * mod_x);
                     ax = mod_ax ? Mod2Indices(mod_ax, std::get<1>(basis1)->at(deg_ax)) : int1d{};
                     ax = Residue(std::move(ax), *cofseq.nodes_ss[iCs], deg_ax, LEVEL_PERM);
                 }
@@ -1208,17 +1270,17 @@ int Diagram::SetDiffLeibnizCofseq(CofSeq& cofseq, size_t iCs, AdamsDeg deg_x, co
             int1d adx;
             if (dx.empty())
                 ;
-            else if (deg_adx.t > t_max2)
+            else if (OutOfRange(deg_adx, t_max2, stem_max2))
                 adx = NULL_DIFF;
             else if (iCw_next.isRing) {
-                Poly poly_adx = ring.gb.Reduce(poly_a * poly_dx);
+                Poly poly_adx = ring.gb->Reduce(poly_a * poly_dx);
                 if (poly_adx) {
-                    adx = Poly2Indices(poly_adx, ring.basis.at(deg_adx));
+                    adx = Poly2Indices(poly_adx, ring.basis->at(deg_adx));
                     adx = Residue(std::move(adx), ring.nodes_ss, deg_adx, LEVEL_PERM);
                 }
             }
             else {
-                Mod poly_adx = modules_[iCw_next.index].gb.Reduce(poly_a * mod_dx);
+                Mod poly_adx = modules_[iCw_next.index].gb->Reduce(poly_a * mod_dx);
                 if (poly_adx)
                     adx = Residue(Mod2Indices(poly_adx, std::get<1>(basis2)->at(deg_adx)), *cofseq.nodes_ss[iCs_next], deg_adx, LEVEL_PERM);
             }
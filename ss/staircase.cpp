@@ -2,16 +2,216 @@
 #include "main.h"
 #include "mylog.h"
 
-/* Add x, dx, level and triangularize.
- * Output the image of a differential that should be moved to the next level */
-void triangularize(Staircase& sc, size_t i_insert, int1d x, int1d dx, int level, int1d& image, int& level_image)
+/*--------------------------------------------------------------------------------------------
+--------------------------------------    Staircases1d    ------------------------------------
+---------------------------------------------------------------------------------------------*/
+
+const Staircase*& Staircases1d::Slot(AdamsDeg deg)
 {
-    level_image = -1;
+    int stem = deg.stem();
+    if (recent_.empty())
+        stem_min_ = stem;
+    else if (stem < stem_min_) {
+        recent_.insert(recent_.begin(), size_t(stem_min_ - stem), {});
+        stem_min_ = stem;
+    }
+    size_t i = size_t(stem - stem_min_);
+    if (i >= recent_.size())
+        recent_.resize(i + 1);
+    if (size_t(deg.s) >= recent_[i].size())
+        recent_[i].resize(size_t(deg.s) + 1, nullptr);
+    return recent_[i][deg.s];
+}
 
-#ifndef NDEBUG
-    if (x.empty())
-        throw MyException(0xfe35902dU, "BUG: triangularize()");
-#endif
+void Staircases1d::Refresh(AdamsDeg deg)
+{
+    const Staircase*& p = Slot(deg);
+    if (auto it = changes_.find(deg); it != changes_.end())
+        p = &it->second;
+    else if (auto it = base_->find(deg); it != base_->end())
+        p = &it->second;
+    else
+        p = nullptr;
+}
+
+void Staircases1d::Reindex()
+{
+    recent_.clear();
+    stem_min_ = 0;
+    for (auto& [deg, sc] : *base_)
+        Slot(deg) = &sc;
+    for (auto& [deg, sc] : changes_)
+        Slot(deg) = &sc;
+}
+
+void Staircases1d::Journal(AdamsDeg deg, size_t first)
+{
+    if (nodes_journal_size_.empty()) {
+        unsaved_.insert(deg);
+        return;
+    }
+    auto it = changes_.find(deg);
+    UndoEntry entry{deg, it == changes_.end(), first, {}};
+    bytes_journaled_ += sizeof(UndoEntry);
+    if (!entry.inserted) {
+        const Staircase& sc = it->second;
+        for (size_t i = first; i < sc.basis.size(); ++i) {
+            entry.rows.basis.push_back(sc.basis[i]);
+            entry.rows.diffs.push_back(sc.diffs[i]);
+            entry.rows.levels.push_back(sc.levels[i]);
+            bytes_journaled_ += (sc.basis[i].size() + sc.diffs[i].size() + 1) * sizeof(int);
+        }
+    }
+    journal_.push_back(std::move(entry));
+}
+
+void Staircases1d::PopNode()
+{
+    size_t size = nodes_journal_size_.back();
+    nodes_journal_size_.pop_back();
+    while (journal_.size() > size) {
+        auto& entry = journal_.back();
+        if (entry.inserted) {
+            changes_.erase(entry.deg);
+            Refresh(entry.deg);
+        }
+        else {
+            Staircase& sc = changes_.at(entry.deg);
+            sc.basis.resize(entry.first);
+            sc.diffs.resize(entry.first);
+            sc.levels.resize(entry.first);
+            for (size_t i = 0; i < entry.rows.basis.size(); ++i) {
+                sc.basis.push_back(std::move(entry.rows.basis[i]));
+                sc.diffs.push_back(std::move(entry.rows.diffs[i]));
+                sc.levels.push_back(entry.rows.levels[i]);
+            }
+        }
+        journal_.pop_back();
+    }
+}
+
+void Staircases1d::CommitNode()
+{
+    size_t size = nodes_journal_size_.back();
+    nodes_journal_size_.pop_back();
+    if (nodes_journal_size_.empty()) {
+        for (size_t i = size; i < journal_.size(); ++i)
+            unsaved_.insert(journal_[i].deg);
+        journal_.erase(journal_.begin() + (std::ptrdiff_t)size, journal_.end());
+    }
+}
+
+Staircases& Staircases1d::WritableBase()
+{
+    if (base_.use_count() > 1) {
+        base_ = std::make_shared<Staircases>(*base_);
+        Reindex();
+    }
+    return *base_;
+}
+
+void Staircases1d::AddToFront(AdamsDeg deg)
+{
+    if (base_->find(deg) != base_->end())
+        return;
+    auto [it, inserted] = WritableBase().try_emplace(deg);
+    const Staircase*& p = Slot(deg);
+    if (!p)
+        p = &it->second;
+}
+
+void Staircases1d::SetFront(Staircases node)
+{
+    base_ = std::make_shared<Staircases>(std::move(node));
+    Reindex();
+}
+
+void Staircases1d::AssignChanges(const Staircases1d& other)
+{
+    std::vector<AdamsDeg> degs;
+    for (auto& [deg, _] : changes_)
+        degs.push_back(deg);
+    changes_ = other.changes_;
+    for (auto& [deg, _] : changes_)
+        degs.push_back(deg);
+    for (AdamsDeg deg : degs)
+        Refresh(deg);
+}
+
+void Staircases1d::AdoptChanges(const Staircases1d& other)
+{
+    AssignChanges(other);
+    unsaved_.insert(other.unsaved_.begin(), other.unsaved_.end());
+}
+
+void Staircases1d::Set(AdamsDeg deg, Staircase sc)
+{
+    Journal(deg, 0);
+    auto [it, inserted] = changes_.insert_or_assign(deg, std::move(sc));
+    if (inserted)
+        Slot(deg) = &it->second;
+}
+
+Staircase& Staircases1d::Modify(AdamsDeg deg, const Staircase& sc_init, size_t first)
+{
+    Journal(deg, first);
+    auto [it, inserted] = changes_.try_emplace(deg, sc_init);
+    if (inserted)
+        Slot(deg) = &it->second;
+    return it->second;
+}
+
+namespace {
+
+/* A row of a staircase with the indices of the basis and the diff packed into bitsets */
+struct BitRow
+{
+    uint64_t x, dx;
+    int level;
+    bool null_dx;
+};
+
+/* Return false if some index is not in [0, 64) */
+bool ToBits(const int1d& v, uint64_t& bits)
+{
+    bits = 0;
+    for (int i : v) {
+        if ((unsigned)i >= 64)
+            return false;
+        bits |= uint64_t(1) << i;
+    }
+    return true;
+}
+
+void FromBits(uint64_t bits, int1d& v)
+{
+    v.clear();
+    for (; bits; bits &= bits - 1)
+        v.push_back(ut::ctz(bits));
+}
+
+bool ToBitRow(const int1d& x, const int1d& dx, int level, BitRow& row)
+{
+    row.level = level;
+    row.null_dx = dx == NULL_DIFF;
+    row.dx = 0;
+    return ToBits(x, row.x) && (row.null_dx || ToBits(dx, row.dx));
+}
+
+/* Reduce `row` by `row_j` if it contains the leading index of `row_j` */
+inline void ReduceBitRow(BitRow& row, const BitRow& row_j)
+{
+    if (row.x & (row_j.x & (~row_j.x + 1))) {
+        row.x ^= row_j.x;
+        if (row.level == row_j.level && !row.null_dx)
+            row.dx ^= row_j.dx;
+    }
+}
+
+/* The sparse implementation of triangularize() */
+void TriangularizeSparse(Staircase& sc, size_t i_insert, int1d x, int1d dx, int level, int1d& image, int& level_image)
+{
+    lina::Workspace& ws = lina::ThreadWorkspace();
 
     size_t i = i_insert;
     while (!x.empty() && i < sc.basis.size()) {
@@ -22,9 +222,9 @@ void triangularize(Staircase& sc, size_t i_insert, int1d x, int1d dx, int level,
         ++i;
         for (size_t j = i_insert; j < i; ++j) {
             if (std::binary_search(x.begin(), x.end(), sc.basis[j][0])) {
-                x = lina::add(x, sc.basis[j]);
+                lina::AddInplace(x, sc.basis[j], ws);
                 if (level == sc.levels[j] && dx != NULL_DIFF)
-                    dx = lina::add(dx, sc.diffs[j]);
+                    lina::AddInplace(dx, sc.diffs[j], ws);
             }
         }
     }
@@ -43,9 +243,9 @@ void triangularize(Staircase& sc, size_t i_insert, int1d x, int1d dx, int level,
     for (; i < sc.basis.size(); ++i) {
         for (size_t j = i_insert; j < i; ++j) {
             if (std::binary_search(sc.basis[i].begin(), sc.basis[i].end(), sc.basis[j][0])) {
-                sc.basis[i] = lina::add(sc.basis[i], sc.basis[j]);
+                lina::AddInplace(sc.basis[i], sc.basis[j], ws);
                 if (sc.levels[i] == sc.levels[j] && sc.diffs[i] != NULL_DIFF)
-                    sc.diffs[i] = lina::add(sc.diffs[i], sc.diffs[j]);
+                    lina::AddInplace(sc.diffs[i], sc.diffs[j], ws);
             }
         }
 #ifndef NDEBUG
@@ -55,6 +255,90 @@ void triangularize(Staircase& sc, size_t i_insert, int1d x, int1d dx, int level,
     }
 }
 
+/* triangularize() with in-place xors of 64-bit rows.
+ * Return false without changing anything if an index is too large for a bitset.
+ * Also return false if a row with a null diff precedes a row with a diff on the same level,
+ * where the sparse implementation is the reference. */
+bool TriangularizeBits(Staircase& sc, size_t i_insert, const int1d& x, const int1d& dx, int level, int1d& image, int& level_image)
+{
+    thread_local std::vector<BitRow> rows;
+    size_t n = sc.basis.size() - i_insert;
+    rows.resize(n);
+    BitRow cur;
+    if (!ToBitRow(x, dx, level, cur))
+        return false;
+    for (size_t k = 0; k < n; ++k) {
+        size_t i = i_insert + k;
+        if (!ToBitRow(sc.basis[i], sc.diffs[i], sc.levels[i], rows[k]))
+            return false;
+        const BitRow& prev = k ? rows[k - 1] : cur;
+        if (prev.null_dx && !rows[k].null_dx && prev.level == rows[k].level)
+            return false;
+    }
+
+    size_t k = 0;
+    while (cur.x && k < n) {
+        std::swap(cur, rows[k]);
+        ++k;
+        for (size_t j = 0; j < k; ++j)
+            ReduceBitRow(cur, rows[j]);
+    }
+    size_t k_changed = k; /* Rows [0, k_changed) are written back */
+    if (cur.x) {
+        rows.push_back(cur);
+        sc.basis.emplace_back();
+        sc.diffs.emplace_back();
+        sc.levels.push_back(0);
+        k_changed = n + 1;
+    }
+    else {
+        if (!cur.null_dx && cur.dx) {
+            FromBits(cur.dx, image);
+            level_image = LEVEL_MAX - cur.level;
+        }
+        /* Triangularize the rest */
+        for (; k < n; ++k) {
+            uint64_t x_k = rows[k].x, dx_k = rows[k].dx;
+            for (size_t j = 0; j < k; ++j)
+                ReduceBitRow(rows[k], rows[j]);
+#ifndef NDEBUG
+            if (!rows[k].x)
+                throw MyException(0xfe35902dU, "BUG: triangularize()");
+#endif
+            if (rows[k].x != x_k || rows[k].dx != dx_k)
+                k_changed = k + 1;
+        }
+    }
+
+    for (k = 0; k < k_changed; ++k) {
+        size_t i = i_insert + k;
+        FromBits(rows[k].x, sc.basis[i]);
+        if (rows[k].null_dx)
+            sc.diffs[i] = NULL_DIFF;
+        else
+            FromBits(rows[k].dx, sc.diffs[i]);
+        sc.levels[i] = rows[k].level;
+    }
+    return true;
+}
+
+}  // namespace
+
+/* Add x, dx, level and triangularize.
+ * Output the image of a differential that should be moved to the next level */
+void triangularize(Staircase& sc, size_t i_insert, int1d x, int1d dx, int level, int1d& image, int& level_image)
+{
+    level_image = -1;
+
+#ifndef NDEBUG
+    if (x.empty())
+        throw MyException(0xfe35902dU, "BUG: triangularize()");
+#endif
+
+    if (!TriangularizeBits(sc, i_insert, x, dx, level, image, level_image))
+        TriangularizeSparse(sc, i_insert, std::move(x), std::move(dx), level, image, level_image);
+}
+
 size_t GetFirstIndexOnLevel(const Staircase& sc, int level)
 {
     return std::lower_bound(sc.levels.begin(), sc.levels.end(), level) - sc.levels.begin();
@@ -105,7 +389,140 @@ bool IsZeroOnLevel(const Staircase& sc, const int1d& x, int level)
  */
 void Diagram::UpdateStaircase(Staircases1d& nodes_ss, AdamsDeg deg, const Staircase& sc_i, size_t i_insert, const int1d& x, const int1d& dx, int level, int1d& image, int& level_image)
 {
-    if (nodes_ss.back().find(deg) == nodes_ss.back().end())
-        nodes_ss.back()[deg] = sc_i;
-    triangularize(nodes_ss.back()[deg], i_insert, x, dx, level, image, level_image);
+    ++version_;
+    triangularize(nodes_ss.Modify(deg, sc_i, i_insert), i_insert, x, dx, level, image, level_image);
+}
+
+namespace {
+
+using TriangularizeFn = void (*)(Staircase&, size_t, int1d, int1d, int, int1d&, int&);
+
+void TriangularizeSparseOnly(Staircase& sc, size_t i_insert, int1d x, int1d dx, int level, int1d& image, int& level_image)
+{
+    level_image = -1;
+    TriangularizeSparse(sc, i_insert, std::move(x), std::move(dx), level, image, level_image);
+}
+
+struct Insertion
+{
+    size_t i_insert;
+    int1d x, dx;
+    int level;
+};
+
+/* The calls of triangularize() that rebuild `sc` by inserting its rows from the last one as SetDiffSc and SetImageSc do */
+std::vector<Insertion> GetInsertions(const Staircase& sc)
+{
+    std::vector<Insertion> result;
+    Staircase sc_new;
+    int1d image;
+    int level_image;
+    for (size_t k = sc.basis.size(); k-- > 0;) {
+        int level = sc.levels[k];
+        size_t i_insert = GetFirstIndexOnLevel(sc_new, sc.diffs[k] == NULL_DIFF ? level + 1 : level);
+        int1d x = lina::Residue(sc_new.basis.begin(), sc_new.basis.begin() + i_insert, sc.basis[k]);
+        if (x.empty())
+            continue;
+        result.push_back({i_insert, x, sc.diffs[k], level});
+        TriangularizeSparseOnly(sc_new, i_insert, std::move(x), sc.diffs[k], level, image, level_image);
+    }
+    return result;
+}
+
+/* Rebuild a staircase from `insertions` and collect the images moved to the next levels */
+void Replay(const std::vector<Insertion>& insertions, TriangularizeFn f, Staircase& sc, std::vector<std::pair<int1d, int>>& images)
+{
+    sc = Staircase();
+    images.clear();
+    int1d image;
+    int level_image;
+    for (auto& ins : insertions) {
+        f(sc, ins.i_insert, ins.x, ins.dx, ins.level, image, level_image);
+        if (level_image != -1)
+            images.push_back({image, level_image});
+    }
+}
+
+bool operator==(const Staircase& sc1, const Staircase& sc2)
+{
+    return sc1.basis == sc2.basis && sc1.diffs == sc2.diffs && sc1.levels == sc2.levels;
+}
+
+}  // namespace
+
+/* Compare the sparse and the bitset triangularize() by rebuilding the staircases of a diagram */
+int main_bench_staircase(int argc, char** argv, int& index, const char* desc)
+{
+    std::string diagram_name;
+    int repeat = 10;
+
+    myio::CmdArg1d args = {{"diagram", &diagram_name}};
+    myio::CmdArg1d op_args = {{"repeat", &repeat}};
+    if (int error = myio::ParseArguments(argc, argv, index, PROGRAM, desc, VERSION, args, op_args))
+        return error;
+    if (repeat < 1) {
+        fmt::print("repeat should be positive\n");
+        return -1;
+    }
+
+    std::unique_ptr<Diagram> holder;
+    Diagram& diagram = OpenDiagram(diagram_name, SSFlag::no_op, holder);
+
+    /* Staircases with at least two rows, split by whether the bitset form applies */
+    std::vector<std::vector<Insertion>> narrow, wide;
+    size_t rows_narrow = 0, rows_wide = 0;
+    auto collect = [&](const Staircases1d& nodes_ss) {
+        for (auto& [deg, _] : nodes_ss.front()) {
+            const Staircase& sc = nodes_ss.GetRecentValue(deg);
+            if (sc.basis.size() < 2)
+                continue;
+            bool is_narrow = true;
+            uint64_t bits;
+            for (size_t i = 0; i < sc.basis.size() && is_narrow; ++i)
+                is_narrow = ToBits(sc.basis[i], bits) && (sc.diffs[i] == NULL_DIFF || ToBits(sc.diffs[i], bits));
+            (is_narrow ? narrow : wide).push_back(GetInsertions(sc));
+            (is_narrow ? rows_narrow : rows_wide) += sc.basis.size();
+        }
+    };
+    for (size_t i = 0; i < diagram.GetRings().size(); ++i)
+        collect(diagram.GetSS(IndexRing(i)));
+    for (size_t i = 0; i < diagram.GetModules().size(); ++i)
+        collect(diagram.GetSS(IndexMod(i)));
+
+    /* Both paths have to rebuild identical staircases with identical images */
+    size_t count_different = 0;
+    for (auto* scs : {&narrow, &wide}) {
+        for (auto& insertions : *scs) {
+            Staircase sc_sparse, sc_bits;
+            std::vector<std::pair<int1d, int>> images_sparse, images_bits;
+            Replay(insertions, TriangularizeSparseOnly, sc_sparse, images_sparse);
+            Replay(insertions, triangularize, sc_bits, images_bits);
+            if (!(sc_sparse == sc_bits) || images_sparse != images_bits)
+                ++count_different;
+        }
+    }
+
+    auto run = [repeat](const std::vector<std::vector<Insertion>>& scs, TriangularizeFn f) {
+        Staircase sc;
+        std::vector<std::pair<int1d, int>> images;
+        bench::Timer timer;
+        timer.SuppressPrint();
+        for (int n = 0; n < repeat; ++n)
+            for (auto& insertions : scs)
+                Replay(insertions, f, sc, images);
+        return timer.Elapsed();
+    };
+    for (auto [name, scs, rows] : {std::tuple{"narrow", &narrow, rows_narrow}, std::tuple{"wide", &wide, rows_wide}}) {
+        if (scs->empty())
+            continue;
+        double t_sparse = run(*scs, TriangularizeSparseOnly);
+        double t_bits = run(*scs, triangularize);
+        fmt::print("{:6} degrees={} rows={} sparse={:.3f}s bits={:.3f}s speedup={:.2f}x\n", name, scs->size(), rows, t_sparse, t_bits, t_sparse / t_bits);
+    }
+    if (count_different) {
+        fmt::print("{} staircases differ between the sparse and the bitset paths\n", count_different);
+        return -1;
+    }
+    fmt::print("The sparse and the bitset paths give identical staircases\n");
+    return 0;
 }
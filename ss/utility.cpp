@@ -20,33 +20,112 @@ int main_mul(int argc, char** argv, int& index, const char* desc)
     x2 = myio::Deserialize<int1d>(str_x2);
 
     SSFlag flag = SSFlag::no_op;
-    Diagram diagram(diagram_name, flag);
+    std::unique_ptr<Diagram> holder;
+    Diagram& diagram = OpenDiagram(diagram_name, flag, holder);
 
     if (auto iCw = diagram.GetIndexCwByName(cw); iCw.isRing) {
         auto& ring = diagram.GetRingByName(cw);
-        if (d3.t > ring.t_max) {
+        if (OutOfRange(d3, ring.t_max, ring.stem_max)) {
             fmt::print("degree out of range");
             return 0;
         }
-        Poly poly_x1 = Indices2Poly(x1, ring.basis.at(d1));
-        Poly poly_x2 = Indices2Poly(x2, ring.basis.at(d2));
-        Poly poly_x3 = ring.gb.Reduce(poly_x1 * poly_x2);
-        int1d x3 = Poly2Indices(poly_x3, ring.basis.at(d3));
+        Poly poly_x1 = Indices2Poly(x1, ring.basis->at(d1));
+        Poly poly_x2 = Indices2Poly(x2, ring.basis->at(d2));
+        Poly poly_x3 = ring.gb->Reduce(poly_x1 * poly_x2);
+        int1d x3 = Poly2Indices(poly_x3, ring.basis->at(d3));
         fmt::print("{} [{}]*[{}]=[{}]\n", d3, myio::Serialize(x1), myio::Serialize(x2), myio::Serialize(x3));
     }
     else {
         auto& mod = diagram.GetModuleByName(cw);
         auto& ring = diagram.GetRings()[mod.iRing];
-        if (d3.t > ring.t_max) {
+        if (OutOfRange(d3, ring.t_max, ring.stem_max)) {
             fmt::print("degree out of range");
             return 0;
         }
-        Poly poly_x1 = Indices2Poly(x1, ring.basis.at(d1));
-        Mod mod_x2 = Indices2Mod(x2, mod.basis.at(d2));
-        Mod mod_x3 = mod.gb.Reduce(poly_x1 * mod_x2);
-        int1d x3 = Mod2Indices(mod_x3, mod.basis.at(d3));
+        Poly poly_x1 = Indices2Poly(x1, ring.basis->at(d1));
+        Mod mod_x2 = Indices2Mod(x2, mod.basis->at(d2));
+        Mod mod_x3 = mod.gb->Reduce(poly_x1 * mod_x2);
+        int1d x3 = Mod2Indices(mod_x3, mod.basis->at(d3));
         fmt::print("{} [{}]*[{}]=[{}]\n", d3, myio::Serialize(x1), myio::Serialize(x2), myio::Serialize(x3));
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+int main_convert_log(int argc, char** argv, int& index, const char* desc)
+{
+    std::string filename;
+    std::string format = "text";
+
+    myio::CmdArg1d args = {{"filename", &filename}};
+    myio::CmdArg1d op_args = {{"format", &format}};
+    if (int error = myio::ParseArguments(argc, argv, index, PROGRAM, desc, VERSION, args, op_args))
+        return error;
+    if (format != "text" && format != "blob") {
+        fmt::print("format should be text or blob\n");
+        return -1;
+    }
+
+    myio::AssertFileExists(filename);
+    DbLog db(filename);
+    db.begin_transaction();
+    int count = db.ConvertIndices(format == "text");
+    db.end_transaction();
+    if (format == "blob")
+        db.execute_cmd("VACUUM");
+    fmt::print("Converted {} rows to {}\n", count, format);
+    return 0;
+}
+
+int main_migrate_db_format(int argc, char** argv, int& index, const char* desc)
+{
+    std::string diagram_name;
+    std::string format = "blob";
+
+    myio::CmdArg1d args = {{"diagram", &diagram_name}};
+    myio::CmdArg1d op_args = {{"format", &format}};
+    if (int error = myio::ParseArguments(argc, argv, index, PROGRAM, desc, VERSION, args, op_args))
+        return error;
+    if (format != "text" && format != "blob") {
+        fmt::print("format should be text or blob\n");
+        return -1;
+    }
+    bool to_text = format == "text";
+
+    auto js = myio::load_json(fmt::format("{}/ss.json", diagram_name));
+    std::set<std::string> paths;
+    for (auto& [key, isRing] : {std::make_pair("rings", true), std::make_pair("modules", false)}) {
+        for (auto& json_cw : js.at(key)) {
+            std::string name = json_cw.at("name").get<std::string>();
+            std::string abs_path = fmt::format("{}/{}", diagram_name, json_cw.at("path").get<std::string>());
+            myio::AssertFileExists(abs_path);
+            DBSS db(abs_path);
+            db.begin_transaction();
+            int count = db.convert_format(fmt::format("{}_AdamsE2", name), isRing, to_text);
+            db.end_transaction();
+            paths.insert(abs_path);
+            fmt::print("{}: converted {} rows to {}\n", name, count, format);
+        }
+    }
+    if (js.contains("cofseqs")) {
+        for (auto& json_cofseq : js.at("cofseqs")) {
+            std::string name = json_cofseq.at("name").get<std::string>();
+            std::string abs_path = fmt::format("{}/{}", diagram_name, json_cofseq.at("path").get<std::string>());
+            if (!myio::FileExists(abs_path))
+                continue;
+            DBSS db(abs_path);
+            std::string table = fmt::format("cofseq_{}", name);
+            if (!db.has_table(table))
+                continue;
+            db.begin_transaction();
+            int count = db.convert_cofseq_format(table, to_text);
+            db.end_transaction();
+            paths.insert(abs_path);
+            fmt::print("cofseq {}: converted {} rows to {}\n", name, count, format);
+        }
+    }
+    if (!to_text)
+        for (auto& path : paths)
+            DBSS(path).execute_cmd("VACUUM");
+    return 0;
+}